@@ -3,6 +3,10 @@
 extern MunitSuite mem_suite;
 extern MunitSuite macro_suite;
 extern MunitSuite ssl_util_suite;
+extern MunitSuite devrule_suite;
+extern MunitSuite workpool_suite;
+extern MunitSuite logstore_suite;
+extern MunitSuite devnode_suite;
 
 int
 main(int argc, char *argv[MUNIT_ARRAY_PARAM(argc + 1)])
@@ -12,6 +16,10 @@ main(int argc, char *argv[MUNIT_ARRAY_PARAM(argc + 1)])
 	failed += munit_suite_main(&mem_suite, NULL, argc, argv);
 	failed += munit_suite_main(&macro_suite, NULL, argc, argv);
 	failed += munit_suite_main(&ssl_util_suite, NULL, argc, argv);
+	failed += munit_suite_main(&devrule_suite, NULL, argc, argv);
+	failed += munit_suite_main(&workpool_suite, NULL, argc, argv);
+	failed += munit_suite_main(&logstore_suite, NULL, argc, argv);
+	failed += munit_suite_main(&devnode_suite, NULL, argc, argv);
 
 	return failed;
 }
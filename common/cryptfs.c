@@ -59,6 +59,13 @@
 #define DM_CRYPT_BUF_SIZE 4096
 #define DM_INTEGRITY_BUF_SIZE 4096
 
+/* parallel writers initializing a new integrity volume, each with its own request in flight */
+#define INTEGRITY_WIPE_WORKERS 4
+#define INTEGRITY_WIPE_CHUNK_SIZE (1024 * 1024)
+#define INTEGRITY_WIPE_ALIGNMENT 4096
+/* granularity in which initialized parts of the volume are tracked */
+#define INTEGRITY_WIPE_REGION_SIZE (64 * 1024 * 1024)
+
 /* FIXME Rejig library to record & use errno instead */
 #ifndef DM_EXISTS_FLAG
 #define DM_EXISTS_FLAG 0x00000004
@@ -494,11 +501,160 @@ errout:
 	return provided_data_sectors;
 }
 
+/*
+ * Returns the number of bytes of a new integrity volume which are written by
+ * integrity_wipe(). fs_size is given in 512 byte sectors, the volume is written
+ * in 4k blocks. The regions tracked in the state file are derived from this size.
+ */
+static off64_t
+integrity_wipe_size(unsigned long fs_size)
+{
+	return (off64_t)(fs_size / 8) * DM_INTEGRITY_BUF_SIZE;
+}
+
+static off64_t
+integrity_wipe_regions(off64_t size)
+{
+	return (size + INTEGRITY_WIPE_REGION_SIZE - 1) / INTEGRITY_WIPE_REGION_SIZE;
+}
+
+/*
+ * Writes zeros to all regions of the device assigned to this worker which are
+ * not yet marked as initialized in the state file and marks them afterwards.
+ * Executed in a forked child, thus it only returns by _exit().
+ */
+static void
+integrity_wipe_worker(const char *blkdev, int state_fd, off64_t size, unsigned int worker)
+{
+	int fd;
+	void *zeros = NULL;
+	off64_t regions = integrity_wipe_regions(size);
+
+	if ((fd = open(blkdev, O_WRONLY | O_DIRECT | O_CLOEXEC)) < 0) {
+		ERROR_ERRNO("Cannot open volume %s", blkdev);
+		_exit(EXIT_FAILURE);
+	}
+	if ((errno = posix_memalign(&zeros, INTEGRITY_WIPE_ALIGNMENT, INTEGRITY_WIPE_CHUNK_SIZE))) {
+		ERROR_ERRNO("Could not allocate wipe buffer");
+		_exit(EXIT_FAILURE);
+	}
+	memset(zeros, 0, INTEGRITY_WIPE_CHUNK_SIZE);
+
+	for (off64_t region = worker; region < regions; region += INTEGRITY_WIPE_WORKERS) {
+		char done = 0;
+		if (state_fd >= 0 && pread(state_fd, &done, 1, region) == 1 && done)
+			continue;
+
+		off64_t end = MIN(size, (region + 1) * INTEGRITY_WIPE_REGION_SIZE);
+		for (off64_t off = region * INTEGRITY_WIPE_REGION_SIZE; off < end;) {
+			size_t len = MIN(end - off, INTEGRITY_WIPE_CHUNK_SIZE);
+			ssize_t written = pwrite(fd, zeros, len, off);
+			if (written < 0 && errno == EINTR)
+				continue;
+			if (written != (ssize_t)len) {
+				ERROR_ERRNO("Could not write empty blocks at %" PRId64 " to %s",
+					    (int64_t)off, blkdev);
+				_exit(EXIT_FAILURE);
+			}
+			off += len;
+		}
+
+		// only mark the region after its MACs are persisted
+		if (fdatasync(fd) < 0) {
+			ERROR_ERRNO("Could not sync %s", blkdev);
+			_exit(EXIT_FAILURE);
+		}
+		if (state_fd >= 0 &&
+		    (pwrite(state_fd, "\1", 1, region) != 1 || fdatasync(state_fd)))
+			WARN_ERRNO("Could not track initialized region %" PRId64, (int64_t)region);
+	}
+
+	free(zeros);
+	close(fd);
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ * Formats the crypto device on top of a new integrity device by writing zeros
+ * to the whole volume, otherwise I/O errors may occur also during write attempts
+ * which are not bound to sector/block size for which no integrity data exist yet.
+ * This is due to the block has to be read first than.
+ *
+ * The MACs are generated by dm-crypt (aead), thus dm-integrity's own recalculation
+ * cannot be used and the volume has to be written completely before its first use.
+ * Several workers write large chunks with O_DIRECT in parallel to keep the device
+ * busy. If state_fd is valid, initialized regions are tracked in it, so that an
+ * interrupted format is resumed instead of leaving uninitialized blocks behind.
+ */
+static int
+integrity_wipe(const char *blkdev, int state_fd, unsigned long fs_size)
+{
+	off64_t size = integrity_wipe_size(fs_size);
+	pid_t workers[INTEGRITY_WIPE_WORKERS];
+	unsigned int started = 0;
+	int ret = 0;
+
+	for (; started < INTEGRITY_WIPE_WORKERS; ++started) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			ERROR_ERRNO("Could not fork wipe worker");
+			ret = -1;
+			break;
+		} else if (pid == 0) {
+			integrity_wipe_worker(blkdev, state_fd, size, started);
+		}
+		workers[started] = pid;
+	}
+
+	for (unsigned int i = 0; i < started; ++i) {
+		int status;
+		if (waitpid(workers[i], &status, 0) < 0 || !WIFEXITED(status) ||
+		    WEXITSTATUS(status) != EXIT_SUCCESS) {
+			ERROR("Wipe worker %d for %s failed", workers[i], blkdev);
+			ret = -1;
+		}
+	}
+	// if a fork failed, the missing regions are written on the next attempt
+	return ret;
+}
+
+/*
+ * Opens the file tracking the initialized regions of a new integrity volume.
+ * A fresh state is created before the integrity superblock is written, thus
+ * a volume with a superblock and a state file has not been initialized completely.
+ */
+static int
+integrity_wipe_state_open(const char *state_file, unsigned long fs_size, bool create)
+{
+	int fd;
+	off64_t regions = integrity_wipe_regions(integrity_wipe_size(fs_size));
+
+	if (!create) {
+		if ((fd = open(state_file, O_RDWR | O_CLOEXEC)) < 0)
+			WARN_ERRNO("Cannot open %s", state_file);
+		return fd;
+	}
+
+	if ((fd = open(state_file, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)) < 0) {
+		ERROR_ERRNO("Cannot create %s", state_file);
+		return -1;
+	}
+	if (ftruncate(fd, regions) < 0 || fsync(fd) < 0) {
+		ERROR_ERRNO("Cannot initialize %s", state_file);
+		close(fd);
+		unlink(state_file);
+		return -1;
+	}
+	return fd;
+}
+
 static char *
 cryptfs_setup_volume_integrity_new(const char *label, const char *real_blkdev,
-				   const char *meta_blkdev, const char *key, unsigned long fs_size)
+				   const char *meta_blkdev, const char *key, unsigned long fs_size,
+				   const char *init_state_file)
 {
 	bool initial_format = false;
+	int state_fd = -1;
 	char *crypto_blkdev = NULL;
 	char *integrity_dev_label = mem_printf("%s-%s", label, "integrity");
 	TRACE("cryptfs_setup_volume_integrity_new");
@@ -506,6 +662,25 @@ cryptfs_setup_volume_integrity_new(const char *label, const char *real_blkdev,
 	/* check if meta device is initialized */
 	initial_format = get_provided_data_sectors(meta_blkdev) != fs_size;
 
+	if (init_state_file && initial_format) {
+		state_fd = integrity_wipe_state_open(init_state_file, fs_size, true);
+	} else if (init_state_file && file_exists(init_state_file)) {
+		INFO("Resuming interrupted initialization of %s", label);
+		initial_format = true;
+		state_fd = integrity_wipe_state_open(init_state_file, fs_size, false);
+		// start over with a fresh state, which is tracked again
+		if (state_fd < 0)
+			state_fd = integrity_wipe_state_open(init_state_file, fs_size, true);
+	}
+	/*
+	 * Without a state file, an interrupted format would not be detected on
+	 * the next start, thus the volume is not formatted untracked.
+	 */
+	if (init_state_file && initial_format && state_fd < 0) {
+		ERROR("Cannot track initialization of %s", label);
+		goto error;
+	}
+
 	if (create_integrity_blk_dev(real_blkdev, meta_blkdev, integrity_dev_label, fs_size) < 0) {
 		DEBUG("create_integrity_blk_dev failed!");
 		goto error;
@@ -515,46 +690,36 @@ cryptfs_setup_volume_integrity_new(const char *label, const char *real_blkdev,
 	mem_free0(integrity_dev_label);
 	if (!integrity_dev) {
 		ERROR("Could not create device node");
-		return NULL;
+		goto error;
 	} else {
 		DEBUG("Successfully created device node");
 	}
 
 	if (create_crypto_blk_dev(integrity_dev, key, label, fs_size, true) < 0) {
 		ERROR("Could not create crypto block device");
-		return NULL;
+		goto error;
 	}
 
 	crypto_blkdev = create_device_node(label);
+	IF_NULL_GOTO_ERROR(crypto_blkdev, error);
 
 	if (initial_format) {
-		/*
-		 * format crypto device, otherwise I/O errors may occur
-		 * also during write attempts which are not bound to
-		 * sector/block size for which no integrity data exist yet.
-		 * This is due to the block has to be read first than.
-		 */
 		DEBUG("Formatting crypto blkdev %s. Generating initial MAC on "
 		      "integrity_dev %s",
 		      crypto_blkdev, integrity_dev);
-		int fd;
-		if ((fd = open(crypto_blkdev, O_WRONLY | O_DIRECT)) < 0) {
-			ERROR("Cannot open volume %s", crypto_blkdev);
+		if (integrity_wipe(crypto_blkdev, state_fd, fs_size) < 0) {
+			ERROR("Cannot format volume %s", crypto_blkdev);
 			goto error;
 		}
-		char zeros[DM_INTEGRITY_BUF_SIZE] __attribute__((__aligned__(512)));
-		for (unsigned long i = 0; i < fs_size / 8; ++i) {
-			if (write(fd, zeros, DM_INTEGRITY_BUF_SIZE) < DM_INTEGRITY_BUF_SIZE) {
-				ERROR_ERRNO("Could not write empty block %lu to %s", i,
-					    crypto_blkdev);
-				close(fd);
-				goto error;
-			}
-		}
-		close(fd);
+		if (init_state_file && unlink(init_state_file) < 0)
+			WARN_ERRNO("Could not remove %s", init_state_file);
 	}
+	if (state_fd >= 0)
+		close(state_fd);
 	return crypto_blkdev;
 error:
+	if (state_fd >= 0)
+		close(state_fd);
 	mem_free0(integrity_dev_label);
 	mem_free0(crypto_blkdev);
 	return NULL;
@@ -562,7 +727,7 @@ error:
 
 char *
 cryptfs_setup_volume_new(const char *label, const char *real_blkdev, const char *key,
-			 const char *meta_blkdev)
+			 const char *meta_blkdev, const char *init_state_file)
 {
 	int fd;
 	// The file system size in sectors
@@ -590,7 +755,7 @@ cryptfs_setup_volume_new(const char *label, const char *real_blkdev, const char
 
 	if (meta_blkdev)
 		return cryptfs_setup_volume_integrity_new(label, real_blkdev, meta_blkdev, key,
-							  fs_size);
+							  fs_size, init_state_file);
 
 	// do dmcrypt device setup only
 
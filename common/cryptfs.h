@@ -52,11 +52,13 @@ cryptfs_get_device_path_new(const char *label);
  * @param real_blk_dev The name of the loop device
  * @param ascii_key The key for the volume
  * @param meta_blk_dev The meta loop device
+ * @param init_state_file File tracking the initialization of a new integrity
+ *	  protected volume, so that an interrupted initialization is resumed (may be NULL)
  * @return char* The path of the newly created volume
  */
 char *
 cryptfs_setup_volume_new(const char *label, const char *real_blk_dev, const char *ascii_key,
-			 const char *meta_blk_dev);
+			 const char *meta_blk_dev, const char *init_state_file);
 
 /**
  * Close a device-mapper volume
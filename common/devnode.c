@@ -0,0 +1,329 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+//#define LOGF_LOG_MIN_PRIO LOGF_PRIO_TRACE
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "devnode.h"
+
+#include "macro.h"
+#include "mem.h"
+#include "dir.h"
+#include "file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+typedef struct devnode_entry {
+	char *name; // relative to the snapshot root
+	mode_t mode;
+	dev_t rdev;
+	uid_t uid;
+	gid_t gid;
+	ino_t ino;
+	char *link;	       // link target for symlinks
+	struct timespec ctime; // changes with the content, mode or ownership
+} devnode_entry_t;
+
+struct devnode_snapshot {
+	char *root;
+	struct timespec root_mtime;
+	devnode_entry_t *entries;
+	unsigned int count;
+	unsigned int size;
+};
+
+struct devnode_scan_data {
+	devnode_snapshot_t *snap;
+	const char *prefix; // relative path of the currently scanned dir
+	int ret;
+};
+
+static devnode_entry_t *
+devnode_snapshot_add_entry(devnode_snapshot_t *snap)
+{
+	if (snap->count == snap->size) {
+		snap->size = snap->size ? 2 * snap->size : 64;
+		snap->entries = mem_renew(devnode_entry_t, snap->entries, snap->size);
+	}
+	devnode_entry_t *entry = &snap->entries[snap->count++];
+	mem_memset0(entry, sizeof(devnode_entry_t));
+	return entry;
+}
+
+static int
+devnode_snapshot_scan_cb(const char *path, const char *file, void *data)
+{
+	struct devnode_scan_data *scan = data;
+	ASSERT(scan);
+
+	struct stat s;
+	char *file_src = mem_printf("%s/%s", path, file);
+
+	// filter out mount points, to avoid copying private stuff, e.g, /dev/pts
+	if (file_is_mountpoint(file_src)) {
+		TRACE("filter mountpoint '%s'", file_src);
+		goto out;
+	}
+
+	if (lstat(file_src, &s) < 0) {
+		// node may have vanished in the meantime
+		TRACE_ERRNO("Could not stat %s", file_src);
+		goto out;
+	}
+
+	switch (s.st_mode & S_IFMT) {
+	case S_IFBLK:
+	case S_IFCHR:
+	case S_IFLNK:
+	case S_IFDIR:
+	case S_IFREG:
+		break;
+	default:
+		TRACE("Skip FIFO, SOCK %s", file_src);
+		goto out;
+	}
+
+	devnode_entry_t *entry = devnode_snapshot_add_entry(scan->snap);
+	entry->name = scan->prefix ? mem_printf("%s/%s", scan->prefix, file) : mem_strdup(file);
+	entry->mode = s.st_mode;
+	entry->rdev = s.st_rdev;
+	entry->uid = s.st_uid;
+	entry->gid = s.st_gid;
+	entry->ino = s.st_ino;
+	entry->ctime = s.st_ctim;
+
+	if (S_ISLNK(s.st_mode)) {
+		entry->link = mem_alloc0(s.st_size + 1);
+		ssize_t len = readlink(file_src, entry->link, s.st_size + 1);
+		if (len < 0 || len > s.st_size) {
+			ERROR_ERRNO("Failed to read link %s", file_src);
+			scan->ret = -1;
+			goto out;
+		}
+		entry->link[len] = '\0';
+	} else if (S_ISDIR(s.st_mode)) {
+		// entry pointer may be invalidated by mem_renew during recursion
+		char *prefix = mem_strdup(entry->name);
+		struct devnode_scan_data sub = { .snap = scan->snap, .prefix = prefix, .ret = 0 };
+		if (dir_foreach(file_src, &devnode_snapshot_scan_cb, &sub) < 0 || sub.ret < 0) {
+			ERROR("Could not snapshot dir %s", file_src);
+			scan->ret = -1;
+		}
+		mem_free0(prefix);
+	}
+out:
+	mem_free0(file_src);
+	return 0;
+}
+
+devnode_snapshot_t *
+devnode_snapshot_new(const char *path)
+{
+	ASSERT(path);
+
+	struct stat s;
+	if (stat(path, &s) < 0) {
+		ERROR_ERRNO("Could not stat %s", path);
+		return NULL;
+	}
+
+	devnode_snapshot_t *snap = mem_new0(devnode_snapshot_t, 1);
+	snap->root = mem_strdup(path);
+	snap->root_mtime = s.st_mtim;
+
+	struct devnode_scan_data scan = { .snap = snap, .prefix = NULL, .ret = 0 };
+	if (dir_foreach(path, &devnode_snapshot_scan_cb, &scan) < 0 || scan.ret < 0) {
+		ERROR("Could not take snapshot of %s", path);
+		devnode_snapshot_free(snap);
+		return NULL;
+	}
+
+	DEBUG("Took snapshot of %s with %u entries", path, snap->count);
+	return snap;
+}
+
+void
+devnode_snapshot_free(devnode_snapshot_t *snap)
+{
+	IF_NULL_RETURN(snap);
+
+	for (unsigned int i = 0; i < snap->count; ++i) {
+		mem_free0(snap->entries[i].name);
+		if (snap->entries[i].link)
+			mem_free0(snap->entries[i].link);
+	}
+	if (snap->entries)
+		mem_free0(snap->entries);
+	mem_free0(snap->root);
+	mem_free0(snap);
+}
+
+static bool
+devnode_timespec_equals(const struct timespec *a, const struct timespec *b)
+{
+	return a->tv_sec == b->tv_sec && a->tv_nsec == b->tv_nsec;
+}
+
+bool
+devnode_snapshot_is_stale(const devnode_snapshot_t *snap)
+{
+	ASSERT(snap);
+
+	struct stat s;
+	IF_TRUE_RETVAL(stat(snap->root, &s) < 0, true);
+	IF_FALSE_RETVAL(devnode_timespec_equals(&s.st_mtim, &snap->root_mtime), true);
+
+	int dirfd = open(snap->root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	IF_TRUE_RETVAL(dirfd < 0, true);
+
+	/*
+	 * chmod or chown of an entry only changes its own ctime, and an entry
+	 * replaced in place is a new inode, thus check every entry and not only
+	 * the directories.
+	 */
+	bool stale = false;
+	for (unsigned int i = 0; i < snap->count && !stale; ++i) {
+		const devnode_entry_t *entry = &snap->entries[i];
+		if (fstatat(dirfd, entry->name, &s, AT_SYMLINK_NOFOLLOW) < 0 ||
+		    s.st_ino != entry->ino || s.st_mode != entry->mode || s.st_uid != entry->uid ||
+		    s.st_gid != entry->gid || s.st_rdev != entry->rdev ||
+		    !devnode_timespec_equals(&s.st_ctim, &entry->ctime))
+			stale = true;
+	}
+	close(dirfd);
+
+	if (stale)
+		TRACE("Snapshot of %s is stale", snap->root);
+
+	return stale;
+}
+
+unsigned int
+devnode_snapshot_get_count(const devnode_snapshot_t *snap)
+{
+	ASSERT(snap);
+	return snap->count;
+}
+
+static int
+devnode_entry_create_at(const devnode_snapshot_t *snap, const devnode_entry_t *entry, int dirfd,
+			const char *target)
+{
+	int ret = 0;
+
+	switch (entry->mode & S_IFMT) {
+	case S_IFBLK:
+	case S_IFCHR:
+		TRACE("Creating device node %s/%s", target, entry->name);
+		ret = mknodat(dirfd, entry->name, entry->mode, entry->rdev);
+		break;
+	case S_IFLNK:
+		TRACE("Creating link %s/%s -> %s", target, entry->name, entry->link);
+		ret = symlinkat(entry->link, dirfd, entry->name);
+		break;
+	case S_IFDIR:
+		TRACE("Creating dir %s/%s", target, entry->name);
+		ret = mkdirat(dirfd, entry->name, entry->mode & ~S_IFMT);
+		break;
+	case S_IFREG: {
+		char *file_src = mem_printf("%s/%s", snap->root, entry->name);
+		char *file_dst = mem_printf("%s/%s", target, entry->name);
+		TRACE("Copying reg file %s -> %s", file_src, file_dst);
+		ret = file_copy(file_src, file_dst, -1, 512, 0);
+		if (!ret && fchmodat(dirfd, entry->name, entry->mode & ~S_IFMT, 0) < 0)
+			WARN_ERRNO("Could not preserve mode for file_dst %s", file_dst);
+		mem_free0(file_src);
+		mem_free0(file_dst);
+	} break;
+	default:
+		return 0;
+	}
+
+	if (ret < 0) {
+		// tolerate nodes which were already created, e.g., by uevent handling
+		if (errno == EEXIST)
+			return 0;
+		ERROR_ERRNO("Could not create %s/%s", target, entry->name);
+		return -1;
+	}
+
+	if (fchownat(dirfd, entry->name, entry->uid, entry->gid, AT_SYMLINK_NOFOLLOW) < 0) {
+		ERROR_ERRNO("Could not chown '%s/%s' to (%d:%d)", target, entry->name, entry->uid,
+			    entry->gid);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+devnode_snapshot_populate(const devnode_snapshot_t *snap, const char *target,
+			  devnode_filter_t filter, void *data)
+{
+	ASSERT(snap);
+	ASSERT(target);
+
+	int dirfd = open(target, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirfd < 0) {
+		ERROR_ERRNO("Could not open target dir %s", target);
+		return -1;
+	}
+
+	int ret = 0;
+	unsigned int created = 0;
+	mode_t old_mask = umask(0);
+
+	// entries are stored in pre-order, thus parent dirs are always created first
+	for (unsigned int i = 0; i < snap->count; ++i) {
+		const devnode_entry_t *entry = &snap->entries[i];
+
+		if (filter && (S_ISCHR(entry->mode) || S_ISBLK(entry->mode))) {
+			char type = S_ISBLK(entry->mode) ? 'b' : 'c';
+			if (!filter(type, major(entry->rdev), minor(entry->rdev), data)) {
+				TRACE("filter device %s (%c %d:%d)", entry->name, type,
+				      major(entry->rdev), minor(entry->rdev));
+				continue;
+			}
+		}
+
+		if (devnode_entry_create_at(snap, entry, dirfd, target) < 0)
+			ret = -1;
+		else
+			created++;
+	}
+
+	umask(old_mask);
+	close(dirfd);
+
+	DEBUG("Populated %s with %u of %u entries from %s", target, created, snap->count,
+	      snap->root);
+	return ret;
+}
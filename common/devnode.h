@@ -0,0 +1,100 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+/**
+ * @file devnode.h
+ *
+ * In-memory snapshot of a device directory (usually the host's /dev).
+ * The snapshot is taken once, without descending into mount points, and can
+ * then be used to populate any number of target directories (e.g. a
+ * container's tmpfs /dev) in a single pass of *at() syscalls relative to the
+ * target's directory fd, without stat()ing the source tree again.
+ */
+
+#ifndef DEVNODE_H
+#define DEVNODE_H
+
+#include <stdbool.h>
+
+typedef struct devnode_snapshot devnode_snapshot_t;
+
+/**
+ * Filter callback used during population.
+ * @param type 'c' for character devices, 'b' for block devices
+ * @param major The major number of the device
+ * @param minor The minor number of the device
+ * @param data The data object given to devnode_snapshot_populate()
+ * @return true if the device node should be created in the target
+ */
+typedef bool (*devnode_filter_t)(char type, int major, int minor, void *data);
+
+/**
+ * Take a snapshot of all device nodes, symlinks, regular files and
+ * directories below path. Mount points (e.g. /dev/pts) are skipped.
+ *
+ * @param path The directory to snapshot, e.g. "/dev"
+ * @return The new snapshot or NULL on error
+ */
+devnode_snapshot_t *
+devnode_snapshot_new(const char *path);
+
+/**
+ * Free a snapshot created by devnode_snapshot_new().
+ */
+void
+devnode_snapshot_free(devnode_snapshot_t *snap);
+
+/**
+ * Check if the snapshot still reflects the source tree. This only stats the
+ * entries recorded in the snapshot, so it is cheap compared to taking a new
+ * snapshot. Device nodes appearing or vanishing change the mtime of their
+ * parent directory, changed modes, owners or replaced nodes are detected by
+ * comparing the metadata and ctime of each entry.
+ *
+ * @return true if any recorded directory has changed since the snapshot
+ */
+bool
+devnode_snapshot_is_stale(const devnode_snapshot_t *snap);
+
+/**
+ * Returns the number of entries recorded in the snapshot.
+ */
+unsigned int
+devnode_snapshot_get_count(const devnode_snapshot_t *snap);
+
+/**
+ * Populate the directory target from the snapshot. Device nodes are created
+ * with mknodat() relative to an fd of target, ownership and mode are taken
+ * from the snapshot. Existing entries in target are left untouched.
+ *
+ * @param snap The snapshot to create the nodes from
+ * @param target The (existing) target directory
+ * @param filter Optional callback to decide which device nodes are created
+ * @param data A data object given to the filter callback
+ * @return 0 on success, -1 if any entry could not be created
+ */
+int
+devnode_snapshot_populate(const devnode_snapshot_t *snap, const char *target,
+			  devnode_filter_t filter, void *data);
+
+#endif /* DEVNODE_H */
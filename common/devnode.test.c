@@ -0,0 +1,261 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+#include "munit.h"
+
+#include "logf.h"
+#include "macro.h"
+#include "mem.h"
+#include "dir.h"
+#include "file.h"
+#include "devnode.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+typedef struct test_state {
+	char src[64];
+	char dst[64];
+	devnode_snapshot_t *snap;
+} test_state_t;
+
+static void
+test_delete_dir(const char *path)
+{
+	char *dir = mem_strdup(path);
+	char *slash = strrchr(dir, '/');
+	*slash = '\0';
+	dir_delete_folder(dir, slash + 1);
+	mem_free0(dir);
+}
+
+/*
+ * Creates a small device tree in the source dir: a regular file, a symlink
+ * and a sub directory with another file. Device nodes are only created if
+ * the test runs as root.
+ */
+static void *
+setup(UNUSED const MunitParameter params[], UNUSED void *data)
+{
+	logf_register(&logf_test_write, stderr);
+
+	test_state_t *state = mem_new0(test_state_t, 1);
+	strcpy(state->src, "/tmp/devnode_src_XXXXXX");
+	strcpy(state->dst, "/tmp/devnode_dst_XXXXXX");
+	munit_assert_not_null(mkdtemp(state->src));
+	munit_assert_not_null(mkdtemp(state->dst));
+
+	char *path = mem_printf("%s/file", state->src);
+	munit_assert_int(file_printf(path, "content"), >=, 0);
+	munit_assert_int(chmod(path, 0640), ==, 0);
+	mem_free0(path);
+
+	path = mem_printf("%s/link", state->src);
+	munit_assert_int(symlink("file", path), ==, 0);
+	mem_free0(path);
+
+	path = mem_printf("%s/sub", state->src);
+	munit_assert_int(mkdir(path, 0750), ==, 0);
+	mem_free0(path);
+
+	path = mem_printf("%s/sub/file", state->src);
+	munit_assert_int(file_printf(path, "sub content"), >=, 0);
+	mem_free0(path);
+
+	if (geteuid() == 0) {
+		path = mem_printf("%s/null", state->src);
+		munit_assert_int(mknod(path, S_IFCHR | 0666, makedev(1, 3)), ==, 0);
+		mem_free0(path);
+	}
+
+	state->snap = devnode_snapshot_new(state->src);
+	munit_assert_not_null(state->snap);
+	return state;
+}
+
+static void
+tear_down(void *fixture)
+{
+	test_state_t *state = fixture;
+
+	devnode_snapshot_free(state->snap);
+	test_delete_dir(state->src);
+	test_delete_dir(state->dst);
+	mem_free0(state);
+}
+
+static MunitResult
+test_devnode_snapshot(UNUSED const MunitParameter params[], void *data)
+{
+	test_state_t *state = data;
+
+	munit_assert_uint(devnode_snapshot_get_count(state->snap), ==, geteuid() == 0 ? 5 : 4);
+	munit_assert_false(devnode_snapshot_is_stale(state->snap));
+
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_devnode_stale_new_entry(UNUSED const MunitParameter params[], void *data)
+{
+	test_state_t *state = data;
+
+	// new entries change the mtime of their parent directory
+	char *path = mem_printf("%s/sub/new", state->src);
+	munit_assert_int(file_printf(path, "new"), >=, 0);
+	mem_free0(path);
+
+	munit_assert_true(devnode_snapshot_is_stale(state->snap));
+
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_devnode_stale_chmod(UNUSED const MunitParameter params[], void *data)
+{
+	test_state_t *state = data;
+
+	// the parent directory is not changed by a chmod
+	char *path = mem_printf("%s/sub/file", state->src);
+	munit_assert_int(chmod(path, 0600), ==, 0);
+	mem_free0(path);
+
+	munit_assert_true(devnode_snapshot_is_stale(state->snap));
+
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_devnode_stale_chown(UNUSED const MunitParameter params[], void *data)
+{
+	test_state_t *state = data;
+
+	if (geteuid() != 0)
+		return MUNIT_SKIP;
+
+	char *path = mem_printf("%s/null", state->src);
+	munit_assert_int(lchown(path, 0, 5), ==, 0);
+	mem_free0(path);
+
+	munit_assert_true(devnode_snapshot_is_stale(state->snap));
+
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_devnode_populate(UNUSED const MunitParameter params[], void *data)
+{
+	test_state_t *state = data;
+
+	munit_assert_int(devnode_snapshot_populate(state->snap, state->dst, NULL, NULL), ==, 0);
+
+	struct stat s;
+	char *path = mem_printf("%s/file", state->dst);
+	munit_assert_int(lstat(path, &s), ==, 0);
+	munit_assert_true(S_ISREG(s.st_mode));
+	munit_assert_int(s.st_mode & 07777, ==, 0640);
+	mem_free0(path);
+
+	path = mem_printf("%s/sub/file", state->dst);
+	char *content = file_read_new(path, 64);
+	munit_assert_string_equal(content, "sub content");
+	mem_free0(content);
+	mem_free0(path);
+
+	path = mem_printf("%s/sub", state->dst);
+	munit_assert_int(lstat(path, &s), ==, 0);
+	munit_assert_int(s.st_mode & 07777, ==, 0750);
+	mem_free0(path);
+
+	char link[16] = { 0 };
+	path = mem_printf("%s/link", state->dst);
+	munit_assert_int(readlink(path, link, sizeof(link) - 1), ==, 4);
+	munit_assert_string_equal(link, "file");
+	mem_free0(path);
+
+	// populating again keeps the existing entries
+	munit_assert_int(devnode_snapshot_populate(state->snap, state->dst, NULL, NULL), ==, 0);
+
+	return MUNIT_OK;
+}
+
+static bool
+test_filter_none(UNUSED char type, UNUSED int major, UNUSED int minor, void *data)
+{
+	int *calls = data;
+	(*calls)++;
+	return false;
+}
+
+static MunitResult
+test_devnode_populate_filter(UNUSED const MunitParameter params[], void *data)
+{
+	test_state_t *state = data;
+
+	if (geteuid() != 0)
+		return MUNIT_SKIP;
+
+	int calls = 0;
+	munit_assert_int(devnode_snapshot_populate(state->snap, state->dst, test_filter_none,
+						   &calls),
+			 ==, 0);
+	munit_assert_int(calls, ==, 1);
+
+	// the device node is filtered, the other entries are created
+	char *path = mem_printf("%s/null", state->dst);
+	munit_assert_false(file_exists(path));
+	mem_free0(path);
+	path = mem_printf("%s/file", state->dst);
+	munit_assert_true(file_exists(path));
+	mem_free0(path);
+
+	return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+	{ "/snapshot", test_devnode_snapshot, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+	{ "/stale new entry", test_devnode_stale_new_entry, setup, tear_down,
+	  MUNIT_TEST_OPTION_NONE, NULL },
+	{ "/stale chmod", test_devnode_stale_chmod, setup, tear_down, MUNIT_TEST_OPTION_NONE,
+	  NULL },
+	{ "/stale chown", test_devnode_stale_chown, setup, tear_down, MUNIT_TEST_OPTION_NONE,
+	  NULL },
+	{ "/populate", test_devnode_populate, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+	{ "/populate filter", test_devnode_populate_filter, setup, tear_down,
+	  MUNIT_TEST_OPTION_NONE, NULL },
+
+	// Mark the end of the array with an entry where the test function is NULL
+	{ NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+MunitSuite devnode_suite = {
+	"/devnode",		/* name */
+	tests,			/* tests */
+	NULL,			/* suites */
+	1,			/* iterations */
+	MUNIT_SUITE_OPTION_NONE /* options */
+};
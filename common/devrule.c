@@ -0,0 +1,175 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+#include "devrule.h"
+
+#include "macro.h"
+#include "mem.h"
+
+#include <stdint.h>
+
+// initial number of slots, must be a power of two
+#define DEVRULE_INDEX_INITIAL_SIZE 64
+
+typedef struct devrule_slot {
+	bool used;
+	char type;
+	int major;
+	int minor;
+} devrule_slot_t;
+
+struct devrule_index {
+	devrule_slot_t *slots;
+	unsigned int size; // always a power of two
+	unsigned int count;
+};
+
+static uint32_t
+devrule_hash(char type, int major, int minor)
+{
+	// FNV-1a over the three components
+	uint32_t h = 2166136261u;
+	const uint32_t vals[3] = { (uint32_t)(unsigned char)type, (uint32_t)major,
+				   (uint32_t)minor };
+	for (int i = 0; i < 3; ++i) {
+		for (int b = 0; b < 4; ++b) {
+			h ^= (vals[i] >> (8 * b)) & 0xff;
+			h *= 16777619u;
+		}
+	}
+	return h;
+}
+
+static devrule_slot_t *
+devrule_index_lookup_slot(const devrule_index_t *index, char type, int major, int minor)
+{
+	unsigned int mask = index->size - 1;
+	unsigned int i = devrule_hash(type, major, minor) & mask;
+
+	// linear probing, the table is never full (load factor <= 1/2)
+	while (index->slots[i].used) {
+		devrule_slot_t *slot = &index->slots[i];
+		if (slot->type == type && slot->major == major && slot->minor == minor)
+			return slot;
+		i = (i + 1) & mask;
+	}
+	return &index->slots[i];
+}
+
+static void
+devrule_index_grow(devrule_index_t *index)
+{
+	devrule_slot_t *old_slots = index->slots;
+	unsigned int old_size = index->size;
+
+	index->size = old_size * 2;
+	index->slots = mem_new0(devrule_slot_t, index->size);
+
+	for (unsigned int i = 0; i < old_size; ++i) {
+		if (!old_slots[i].used)
+			continue;
+		devrule_slot_t *slot = devrule_index_lookup_slot(
+			index, old_slots[i].type, old_slots[i].major, old_slots[i].minor);
+		*slot = old_slots[i];
+	}
+	mem_free0(old_slots);
+}
+
+devrule_index_t *
+devrule_index_new(void)
+{
+	devrule_index_t *index = mem_new0(devrule_index_t, 1);
+	index->size = DEVRULE_INDEX_INITIAL_SIZE;
+	index->slots = mem_new0(devrule_slot_t, index->size);
+	return index;
+}
+
+void
+devrule_index_free(devrule_index_t *index)
+{
+	IF_NULL_RETURN(index);
+
+	mem_free0(index->slots);
+	mem_free0(index);
+}
+
+int
+devrule_index_add(devrule_index_t *index, char type, int major, int minor)
+{
+	ASSERT(index);
+
+	IF_TRUE_RETVAL_TRACE(type != 'a' && type != 'b' && type != 'c', -1);
+	IF_TRUE_RETVAL_TRACE(major < DEVRULE_WILDCARD || minor < DEVRULE_WILDCARD, -1);
+
+	if (2 * (index->count + 1) > index->size)
+		devrule_index_grow(index);
+
+	devrule_slot_t *slot = devrule_index_lookup_slot(index, type, major, minor);
+	if (slot->used)
+		return 0;
+
+	slot->used = true;
+	slot->type = type;
+	slot->major = major;
+	slot->minor = minor;
+	index->count++;
+
+	return 0;
+}
+
+static bool
+devrule_index_contains(const devrule_index_t *index, char type, int major, int minor)
+{
+	return devrule_index_lookup_slot(index, type, major, minor)->used;
+}
+
+bool
+devrule_index_match(const devrule_index_t *index, char type, int major, int minor)
+{
+	ASSERT(index);
+
+	IF_TRUE_RETVAL(type != 'b' && type != 'c', false);
+	IF_TRUE_RETVAL(major < 0 || minor < 0, false);
+
+	const char types[] = { type, 'a' };
+	const int majors[] = { major, DEVRULE_WILDCARD };
+	const int minors[] = { minor, DEVRULE_WILDCARD };
+
+	// at most 8 lookups for exact and all wildcard combinations
+	for (int t = 0; t < 2; ++t) {
+		for (int ma = 0; ma < 2; ++ma) {
+			for (int mi = 0; mi < 2; ++mi) {
+				if (devrule_index_contains(index, types[t], majors[ma], minors[mi]))
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+unsigned int
+devrule_index_get_count(const devrule_index_t *index)
+{
+	ASSERT(index);
+	return index->count;
+}
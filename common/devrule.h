@@ -0,0 +1,87 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+/**
+ * @file devrule.h
+ *
+ * Compiled index of device rules (type, major, minor) as used by the devices
+ * controller of cgroups, e.g. "c 136:* rwm". Exact rules and wildcard rules
+ * are stored in one hash table, thus checking whether a concrete device is
+ * matched by any rule takes a constant number of lookups, independent of the
+ * number of rules in the index.
+ *
+ * The semantic of a match corresponds to the kernel's device controller:
+ * type 'a' matches block and char devices and a major or minor of -1 ('*')
+ * matches any major or minor number.
+ */
+
+#ifndef DEVRULE_H
+#define DEVRULE_H
+
+#include <stdbool.h>
+
+#define DEVRULE_WILDCARD -1
+
+typedef struct devrule_index devrule_index_t;
+
+/**
+ * Create a new empty rule index.
+ */
+devrule_index_t *
+devrule_index_new(void);
+
+/**
+ * Free a rule index and all of its entries.
+ */
+void
+devrule_index_free(devrule_index_t *index);
+
+/**
+ * Add a rule to the index. Adding the same rule multiple times is allowed.
+ *
+ * @param type 'a', 'b' or 'c'
+ * @param major The major number or DEVRULE_WILDCARD
+ * @param minor The minor number or DEVRULE_WILDCARD
+ * @return 0 on success, -1 if the rule is invalid
+ */
+int
+devrule_index_add(devrule_index_t *index, char type, int major, int minor);
+
+/**
+ * Check if a concrete device is matched by any rule in the index.
+ *
+ * @param type 'b' or 'c'
+ * @param major The major number of the device
+ * @param minor The minor number of the device
+ * @return true if at least one rule matches the device
+ */
+bool
+devrule_index_match(const devrule_index_t *index, char type, int major, int minor);
+
+/**
+ * Returns the number of distinct rules stored in the index.
+ */
+unsigned int
+devrule_index_get_count(const devrule_index_t *index);
+
+#endif /* DEVRULE_H */
@@ -0,0 +1,148 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+#include "munit.h"
+
+#include "logf.h"
+#include "macro.h"
+#include "devrule.h"
+
+static void *
+setup(UNUSED const MunitParameter params[], UNUSED void *data)
+{
+	logf_register(&logf_test_write, stderr);
+	return devrule_index_new();
+}
+
+static void
+tear_down(void *fixture)
+{
+	devrule_index_free(fixture);
+}
+
+static MunitResult
+test_devrule_exact(UNUSED const MunitParameter params[], void *data)
+{
+	devrule_index_t *index = data;
+
+	munit_assert_int(devrule_index_add(index, 'c', 1, 3), ==, 0);
+	munit_assert_int(devrule_index_add(index, 'b', 7, 0), ==, 0);
+
+	munit_assert_true(devrule_index_match(index, 'c', 1, 3));
+	munit_assert_true(devrule_index_match(index, 'b', 7, 0));
+
+	// type has to match
+	munit_assert_false(devrule_index_match(index, 'b', 1, 3));
+	munit_assert_false(devrule_index_match(index, 'c', 7, 0));
+
+	// no implicit wildcards
+	munit_assert_false(devrule_index_match(index, 'c', 1, 5));
+	munit_assert_false(devrule_index_match(index, 'b', 7, 1));
+
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_devrule_wildcards(UNUSED const MunitParameter params[], void *data)
+{
+	devrule_index_t *index = data;
+
+	munit_assert_int(devrule_index_add(index, 'c', 136, DEVRULE_WILDCARD), ==, 0);
+	munit_assert_true(devrule_index_match(index, 'c', 136, 0));
+	munit_assert_true(devrule_index_match(index, 'c', 136, 4711));
+	munit_assert_false(devrule_index_match(index, 'b', 136, 0));
+	munit_assert_false(devrule_index_match(index, 'c', 137, 0));
+
+	munit_assert_int(devrule_index_add(index, 'b', DEVRULE_WILDCARD, 2), ==, 0);
+	munit_assert_true(devrule_index_match(index, 'b', 8, 2));
+	munit_assert_false(devrule_index_match(index, 'b', 8, 3));
+
+	munit_assert_int(devrule_index_add(index, 'a', 189, DEVRULE_WILDCARD), ==, 0);
+	munit_assert_true(devrule_index_match(index, 'b', 189, 1));
+	munit_assert_true(devrule_index_match(index, 'c', 189, 1));
+
+	munit_assert_false(devrule_index_match(index, 'c', 1, 1));
+	munit_assert_int(devrule_index_add(index, 'a', DEVRULE_WILDCARD, DEVRULE_WILDCARD), ==, 0);
+	munit_assert_true(devrule_index_match(index, 'c', 1, 1));
+
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_devrule_invalid(UNUSED const MunitParameter params[], void *data)
+{
+	devrule_index_t *index = data;
+
+	munit_assert_int(devrule_index_add(index, 'x', 1, 3), ==, -1);
+	munit_assert_int(devrule_index_add(index, 'c', -2, 3), ==, -1);
+	munit_assert_int(devrule_index_get_count(index), ==, 0);
+
+	munit_assert_int(devrule_index_add(index, 'a', DEVRULE_WILDCARD, DEVRULE_WILDCARD), ==, 0);
+
+	// queries must be concrete devices
+	munit_assert_false(devrule_index_match(index, 'a', 1, 3));
+	munit_assert_false(devrule_index_match(index, 'c', -1, 3));
+	munit_assert_false(devrule_index_match(index, 'c', 1, -1));
+
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_devrule_many_rules(UNUSED const MunitParameter params[], void *data)
+{
+	devrule_index_t *index = data;
+
+	// forces the table to grow several times
+	for (int i = 0; i < 1000; ++i) {
+		munit_assert_int(devrule_index_add(index, 'c', i, i), ==, 0);
+		// duplicates are only stored once
+		munit_assert_int(devrule_index_add(index, 'c', i, i), ==, 0);
+	}
+	munit_assert_int(devrule_index_get_count(index), ==, 1000);
+
+	for (int i = 0; i < 1000; ++i) {
+		munit_assert_true(devrule_index_match(index, 'c', i, i));
+		munit_assert_false(devrule_index_match(index, 'c', i, i + 1));
+		munit_assert_false(devrule_index_match(index, 'b', i, i));
+	}
+
+	return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+	{ "/exact", test_devrule_exact, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+	{ "/wildcards", test_devrule_wildcards, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+	{ "/invalid", test_devrule_invalid, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+	{ "/many rules", test_devrule_many_rules, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+
+	// Mark the end of the array with an entry where the test function is NULL
+	{ NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+MunitSuite devrule_suite = {
+	"/devrule",		/* name */
+	tests,			/* tests */
+	NULL,			/* suites */
+	1,			/* iterations */
+	MUNIT_SUITE_OPTION_NONE /* options */
+};
@@ -225,4 +225,22 @@ dm_get_target_type_new(int fd, const char *name)
 	tgt = (struct dm_target_spec *)&buf[sizeof(struct dm_ioctl)];
 
 	return mem_strdup(tgt->target_type);
-}
\ No newline at end of file
+}
+
+int
+dm_get_open_count(int fd, const char *name)
+{
+	ASSERT(strlen(name) <= DM_NAME_LEN);
+
+	uint8_t buf[16384] = { 0 };
+	struct dm_ioctl *dmi = (struct dm_ioctl *)buf;
+
+	dm_ioctl_init(dmi, INDEX_DM_DEV_STATUS, sizeof(buf), name, NULL, DM_EXISTS_FLAG, 0, 0, 0);
+	int ret = dm_ioctl(fd, cmd_table[INDEX_DM_DEV_STATUS].cmd, dmi);
+	if (ret) {
+		TRACE_ERRNO("DM_DEV_STATUS ioctl for %s returned %d", name, ret);
+		return -1;
+	}
+
+	return dmi->open_count;
+}
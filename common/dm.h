@@ -169,4 +169,15 @@ dm_list_versions(int fd);
 char *
 dm_get_target_type_new(int fd, const char *name);
 
+/**
+ * Get the number of openers of a dm-device, e.g., mounts of its filesystem
+ *
+ * @param fd The /dev/mapper/control file descripter (can be retrieved
+ * 				via dm_open_control)
+ * @param name The name of the dm-device
+ * @return int The open count or -1 if the device does not exist
+ */
+int
+dm_get_open_count(int fd, const char *name);
+
 #endif // DM_H
\ No newline at end of file
@@ -0,0 +1,803 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+//#define LOGF_LOG_MIN_PRIO LOGF_PRIO_TRACE
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "logstore.h"
+
+#include "macro.h"
+#include "mem.h"
+#include "list.h"
+#include "dir.h"
+#include "fd.h"
+#include "file.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/*
+ * A new index entry is written if the second changed and at least
+ * LOGSTORE_INDEX_BLOCK_MIN bytes were written since the last entry, or if
+ * LOGSTORE_INDEX_BLOCK_MAX bytes were written independent of the time.
+ */
+#define LOGSTORE_INDEX_BLOCK_MIN (4 * 1024)
+#define LOGSTORE_INDEX_BLOCK_MAX (64 * 1024)
+
+#define LOGSTORE_COPY_BUF_SIZE 4096
+
+#define LOGSTORE_SUFFIX_LOG ".log"
+#define LOGSTORE_SUFFIX_GZ ".log.gz"
+#define LOGSTORE_SUFFIX_IDX ".idx"
+
+typedef struct logstore_segment {
+	unsigned int seq;
+	bool compressed;
+} logstore_segment_t;
+
+struct logstore {
+	char *dir;
+	char *name;
+	size_t segment_size;
+	unsigned int segment_age;
+	size_t budget;
+
+	pid_t owner; // only the creating process rotates and compresses
+	bool busy;   // guards against log messages from within the store
+
+	list_t *segments; // in ascending order, the last one is the current segment
+	logstore_segment_t *current;
+	FILE *log;
+	FILE *idx;
+	time_t created;
+	time_t last_time; // time of the last record in the current segment
+	off_t size;
+	off_t index_offset; // offset of the last index entry
+	time_t index_time;  // time of the last index entry
+	bool index_empty;
+
+	list_t *compress_queue;
+	logstore_segment_t *compressing;
+	pid_t compress_pid;
+};
+
+/*
+ * The pid of this process, cached to avoid a getpid() syscall for each record.
+ * It is refreshed in children created by fork(). Children created by clone()
+ * keep the pid of their parent, thus owner only operations check the real pid.
+ */
+static pid_t logstore_pid = 0;
+
+static void
+logstore_atfork_child(void)
+{
+	logstore_pid = getpid();
+}
+
+static bool
+logstore_is_owner(const logstore_t *store)
+{
+	return logstore_pid == store->owner && getpid() == store->owner;
+}
+
+static char *
+logstore_segment_path(const logstore_t *store, const logstore_segment_t *seg, const char *suffix)
+{
+	return mem_printf("%s/%s.%06u%s", store->dir, store->name, seg->seq, suffix);
+}
+
+static size_t
+logstore_segment_get_usage(const logstore_t *store, const logstore_segment_t *seg)
+{
+	const char *suffixes[] = { LOGSTORE_SUFFIX_LOG, LOGSTORE_SUFFIX_GZ, LOGSTORE_SUFFIX_IDX };
+	size_t usage = 0;
+
+	// during compression, both the plain and the compressed segment exist
+	for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); ++i) {
+		char *path = logstore_segment_path(store, seg, suffixes[i]);
+		off_t size = file_size(path);
+		if (size > 0)
+			usage += size;
+		mem_free0(path);
+	}
+	return usage;
+}
+
+static void
+logstore_segment_delete(logstore_t *store, logstore_segment_t *seg)
+{
+	const char *suffixes[] = { LOGSTORE_SUFFIX_LOG, LOGSTORE_SUFFIX_GZ, LOGSTORE_SUFFIX_IDX };
+
+	for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); ++i) {
+		char *path = logstore_segment_path(store, seg, suffixes[i]);
+		if (unlink(path) < 0 && errno != ENOENT)
+			WARN_ERRNO("Could not remove log segment file %s", path);
+		mem_free0(path);
+	}
+
+	store->compress_queue = list_remove(store->compress_queue, seg);
+	store->segments = list_remove(store->segments, seg);
+	mem_free0(seg);
+}
+
+static void
+logstore_enforce_budget(logstore_t *store)
+{
+	size_t usage = logstore_get_disk_usage(store);
+
+	for (list_t *l = store->segments; l && usage > store->budget;) {
+		logstore_segment_t *seg = l->data;
+		l = l->next;
+
+		if (seg == store->current || seg == store->compressing)
+			continue;
+
+		size_t seg_usage = logstore_segment_get_usage(store, seg);
+		DEBUG("Removing log segment %s.%06u to meet disk budget", store->name, seg->seq);
+		logstore_segment_delete(store, seg);
+		usage -= MIN(usage, seg_usage);
+	}
+}
+
+static void
+logstore_compress_start(logstore_t *store)
+{
+	IF_TRUE_RETURN(store->compress_pid > 0);
+
+	while (store->compress_queue) {
+		logstore_segment_t *seg = store->compress_queue->data;
+		store->compress_queue = list_unlink(store->compress_queue, store->compress_queue);
+
+		char *path = logstore_segment_path(store, seg, LOGSTORE_SUFFIX_LOG);
+		pid_t pid = fork();
+		if (pid == 0) {
+			const char *const argv[] = { "gzip", "-n", "-f", path, NULL };
+			execvp(argv[0], (char *const *)argv);
+			_exit(EXIT_FAILURE);
+		}
+		mem_free0(path);
+
+		if (pid < 0) {
+			WARN_ERRNO("Could not fork compression of log segment %u", seg->seq);
+			continue;
+		}
+
+		TRACE("Compressing log segment %u in child %d", seg->seq, pid);
+		store->compress_pid = pid;
+		store->compressing = seg;
+		return;
+	}
+}
+
+/*
+ * Reaps the compression child if it has finished, or waits for it if wait is
+ * set, and starts compressing the next queued segment.
+ */
+static void
+logstore_compress_reap(logstore_t *store, bool wait)
+{
+	while (store->compress_pid > 0) {
+		pid_t pid = waitpid(store->compress_pid, NULL, wait ? 0 : WNOHANG);
+		if (pid == 0)
+			return;
+		if (pid < 0 && errno == EINTR)
+			continue;
+
+		// the child may also have been reaped by someone else, thus check the result
+		logstore_segment_t *seg = store->compressing;
+		char *log_path = logstore_segment_path(store, seg, LOGSTORE_SUFFIX_LOG);
+		char *gz_path = logstore_segment_path(store, seg, LOGSTORE_SUFFIX_GZ);
+		seg->compressed = !file_exists(log_path) && file_exists(gz_path);
+		if (!seg->compressed)
+			WARN("Could not compress log segment %s", log_path);
+		mem_free0(log_path);
+		mem_free0(gz_path);
+
+		store->compress_pid = -1;
+		store->compressing = NULL;
+
+		logstore_enforce_budget(store);
+		logstore_compress_start(store);
+
+		if (!wait)
+			return;
+	}
+}
+
+static int
+logstore_segment_open(logstore_t *store)
+{
+	logstore_segment_t *seg = mem_new0(logstore_segment_t, 1);
+	list_t *tail = list_tail(store->segments);
+	seg->seq = tail ? ((logstore_segment_t *)tail->data)->seq + 1 : 0;
+
+	char *log_path = logstore_segment_path(store, seg, LOGSTORE_SUFFIX_LOG);
+	char *idx_path = logstore_segment_path(store, seg, LOGSTORE_SUFFIX_IDX);
+
+	store->log = fopen(log_path, "ae");
+	if (!store->log) {
+		ERROR_ERRNO("Could not open log segment %s", log_path);
+		goto error;
+	}
+	store->idx = fopen(idx_path, "ae");
+	if (!store->idx) {
+		ERROR_ERRNO("Could not open log index %s", idx_path);
+		fclose(store->log);
+		store->log = NULL;
+		goto error;
+	}
+	mem_free0(log_path);
+	mem_free0(idx_path);
+
+	store->segments = list_append(store->segments, seg);
+	store->current = seg;
+	store->created = time(NULL);
+	store->last_time = store->created;
+	store->size = 0;
+	store->index_offset = 0;
+	store->index_time = 0;
+	store->index_empty = true;
+
+	return 0;
+error:
+	mem_free0(log_path);
+	mem_free0(idx_path);
+	mem_free0(seg);
+	return -1;
+}
+
+static void
+logstore_segment_close(logstore_t *store)
+{
+	IF_NULL_RETURN(store->current);
+
+	// the end marker holds the time of the last record and the final size
+	if (!store->index_empty)
+		fprintf(store->idx, "%lld %lld end\n", (long long)store->last_time,
+			(long long)store->size);
+	fclose(store->idx);
+	fclose(store->log);
+	store->idx = NULL;
+	store->log = NULL;
+
+	logstore_segment_t *seg = store->current;
+	store->current = NULL;
+
+	if (store->index_empty)
+		logstore_segment_delete(store, seg);
+	else
+		store->compress_queue = list_append(store->compress_queue, seg);
+}
+
+static int
+logstore_rotate_internal(logstore_t *store)
+{
+	logstore_segment_close(store);
+	int ret = logstore_segment_open(store);
+
+	logstore_enforce_budget(store);
+	logstore_compress_start(store);
+
+	return ret;
+}
+
+static int
+logstore_scan_cb(UNUSED const char *path, const char *file, void *data)
+{
+	logstore_t *store = data;
+	size_t name_len = strlen(store->name);
+
+	IF_TRUE_RETVAL(strncmp(file, store->name, name_len) || file[name_len] != '.', 0);
+
+	const char *seq_str = file + name_len + 1;
+	char *end = NULL;
+	errno = 0;
+	unsigned long seq = strtoul(seq_str, &end, 10);
+	IF_TRUE_RETVAL(errno || end == seq_str || seq > UINT_MAX, 0);
+
+	bool compressed = !strcmp(end, LOGSTORE_SUFFIX_GZ);
+	IF_TRUE_RETVAL(!compressed && strcmp(end, LOGSTORE_SUFFIX_LOG) &&
+			       strcmp(end, LOGSTORE_SUFFIX_IDX),
+		       0);
+
+	logstore_segment_t *seg = NULL;
+	for (list_t *l = store->segments; l; l = l->next) {
+		logstore_segment_t *s = l->data;
+		if (s->seq == seq) {
+			seg = s;
+			break;
+		}
+	}
+	if (!seg) {
+		seg = mem_new0(logstore_segment_t, 1);
+		seg->seq = seq;
+		store->segments = list_append(store->segments, seg);
+	}
+	seg->compressed |= compressed;
+
+	return 1;
+}
+
+/*
+ * Collects the segments of a previous run in ascending order. Plain segments
+ * were not compressed before, e.g. on a crash, and are queued for compression.
+ */
+static int
+logstore_scan(logstore_t *store)
+{
+	IF_TRUE_RETVAL(dir_foreach(store->dir, logstore_scan_cb, store) < 0, -1);
+
+	list_t *sorted = NULL;
+	while (store->segments) {
+		list_t *min = store->segments;
+		for (list_t *l = store->segments->next; l; l = l->next) {
+			if (((logstore_segment_t *)l->data)->seq <
+			    ((logstore_segment_t *)min->data)->seq)
+				min = l;
+		}
+		logstore_segment_t *seg = min->data;
+		store->segments = list_unlink(store->segments, min);
+		sorted = list_append(sorted, seg);
+
+		char *log_path = logstore_segment_path(store, seg, LOGSTORE_SUFFIX_LOG);
+		if (file_exists(log_path)) {
+			seg->compressed = false;
+			store->compress_queue = list_append(store->compress_queue, seg);
+		}
+		mem_free0(log_path);
+	}
+	store->segments = sorted;
+
+	DEBUG("Found %u log segments of %s in %s", list_length(store->segments), store->name,
+	      store->dir);
+	return 0;
+}
+
+logstore_t *
+logstore_new(const char *dir, const char *name, size_t segment_size, unsigned int segment_age,
+	     size_t budget)
+{
+	IF_NULL_RETVAL_ERROR(dir, NULL);
+	IF_NULL_RETVAL_ERROR(name, NULL);
+	IF_TRUE_RETVAL_ERROR(segment_size == 0 || budget < segment_size, NULL);
+
+	IF_TRUE_RETVAL(dir_mkdir_p(dir, 0755) < 0, NULL);
+
+	logstore_t *store = mem_new0(logstore_t, 1);
+	store->dir = mem_strdup(dir);
+	store->name = mem_strdup(name);
+	store->segment_size = segment_size;
+	store->segment_age = segment_age;
+	store->budget = budget;
+	store->compress_pid = -1;
+
+	if (!logstore_pid) {
+		logstore_pid = getpid();
+		if (pthread_atfork(NULL, NULL, logstore_atfork_child))
+			WARN("Could not register fork handler for log stores");
+	}
+	store->owner = getpid();
+
+	if (logstore_scan(store) < 0) {
+		ERROR("Could not scan log directory %s", dir);
+		goto error;
+	}
+	if (logstore_segment_open(store) < 0)
+		goto error;
+
+	logstore_enforce_budget(store);
+	logstore_compress_start(store);
+
+	return store;
+error:
+	logstore_free(store);
+	return NULL;
+}
+
+logstore_t *
+logstore_open_readonly(const char *dir, const char *name)
+{
+	IF_NULL_RETVAL_ERROR(dir, NULL);
+	IF_NULL_RETVAL_ERROR(name, NULL);
+
+	logstore_t *store = mem_new0(logstore_t, 1);
+	store->dir = mem_strdup(dir);
+	store->name = mem_strdup(name);
+	store->owner = -1;
+	store->compress_pid = -1;
+
+	if (logstore_scan(store) < 0) {
+		ERROR("Could not scan log directory %s", dir);
+		logstore_free(store);
+		return NULL;
+	}
+	// plain segments are compressed by the owner of the store only
+	list_delete(store->compress_queue);
+	store->compress_queue = NULL;
+
+	return store;
+}
+
+char *
+logstore_get_name_new(const char *file)
+{
+	IF_NULL_RETVAL(file, NULL);
+
+	const char *suffixes[] = { LOGSTORE_SUFFIX_GZ, LOGSTORE_SUFFIX_LOG, LOGSTORE_SUFFIX_IDX };
+	size_t len = strlen(file);
+	const char *end = NULL;
+
+	for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]) && !end; ++i) {
+		size_t suffix_len = strlen(suffixes[i]);
+		if (len > suffix_len && !strcmp(file + len - suffix_len, suffixes[i]))
+			end = file + len - suffix_len;
+	}
+	IF_NULL_RETVAL(end, NULL);
+
+	// '<name>.<seq>' with a non-empty name and sequence number
+	const char *seq = end;
+	while (seq > file && isdigit((unsigned char)seq[-1]))
+		seq--;
+	IF_TRUE_RETVAL(seq == end || seq < file + 2 || seq[-1] != '.', NULL);
+
+	return mem_strndup(file, seq - 1 - file);
+}
+
+void
+logstore_free(logstore_t *store)
+{
+	IF_NULL_RETURN(store);
+
+	store->busy = true;
+
+	logstore_segment_close(store);
+	if (store->compress_pid > 0) {
+		// do not start any further compression, it is continued on the next run
+		list_delete(store->compress_queue);
+		store->compress_queue = NULL;
+		logstore_compress_reap(store, true);
+	}
+
+	for (list_t *l = store->segments; l; l = l->next)
+		mem_free0(l->data);
+	list_delete(store->segments);
+	list_delete(store->compress_queue);
+	mem_free0(store->dir);
+	mem_free0(store->name);
+	mem_free0(store);
+}
+
+void
+logstore_write(logf_prio_t prio, const char *msg, void *data)
+{
+	logstore_t *store = data;
+
+	if (!store || store->busy)
+		return;
+
+	store->busy = true;
+
+	// forked children only append to the segment of their parent
+	if (logstore_pid != store->owner)
+		goto append;
+
+	if (store->compress_pid > 0 && logstore_is_owner(store))
+		logstore_compress_reap(store, false);
+
+	// a segment which could not be opened on rotation is retried here
+	time_t now = time(NULL);
+	if (!store->log || (size_t)store->size >= store->segment_size ||
+	    (store->segment_age && now - store->created >= (time_t)store->segment_age)) {
+		if (!logstore_is_owner(store))
+			goto append;
+		if (logstore_rotate_internal(store) < 0)
+			goto out;
+	}
+
+	off_t block = store->size - store->index_offset;
+	if (store->index_empty || (now != store->index_time && block >= LOGSTORE_INDEX_BLOCK_MIN) ||
+	    block >= LOGSTORE_INDEX_BLOCK_MAX) {
+		fprintf(store->idx, "%lld %lld\n", (long long)now, (long long)store->size);
+		fflush(store->idx);
+		store->index_offset = store->size;
+		store->index_time = now;
+		store->index_empty = false;
+	}
+
+	logf_file_write(prio, msg, store->log);
+
+	// the segment is opened for appending, thus this includes writes of children
+	off_t pos = ftello(store->log);
+	if (pos >= 0)
+		store->size = pos;
+	store->last_time = now;
+	goto out;
+append:
+	if (store->log)
+		logf_file_write(prio, msg, store->log);
+out:
+	store->busy = false;
+}
+
+int
+logstore_rotate(logstore_t *store)
+{
+	ASSERT(store);
+
+	store->busy = true;
+	int ret = logstore_rotate_internal(store);
+	store->busy = false;
+
+	return ret;
+}
+
+/*
+ * Passes the bytes in [start, end) of the uncompressed segment to func in
+ * chunks. For a compressed segment, the output of 'gzip -dc' is read up to end.
+ */
+static ssize_t
+logstore_segment_copy(const logstore_t *store, const logstore_segment_t *seg, off_t start,
+		      off_t end, int (*func)(const char *buf, size_t len, void *data), void *data)
+{
+	char buf[LOGSTORE_COPY_BUF_SIZE];
+	ssize_t written = 0;
+	off_t pos = 0;
+	int in = -1;
+	pid_t pid = -1;
+
+	char *path = logstore_segment_path(store, seg, LOGSTORE_SUFFIX_LOG);
+	// the segment of a read-only store may have been compressed by its owner meanwhile
+	bool compressed = seg->compressed || !file_exists(path);
+	if (compressed) {
+		mem_free0(path);
+		path = logstore_segment_path(store, seg, LOGSTORE_SUFFIX_GZ);
+	}
+
+	if (compressed) {
+		int fds[2];
+		if (pipe2(fds, O_CLOEXEC) < 0) {
+			ERROR_ERRNO("Could not create pipe for decompression");
+			goto error;
+		}
+		pid = fork();
+		if (pid == 0) {
+			if (dup2(fds[1], STDOUT_FILENO) < 0)
+				_exit(EXIT_FAILURE);
+			const char *const argv[] = { "gzip", "-dc", path, NULL };
+			execvp(argv[0], (char *const *)argv);
+			_exit(EXIT_FAILURE);
+		}
+		close(fds[1]);
+		in = fds[0];
+		if (pid < 0) {
+			ERROR_ERRNO("Could not fork decompression of %s", path);
+			goto error;
+		}
+	} else {
+		in = open(path, O_RDONLY | O_CLOEXEC);
+		if (in < 0) {
+			ERROR_ERRNO("Could not open log segment %s", path);
+			goto error;
+		}
+		if (lseek(in, start, SEEK_SET) < 0) {
+			ERROR_ERRNO("Could not seek in log segment %s", path);
+			goto error;
+		}
+		pos = start;
+	}
+
+	while (end < 0 || pos < end) {
+		size_t len = sizeof(buf);
+		if (end >= 0)
+			len = MIN(len, (size_t)(end - pos));
+
+		ssize_t n = read(in, buf, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0) {
+			ERROR_ERRNO("Could not read log segment %s", path);
+			goto error;
+		}
+		if (n == 0)
+			break;
+
+		// skip the decompressed bytes before start
+		off_t skip = MIN(n, MAX(start - pos, 0));
+		pos += n;
+		if (n == skip)
+			continue;
+
+		if (func(buf + skip, n - skip, data) < 0) {
+			ERROR("Could not pass on log records of %s", path);
+			goto error;
+		}
+		written += n - skip;
+	}
+
+	close(in);
+	if (pid > 0) {
+		// terminates gzip by SIGPIPE if not all of its output was read
+		while (waitpid(pid, NULL, 0) < 0 && errno == EINTR)
+			;
+	}
+	mem_free0(path);
+	return written;
+error:
+	if (in >= 0)
+		close(in);
+	if (pid > 0) {
+		kill(pid, SIGKILL);
+		while (waitpid(pid, NULL, 0) < 0 && errno == EINTR)
+			;
+	}
+	mem_free0(path);
+	return -1;
+}
+
+/*
+ * Looks up the range of a segment which may contain records in [from, to]
+ * in its index. Returns false if the segment does not contain any of them.
+ */
+static bool
+logstore_segment_lookup(const logstore_t *store, const logstore_segment_t *seg, time_t from,
+			time_t to, off_t *start, off_t *end)
+{
+	char *path = logstore_segment_path(store, seg, LOGSTORE_SUFFIX_IDX);
+	FILE *idx = fopen(path, "re");
+	mem_free0(path);
+	IF_NULL_RETVAL(idx, false);
+
+	bool empty = true, ended = false;
+	time_t first = 0, last = 0;
+	char line[64];
+
+	*start = 0;
+	*end = -1;
+
+	while (fgets(line, sizeof(line), idx)) {
+		long long t, offset;
+		char tag[4] = "";
+		int n = sscanf(line, "%lld %lld %3s", &t, &offset, tag);
+		if (n < 2)
+			continue;
+
+		if (empty)
+			first = t;
+		empty = false;
+		last = t;
+		ended = n == 3 && !strcmp(tag, "end");
+
+		// records of a block are between the time of its entry and of the next one
+		if (t < from)
+			*start = offset;
+		if (t > to && *end < 0)
+			*end = offset;
+	}
+	fclose(idx);
+
+	// the current segment has no end marker yet
+	if (seg == store->current) {
+		ended = true;
+		last = store->last_time;
+	}
+
+	IF_TRUE_RETVAL(empty || first > to || (ended && last < from), false);
+	IF_TRUE_RETVAL(*end >= 0 && *end <= *start, false);
+
+	return true;
+}
+
+ssize_t
+logstore_read_range_foreach(logstore_t *store, time_t from, time_t to,
+			    int (*func)(const char *buf, size_t len, void *data), void *data)
+{
+	ASSERT(store);
+	IF_TRUE_RETVAL(from > to, 0);
+
+	ssize_t written = 0;
+	store->busy = true;
+
+	// gzip removes the plain segment when it is done, thus finish compression first
+	logstore_compress_reap(store, true);
+	if (store->log)
+		fflush(store->log);
+
+	for (list_t *l = store->segments; l; l = l->next) {
+		logstore_segment_t *seg = l->data;
+		off_t start, end;
+
+		if (!logstore_segment_lookup(store, seg, from, to, &start, &end))
+			continue;
+
+		TRACE("Reading log segment %u from %lld to %lld", seg->seq, (long long)start,
+		      (long long)end);
+		ssize_t n = logstore_segment_copy(store, seg, start, end, func, data);
+		if (n < 0) {
+			written = -1;
+			break;
+		}
+		written += n;
+	}
+
+	store->busy = false;
+	return written;
+}
+
+static int
+logstore_write_fd_cb(const char *buf, size_t len, void *data)
+{
+	int *fd = data;
+
+	if (fd_write(*fd, buf, len) < 0) {
+		ERROR_ERRNO("Could not write log records");
+		return -1;
+	}
+	return 0;
+}
+
+ssize_t
+logstore_read_range(logstore_t *store, time_t from, time_t to, int fd)
+{
+	return logstore_read_range_foreach(store, from, to, &logstore_write_fd_cb, &fd);
+}
+
+size_t
+logstore_get_disk_usage(const logstore_t *store)
+{
+	ASSERT(store);
+
+	size_t usage = 0;
+	for (const list_t *l = store->segments; l; l = l->next)
+		usage += logstore_segment_get_usage(store, l->data);
+	return usage;
+}
+
+unsigned int
+logstore_get_segment_count(const logstore_t *store)
+{
+	ASSERT(store);
+	return list_length(store->segments);
+}
+
+void
+logstore_flush(logstore_t *store)
+{
+	ASSERT(store);
+
+	store->busy = true;
+	logstore_compress_start(store);
+	logstore_compress_reap(store, true);
+	store->busy = false;
+}
@@ -0,0 +1,156 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+/**
+ * @file logstore.h
+ *
+ * Size bounded store for the log of a service. The log is written to numbered
+ * segments '<dir>/<name>.<seq>.log' in the format of logf_file_write. A segment
+ * is closed as soon as it exceeds a maximum size or age and a new one is
+ * started. Closed segments are compressed with gzip by a fork()ed child in the
+ * background to '<name>.<seq>.log.gz'. If the store exceeds its disk budget,
+ * the oldest segments are deleted.
+ *
+ * For each segment, a small text index '<name>.<seq>.idx' maps timestamps to
+ * offsets in the uncompressed segment, so that a query for a time range only
+ * reads the segments and blocks which may contain matching records.
+ *
+ * Only the process which created the store rotates and compresses segments.
+ * Forked children which still have the writer registered only append to the
+ * current segment.
+ */
+
+#ifndef LOGSTORE_H
+#define LOGSTORE_H
+
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "logf.h"
+
+// defaults for the logs of the services in LOGFILE_DIR
+#define LOGSTORE_SEGMENT_SIZE_DEFAULT (4 * 1024 * 1024)
+#define LOGSTORE_SEGMENT_AGE_DEFAULT (24 * 60 * 60)
+#define LOGSTORE_BUDGET_DEFAULT (64 * 1024 * 1024)
+
+typedef struct logstore logstore_t;
+
+/**
+ * Opens a log store and starts a new segment. Uncompressed segments left over
+ * from a previous run are queued for compression.
+ *
+ * @param dir The directory of the segments, created if it does not exist.
+ * @param name The name prefix of the segments, e.g. "cml-daemon".
+ * @param segment_size Size in bytes after which a segment is closed.
+ * @param segment_age Age in seconds after which a segment is closed, 0 for none.
+ * @param budget Maximum disk usage in bytes of all segments and their indexes.
+ * @return The new store or NULL on error.
+ */
+logstore_t *
+logstore_new(const char *dir, const char *name, size_t segment_size, unsigned int segment_age,
+	     size_t budget);
+
+/**
+ * Opens the store of another process or of a previous run for reading its
+ * records by logstore_read_range(). The store is neither written, rotated
+ * nor compressed and has to be freed by logstore_free().
+ *
+ * @param dir The directory of the segments.
+ * @param name The name prefix of the segments, e.g. "cml-scd".
+ * @return The store or NULL on error.
+ */
+logstore_t *
+logstore_open_readonly(const char *dir, const char *name);
+
+/**
+ * Returns the name of the store a file in the log directory belongs to, i.e.,
+ * the prefix of a segment or index file '<name>.<seq>.log[.gz]' or '<name>.<seq>.idx'.
+ *
+ * @return The newly allocated name or NULL if the file is not part of a store.
+ */
+char *
+logstore_get_name_new(const char *file);
+
+/**
+ * Closes the current segment and frees the store. Waits for a running
+ * compression to finish, queued compressions are continued by the next run.
+ * The writer has to be unregistered before.
+ */
+void
+logstore_free(logstore_t *store);
+
+/**
+ * Log writer for logf_register() with a logstore_t as data.
+ */
+void
+logstore_write(logf_prio_t prio, const char *msg, void *data);
+
+/**
+ * Closes the current segment independent of its size and age and starts a new one.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int
+logstore_rotate(logstore_t *store);
+
+/**
+ * Writes the log records in the time range [from, to] to fd in chronological
+ * order. Records are selected by the index at block granularity, thus some
+ * records just outside of the range may be included as well.
+ *
+ * @return The number of bytes written or -1 on error.
+ */
+ssize_t
+logstore_read_range(logstore_t *store, time_t from, time_t to, int fd);
+
+/**
+ * Like logstore_read_range(), but passes the log records in chunks of a few
+ * KB to func instead of writing them to a file, so that they do not have to
+ * be copied as a whole. Reading stops if func returns a value < 0.
+ *
+ * @return The number of bytes passed to func or -1 on error.
+ */
+ssize_t
+logstore_read_range_foreach(logstore_t *store, time_t from, time_t to,
+			    int (*func)(const char *buf, size_t len, void *data), void *data);
+
+/**
+ * Returns the current disk usage of all segments and their indexes in bytes.
+ */
+size_t
+logstore_get_disk_usage(const logstore_t *store);
+
+/**
+ * Returns the number of segments in the store including the current one.
+ */
+unsigned int
+logstore_get_segment_count(const logstore_t *store);
+
+/**
+ * Waits until all closed segments are compressed. Mainly useful for tests.
+ */
+void
+logstore_flush(logstore_t *store);
+
+#endif /* LOGSTORE_H */
@@ -0,0 +1,370 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+#include "munit.h"
+
+#include "logf.h"
+#include "macro.h"
+#include "mem.h"
+#include "dir.h"
+#include "file.h"
+#include "str.h"
+#include "logstore.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_SEGMENT_SIZE (16 * 1024)
+#define TEST_BUDGET (64 * 1024)
+#define TEST_LINE_LEN 200
+
+typedef struct test_state {
+	char dir[64];
+	logstore_t *store;
+} test_state_t;
+
+static void *
+setup(UNUSED const MunitParameter params[], UNUSED void *data)
+{
+	logf_register(&logf_test_write, stderr);
+
+	test_state_t *state = mem_new0(test_state_t, 1);
+	strcpy(state->dir, "/tmp/logstore_test_XXXXXX");
+	munit_assert_not_null(mkdtemp(state->dir));
+	return state;
+}
+
+static void
+tear_down(void *fixture)
+{
+	test_state_t *state = fixture;
+
+	logstore_free(state->store);
+	char *dir = mem_strdup(state->dir);
+	char *slash = strrchr(dir, '/');
+	*slash = '\0';
+	dir_delete_folder(dir, slash + 1);
+	mem_free0(dir);
+	mem_free0(state);
+}
+
+/*
+ * Writes records with pseudo random payload, so that compressed segments
+ * still take up a considerable part of the budget.
+ */
+static void
+test_write_lines(logstore_t *store, const char *tag, int count)
+{
+	static unsigned int seed = 4711;
+	char line[TEST_LINE_LEN];
+
+	for (int i = 0; i < count; ++i) {
+		int len = snprintf(line, sizeof(line), "%s %06d ", tag, i);
+		for (; len < TEST_LINE_LEN / 2; ++len) {
+			seed = seed * 1103515245 + 12345;
+			line[len] = 'a' + (seed >> 16) % 26;
+		}
+		line[len] = '\0';
+		logstore_write(LOGF_PRIO_INFO, line, store);
+	}
+}
+
+static int
+test_count_cb(UNUSED const char *path, const char *file, void *data)
+{
+	const char *suffix = data;
+	size_t len = strlen(file);
+	return len > strlen(suffix) && !strcmp(file + len - strlen(suffix), suffix);
+}
+
+static char *
+test_read_range(logstore_t *store, time_t from, time_t to)
+{
+	char *path = mem_strdup("/tmp/logstore_read_XXXXXX");
+	int fd = mkstemp(path);
+	munit_assert_int(fd, >=, 0);
+
+	ssize_t len = logstore_read_range(store, from, to, fd);
+	munit_assert_int(len, >=, 0);
+	close(fd);
+
+	char *buf = file_read_new(path, len + 1);
+	munit_assert_not_null(buf);
+	munit_assert_size(strlen(buf), ==, len);
+	unlink(path);
+	mem_free0(path);
+	return buf;
+}
+
+static MunitResult
+test_logstore_rotate_size(UNUSED const MunitParameter params[], void *data)
+{
+	test_state_t *state = data;
+
+	state->store = logstore_new(state->dir, "test", TEST_SEGMENT_SIZE, 0, TEST_BUDGET);
+	munit_assert_not_null(state->store);
+	munit_assert_uint(logstore_get_segment_count(state->store), ==, 1);
+
+	// more than twice the segment size
+	test_write_lines(state->store, "rotate", 250);
+	unsigned int count = logstore_get_segment_count(state->store);
+	munit_assert_uint(count, >=, 3);
+
+	// all but the current segment are compressed
+	logstore_flush(state->store);
+	munit_assert_int(dir_foreach(state->dir, test_count_cb, ".log.gz"), ==, count - 1);
+	munit_assert_int(dir_foreach(state->dir, test_count_cb, ".log"), ==, 1);
+	munit_assert_int(dir_foreach(state->dir, test_count_cb, ".idx"), ==, count);
+
+	// compressed segments are decompressed transparently
+	char *buf = test_read_range(state->store, 0, time(NULL) + 1);
+	munit_assert_not_null(strstr(buf, "rotate 000000"));
+	munit_assert_not_null(strstr(buf, "rotate 000249"));
+	munit_assert_ptr(strstr(buf, "rotate 000000"), <, strstr(buf, "rotate 000249"));
+	mem_free0(buf);
+
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_logstore_budget(UNUSED const MunitParameter params[], void *data)
+{
+	test_state_t *state = data;
+
+	state->store = logstore_new(state->dir, "test", TEST_SEGMENT_SIZE, 0, TEST_BUDGET);
+	munit_assert_not_null(state->store);
+
+	char tag[16];
+	for (int i = 0; i < 20; ++i) {
+		snprintf(tag, sizeof(tag), "budget%02d", i);
+		test_write_lines(state->store, tag, 100);
+		logstore_flush(state->store);
+		munit_assert_size(logstore_get_disk_usage(state->store), <=,
+				  TEST_BUDGET + TEST_SEGMENT_SIZE);
+	}
+
+	// the oldest records were removed, the newest are still there
+	char *buf = test_read_range(state->store, 0, time(NULL) + 1);
+	munit_assert_null(strstr(buf, "budget00 000000"));
+	munit_assert_not_null(strstr(buf, "budget19 000099"));
+	mem_free0(buf);
+
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_logstore_range(UNUSED const MunitParameter params[], void *data)
+{
+	test_state_t *state = data;
+
+	state->store = logstore_new(state->dir, "test", TEST_SEGMENT_SIZE, 0, TEST_BUDGET);
+	munit_assert_not_null(state->store);
+
+	time_t t0 = time(NULL);
+	test_write_lines(state->store, "first", 100);
+	logstore_rotate(state->store);
+	while (time(NULL) <= t0 + 1)
+		sleep(1);
+
+	time_t t1 = time(NULL);
+	test_write_lines(state->store, "second", 30);
+	while (time(NULL) <= t1 + 1)
+		sleep(1);
+
+	time_t t2 = time(NULL);
+	test_write_lines(state->store, "third", 30);
+
+	// the segment of the first records is skipped
+	char *buf = test_read_range(state->store, t1, t2 - 1);
+	munit_assert_null(strstr(buf, "first"));
+	munit_assert_not_null(strstr(buf, "second 000000"));
+	munit_assert_not_null(strstr(buf, "second 000029"));
+	munit_assert_null(strstr(buf, "third"));
+	mem_free0(buf);
+
+	buf = test_read_range(state->store, t2, t2 + 1);
+	munit_assert_null(strstr(buf, "first"));
+	munit_assert_not_null(strstr(buf, "third 000029"));
+	mem_free0(buf);
+
+	buf = test_read_range(state->store, t0, t0);
+	munit_assert_not_null(strstr(buf, "first 000099"));
+	munit_assert_null(strstr(buf, "second"));
+	mem_free0(buf);
+
+	buf = test_read_range(state->store, t2 + 10, t2 + 20);
+	munit_assert_size(strlen(buf), ==, 0);
+	mem_free0(buf);
+
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_logstore_reopen(UNUSED const MunitParameter params[], void *data)
+{
+	test_state_t *state = data;
+
+	state->store = logstore_new(state->dir, "test", TEST_SEGMENT_SIZE, 0, TEST_BUDGET);
+	munit_assert_not_null(state->store);
+	test_write_lines(state->store, "before", 10);
+	logstore_free(state->store);
+
+	// the segment of the previous run is kept and compressed
+	state->store = logstore_new(state->dir, "test", TEST_SEGMENT_SIZE, 0, TEST_BUDGET);
+	munit_assert_not_null(state->store);
+	munit_assert_uint(logstore_get_segment_count(state->store), ==, 2);
+	test_write_lines(state->store, "after", 10);
+
+	logstore_flush(state->store);
+	munit_assert_int(dir_foreach(state->dir, test_count_cb, ".log.gz"), ==, 1);
+
+	char *buf = test_read_range(state->store, 0, time(NULL) + 1);
+	munit_assert_ptr_not_null(strstr(buf, "before 000009"));
+	munit_assert_ptr(strstr(buf, "before 000009"), <, strstr(buf, "after 000000"));
+	mem_free0(buf);
+
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_logstore_readonly(UNUSED const MunitParameter params[], void *data)
+{
+	test_state_t *state = data;
+
+	state->store = logstore_new(state->dir, "test", TEST_SEGMENT_SIZE, 0, TEST_BUDGET);
+	munit_assert_not_null(state->store);
+	test_write_lines(state->store, "owner", 250);
+	logstore_flush(state->store);
+	unsigned int count = logstore_get_segment_count(state->store);
+
+	// the records of compressed and of the current segment are read, nothing is written
+	logstore_t *reader = logstore_open_readonly(state->dir, "test");
+	munit_assert_not_null(reader);
+	munit_assert_uint(logstore_get_segment_count(reader), ==, count);
+
+	char *buf = test_read_range(reader, 0, time(NULL) + 1);
+	munit_assert_not_null(strstr(buf, "owner 000000"));
+	munit_assert_not_null(strstr(buf, "owner 000249"));
+	mem_free0(buf);
+
+	logstore_write(LOGF_PRIO_INFO, "reader", reader);
+	logstore_free(reader);
+	munit_assert_uint(logstore_get_segment_count(state->store), ==, count);
+	munit_assert_int(dir_foreach(state->dir, test_count_cb, ".log"), ==, 1);
+
+	return MUNIT_OK;
+}
+
+static int
+test_append_cb(const char *buf, size_t len, void *data)
+{
+	str_t *str = data;
+	munit_assert_size(len, >, 0);
+	str_append_len(str, buf, len);
+	return 0;
+}
+
+static int
+test_abort_cb(UNUSED const char *buf, UNUSED size_t len, UNUSED void *data)
+{
+	return -1;
+}
+
+static MunitResult
+test_logstore_foreach(UNUSED const MunitParameter params[], void *data)
+{
+	test_state_t *state = data;
+
+	state->store = logstore_new(state->dir, "test", TEST_SEGMENT_SIZE, 0, TEST_BUDGET);
+	munit_assert_not_null(state->store);
+	test_write_lines(state->store, "chunk", 250);
+	logstore_flush(state->store);
+
+	// the chunks add up to the same records as written to a file
+	str_t *str = str_new(NULL);
+	ssize_t len =
+		logstore_read_range_foreach(state->store, 0, time(NULL) + 1, test_append_cb, str);
+	munit_assert_size(len, ==, str_length(str));
+
+	char *buf = test_read_range(state->store, 0, time(NULL) + 1);
+	munit_assert_string_equal(str_buffer(str), buf);
+	mem_free0(buf);
+	str_free(str, true);
+
+	munit_assert_int(logstore_read_range_foreach(state->store, 0, time(NULL) + 1, test_abort_cb,
+						     NULL),
+			 ==, -1);
+
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_logstore_get_name(UNUSED const MunitParameter params[], UNUSED void *data)
+{
+	const char *files[][2] = {
+		{ "cml-daemon.000012.log", "cml-daemon" },
+		{ "cml-daemon.000012.log.gz", "cml-daemon" },
+		{ "cml-scd.000000.idx", "cml-scd" },
+		{ "a.b.1.log", "a.b" },
+		{ "rattestation", NULL },
+		{ "cml-daemon.log", NULL },
+		{ ".000001.log", NULL },
+		{ "cml-daemon.x1.idx", NULL },
+	};
+
+	for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); ++i) {
+		char *name = logstore_get_name_new(files[i][0]);
+		if (files[i][1]) {
+			munit_assert_not_null(name);
+			munit_assert_string_equal(name, files[i][1]);
+			mem_free0(name);
+		} else {
+			munit_assert_null(name);
+		}
+	}
+
+	return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+	{ "/rotate size", test_logstore_rotate_size, setup, tear_down, MUNIT_TEST_OPTION_NONE,
+	  NULL },
+	{ "/budget", test_logstore_budget, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+	{ "/range", test_logstore_range, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+	{ "/reopen", test_logstore_reopen, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+	{ "/readonly", test_logstore_readonly, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+	{ "/foreach", test_logstore_foreach, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+	{ "/get name", test_logstore_get_name, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+
+	// Mark the end of the array with an entry where the test function is NULL
+	{ NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+MunitSuite logstore_suite = {
+	"/logstore",		/* name */
+	tests,			/* tests */
+	NULL,			/* suites */
+	1,			/* iterations */
+	MUNIT_SUITE_OPTION_NONE /* options */
+};
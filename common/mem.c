@@ -22,6 +22,7 @@
  */
 
 #define _GNU_SOURCE
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -37,6 +38,24 @@
 			DEBUG("Allocating a large memory area of %zu bytes", size);                \
 	} while (0)
 
+// alignment of all allocations from an arena, suitable for any type
+#define MEM_ARENA_ALIGN 16
+// upper bound for the chunk merged on reset, larger peaks are not kept
+#define MEM_ARENA_MAX_RETAIN (4 * 1024 * 1024)
+
+typedef struct mem_arena_chunk {
+	struct mem_arena_chunk *next;
+	size_t size;
+	size_t off;
+	unsigned char data[];
+} mem_arena_chunk_t;
+
+struct mem_arena {
+	mem_arena_chunk_t *chunks; // the chunk currently allocated from comes first
+	size_t chunk_size;
+	size_t used;
+};
+
 void *
 mem_alloc(size_t size)
 {
@@ -138,3 +157,145 @@ mem_free_array(void **array, size_t size)
 		mem_free0(array);
 	}
 }
+
+static mem_arena_chunk_t *
+mem_arena_chunk_new(size_t size)
+{
+	mem_arena_chunk_t *chunk = mem_alloc(sizeof(mem_arena_chunk_t) + size);
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->off = 0;
+	return chunk;
+}
+
+static void
+mem_arena_chunks_free(mem_arena_chunk_t *chunk)
+{
+	while (chunk) {
+		mem_arena_chunk_t *next = chunk->next;
+		mem_free0(chunk);
+		chunk = next;
+	}
+}
+
+mem_arena_t *
+mem_arena_new(size_t chunk_size)
+{
+	ASSERT(chunk_size > 0);
+
+	mem_arena_t *arena = mem_new0(mem_arena_t, 1);
+	arena->chunk_size = chunk_size;
+	arena->chunks = mem_arena_chunk_new(chunk_size);
+	return arena;
+}
+
+void
+mem_arena_free(mem_arena_t *arena)
+{
+	IF_NULL_RETURN(arena);
+
+	mem_arena_chunks_free(arena->chunks);
+	mem_free0(arena);
+}
+
+void
+mem_arena_reset(mem_arena_t *arena)
+{
+	ASSERT(arena);
+
+	if (arena->chunks->next) {
+		size_t total = 0;
+		for (mem_arena_chunk_t *c = arena->chunks; c; c = c->next)
+			total += c->size;
+
+		mem_arena_chunks_free(arena->chunks);
+		arena->chunks = mem_arena_chunk_new(
+			total <= MEM_ARENA_MAX_RETAIN ? total : arena->chunk_size);
+	}
+	arena->chunks->off = 0;
+	arena->used = 0;
+}
+
+void *
+mem_arena_alloc(mem_arena_t *arena, size_t size)
+{
+	ASSERT(arena);
+
+	mem_arena_chunk_t *chunk = arena->chunks;
+	uintptr_t base = (uintptr_t)chunk->data;
+	size_t off =
+		((base + chunk->off + MEM_ARENA_ALIGN - 1) & ~(uintptr_t)(MEM_ARENA_ALIGN - 1)) -
+		base;
+
+	if (off > chunk->size || size > chunk->size - off) {
+		// the rest of the current chunk is wasted until the next reset
+		size_t chunk_size = arena->chunk_size;
+		if (size + MEM_ARENA_ALIGN > chunk_size) {
+			ASSERT(size < SIZE_MAX - MEM_ARENA_ALIGN);
+			chunk_size = size + MEM_ARENA_ALIGN;
+		}
+		chunk = mem_arena_chunk_new(chunk_size);
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+
+		base = (uintptr_t)chunk->data;
+		off = ((base + MEM_ARENA_ALIGN - 1) & ~(uintptr_t)(MEM_ARENA_ALIGN - 1)) - base;
+	}
+
+	chunk->off = off + size;
+	arena->used += size;
+	return chunk->data + off;
+}
+
+void *
+mem_arena_alloc0(mem_arena_t *arena, size_t size)
+{
+	void *p = mem_arena_alloc(arena, size);
+	memset(p, 0, size);
+	return p;
+}
+
+void *
+mem_arena_calloc(mem_arena_t *arena, size_t nmemb, size_t size)
+{
+	size_t total;
+	if (__builtin_mul_overflow(nmemb, size, &total))
+		FATAL("Detected integer overflow in allocation size. Aborting to prevent heap overflow.");
+	return mem_arena_alloc0(arena, total);
+}
+
+char *
+mem_arena_strdup(mem_arena_t *arena, const char *str)
+{
+	ASSERT(str);
+
+	size_t len = strlen(str) + 1;
+	char *p = mem_arena_alloc(arena, len);
+	memcpy(p, str, len);
+	return p;
+}
+
+char *
+mem_arena_printf(mem_arena_t *arena, const char *fmt, ...)
+{
+	va_list ap;
+	ASSERT(fmt);
+
+	va_start(ap, fmt);
+	int len = vsnprintf(NULL, 0, fmt, ap);
+	va_end(ap);
+	ASSERT(len >= 0);
+
+	char *p = mem_arena_alloc(arena, len + 1);
+	va_start(ap, fmt);
+	vsnprintf(p, len + 1, fmt, ap);
+	va_end(ap);
+	return p;
+}
+
+size_t
+mem_arena_get_used(const mem_arena_t *arena)
+{
+	ASSERT(arena);
+	return arena->used;
+}
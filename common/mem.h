@@ -214,6 +214,104 @@ mem_free_array(void **array, size_t size);
 		(struct_type *)aligned_alloc(alignment, _total_len);                               \
 	})
 
+/**
+ * Arena for many small allocations with the same lifetime, e.g. all objects
+ * needed to handle a single request. Memory is handed out from larger chunks
+ * and is not freed individually, but all at once by mem_arena_reset().
+ */
+typedef struct mem_arena mem_arena_t;
+
+/**
+ * Creates a new arena.
+ *
+ * @param chunk_size The size of the chunks the arena allocates from the heap.
+ * @return Pointer to the new arena.
+ */
+mem_arena_t *
+mem_arena_new(size_t chunk_size);
+
+/**
+ * Frees the arena and all memory allocated from it.
+ *
+ * @param arena The arena to be freed.
+ */
+void
+mem_arena_free(mem_arena_t *arena);
+
+/**
+ * Releases all memory allocated from the arena at once. The memory is kept
+ * by the arena to serve subsequent allocations. If the last cycle needed
+ * more than one chunk, the chunks are merged, so that an equal load fits
+ * into a single chunk next time.
+ *
+ * @param arena The arena to be reset.
+ */
+void
+mem_arena_reset(mem_arena_t *arena);
+
+/**
+ * Allocates memory from the arena. The memory is not initialized.
+ * Aborts if the allocation fails.
+ *
+ * @param arena The arena to allocate from.
+ * @param size The number of bytes to allocate.
+ * @return Pointer to the allocated memory, valid until the arena is reset.
+ */
+void *
+mem_arena_alloc(mem_arena_t *arena, size_t size);
+
+/**
+ * Allocates memory from the arena. The memory is set to zero.
+ *
+ * @param arena The arena to allocate from.
+ * @param size The number of bytes to allocate.
+ * @return Pointer to the allocated memory, valid until the arena is reset.
+ */
+void *
+mem_arena_alloc0(mem_arena_t *arena, size_t size);
+
+/**
+ * Allocates zeroed memory for an array from the arena.
+ * Aborts if nmemb * size overflows.
+ *
+ * @param arena The arena to allocate from.
+ * @param nmemb The number of array elements.
+ * @param size The size of an array element.
+ * @return Pointer to the allocated memory, valid until the arena is reset.
+ */
+void *
+mem_arena_calloc(mem_arena_t *arena, size_t nmemb, size_t size);
+
+/**
+ * Duplicates a string into memory allocated from the arena.
+ *
+ * @param arena The arena to allocate from.
+ * @param str The string to duplicate.
+ * @return Pointer to the new string, valid until the arena is reset.
+ */
+char *
+mem_arena_strdup(mem_arena_t *arena, const char *str);
+
+/**
+ * Prints to a string allocated from the arena.
+ *
+ * @param arena The arena to allocate from.
+ * @param fmt The format string.
+ * @return Pointer to the formatted string, valid until the arena is reset.
+ */
+char *
+mem_arena_printf(mem_arena_t *arena, const char *fmt, ...)
+#if defined(__GNUC__)
+	__attribute__((format(printf, 2, 3)))
+#endif
+	;
+
+/**
+ * Returns the number of bytes allocated from the arena since the last reset.
+ */
+size_t
+mem_arena_get_used(const mem_arena_t *arena);
+
 static inline void
 mem_memset0(void *ptr, size_t num)
 {
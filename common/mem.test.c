@@ -294,6 +294,61 @@ test_mem_memset0(UNUSED const MunitParameter params[], UNUSED void *data)
 	return MUNIT_OK;
 }
 
+static MunitResult
+test_mem_arena(UNUSED const MunitParameter params[], UNUSED void *data)
+{
+	mem_arena_t *arena = mem_arena_new(256);
+	munit_assert_not_null(arena);
+
+	// allocations are aligned for any type and do not overlap
+	char *c = mem_arena_alloc(arena, 1);
+	struct complex_t *ptr_struct = mem_arena_alloc0(arena, sizeof(struct complex_t));
+	munit_assert_size((uintptr_t)ptr_struct % 16, ==, 0);
+	munit_assert_ptr(c, <, (char *)ptr_struct);
+	munit_assert_int(ptr_struct->int_field, ==, 0);
+	ptr_struct->long_field = 0xbeef;
+
+	char *str = mem_arena_strdup(arena, "deadbeef");
+	munit_assert_string_equal(str, "deadbeef");
+	char *fmt = mem_arena_printf(arena, "%s-%d", str, 42);
+	munit_assert_string_equal(fmt, "deadbeef-42");
+
+	int *array = mem_arena_calloc(arena, 16, sizeof(int));
+	for (int i = 0; i < 16; ++i)
+		munit_assert_int(array[i], ==, 0);
+
+	// exceeds the chunk size and the remaining space of the current chunk
+	unsigned char *large = mem_arena_alloc(arena, 1000);
+	memset(large, 0xaa, 1000);
+	munit_assert_ulong(ptr_struct->long_field, ==, 0xbeef);
+	munit_assert_string_equal(fmt, "deadbeef-42");
+	munit_assert_size(mem_arena_get_used(arena), >=, 1000);
+
+	// after a reset the same load is served from the beginning of a single chunk
+	mem_arena_reset(arena);
+	munit_assert_size(mem_arena_get_used(arena), ==, 0);
+	char *c2 = mem_arena_alloc(arena, 1);
+	for (int i = 0; i < 10; ++i)
+		munit_assert_not_null(mem_arena_alloc(arena, 100));
+	munit_assert_ptr(mem_arena_alloc(arena, 1), >, c2);
+
+	mem_arena_free(arena);
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_integer_overflow_in_mem_arena_calloc_is_detected(UNUSED const MunitParameter params[],
+						      UNUSED void *data)
+{
+	size_t MAX = (~(size_t)(0));
+	mem_arena_t *arena = mem_arena_new(256);
+	mem_arena_calloc(arena, MAX >> 1, sizeof(struct complex_t));
+
+	// shouldn't be reached
+	mem_arena_free(arena);
+	return MUNIT_FAIL;
+}
+
 static MunitTest tests[] = {
 	{
 		"/allocate primitives and structs",	  /* name */
@@ -375,6 +430,22 @@ static MunitTest tests[] = {
 		MUNIT_TEST_OPTION_NONE,		   /* options */
 		NULL				   /* parameters */
 	},
+	{
+		"/arena allocations",	/* name */
+		test_mem_arena,		/* test */
+		setup,			/* setup */
+		tear_down,		/* tear_down */
+		MUNIT_TEST_OPTION_NONE, /* options */
+		NULL			/* parameters */
+	},
+	{
+		"/integer overflow in allocation size of mem_arena_calloc is detected", /* name */
+		test_integer_overflow_in_mem_arena_calloc_is_detected,			/* test */
+		setup,									/* setup */
+		tear_down,			/* tear_down */
+		MUNIT_TEST_OPTION_RECV_SIGABRT, /* options */
+		NULL				/* parameters */
+	},
 
 	// Mark the end of the array with an entry where the test function is NULL
 	{ NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
@@ -37,14 +37,37 @@
 
 // TODO update naming scheme
 
-uint32_t
-protobuf_pack_message_new(const ProtobufCMessage *message, uint8_t **ptr)
+static void *
+protobuf_arena_alloc(void *allocator_data, size_t size)
+{
+	return mem_arena_alloc(allocator_data, size);
+}
+
+static void
+protobuf_arena_free(UNUSED void *allocator_data, UNUSED void *pointer)
+{
+	// released all at once by mem_arena_reset()
+}
+
+void
+protobuf_allocator_init_arena(ProtobufCAllocator *allocator, mem_arena_t *arena)
+{
+	ASSERT(allocator);
+	ASSERT(arena);
+
+	allocator->alloc = protobuf_arena_alloc;
+	allocator->free = protobuf_arena_free;
+	allocator->allocator_data = arena;
+}
+
+static uint32_t
+protobuf_pack_message_internal(const ProtobufCMessage *message, uint8_t **ptr, mem_arena_t *arena)
 {
 	ASSERT(message);
 	ASSERT(ptr);
 
 	uint32_t packed_len = protobuf_c_message_get_packed_size(message);
-	uint8_t *packed = mem_alloc(packed_len);
+	uint8_t *packed = arena ? mem_arena_alloc(arena, packed_len) : mem_alloc(packed_len);
 
 	TRACE("Packed size: %d", packed_len);
 
@@ -56,6 +79,12 @@ protobuf_pack_message_new(const ProtobufCMessage *message, uint8_t **ptr)
 	return actual_len;
 }
 
+uint32_t
+protobuf_pack_message_new(const ProtobufCMessage *message, uint8_t **ptr)
+{
+	return protobuf_pack_message_internal(message, ptr, NULL);
+}
+
 ssize_t
 protobuf_send_message_packed(int fd, const uint8_t *buf, uint32_t buflen)
 {
@@ -90,20 +119,19 @@ error_write:
 	return -1;
 }
 
-ssize_t
-protobuf_send_message(int fd, const ProtobufCMessage *message)
+static ssize_t
+protobuf_send_message_internal(int fd, const ProtobufCMessage *message, mem_arena_t *arena)
 {
 	ASSERT(message);
 
 	uint8_t *buf = NULL;
-	uint32_t buflen = protobuf_pack_message_new(message, &buf);
+	uint32_t buflen = protobuf_pack_message_internal(message, &buf, arena);
+	ssize_t ret = buflen;
 
 	if (!(buflen < PROTOBUF_MAX_MESSAGE_SIZE)) {
 		ERROR("Packed message exceeds PROTOBUF_MAX_MESSAGE_SIZE");
-		if (buf)
-			mem_free0(buf);
-
-		return -1;
+		ret = -1;
+		goto out;
 	}
 
 	if (LOGF_PRIO_TRACE >= LOGF_LOG_MIN_PRIO) {
@@ -119,17 +147,31 @@ protobuf_send_message(int fd, const ProtobufCMessage *message)
 
 	if (-1 == protobuf_send_message_packed(fd, buf, buflen)) {
 		ERROR_ERRNO("Failed to write packed protobuf message to fd %d.", fd);
-		mem_free0(buf);
-		return -1;
+		ret = -1;
 	}
 
-	mem_free0(buf);
+out:
+	if (!arena)
+		mem_free0(buf);
 
-	return buflen;
+	return ret;
 }
 
-uint8_t *
-protobuf_recv_message_packed_new(int fd, ssize_t *ret_len)
+ssize_t
+protobuf_send_message(int fd, const ProtobufCMessage *message)
+{
+	return protobuf_send_message_internal(fd, message, NULL);
+}
+
+ssize_t
+protobuf_send_message_arena(int fd, const ProtobufCMessage *message, mem_arena_t *arena)
+{
+	ASSERT(arena);
+	return protobuf_send_message_internal(fd, message, arena);
+}
+
+static uint8_t *
+protobuf_recv_message_packed_internal(int fd, ssize_t *ret_len, mem_arena_t *arena)
 {
 	ASSERT(ret_len);
 	uint32_t buflen = 0;
@@ -165,12 +207,13 @@ protobuf_recv_message_packed_new(int fd, ssize_t *ret_len)
 		return NULL;
 	}
 
-	uint8_t *buf = mem_alloc(buflen);
+	uint8_t *buf = arena ? mem_arena_alloc(arena, buflen) : mem_alloc(buflen);
 	do {
 		bytes_read = fd_read(fd, (char *)buf, buflen);
 	} while (-1 == bytes_read && errno == EINTR);
 	if (-1 == bytes_read) {
-		mem_free0(buf);
+		if (!arena)
+			mem_free0(buf);
 		goto error_read;
 	}
 	TRACE("read protobuf message data (%zd bytes read, %u bytes expected)", bytes_read, buflen);
@@ -180,7 +223,8 @@ protobuf_recv_message_packed_new(int fd, ssize_t *ret_len)
 	if ((size_t)bytes_read != buflen) {
 		ERROR("Dropped protobuf message (expected length : %zd bytes read != %u bytes expected)",
 		      bytes_read, buflen);
-		mem_free0(buf);
+		if (!arena)
+			mem_free0(buf);
 		goto error_read;
 	}
 	// TODO: what if only part of a message could be read?
@@ -196,20 +240,34 @@ error_read:
 	return NULL;
 }
 
-ProtobufCMessage *
-protobuf_recv_message(int fd, const ProtobufCMessageDescriptor *descriptor)
+uint8_t *
+protobuf_recv_message_packed_new(int fd, ssize_t *ret_len)
+{
+	return protobuf_recv_message_packed_internal(fd, ret_len, NULL);
+}
+
+static ProtobufCMessage *
+protobuf_recv_message_internal(int fd, const ProtobufCMessageDescriptor *descriptor,
+			       mem_arena_t *arena)
 {
 	ASSERT(descriptor);
 
+	ProtobufCAllocator arena_allocator;
+	ProtobufCAllocator *allocator = NULL;
+	if (arena) {
+		protobuf_allocator_init_arena(&arena_allocator, arena);
+		allocator = &arena_allocator;
+	}
+
 	ssize_t buflen = 0;
-	uint8_t *buf = protobuf_recv_message_packed_new(fd, &buflen);
+	uint8_t *buf = protobuf_recv_message_packed_internal(fd, &buflen, arena);
 
 	// zero length data represents a message with all default values
 	// => use unpack to construct it (and initialize it with these defaults)
 	if (0 == buflen) {
 		TRACE("Got zero length message, returning default message fields");
 
-		return protobuf_c_message_unpack(descriptor, NULL, 0, NULL);
+		return protobuf_c_message_unpack(descriptor, allocator, 0, NULL);
 	}
 
 	// -2 means that client closed connection
@@ -222,7 +280,7 @@ protobuf_recv_message(int fd, const ProtobufCMessageDescriptor *descriptor)
 		return NULL;
 	}
 
-	ProtobufCMessage *msg = protobuf_c_message_unpack(descriptor, NULL, buflen, buf);
+	ProtobufCMessage *msg = protobuf_c_message_unpack(descriptor, allocator, buflen, buf);
 
 	if (!msg) {
 		WARN("Failed to parse received protobuf message");
@@ -239,10 +297,25 @@ protobuf_recv_message(int fd, const ProtobufCMessageDescriptor *descriptor)
 			free(msg_text);
 	}
 
-	mem_free0(buf);
+	if (!arena)
+		mem_free0(buf);
 	return msg;
 }
 
+ProtobufCMessage *
+protobuf_recv_message(int fd, const ProtobufCMessageDescriptor *descriptor)
+{
+	return protobuf_recv_message_internal(fd, descriptor, NULL);
+}
+
+ProtobufCMessage *
+protobuf_recv_message_arena(int fd, const ProtobufCMessageDescriptor *descriptor,
+			    mem_arena_t *arena)
+{
+	ASSERT(arena);
+	return protobuf_recv_message_internal(fd, descriptor, arena);
+}
+
 ProtobufCMessage *
 protobuf_unpack_message(const ProtobufCMessageDescriptor *descriptor, uint8_t *buf,
 			uint32_t buf_len)
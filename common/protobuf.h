@@ -34,6 +34,8 @@
 
 #include <protobuf-c/protobuf-c.h>
 
+#include "mem.h"
+
 #include <sys/types.h>
 #include <stdbool.h>
 
@@ -94,6 +96,43 @@ protobuf_send_message(int fd, const ProtobufCMessage *message);
 ProtobufCMessage *
 protobuf_recv_message(int fd, const ProtobufCMessageDescriptor *descriptor);
 
+/**
+ * Like protobuf_recv_message(), but the received data and the new message
+ * struct are allocated from the given arena. The message must not be released
+ * with protobuf_free_message(), it is released by resetting the arena.
+ *
+ * @param fd        the file descriptor that the serialized message is read from
+ * @param descriptor    the protobuf message descriptor that defines the message structure
+ * @param arena     the arena which is used for all allocations
+ * @return          a pointer to a new protobuf message struct
+ */
+ProtobufCMessage *
+protobuf_recv_message_arena(int fd, const ProtobufCMessageDescriptor *descriptor,
+			    mem_arena_t *arena);
+
+/**
+ * Like protobuf_send_message(), but the message is serialized into a buffer
+ * allocated from the given arena.
+ *
+ * @param fd        the file descriptor that the serialized message is written to
+ * @param message   the protobuf message struct to serialize and write
+ * @param arena     the arena which is used for the serialization buffer
+ * @return          the length of the serialized message (without length prefix)
+ */
+ssize_t
+protobuf_send_message_arena(int fd, const ProtobufCMessage *message, mem_arena_t *arena);
+
+/**
+ * Initializes a ProtobufCAllocator which allocates from the given arena,
+ * e.g. to unpack messages with protobuf_c_message_unpack(). Freeing through
+ * the allocator is a no-op, the memory is released by resetting the arena.
+ *
+ * @param allocator the allocator to initialize
+ * @param arena     the arena to allocate from
+ */
+void
+protobuf_allocator_init_arena(ProtobufCAllocator *allocator, mem_arena_t *arena);
+
 /**
  * Reads a serialized protobuf message from the given file descriptor
  * and returns it's packed representation
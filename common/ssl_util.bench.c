@@ -0,0 +1,336 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+/*
+ * Benchmark of the file hashing strategies of ssl_util over synthetic images
+ * of several sizes. Each image is hashed once with a warm page cache and, if
+ * run as root, once after dropping the page cache.
+ *
+ * With 'keys', the supported key types are compared instead: creation of a
+ * key with its CSR, signing and verification of a config sized buffer and
+ * wrapping and unwrapping of a container key.
+ *
+ * Usage: ssl_util.bench [directory] (defaults to /tmp)
+ *        ssl_util.bench keys [directory]
+ */
+
+#include "ssl_util.h"
+
+#include "macro.h"
+#include "mem.h"
+#include "file.h"
+#include "logf.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_MIB (1024 * 1024)
+#define BENCH_HASH_ALGO "SHA256"
+#define BENCH_KEY_MIN_TIME 1.0
+#define BENCH_KEY_SIGNED_SIZE 4096
+#define BENCH_KEY_WRAPPED_SIZE 64
+
+static const size_t bench_sizes_mib[] = { 1, 16, 128, 512 };
+
+static const ssl_hash_strategy_t bench_strategies[] = { SSL_HASH_STRATEGY_AUTO,
+							SSL_HASH_STRATEGY_READ,
+							SSL_HASH_STRATEGY_MMAP,
+							SSL_HASH_STRATEGY_DIRECT };
+
+static const ssl_key_type_t bench_key_types[] = { RSA_SSA_PADDING, RSA_PSS_PADDING, ECDSA_P256_KEY,
+						  ECDSA_P384_KEY, ED25519_KEY };
+
+static int
+bench_create_image(const char *path, size_t size)
+{
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	IF_TRUE_RETVAL(fd < 0, -1);
+
+	unsigned char *buf = mem_alloc(BENCH_MIB);
+	for (size_t i = 0; i < BENCH_MIB; ++i)
+		buf[i] = rand();
+
+	int ret = 0;
+	for (size_t written = 0; written < size && ret == 0; written += BENCH_MIB) {
+		// vary each block to avoid identical content in the image
+		buf[written / BENCH_MIB % BENCH_MIB] ^= 0xff;
+		if (write(fd, buf, BENCH_MIB) != BENCH_MIB)
+			ret = -1;
+	}
+	if (fsync(fd) < 0)
+		ret = -1;
+
+	close(fd);
+	mem_free0(buf);
+	return ret;
+}
+
+static bool
+bench_drop_caches(void)
+{
+	sync();
+	int fd = open("/proc/sys/vm/drop_caches", O_WRONLY | O_CLOEXEC);
+	IF_TRUE_RETVAL(fd < 0, false);
+	bool ret = write(fd, "3", 1) == 1;
+	close(fd);
+	return ret;
+}
+
+static double
+bench_hash(const char *path, ssl_hash_strategy_t strategy)
+{
+	const char *algo = BENCH_HASH_ALGO;
+	unsigned char *hash = NULL;
+	unsigned int hash_len;
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (ssl_hash_file_multi_strategy(path, &algo, 1, &hash, &hash_len, strategy) < 0)
+		return -1;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	mem_free0(hash);
+	return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static double
+bench_now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/*
+ * Runs one of the operations of bench_key_op() repeatedly for at least
+ * BENCH_KEY_MIN_TIME seconds and returns the mean time per run in ms, or -1 if
+ * the operation is not supported by the key type.
+ */
+typedef int (*bench_key_op_t)(EVP_PKEY *pkey, const char *cert_buf, size_t cert_len, void *data);
+
+static double
+bench_key_op(bench_key_op_t op, EVP_PKEY *pkey, const char *cert_buf, size_t cert_len, void *data)
+{
+	int runs = 0;
+	double start = bench_now(), elapsed;
+	do {
+		if (op(pkey, cert_buf, cert_len, data) < 0)
+			return -1;
+		++runs;
+	} while ((elapsed = bench_now() - start) < BENCH_KEY_MIN_TIME);
+
+	return elapsed * 1000 / runs;
+}
+
+typedef struct {
+	const char *dir;
+	ssl_key_type_t key_type;
+	uint8_t buf[BENCH_KEY_SIGNED_SIZE];
+	uint8_t *sig;
+	size_t sig_len;
+	unsigned char *wrapped_key;
+	int wrapped_key_len;
+} bench_key_data_t;
+
+static int
+bench_key_keygen(UNUSED EVP_PKEY *pkey, UNUSED const char *cert_buf, UNUSED size_t cert_len,
+		 void *data)
+{
+	bench_key_data_t *d = data;
+	char *csr = mem_printf("%s/ssl_util_bench.csr", d->dir);
+	char *key = mem_printf("%s/ssl_util_bench.key", d->dir);
+
+	int ret = ssl_create_csr(csr, key, NULL, "bench", "00000000-0000-0000-0000-000000000000",
+				 false, d->key_type);
+
+	unlink(csr);
+	unlink(key);
+	mem_free0(csr);
+	mem_free0(key);
+	return ret;
+}
+
+static int
+bench_key_sign(EVP_PKEY *pkey, UNUSED const char *cert_buf, UNUSED size_t cert_len, void *data)
+{
+	bench_key_data_t *d = data;
+	mem_free0(d->sig);
+	return ssl_sign_buf(pkey, d->buf, sizeof(d->buf), BENCH_HASH_ALGO, &d->sig, &d->sig_len);
+}
+
+static int
+bench_key_verify(UNUSED EVP_PKEY *pkey, const char *cert_buf, size_t cert_len, void *data)
+{
+	bench_key_data_t *d = data;
+	return ssl_verify_signature_from_buf((uint8_t *)cert_buf, cert_len, d->sig, d->sig_len,
+					     d->buf, sizeof(d->buf), BENCH_HASH_ALGO) == 0 ?
+		       0 :
+		       -1;
+}
+
+static int
+bench_key_wrap(EVP_PKEY *pkey, UNUSED const char *cert_buf, UNUSED size_t cert_len, void *data)
+{
+	bench_key_data_t *d = data;
+	mem_free0(d->wrapped_key);
+	return ssl_wrap_key(pkey, d->buf, BENCH_KEY_WRAPPED_SIZE, &d->wrapped_key,
+			    &d->wrapped_key_len);
+}
+
+static int
+bench_key_unwrap(EVP_PKEY *pkey, UNUSED const char *cert_buf, UNUSED size_t cert_len, void *data)
+{
+	bench_key_data_t *d = data;
+	unsigned char *plain_key = NULL;
+	int plain_key_len;
+
+	IF_NULL_RETVAL(d->wrapped_key, -1);
+	int ret = ssl_unwrap_key(pkey, d->wrapped_key, d->wrapped_key_len, &plain_key,
+				 &plain_key_len);
+	mem_free0(plain_key);
+	return ret;
+}
+
+static void
+bench_key_print(double ms)
+{
+	if (ms < 0)
+		printf(" %12s", "n/a");
+	else
+		printf(" %12.3f", ms);
+}
+
+static int
+bench_keys(const char *dir)
+{
+	char *token = mem_printf("%s/ssl_util_bench.p12", dir);
+	char *cert = mem_printf("%s/ssl_util_bench.cert", dir);
+
+	printf("%10s %12s %12s %12s %12s %12s %8s\n", "key", "keygen(ms)", "sign(ms)", "verify(ms)",
+	       "wrap(ms)", "unwrap(ms)", "sig(B)");
+
+	for (size_t i = 0; i < sizeof(bench_key_types) / sizeof(bench_key_types[0]); ++i) {
+		bench_key_data_t *d = mem_new0(bench_key_data_t, 1);
+		d->dir = dir;
+		d->key_type = bench_key_types[i];
+		for (size_t j = 0; j < sizeof(d->buf); ++j)
+			d->buf[j] = rand();
+
+		EVP_PKEY *pkey = NULL;
+		X509 *x509 = NULL;
+		char *cert_buf = NULL;
+		off_t cert_len = 0;
+
+		if (ssl_create_pkcs12_token(token, cert, "bench", "bench", d->key_type) < 0 ||
+		    ssl_read_pkcs12_token(token, "bench", &pkey, &x509, NULL) < 0 ||
+		    (cert_len = file_size(cert)) <= 0) {
+			fprintf(stderr, "Could not create token for %s\n",
+				ssl_key_type_to_string(d->key_type));
+			goto next;
+		}
+		cert_buf = mem_alloc0(cert_len);
+		if (file_read(cert, cert_buf, cert_len) < 0)
+			goto next;
+
+		printf("%10s", ssl_key_type_to_string(d->key_type));
+		bench_key_print(bench_key_op(bench_key_keygen, pkey, cert_buf, cert_len, d));
+		bench_key_print(bench_key_op(bench_key_sign, pkey, cert_buf, cert_len, d));
+		bench_key_print(bench_key_op(bench_key_verify, pkey, cert_buf, cert_len, d));
+		bench_key_print(bench_key_op(bench_key_wrap, pkey, cert_buf, cert_len, d));
+		bench_key_print(bench_key_op(bench_key_unwrap, pkey, cert_buf, cert_len, d));
+		printf(" %8zu\n", d->sig_len);
+	next:
+		unlink(token);
+		unlink(cert);
+		mem_free0(cert_buf);
+		mem_free0(d->sig);
+		mem_free0(d->wrapped_key);
+		mem_free0(d);
+		if (x509)
+			X509_free(x509);
+		if (pkey)
+			EVP_PKEY_free(pkey);
+	}
+
+	mem_free0(token);
+	mem_free0(cert);
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	logf_handler_t *logf = logf_register(&logf_file_write, stderr);
+	ssl_init(false, NULL);
+
+	if (argc > 1 && !strcmp(argv[1], "keys")) {
+		// suppress the debug output of the key operations
+		logf_handler_set_prio(logf, LOGF_PRIO_ERROR);
+		int ret = bench_keys(argc > 2 ? argv[2] : "/tmp");
+		ssl_free();
+		return ret;
+	}
+
+	const char *dir = argc > 1 ? argv[1] : "/tmp";
+
+	printf("%10s %8s %14s %14s\n", "size(MiB)", "strategy", "warm(MiB/s)", "cold(MiB/s)");
+
+	for (size_t i = 0; i < sizeof(bench_sizes_mib) / sizeof(bench_sizes_mib[0]); ++i) {
+		size_t size = bench_sizes_mib[i] * BENCH_MIB;
+		char *path = mem_printf("%s/ssl_util_bench_%zu", dir, bench_sizes_mib[i]);
+
+		if (bench_create_image(path, size) < 0) {
+			fprintf(stderr, "Could not create image %s\n", path);
+			mem_free0(path);
+			continue;
+		}
+
+		for (size_t j = 0; j < sizeof(bench_strategies) / sizeof(bench_strategies[0]);
+		     ++j) {
+			ssl_hash_strategy_t strategy = bench_strategies[j];
+
+			// first run pulls the image into the page cache
+			bench_hash(path, strategy);
+			double warm = bench_hash(path, strategy);
+			double cold = bench_drop_caches() ? bench_hash(path, strategy) : -1;
+
+			printf("%10zu %8s %14.1f ", bench_sizes_mib[i],
+			       ssl_hash_strategy_to_string(strategy),
+			       warm > 0 ? bench_sizes_mib[i] / warm : 0);
+			if (cold > 0)
+				printf("%14.1f\n", bench_sizes_mib[i] / cold);
+			else
+				printf("%14s\n", "n/a");
+		}
+
+		unlink(path);
+		mem_free0(path);
+	}
+
+	ssl_free();
+	return 0;
+}
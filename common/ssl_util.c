@@ -21,6 +21,10 @@
  * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "ssl_util.h"
 
 #include "macro.h"
@@ -39,8 +43,15 @@
 #include <openssl/bio.h>
 #include <openssl/x509_vfy.h>
 #include <openssl/evp.h>
+#include <openssl/kdf.h>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 //#undef LOGF_LOG_MIN_PRIO
@@ -54,6 +65,8 @@
 #define ORG_UNIT_OU1_CSR "AISEC"
 //#define ORG_UNIT_OU2_CSR "trustme"
 #define KEY_USAGE_CSR "critical, digitalSignature,keyEncipherment,nonRepudiation"
+#define KEY_USAGE_CSR_EC "critical, digitalSignature,keyAgreement,nonRepudiation"
+#define KEY_USAGE_CSR_ED25519 "critical, digitalSignature,nonRepudiation"
 #define EXT_KEY_USAGE_CSR "clientAuth"
 #define REQ_VERSION_CSR 0L
 #define SINGATURE_MD_CSR "SHA256"
@@ -66,12 +79,28 @@
  * have a sufficient length when changing this!
  */
 #define CIPHER_KEY_WRAP_SKEY SN_id_aes256_wrap
+/* Key wrapping with EC keys: the key encryption key for the cipher is derived
+ * from the ECDH shared secret with HKDF */
+#define CIPHER_KEY_WRAP_ECDH SN_id_aes256_wrap_pad
+#define KDF_MD_KEY_WRAP_ECDH "SHA256"
+#define KDF_INFO_KEY_WRAP_ECDH "gyroidos key wrap"
 /* RSA key size when keypair is created */
 #define RSA_KEY_SIZE_MKKEYP 4096
 
 #define RSA_KEY_EXPONENT RSA_F4
-/* Chunk size for reading sig-/hashfiles */
-#define SIGN_HASH_BUFFER_SIZE 4096
+/* Maximum size of files signed with Ed25519, which are read into memory for verification */
+#define SSL_ED25519_SIGNED_FILE_MAX_SIZE (16 * 1024 * 1024)
+/* Chunk size for reading hashfiles, also used to feed mapped files to the digests */
+#define SSL_HASH_BUFFER_SIZE (256 * 1024)
+/* Files of at least this size are mapped into memory for hashing */
+#define SSL_HASH_MMAP_THRESHOLD (1024 * 1024)
+/* Window of mapped files which is requested ahead of hashing */
+#define SSL_HASH_READAHEAD_SIZE (4 * 1024 * 1024)
+/* Files of at least this size are read with O_DIRECT if they are mostly not cached */
+#define SSL_HASH_DIRECT_THRESHOLD (64 * 1024 * 1024)
+#define SSL_HASH_DIRECT_CACHED_PERCENT 50
+#define SSL_HASH_DIRECT_BUFFER_SIZE (4 * 1024 * 1024)
+#define SSL_HASH_DIRECT_ALIGNMENT 4096
 
 /*** self provisioning flags and functions */
 #define TEST_C "DE"
@@ -101,7 +130,7 @@ ssl_add_ext_cert(X509 *cert, int nid, char *value);
 
 /* creates a public key pair */
 static EVP_PKEY *
-ssl_mkkeypair(rsa_padding_t key_type);
+ssl_mkkeypair(ssl_key_type_t key_type);
 
 /* creates a CSR of a public key. If tpmkey is set true, openssl-tpm-engine
  * is used to create the request with a TPM-bound key */
@@ -116,6 +145,10 @@ add_ext_req(STACK_OF(X509_EXTENSION) * sk, int nid, char *value);
 static int
 ssl_set_pkey_ctx_rsa_pss(EVP_PKEY_CTX *ctx, const EVP_MD *hash_fct);
 
+/* returns the digest for certificates and CSRs signed with pkey in md, NULL for Ed25519 */
+static int
+ssl_get_sign_md(EVP_PKEY *pkey, const EVP_MD **md);
+
 ENGINE *tpm_engine = NULL;
 
 #define ssl_print_err()                                                                            \
@@ -234,7 +267,7 @@ end:
 
 int
 ssl_create_csr(const char *req_file, const char *key_file, const char *passphrase,
-	       const char *common_name, const char *uid, bool tpmkey, rsa_padding_t rsa_padding)
+	       const char *common_name, const char *uid, bool tpmkey, ssl_key_type_t key_type)
 {
 	ASSERT(req_file);
 	ASSERT(key_file);
@@ -248,7 +281,7 @@ ssl_create_csr(const char *req_file, const char *key_file, const char *passphras
 	int pass_len = 0;
 
 	if (!tpmkey) {
-		pkeyp = ssl_mkkeypair(rsa_padding);
+		pkeyp = ssl_mkkeypair(key_type);
 
 		if (NULL == pkeyp) {
 			ERROR("Error creating public key pair");
@@ -402,8 +435,14 @@ ssl_mkreq(EVP_PKEY *pkeyp, const char *common_name, const char *uid, UNUSED bool
 		goto error;
 	}
 
-	/* Standard extenions */
-	if (add_ext_req(exts, NID_key_usage, KEY_USAGE_CSR) != 0) {
+	/* Standard extenions, keys for signatures only are not usable for key encipherment */
+	char *key_usage = KEY_USAGE_CSR;
+	if (EVP_PKEY_EC == EVP_PKEY_base_id(pkeyp))
+		key_usage = KEY_USAGE_CSR_EC;
+	else if (EVP_PKEY_ED25519 == EVP_PKEY_base_id(pkeyp))
+		key_usage = KEY_USAGE_CSR_ED25519;
+
+	if (add_ext_req(exts, NID_key_usage, key_usage) != 0) {
 		ERROR("Error setting CSR extension (NID_key_usage)");
 		goto error;
 	}
@@ -431,7 +470,7 @@ ssl_mkreq(EVP_PKEY *pkeyp, const char *common_name, const char *uid, UNUSED bool
 	DEBUG("Certificate request initialized");
 
 	const EVP_MD *hash_fct;
-	if ((hash_fct = EVP_get_digestbyname(SINGATURE_MD_CSR)) == NULL) {
+	if (ssl_get_sign_md(pkeyp, &hash_fct) < 0) {
 		ERROR("Error in signature verification (unable to initialize hash function)");
 		goto error;
 	}
@@ -452,17 +491,26 @@ error:
 }
 
 static EVP_PKEY *
-ssl_mkkeypair(rsa_padding_t key_type)
+ssl_mkkeypair(ssl_key_type_t key_type)
 {
 	//https://www.openssl.org/docs/man1.1.1/man3/EVP_PKEY_keygen_init.html
 	EVP_PKEY_CTX *ctx = NULL;
 	EVP_PKEY *pkey = NULL;
 	//const EVP_MD *hash_fct = EVP_sha512();
+	int curve_nid = NID_undef;
 
 	if (RSA_SSA_PADDING == key_type) {
 		ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
 	} else if (RSA_PSS_PADDING == key_type) {
 		ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA_PSS, NULL);
+	} else if (ECDSA_P256_KEY == key_type) {
+		ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+		curve_nid = NID_X9_62_prime256v1;
+	} else if (ECDSA_P384_KEY == key_type) {
+		ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+		curve_nid = NID_secp384r1;
+	} else if (ED25519_KEY == key_type) {
+		ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_ED25519, NULL);
 	} else {
 		ERROR("Unsupported key type");
 		return NULL;
@@ -478,11 +526,17 @@ ssl_mkkeypair(rsa_padding_t key_type)
 		goto out;
 	}
 
-	if (EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, RSA_KEY_SIZE_MKKEYP) <= 0) {
+	if ((RSA_SSA_PADDING == key_type || RSA_PSS_PADDING == key_type) &&
+	    EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, RSA_KEY_SIZE_MKKEYP) <= 0) {
 		ERROR("Failed to set key length");
 		goto out;
 	}
 
+	if (NID_undef != curve_nid && EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, curve_nid) <= 0) {
+		ERROR("Failed to set curve");
+		goto out;
+	}
+
 	/* Generate key */
 	if (EVP_PKEY_keygen(ctx, &pkey) <= 0) {
 		ERROR("Failed to generate keypair");
@@ -508,6 +562,216 @@ add_ext_req(STACK_OF(X509_EXTENSION) * sk, int nid, char *value)
 	return 0;
 }
 
+/*
+ * Derives the key encryption key for key wrapping with EC keys from the ECDH
+ * shared secret of the private key priv and the public key peer.
+ */
+static int
+ssl_derive_kek_ecdh(EVP_PKEY *priv, EVP_PKEY *peer, unsigned char *kek, size_t kek_len)
+{
+	int res = -1;
+	unsigned char *secret = NULL;
+	size_t secret_len = 0;
+	EVP_PKEY_CTX *kdf_ctx = NULL;
+
+	EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(priv, NULL);
+	IF_NULL_RETVAL_ERROR(ctx, -1);
+
+	if (EVP_PKEY_derive_init(ctx) <= 0 || EVP_PKEY_derive_set_peer(ctx, peer) <= 0 ||
+	    EVP_PKEY_derive(ctx, NULL, &secret_len) <= 0) {
+		ssl_print_err();
+		ERROR("Failed to set up ECDH key agreement");
+		goto out;
+	}
+
+	secret = mem_alloc0(secret_len);
+	if (EVP_PKEY_derive(ctx, secret, &secret_len) <= 0) {
+		ssl_print_err();
+		ERROR("ECDH key agreement failed");
+		goto out;
+	}
+
+	if ((kdf_ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, NULL)) == NULL) {
+		ERROR("Allocating HKDF context failed!");
+		goto out;
+	}
+	if (EVP_PKEY_derive_init(kdf_ctx) <= 0 ||
+	    EVP_PKEY_CTX_set_hkdf_md(kdf_ctx, EVP_get_digestbyname(KDF_MD_KEY_WRAP_ECDH)) <= 0 ||
+	    EVP_PKEY_CTX_set1_hkdf_key(kdf_ctx, secret, secret_len) <= 0 ||
+	    EVP_PKEY_CTX_add1_hkdf_info(kdf_ctx, (unsigned char *)KDF_INFO_KEY_WRAP_ECDH,
+					strlen(KDF_INFO_KEY_WRAP_ECDH)) <= 0 ||
+	    EVP_PKEY_derive(kdf_ctx, kek, &kek_len) <= 0) {
+		ssl_print_err();
+		ERROR("Failed to derive key encryption key");
+		goto out;
+	}
+
+	res = 0;
+out:
+	if (secret) {
+		mem_memset0(secret, secret_len);
+		mem_free0(secret);
+	}
+	EVP_PKEY_CTX_free(kdf_ctx);
+	EVP_PKEY_CTX_free(ctx);
+	return res;
+}
+
+/*
+ * Wraps or unwraps (encrypt == 0) in with the key wrap cipher for EC keys.
+ * out must provide space for inlen + 8 bytes, rounded up to the block size.
+ */
+static int
+ssl_cipher_key_wrap_ecdh(const unsigned char *kek, const unsigned char *in, int inlen,
+			 unsigned char *out, int *outlen, int encrypt)
+{
+	int res = -1;
+	int tmplen = 0;
+	const EVP_CIPHER *type;
+
+	if (!(type = EVP_get_cipherbyname(CIPHER_KEY_WRAP_ECDH))) {
+		ERROR("Error setting up cipher for key wrapping");
+		return res;
+	}
+
+	EVP_CIPHER_CTX *ctx;
+	if ((ctx = EVP_CIPHER_CTX_new()) == NULL) {
+		ERROR("Allocating EVP cipher failed!");
+		return res;
+	}
+	EVP_CIPHER_CTX_set_flags(ctx, EVP_CIPHER_CTX_FLAG_WRAP_ALLOW);
+
+	// default IV as defined in RFC 5649
+	if (1 != EVP_CipherInit_ex(ctx, type, NULL, kek, NULL, encrypt) ||
+	    1 != EVP_CipherUpdate(ctx, out, &tmplen, in, inlen)) {
+		WARN("Key wrap cipher failed");
+		goto cleanup;
+	}
+	*outlen = tmplen;
+	if (1 != EVP_CipherFinal_ex(ctx, out + tmplen, &tmplen)) {
+		WARN("Key wrap cipher failed");
+		goto cleanup;
+	}
+	*outlen += tmplen;
+
+	res = 0;
+cleanup:
+	EVP_CIPHER_CTX_free(ctx);
+	return res;
+}
+
+/*
+ * Wraps plain_key for the EC public key pkey. The wrapped key consists of the
+ * length of the ephemeral public key, the length of the encrypted key, the DER
+ * encoded ephemeral public key and the encrypted key.
+ */
+static int
+ssl_wrap_key_ecdh(EVP_PKEY *pkey, const unsigned char *plain_key, size_t plain_key_len,
+		  unsigned char **wrapped_key, int *wrapped_key_len)
+{
+	int res = -1;
+	EVP_PKEY *eph_key = NULL;
+	unsigned char *eph_pub = NULL;
+	unsigned char kek[32];
+	unsigned char *out = NULL;
+	int outlen = 0;
+
+	IF_TRUE_RETVAL_ERROR(plain_key_len > INT_MAX - 16, -1);
+
+	// the ephemeral key is created on the curve of pkey
+	EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(pkey, NULL);
+	IF_NULL_RETVAL_ERROR(ctx, -1);
+	if (EVP_PKEY_keygen_init(ctx) <= 0 || EVP_PKEY_keygen(ctx, &eph_key) <= 0) {
+		ssl_print_err();
+		ERROR("Failed to generate ephemeral key for key wrapping");
+		goto out;
+	}
+
+	int eph_pub_len = i2d_PUBKEY(eph_key, &eph_pub);
+	if (eph_pub_len <= 0) {
+		ERROR("Failed to encode ephemeral public key");
+		goto out;
+	}
+
+	if (ssl_derive_kek_ecdh(eph_key, pkey, kek, sizeof(kek)) < 0)
+		goto out;
+
+	out = mem_alloc0(plain_key_len + 16);
+	if (ssl_cipher_key_wrap_ecdh(kek, plain_key, plain_key_len, out, &outlen, 1) < 0)
+		goto out;
+
+	size_t len = ADD_WITH_OVERFLOW_CHECK(2 * sizeof(int), (size_t)eph_pub_len);
+	len = ADD_WITH_OVERFLOW_CHECK(len, (size_t)outlen);
+	unsigned char *p = mem_alloc(len);
+	*wrapped_key_len = len;
+	*wrapped_key = p;
+	memcpy(p, &eph_pub_len, sizeof(int));
+	p += sizeof(int);
+	memcpy(p, &outlen, sizeof(int));
+	p += sizeof(int);
+	memcpy(p, eph_pub, eph_pub_len);
+	p += eph_pub_len;
+	memcpy(p, out, outlen);
+
+	res = 0;
+out:
+	mem_memset0(kek, sizeof(kek));
+	if (out) {
+		mem_memset0(out, plain_key_len + 16);
+		mem_free0(out);
+	}
+	OPENSSL_free(eph_pub);
+	EVP_PKEY_free(eph_key);
+	EVP_PKEY_CTX_free(ctx);
+	return res;
+}
+
+static int
+ssl_unwrap_key_ecdh(EVP_PKEY *pkey, const unsigned char *wrapped_key, size_t wrapped_key_len,
+		    unsigned char **plain_key, int *plain_key_len)
+{
+	int res = -1;
+	EVP_PKEY *eph_key = NULL;
+	unsigned char kek[32];
+
+	if (wrapped_key_len < 2 * sizeof(int)) {
+		WARN("Given wrapped key is invalid/corrupted.");
+		return res;
+	}
+	int eph_pub_len = *((int *)wrapped_key);
+	wrapped_key += sizeof(int);
+	int keylen = *((int *)wrapped_key);
+	wrapped_key += sizeof(int);
+	if (eph_pub_len <= 0 || keylen <= 0 ||
+	    wrapped_key_len != 2 * sizeof(int) + (size_t)eph_pub_len + (size_t)keylen) {
+		WARN("Given wrapped key is invalid/corrupted.");
+		return res;
+	}
+
+	const unsigned char *eph_pub = wrapped_key;
+	if ((eph_key = d2i_PUBKEY(NULL, &eph_pub, eph_pub_len)) == NULL) {
+		WARN("Given wrapped key contains no valid ephemeral key.");
+		return res;
+	}
+	wrapped_key += eph_pub_len;
+
+	if (ssl_derive_kek_ecdh(pkey, eph_key, kek, sizeof(kek)) < 0)
+		goto out;
+
+	unsigned char *out = mem_alloc0(keylen);
+	if (ssl_cipher_key_wrap_ecdh(kek, wrapped_key, keylen, out, plain_key_len, 0) < 0) {
+		mem_free0(out);
+		goto out;
+	}
+	*plain_key = out;
+
+	res = 0;
+out:
+	mem_memset0(kek, sizeof(kek));
+	EVP_PKEY_free(eph_key);
+	return res;
+}
+
 int
 ssl_wrap_key(EVP_PKEY *pkey, const unsigned char *plain_key, size_t plain_key_len,
 	     unsigned char **wrapped_key, int *wrapped_key_len)
@@ -517,6 +781,14 @@ ssl_wrap_key(EVP_PKEY *pkey, const unsigned char *plain_key, size_t plain_key_le
 	ASSERT(wrapped_key);
 	ASSERT(wrapped_key_len);
 
+	if (EVP_PKEY_EC == EVP_PKEY_base_id(pkey))
+		return ssl_wrap_key_ecdh(pkey, plain_key, plain_key_len, wrapped_key,
+					 wrapped_key_len);
+	if (EVP_PKEY_ED25519 == EVP_PKEY_base_id(pkey)) {
+		ERROR("Ed25519 keys do not support key wrapping");
+		return -1;
+	}
+
 	int res = -1;
 	const EVP_CIPHER *type;
 	const size_t max_out_len = plain_key_len + EVP_MAX_BLOCK_LENGTH;
@@ -603,6 +875,14 @@ ssl_unwrap_key(EVP_PKEY *pkey, const unsigned char *wrapped_key, size_t wrapped_
 	ASSERT(plain_key);
 	ASSERT(plain_key_len);
 
+	if (EVP_PKEY_EC == EVP_PKEY_base_id(pkey))
+		return ssl_unwrap_key_ecdh(pkey, wrapped_key, wrapped_key_len, plain_key,
+					   plain_key_len);
+	if (EVP_PKEY_ED25519 == EVP_PKEY_base_id(pkey)) {
+		ERROR("Ed25519 keys do not support key unwrapping");
+		return -1;
+	}
+
 	int res = -1;
 	const EVP_CIPHER *type;
 	const size_t max_out_len = wrapped_key_len + EVP_MAX_BLOCK_LENGTH;
@@ -966,6 +1246,130 @@ ssl_set_pkey_ctx_rsa_pss(EVP_PKEY_CTX *ctx, const EVP_MD *hash_fct)
 	return 0;
 }
 
+static int
+ssl_get_sign_md(EVP_PKEY *pkey, const EVP_MD **md)
+{
+	switch (EVP_PKEY_base_id(pkey)) {
+	case EVP_PKEY_ED25519:
+		*md = NULL;
+		return 0;
+	case EVP_PKEY_EC:
+		*md = EVP_PKEY_bits(pkey) > 256 ? EVP_sha384() : EVP_sha256();
+		break;
+	default:
+		*md = EVP_get_digestbyname(SINGATURE_MD_CSR);
+		break;
+	}
+	return *md ? 0 : -1;
+}
+
+/*
+ * Loads the public key of the PEM encoded certificate in cert_buf.
+ */
+static EVP_PKEY *
+ssl_get_pubkey_from_cert_buf(const char *cert_buf, size_t cert_len)
+{
+	BIO *mem = BIO_new_mem_buf(cert_buf, cert_len);
+	IF_NULL_RETVAL_ERROR(mem, NULL);
+	X509 *cert = PEM_read_bio_X509(mem, NULL, 0, NULL);
+	BIO_free(mem);
+	IF_NULL_RETVAL_ERROR(cert, NULL);
+
+	EVP_PKEY *key = X509_get_pubkey(cert);
+	X509_free(cert);
+	return key;
+}
+
+/*
+ * Verifies a signature over the data itself, which is required for Ed25519.
+ */
+static int
+ssl_verify_signature_from_msg(EVP_PKEY *key, const uint8_t *sig_buf, size_t sig_len,
+			      const uint8_t *buf, size_t buf_len)
+{
+	int ret = -2;
+	EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+	IF_NULL_RETVAL_ERROR(md_ctx, -2);
+
+	if (EVP_DigestVerifyInit(md_ctx, NULL, NULL, NULL, key) != 1) {
+		ERROR("EVP_DigestVerifyInit failed");
+		goto out;
+	}
+
+	ret = EVP_DigestVerify(md_ctx, sig_buf, sig_len, buf, buf_len);
+	if (ret == 1) {
+		DEBUG("Signature successfully verified");
+		ret = 0;
+	} else {
+		ERROR("EVP_DigestVerify error");
+		ssl_print_err();
+		ret = (ret == 0) ? -1 : -2;
+	}
+out:
+	EVP_MD_CTX_free(md_ctx);
+	return ret;
+}
+
+int
+ssl_sign_buf(EVP_PKEY *pkey, const uint8_t *buf, size_t buf_len, const char *digest_algo,
+	     uint8_t **sig, size_t *sig_len)
+{
+	ASSERT(pkey);
+	ASSERT(buf);
+	ASSERT(sig);
+	ASSERT(sig_len);
+
+	int ret = -1;
+	const EVP_MD *digest_fct = NULL;
+	EVP_PKEY_CTX *pkey_ctx = NULL;
+	int key_base_id = EVP_PKEY_base_id(pkey);
+
+	*sig = NULL;
+	*sig_len = 0;
+
+	if (EVP_PKEY_ED25519 != key_base_id) {
+		ASSERT(digest_algo);
+		if ((digest_fct = EVP_get_digestbyname(digest_algo)) == NULL) {
+			ERROR("Error in signing (unable to initialize digest %s)", digest_algo);
+			return -1;
+		}
+	}
+
+	EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+	IF_NULL_RETVAL_ERROR(md_ctx, -1);
+
+	if (EVP_DigestSignInit(md_ctx, &pkey_ctx, digest_fct, NULL, pkey) != 1) {
+		ssl_print_err();
+		ERROR("EVP_DigestSignInit failed");
+		goto out;
+	}
+
+	// same parameters as used by ssl_verify_signature_from_digest()
+	if (EVP_PKEY_RSA_PSS == key_base_id && ssl_set_pkey_ctx_rsa_pss(pkey_ctx, digest_fct) < 0) {
+		ERROR("Failed to configue ctx for RSA-PSS padding scheme");
+		goto out;
+	}
+
+	size_t len = 0;
+	if (EVP_DigestSign(md_ctx, NULL, &len, buf, buf_len) != 1) {
+		ERROR("Failed to determine signature length");
+		goto out;
+	}
+	*sig = mem_alloc0(len);
+	if (EVP_DigestSign(md_ctx, *sig, &len, buf, buf_len) != 1) {
+		ssl_print_err();
+		ERROR("EVP_DigestSign failed");
+		mem_free0(*sig);
+		goto out;
+	}
+	*sig_len = len;
+
+	ret = 0;
+out:
+	EVP_MD_CTX_free(md_ctx);
+	return ret;
+}
+
 int
 ssl_verify_signature_from_digest(const char *cert_buf, size_t cert_len, const uint8_t *sig_buf,
 				 size_t sig_len, const uint8_t *hash, size_t hash_len,
@@ -1027,14 +1431,19 @@ ssl_verify_signature_from_digest(const char *cert_buf, size_t cert_len, const ui
 			ERROR("Failed to configue ctx for RSA-PSS padding scheme");
 			goto error;
 		}
-	} else if (EVP_PKEY_RSA == key_base_id) {
-		DEBUG("Verifying signature with OpenSSL default padding scheme");
+	} else if (EVP_PKEY_RSA == key_base_id || EVP_PKEY_EC == key_base_id) {
+		DEBUG("Verifying signature with OpenSSL default %s scheme",
+		      EVP_PKEY_EC == key_base_id ? "ECDSA" : "padding");
 		if (EVP_PKEY_CTX_set_signature_md(pkey_ctx, digest_fct) != 1) {
 			DEBUG("EVP_PKEY_CTX_set_signature_md failed");
 			ret = -2;
 			goto error;
 		}
 
+	} else if (EVP_PKEY_ED25519 == key_base_id) {
+		ERROR("Ed25519 signatures can only be verified over the signed data, not a digest");
+		ret = -2;
+		goto error;
 	} else {
 		ERROR("Unsupported key type");
 		ret = -1;
@@ -1076,7 +1485,6 @@ ssl_hash_buf(const unsigned char *buf_to_hash, unsigned int buf_len, unsigned in
 	ASSERT(digest_algo);
 
 	unsigned char *ret = NULL;
-	FILE *fp = NULL;
 	const EVP_MD *hash_fct;
 	EVP_MD_CTX *md_ctx = NULL;
 
@@ -1087,7 +1495,6 @@ ssl_hash_buf(const unsigned char *buf_to_hash, unsigned int buf_len, unsigned in
 
 	if ((md_ctx = EVP_MD_CTX_new()) == NULL) {
 		ERROR("Allocating EVP_MD failed!");
-		fclose(fp);
 		return NULL;
 	}
 
@@ -1095,7 +1502,6 @@ ssl_hash_buf(const unsigned char *buf_to_hash, unsigned int buf_len, unsigned in
 
 	if (!EVP_DigestUpdate(md_ctx, buf_to_hash, buf_len)) {
 		ERROR("Error in buffer hashing");
-		fclose(fp);
 		goto error;
 	}
 
@@ -1112,69 +1518,299 @@ error:
 	return ret;
 }
 
-unsigned char *
-ssl_hash_file(const char *file_to_hash, unsigned int *calc_len, const char *hash_algo)
+/*
+ * Feeds a chunk to all digests. Passing each chunk to every digest before
+ * loading the next one keeps the data in the cpu cache for all of them.
+ */
+static int
+ssl_hash_update_all(EVP_MD_CTX **md_ctxs, size_t md_ctxs_len, const unsigned char *buf, size_t len)
 {
-	ASSERT(file_to_hash);
-	ASSERT(hash_algo);
+	for (size_t i = 0; i < md_ctxs_len; ++i) {
+		if (!EVP_DigestUpdate(md_ctxs[i], buf, len))
+			return -1;
+	}
+	return 0;
+}
 
-	unsigned char *ret = NULL;
-	FILE *fp = NULL;
-	const EVP_MD *hash_fct;
-	EVP_MD_CTX *md_ctx = NULL;
+/*
+ * Reads the file with the given buffer until EOF and feeds it to all digests.
+ * If the fd was opened with O_DIRECT and the kernel refuses a direct read,
+ * O_DIRECT is dropped and reading continues through the page cache.
+ */
+static int
+ssl_hash_fd_read_loop(int fd, EVP_MD_CTX **md_ctxs, size_t md_ctxs_len, unsigned char *buf,
+		      size_t buf_size)
+{
+	ssize_t len;
+	while ((len = read(fd, buf, buf_size)) != 0) {
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			int read_errno = errno;
+			int flags = fcntl(fd, F_GETFL);
+			if (read_errno == EINVAL && flags >= 0 && (flags & O_DIRECT)) {
+				TRACE("Direct read refused, continuing with buffered read");
+				if (fcntl(fd, F_SETFL, flags & ~O_DIRECT) == 0)
+					continue;
+			}
+			errno = read_errno;
+			ERROR_ERRNO("Error in file hashing (reading file failed)");
+			return -1;
+		}
+		if (ssl_hash_update_all(md_ctxs, md_ctxs_len, buf, len) < 0)
+			return -1;
+	}
+	return 0;
+}
 
-	if (!(fp = fopen(file_to_hash, "rb"))) {
-		ERROR("Error in file hasing (opening hash file)");
-		return NULL;
+static int
+ssl_hash_fd_update_read(int fd, EVP_MD_CTX **md_ctxs, size_t md_ctxs_len)
+{
+	if (posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL))
+		TRACE("posix_fadvise failed, continuing anyway");
+
+	unsigned char *buf = mem_alloc(SSL_HASH_BUFFER_SIZE);
+	int ret = ssl_hash_fd_read_loop(fd, md_ctxs, md_ctxs_len, buf, SSL_HASH_BUFFER_SIZE);
+	mem_free0(buf);
+	return ret;
+}
+
+static int
+ssl_hash_fd_update_mmap(int fd, size_t size, EVP_MD_CTX **md_ctxs, size_t md_ctxs_len)
+{
+	unsigned char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		TRACE_ERRNO("mmap failed, falling back to buffered read");
+		return ssl_hash_fd_update_read(fd, md_ctxs, md_ctxs_len);
 	}
 
-	if ((hash_fct = EVP_get_digestbyname(hash_algo)) == NULL) {
-		ERROR("Error in file hasing (unable to initialize hash function");
-		fclose(fp);
-		return NULL;
+	if (madvise(map, size, MADV_SEQUENTIAL) < 0)
+		TRACE_ERRNO("madvise failed, continuing anyway");
+
+	int ret = 0;
+	for (size_t off = 0; off < size && ret == 0; off += SSL_HASH_BUFFER_SIZE) {
+		// request the next window while the current one is hashed
+		if (off % SSL_HASH_READAHEAD_SIZE == 0 && off + SSL_HASH_READAHEAD_SIZE < size) {
+			size_t ra_off = off + SSL_HASH_READAHEAD_SIZE;
+			size_t ra_len = MIN(size - ra_off, (size_t)SSL_HASH_READAHEAD_SIZE);
+			if (madvise(map + ra_off, ra_len, MADV_WILLNEED) < 0)
+				TRACE_ERRNO("madvise failed, continuing anyway");
+		}
+		size_t len = MIN(size - off, (size_t)SSL_HASH_BUFFER_SIZE);
+		ret = ssl_hash_update_all(md_ctxs, md_ctxs_len, map + off, len);
 	}
+	munmap(map, size);
+	return ret;
+}
 
-	if ((md_ctx = EVP_MD_CTX_new()) == NULL) {
-		ERROR("Allocating EVP_MD failed!");
-		fclose(fp);
-		return NULL;
+static int
+ssl_hash_fd_update_direct(int fd, EVP_MD_CTX **md_ctxs, size_t md_ctxs_len)
+{
+	int flags = fcntl(fd, F_GETFL);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_DIRECT) < 0) {
+		TRACE_ERRNO("O_DIRECT not supported, falling back to buffered read");
+		return ssl_hash_fd_update_read(fd, md_ctxs, md_ctxs_len);
 	}
 
-	EVP_DigestInit(md_ctx, hash_fct);
+	void *buf = NULL;
+	if ((errno = posix_memalign(&buf, SSL_HASH_DIRECT_ALIGNMENT,
+				    SSL_HASH_DIRECT_BUFFER_SIZE))) {
+		ERROR_ERRNO("Could not allocate aligned buffer for file hashing");
+		return -1;
+	}
+	int ret = ssl_hash_fd_read_loop(fd, md_ctxs, md_ctxs_len, buf, SSL_HASH_DIRECT_BUFFER_SIZE);
+	free(buf);
+	return ret;
+}
 
-	int len = 0;
-	unsigned char buffer[SIGN_HASH_BUFFER_SIZE];
+/*
+ * Returns the percentage of the file's pages which are resident in the page
+ * cache or -1 if this could not be determined.
+ */
+static int
+ssl_hash_fd_cached_percent(int fd, size_t size)
+{
+	long page_size = sysconf(_SC_PAGESIZE);
+	IF_TRUE_RETVAL(page_size <= 0, -1);
 
-	while ((len = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
-		if (!EVP_DigestUpdate(md_ctx, buffer, len)) {
-			ERROR("Error in file hashing (reading/hashing file failed");
-			fclose(fp);
+	// the mapping is never touched, thus no page is read in by this
+	void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	IF_TRUE_RETVAL(map == MAP_FAILED, -1);
+
+	size_t pages = (size + page_size - 1) / page_size;
+	unsigned char *vec = mem_alloc(pages);
+	int ret = -1;
+	if (mincore(map, size, vec) == 0) {
+		size_t resident = 0;
+		for (size_t i = 0; i < pages; ++i)
+			resident += vec[i] & 1;
+		ret = resident * 100 / pages;
+	}
+	mem_free0(vec);
+	munmap(map, size);
+	return ret;
+}
+
+static ssl_hash_strategy_t
+ssl_hash_fd_choose_strategy(int fd, const struct stat *s)
+{
+	// the setup costs of a mapping do not pay off for small files
+	if (!S_ISREG(s->st_mode) || s->st_size < SSL_HASH_MMAP_THRESHOLD)
+		return SSL_HASH_STRATEGY_READ;
+	if (s->st_size < SSL_HASH_DIRECT_THRESHOLD)
+		return SSL_HASH_STRATEGY_MMAP;
+
+	/*
+	 * Large images which are not cached are read directly from the device with
+	 * large requests instead of evicting the page cache, cached ones are mapped.
+	 */
+	int cached = ssl_hash_fd_cached_percent(fd, s->st_size);
+	TRACE("%d%% of file to hash are cached", cached);
+	if (cached >= 0 && cached < SSL_HASH_DIRECT_CACHED_PERCENT)
+		return SSL_HASH_STRATEGY_DIRECT;
+	return SSL_HASH_STRATEGY_MMAP;
+}
+
+static int
+ssl_hash_fd_update(int fd, EVP_MD_CTX **md_ctxs, size_t md_ctxs_len, ssl_hash_strategy_t strategy)
+{
+	struct stat s;
+	if (fstat(fd, &s) < 0) {
+		ERROR_ERRNO("Error in file hashing (stat failed)");
+		return -1;
+	}
+
+	if (strategy == SSL_HASH_STRATEGY_AUTO)
+		strategy = ssl_hash_fd_choose_strategy(fd, &s);
+
+	// only regular files with content can be mapped
+	if (strategy == SSL_HASH_STRATEGY_MMAP && (!S_ISREG(s.st_mode) || s.st_size == 0))
+		strategy = SSL_HASH_STRATEGY_READ;
+
+	TRACE("Hashing file using %s strategy", ssl_hash_strategy_to_string(strategy));
+
+	switch (strategy) {
+	case SSL_HASH_STRATEGY_MMAP:
+		return ssl_hash_fd_update_mmap(fd, s.st_size, md_ctxs, md_ctxs_len);
+	case SSL_HASH_STRATEGY_DIRECT:
+		return ssl_hash_fd_update_direct(fd, md_ctxs, md_ctxs_len);
+	default:
+		return ssl_hash_fd_update_read(fd, md_ctxs, md_ctxs_len);
+	}
+}
+
+const char *
+ssl_hash_strategy_to_string(ssl_hash_strategy_t strategy)
+{
+	switch (strategy) {
+	case SSL_HASH_STRATEGY_AUTO:
+		return "auto";
+	case SSL_HASH_STRATEGY_READ:
+		return "read";
+	case SSL_HASH_STRATEGY_MMAP:
+		return "mmap";
+	case SSL_HASH_STRATEGY_DIRECT:
+		return "direct";
+	default:
+		return "unknown";
+	}
+}
+
+int
+ssl_hash_file_multi_strategy(const char *file_to_hash, const char **hash_algos,
+			     size_t hash_algos_len, unsigned char **hashes, unsigned int *hash_lens,
+			     ssl_hash_strategy_t strategy)
+{
+	ASSERT(file_to_hash);
+	ASSERT(hash_algos);
+	ASSERT(hashes);
+	ASSERT(hash_lens);
+
+	IF_FALSE_RETVAL_ERROR(0 < hash_algos_len, -1);
+
+	int ret = -1;
+	int fd = -1;
+	EVP_MD_CTX **md_ctxs = mem_new0(EVP_MD_CTX *, hash_algos_len);
+
+	for (size_t i = 0; i < hash_algos_len; ++i) {
+		hashes[i] = NULL;
+		hash_lens[i] = 0;
+	}
+
+	for (size_t i = 0; i < hash_algos_len; ++i) {
+		const EVP_MD *hash_fct;
+		if ((hash_fct = EVP_get_digestbyname(hash_algos[i])) == NULL) {
+			ERROR("Error in file hasing (unable to initialize hash function %s)",
+			      hash_algos[i]);
+			goto error;
+		}
+		if ((md_ctxs[i] = EVP_MD_CTX_new()) == NULL) {
+			ERROR("Allocating EVP_MD failed!");
+			goto error;
+		}
+		if (EVP_DigestInit_ex(md_ctxs[i], hash_fct, NULL) != 1) {
+			ERROR("Error in file hashing (initializing %s failed)", hash_algos[i]);
 			goto error;
 		}
 	}
-	fclose(fp);
 
-	ret = (unsigned char *)mem_alloc0(EVP_MAX_MD_SIZE);
-	if (EVP_DigestFinal(md_ctx, ret, calc_len) != 1) {
-		ERROR("Error in file hashing (computing hash)");
-		mem_free0(ret);
-		ret = NULL;
+	if ((fd = open(file_to_hash, O_RDONLY | O_CLOEXEC)) < 0) {
+		ERROR_ERRNO("Error in file hasing (opening hash file %s)", file_to_hash);
+		goto error;
+	}
+
+	if (ssl_hash_fd_update(fd, md_ctxs, hash_algos_len, strategy) < 0) {
+		ERROR("Error in file hashing (reading/hashing file %s failed)", file_to_hash);
 		goto error;
 	}
-	/* DEBUG OUTPUT
-	char *string = mem_alloc0(*calc_len*2+1);
-	for (unsigned int i = 0;  i < *calc_len;  i++) snprintf(string+2*i, 3, "%02x", ret[i]);
-	DEBUG("Calc hash: %s", string);
-	*/
+
+	for (size_t i = 0; i < hash_algos_len; ++i) {
+		hashes[i] = mem_alloc0(EVP_MAX_MD_SIZE);
+		if (EVP_DigestFinal_ex(md_ctxs[i], hashes[i], &hash_lens[i]) != 1) {
+			ERROR("Error in file hashing (computing hash)");
+			goto error;
+		}
+	}
+	ret = 0;
 
 error:
-	EVP_MD_CTX_free(md_ctx);
+	if (fd >= 0)
+		close(fd);
+	for (size_t i = 0; i < hash_algos_len; ++i) {
+		if (md_ctxs[i])
+			EVP_MD_CTX_free(md_ctxs[i]);
+		if (ret && hashes[i]) {
+			mem_free0(hashes[i]);
+			hash_lens[i] = 0;
+		}
+	}
+	mem_free0(md_ctxs);
 	return ret;
 }
 
+int
+ssl_hash_file_multi(const char *file_to_hash, const char **hash_algos, size_t hash_algos_len,
+		    unsigned char **hashes, unsigned int *hash_lens)
+{
+	return ssl_hash_file_multi_strategy(file_to_hash, hash_algos, hash_algos_len, hashes,
+					    hash_lens, SSL_HASH_STRATEGY_AUTO);
+}
+
+unsigned char *
+ssl_hash_file(const char *file_to_hash, unsigned int *calc_len, const char *hash_algo)
+{
+	ASSERT(file_to_hash);
+	ASSERT(hash_algo);
+
+	unsigned char *hash = NULL;
+	IF_TRUE_RETVAL(ssl_hash_file_multi(file_to_hash, &hash_algo, 1, &hash, calc_len) < 0, NULL);
+
+	return hash;
+}
+
 int
 ssl_create_pkcs12_token(const char *token_file, const char *cert_file, const char *passphrase,
-			const char *user_name, rsa_padding_t rsa_padding)
+			const char *user_name, ssl_key_type_t key_type)
 {
 	ASSERT(token_file && passphrase);
 
@@ -1184,7 +1820,7 @@ ssl_create_pkcs12_token(const char *token_file, const char *cert_file, const cha
 	PKCS12 *p12 = NULL;
 	char *passphr = mem_strdup(passphrase);
 
-	pkey = ssl_mkkeypair(rsa_padding);
+	pkey = ssl_mkkeypair(key_type);
 
 	if (NULL == pkey) {
 		ERROR("Error creating public-key pair");
@@ -1440,7 +2076,8 @@ ssl_mkcert(EVP_PKEY *pkeyp, const char *common_name)
 	DEBUG("Certificate initialized");
 	//DEBUG("Error status: %s", ERR_error_string(ERR_get_error(), NULL));
 
-	if (!X509_sign(cert, pkeyp, EVP_sha256())) {
+	const EVP_MD *md;
+	if (ssl_get_sign_md(pkeyp, &md) < 0 || !X509_sign(cert, pkeyp, md)) {
 		ERROR("Error signing certificate");
 		return NULL;
 	}
@@ -1496,7 +2133,6 @@ ssl_self_sign_csr(const char *csr_file, const char *cert_file, const char *key_f
 	BIO *csr = NULL;
 	BIO *cert = NULL;
 	BIO *key = NULL;
-	RSA *key_rsa = NULL;
 	EVP_PKEY *key_evp_priv = NULL;
 	EVP_PKEY *key_evp_pub = NULL;
 	X509_REQ *csr_x509 = NULL;
@@ -1523,19 +2159,9 @@ ssl_self_sign_csr(const char *csr_file, const char *cert_file, const char *key_f
 			goto error;
 		}
 
-		if ((key_evp_priv = EVP_PKEY_new()) == NULL) {
-			ERROR("Error creating evp priv key");
-			goto error;
-		}
-
-		if ((PEM_read_bio_RSAPrivateKey(key, &key_rsa, NULL, NULL)) == NULL) {
-			ERROR("error reading rsa priv key");
-			goto error;
-		}
-
-		if (EVP_PKEY_assign_RSA(key_evp_priv, key_rsa) != 1) {
-			ERROR("error assigning rsa priv key");
-			RSA_free(key_rsa);
+		// RSA, EC or Ed25519 key
+		if ((key_evp_priv = PEM_read_bio_PrivateKey(key, NULL, NULL, NULL)) == NULL) {
+			ERROR("error reading priv key");
 			goto error;
 		}
 	} else {
@@ -1619,7 +2245,8 @@ ssl_self_sign_csr(const char *csr_file, const char *cert_file, const char *key_f
 	DEBUG("Self-sign device cert initialized");
 
 	// sign cert
-	if (!X509_sign(cert_x509, key_evp_priv, EVP_sha256())) {
+	const EVP_MD *md;
+	if (ssl_get_sign_md(key_evp_priv, &md) < 0 || !X509_sign(cert_x509, key_evp_priv, md)) {
 		ERROR("Error signing certificate");
 		goto error;
 	}
@@ -1652,7 +2279,6 @@ error:
 		X509_free(cert_x509);
 	if (csr_x509)
 		X509_REQ_free(csr_x509);
-	// EVP_PKEY_free also frees rsa key if assigned
 	if (key_evp_pub)
 		EVP_PKEY_free(key_evp_pub);
 	if (ext_stack)
@@ -1660,6 +2286,40 @@ error:
 	return ret;
 }
 
+const char *
+ssl_key_type_to_string(ssl_key_type_t key_type)
+{
+	switch (key_type) {
+	case RSA_PSS_PADDING:
+		return "rsa-pss";
+	case RSA_SSA_PADDING:
+		return "rsa";
+	case ECDSA_P256_KEY:
+		return "ecdsa-p256";
+	case ECDSA_P384_KEY:
+		return "ecdsa-p384";
+	case ED25519_KEY:
+		return "ed25519";
+	default:
+		return "unknown";
+	}
+}
+
+int
+ssl_key_type_from_string(const char *name, ssl_key_type_t *key_type)
+{
+	ASSERT(name);
+	ASSERT(key_type);
+
+	for (ssl_key_type_t t = RSA_PSS_PADDING; t <= ED25519_KEY; ++t) {
+		if (!strcasecmp(name, ssl_key_type_to_string(t))) {
+			*key_type = t;
+			return 0;
+		}
+	}
+	return -1;
+}
+
 const char *
 get_digest_name_by_sig_algo_obj(const ASN1_OBJECT *obj)
 {
@@ -1675,6 +2335,12 @@ get_digest_name_by_sig_algo_obj(const ASN1_OBJECT *obj)
 		return "sha512";
 	case NID_sha224WithRSAEncryption:
 		return "sha224";
+	case NID_ecdsa_with_SHA256:
+		return "sha256";
+	case NID_ecdsa_with_SHA384:
+		return "sha384";
+	case NID_ecdsa_with_SHA512:
+		return "sha512";
 	default:
 		return NULL;
 	}
@@ -1693,15 +2359,19 @@ ssl_verify_signature_from_buf(uint8_t *cert_buf, size_t cert_len, const uint8_t
 
 	int ret = 0;
 
-	// certificate variables
-	X509 *cert;
-	BIO *mem;
+	EVP_PKEY *key = ssl_get_pubkey_from_cert_buf((char *)cert_buf, cert_len);
+	if (key == NULL) {
+		ERROR("Error in signature verification (loading pubkey failed)");
+		return -2;
+	}
 
-	// load certificate
-	mem = BIO_new(BIO_s_mem());
-	BIO_write(mem, cert_buf, cert_len);
-	cert = PEM_read_bio_X509(mem, NULL, 0, NULL);
-	BIO_free(mem);
+	// Ed25519 signs the data itself instead of a digest
+	if (EVP_PKEY_ED25519 == EVP_PKEY_base_id(key)) {
+		ret = ssl_verify_signature_from_msg(key, sig_buf, sig_len, buf, buf_len);
+		EVP_PKEY_free(key);
+		return ret;
+	}
+	EVP_PKEY_free(key);
 
 	DEBUG("Hash algo: %s", digest_algo);
 	unsigned int hash_len = 0;
@@ -1715,50 +2385,144 @@ ssl_verify_signature_from_buf(uint8_t *cert_buf, size_t cert_len, const uint8_t
 	}
 
 	mem_free0(hash);
-	if (cert)
-		X509_free(cert);
 
 	return ret;
 }
 
 int
-ssl_verify_signature(const char *cert_file, const char *signature_file, const char *signed_file,
-		     const char *digest_algo)
+ssl_verify_signature_hash_file(const char *cert_file, const char *signature_file,
+			       const char *signed_file, const char *digest_algo,
+			       const char **hash_algos, size_t hash_algos_len,
+			       unsigned char **hashes, unsigned int *hash_lens)
 {
 	ASSERT(cert_file);
 	ASSERT(signature_file);
 	ASSERT(signed_file);
+	ASSERT(digest_algo);
+	ASSERT(hash_algos_len == 0 || (hash_algos && hashes && hash_lens));
 
-	off_t cert_len = file_size(cert_file);
-	char *cert_buf = mem_alloc0(cert_len);
+	int ret = -2;
+	char *cert_buf = NULL;
+	unsigned char *sig_buf = NULL;
+	EVP_PKEY *key = NULL;
+
+	for (size_t i = 0; i < hash_algos_len; ++i) {
+		hashes[i] = NULL;
+		hash_lens[i] = 0;
+	}
 
+	off_t cert_len = file_size(cert_file);
+	IF_TRUE_RETVAL_ERROR(cert_len <= 0, -2);
+	cert_buf = mem_alloc0(cert_len);
 	if (0 > file_read(cert_file, cert_buf, cert_len)) {
 		ERROR("Failed to read cert file");
-		return -1;
+		goto out;
 	}
 
-	int sig_len = file_size(signature_file);
-	unsigned char *sig_buf = mem_alloc0(sig_len);
-
+	off_t sig_len = file_size(signature_file);
+	IF_TRUE_GOTO_ERROR(sig_len <= 0, out);
+	sig_buf = mem_alloc0(sig_len);
 	if (0 > file_read(signature_file, (char *)sig_buf, sig_len)) {
 		ERROR("Failed to read signature file");
-		return -1;
+		goto out;
 	}
 
-	unsigned int hash_len;
-	unsigned char *hash = ssl_hash_file(signed_file, &hash_len, digest_algo);
+	if ((key = ssl_get_pubkey_from_cert_buf(cert_buf, cert_len)) == NULL) {
+		ERROR("Error in signature verification (loading pubkey failed)");
+		goto out;
+	}
 
-	if (!hash) {
-		ERROR("Failed to hash file: %s", signed_file);
-		return -1;
+	/*
+	 * Ed25519 signs the data itself instead of a digest, thus, the signed
+	 * file is read into memory and the requested hashes are computed from
+	 * the same buffer which is verified.
+	 */
+	if (EVP_PKEY_ED25519 == EVP_PKEY_base_id(key)) {
+		off_t signed_len = file_size(signed_file);
+		IF_TRUE_GOTO_ERROR(signed_len < 0 || signed_len > SSL_ED25519_SIGNED_FILE_MAX_SIZE,
+				   out);
+		unsigned char *signed_buf = mem_alloc0(signed_len + 1);
+		if (signed_len > 0 && 0 > file_read(signed_file, (char *)signed_buf, signed_len)) {
+			ERROR("Failed to read signed file");
+			mem_free0(signed_buf);
+			goto out;
+		}
+		ret = ssl_verify_signature_from_msg(key, sig_buf, sig_len, signed_buf, signed_len);
+
+		for (size_t i = 0; i < hash_algos_len; ++i) {
+			hashes[i] =
+				ssl_hash_buf(signed_buf, signed_len, &hash_lens[i], hash_algos[i]);
+			if (hashes[i])
+				continue;
+
+			ERROR("Failed to hash file: %s", signed_file);
+			for (size_t j = 0; j < i; ++j) {
+				mem_free0(hashes[j]);
+				hash_lens[j] = 0;
+			}
+			hash_lens[i] = 0;
+			ret = -2;
+			break;
+		}
+		mem_free0(signed_buf);
+		goto out;
 	}
 
-	int ret = ssl_verify_signature_from_digest(cert_buf, cert_len, sig_buf, sig_len, hash,
-						   hash_len, digest_algo);
+	/*
+	 * The digest for the signature is computed in the same pass as the
+	 * requested hashes. If it is among them, it is only computed once.
+	 */
+	size_t digest_idx = hash_algos_len;
+	for (size_t i = 0; i < hash_algos_len; ++i) {
+		if (!strcasecmp(hash_algos[i], digest_algo)) {
+			digest_idx = i;
+			break;
+		}
+	}
+	size_t algos_len = hash_algos_len + (digest_idx == hash_algos_len ? 1 : 0);
+	const char **algos = mem_new0(const char *, algos_len);
+	unsigned char **digests = mem_new0(unsigned char *, algos_len);
+	unsigned int *digest_lens = mem_new0(unsigned int, algos_len);
 
+	for (size_t i = 0; i < hash_algos_len; ++i)
+		algos[i] = hash_algos[i];
+	algos[digest_idx] = digest_algo;
+
+	if (ssl_hash_file_multi(signed_file, algos, algos_len, digests, digest_lens) < 0) {
+		ERROR("Failed to hash file: %s", signed_file);
+	} else {
+		ret = ssl_verify_signature_from_digest(cert_buf, cert_len, sig_buf, sig_len,
+						       digests[digest_idx], digest_lens[digest_idx],
+						       digest_algo);
+		// hand out the requested hashes independently of the verification result
+		for (size_t i = 0; i < hash_algos_len; ++i) {
+			hashes[i] = digests[i];
+			hash_lens[i] = digest_lens[i];
+		}
+		if (digest_idx == hash_algos_len)
+			mem_free0(digests[digest_idx]);
+	}
+
+	mem_free0(algos);
+	mem_free0(digests);
+	mem_free0(digest_lens);
+out:
+	if (key)
+		EVP_PKEY_free(key);
+	mem_free0(cert_buf);
+	if (sig_buf)
+		mem_free0(sig_buf);
 	return ret;
 }
 
+int
+ssl_verify_signature(const char *cert_file, const char *signature_file, const char *signed_file,
+		     const char *digest_algo)
+{
+	return ssl_verify_signature_hash_file(cert_file, signature_file, signed_file, digest_algo,
+					      NULL, 0, NULL, NULL);
+}
+
 int
 ssl_aes_ecb_encrypt(uint8_t *in, int inlen, uint8_t *out, int *outlen, uint8_t *key, int keylen,
 		    int pad)
@@ -29,7 +29,33 @@
 #include <openssl/evp.h>
 #include <openssl/x509v3.h>
 
-typedef enum { RSA_PSS_PADDING, RSA_SSA_PADDING } rsa_padding_t;
+/**
+ * Types of key pairs created for CSRs and softtokens. For RSA keys, the type
+ * selects the padding scheme of signatures. ECDSA keys sign with SHA256 (P-256)
+ * or SHA384 (P-384). Ed25519 keys sign the data itself instead of a digest.
+ */
+typedef enum {
+	RSA_PSS_PADDING,
+	RSA_SSA_PADDING,
+	ECDSA_P256_KEY,
+	ECDSA_P384_KEY,
+	ED25519_KEY,
+} ssl_key_type_t;
+
+/* previous name of ssl_key_type_t, when only RSA keys were supported */
+typedef ssl_key_type_t rsa_padding_t;
+
+/**
+ * I/O strategies for hashing files.
+ * AUTO reads small files with a buffer, maps larger ones and reads large
+ * images which are mostly not in the page cache with O_DIRECT.
+ */
+typedef enum {
+	SSL_HASH_STRATEGY_AUTO = 0,
+	SSL_HASH_STRATEGY_READ,
+	SSL_HASH_STRATEGY_MMAP,
+	SSL_HASH_STRATEGY_DIRECT,
+} ssl_hash_strategy_t;
 
 typedef EVP_CIPHER_CTX ssl_aes_ctx_t;
 
@@ -53,11 +79,14 @@ ssl_read_pkcs12_token(const char *token_file, const char *passphrase, EVP_PKEY *
  * @return returns 0 on success, -1 in case of a failure. */
 int
 ssl_create_csr(const char *req_file, const char *key_file, const char *passphrase,
-	       const char *common_name, const char *uid, bool tpmkey, rsa_padding_t rsa_padding);
+	       const char *common_name, const char *uid, bool tpmkey, ssl_key_type_t key_type);
 
 /**
  * This function wraps a (symmetric) key plain_key of length plain_key_len into a wrapped key wrapped_key
  * of length wrapped_key_len using a public key pkey (unwrap works with the corresp. private key).
+ * RSA keys encrypt a random key encryption key. For EC keys, the key encryption key is derived by
+ * ECDH with an ephemeral key, whose public key is part of wrapped_key. Ed25519 keys are not
+ * supported, as they can only be used for signatures.
  * @return returns 0 on success, -1 in case of a failure. */
 int
 ssl_wrap_key(EVP_PKEY *pkey, const unsigned char *plain_key, size_t plain_key_len,
@@ -108,6 +137,34 @@ int
 ssl_verify_signature(const char *cert_file, const char *signature_file, const char *signed_file,
 		     const char *digest_algo);
 
+/**
+ * signs the buffer buf of length buf_len with the private key pkey. The digest digest_algo is used
+ * for RSA and ECDSA keys. RSA-PSS keys are used with PSS padding, other RSA keys with PKCS#1 v1.5
+ * padding. Ed25519 keys sign buf itself and ignore digest_algo.
+ * The signature is verifiable with ssl_verify_signature_from_buf() and must be freed by the caller.
+ * @return returns 0 on success, -1 in case of a failure.
+ */
+int
+ssl_sign_buf(EVP_PKEY *pkey, const uint8_t *buf, size_t buf_len, const char *digest_algo,
+	     uint8_t **sig, size_t *sig_len);
+
+/**
+ * verifies a signature stored in signature_file with a certificate stored in cert_file like
+ * ssl_verify_signature. Additionally, the hashes of signed_file for the hash algorithms in
+ * hash_algos are computed in the same pass over signed_file which is used for the signature
+ * digest. Thus, signed_file is only read once.
+ * The requested hashes are returned in the arrays hashes and hash_lens (both of size
+ * hash_algos_len) independently of the verification result, as long as signed_file could be
+ * hashed. Otherwise, all entries of hashes are set to NULL. The caller has to free the hashes.
+ * @return Returns 0 on success, -1 if the verification failed and -2 in case of
+ * an unexpected verification error.
+ */
+int
+ssl_verify_signature_hash_file(const char *cert_file, const char *signature_file,
+			       const char *signed_file, const char *digest_algo,
+			       const char **hash_algos, size_t hash_algos_len,
+			       unsigned char **hashes, unsigned int *hash_lens);
+
 /**
  * verifies a signature stored in sig_buf with a certificate stored in cert_buf. Thereby, the
  * data to be verified located in buf is hashed. Compared to
@@ -123,6 +180,7 @@ ssl_verify_signature_from_buf(uint8_t *cert_buf, size_t cert_len, const uint8_t
 /**
  * verifies a signature stored in sig_buf with a certificate stored in cert_buf. Compared to
  * ssl_verify_from_signature, this function expects the data to be verified already to be hashed.
+ * Thus, it does not support certificates with Ed25519 keys.
  * @return Returns 0 on success, -1 if the verification failed and -2 in case of
  * an unexpected verification error.
  */
@@ -148,13 +206,39 @@ ssl_hash_buf(const unsigned char *buf_to_hash, unsigned int buf_len, unsigned in
 unsigned char *
 ssl_hash_file(const char *file_to_hash, unsigned int *calc_len, const char *hash_algo);
 
+/**
+ * The file located in file_to_hash is hashed with all hash algorithms in hash_algos in a
+ * single pass. The I/O strategy is chosen automatically (see ssl_hash_strategy_t).
+ * The resulting hashes and their lengths are stored in the arrays hashes and hash_lens which
+ * must provide hash_algos_len entries. The caller has to free the hashes.
+ * @return 0 on success, -1 on failure (all entries of hashes are NULL in this case).
+ */
+int
+ssl_hash_file_multi(const char *file_to_hash, const char **hash_algos, size_t hash_algos_len,
+		    unsigned char **hashes, unsigned int *hash_lens);
+
+/**
+ * Like ssl_hash_file_multi(), but reads the file with the given I/O strategy.
+ * Strategies which are not supported for the file fall back to a buffered read.
+ */
+int
+ssl_hash_file_multi_strategy(const char *file_to_hash, const char **hash_algos,
+			     size_t hash_algos_len, unsigned char **hashes, unsigned int *hash_lens,
+			     ssl_hash_strategy_t strategy);
+
+/**
+ * Returns a printable name of a hash strategy.
+ */
+const char *
+ssl_hash_strategy_to_string(ssl_hash_strategy_t strategy);
+
 /**
  * creates a pkcs 12 softtoken located in the file token_file, locked with the password passphrase.
  * The corresponding (currently) self-signed certificate is stored in the file cert_file, if specified
  */
 int
 ssl_create_pkcs12_token(const char *token_file, const char *cert_file, const char *passphrase,
-			const char *user_name, rsa_padding_t rsa_padding);
+			const char *user_name, ssl_key_type_t key_type);
 
 /**
  * changes the passwphrase/pin of a pkcs 12 softtoken located in the file token_file,
@@ -191,6 +275,20 @@ ssl_init(bool use_tpm, void *tpm2d_primary_storage_key_pw);
 void
 ssl_free(void);
 
+/**
+ * Returns the key type of a name used in configs, i.e.,
+ * "rsa", "rsa-pss", "ecdsa-p256", "ecdsa-p384" or "ed25519".
+ * @return 0 on success, -1 if the name is unknown
+ */
+int
+ssl_key_type_from_string(const char *name, ssl_key_type_t *key_type);
+
+/**
+ * Returns a printable name of a key type, see ssl_key_type_from_string().
+ */
+const char *
+ssl_key_type_to_string(ssl_key_type_t key_type);
+
 /**
  * Takes an ASN1_OBJECT as an input and returns the corresponding hash algorithm
  * as a string, if supported. NOTE: Only for signature algorithms, use
@@ -249,6 +249,137 @@ test_ssl_verify_signature_pss_sha512(UNUSED const MunitParameter params[], UNUSE
 	return MUNIT_OK;
 }
 
+static UNUSED MunitResult
+test_ssl_verify_signature_hash_file(UNUSED const MunitParameter params[], UNUSED void *data)
+{
+	const char *algos[] = { "SHA1", "SHA256" };
+	unsigned char *hashes[2];
+	unsigned int hash_lens[2];
+
+	int ret = ssl_verify_signature_hash_file("testdata/testpki/ssig.cert",
+						 "testdata/sigssa_ssacert", "testdata/test-quote",
+						 "SHA256", algos, 2, hashes, hash_lens);
+	munit_assert(0 == ret);
+
+	for (int i = 0; i < 2; ++i) {
+		unsigned int len;
+		unsigned char *hash = ssl_hash_file("testdata/test-quote", &len, algos[i]);
+		munit_assert_not_null(hash);
+		munit_assert_not_null(hashes[i]);
+		munit_assert_uint(len, ==, hash_lens[i]);
+		munit_assert_memory_equal(len, hash, hashes[i]);
+		mem_free0(hash);
+		mem_free0(hashes[i]);
+	}
+
+	// hashes are returned even if the signature does not match
+	ret = ssl_verify_signature_hash_file("testdata/testpki/ssig.cert",
+					     "testdata/sigssa_ssacert_sha512",
+					     "testdata/test-quote", "SHA256", algos, 1, hashes,
+					     hash_lens);
+	munit_assert(0 != ret);
+	munit_assert_not_null(hashes[0]);
+	munit_assert_uint(hash_lens[0], ==, 20);
+	mem_free0(hashes[0]);
+
+	return MUNIT_OK;
+}
+
+static UNUSED MunitResult
+test_ssl_hash_file_multi(UNUSED const MunitParameter params[], UNUSED void *data)
+{
+	const char *algos[] = { "SHA1", "SHA256", "SHA512" };
+	unsigned char *hashes[3];
+	unsigned int hash_lens[3];
+
+	// large enough to be mapped into memory, not a multiple of the chunk size
+	size_t buf_len = 3 * 1024 * 1024 + 17;
+	unsigned char *buf = mem_alloc(buf_len);
+	for (size_t i = 0; i < buf_len; ++i)
+		buf[i] = i * 31 + 7;
+
+	char file[] = "/tmp/ssl_util_test_XXXXXX";
+	int fd = mkstemp(file);
+	munit_assert(fd >= 0);
+	munit_assert(buf_len == (size_t)write(fd, buf, buf_len));
+	close(fd);
+
+	munit_assert(0 == ssl_hash_file_multi(file, algos, 3, hashes, hash_lens));
+	for (int i = 0; i < 3; ++i) {
+		unsigned int len;
+		unsigned char *hash = ssl_hash_buf(buf, buf_len, &len, algos[i]);
+		munit_assert_not_null(hash);
+		munit_assert_uint(len, ==, hash_lens[i]);
+		munit_assert_memory_equal(len, hash, hashes[i]);
+		mem_free0(hash);
+		mem_free0(hashes[i]);
+	}
+
+	unlink(file);
+	mem_free0(buf);
+
+	munit_assert(-1 ==
+		     ssl_hash_file_multi("testdata/does-not-exist", algos, 3, hashes, hash_lens));
+	for (int i = 0; i < 3; ++i)
+		munit_assert_null(hashes[i]);
+
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_ssl_hash_file_multi_strategy(UNUSED const MunitParameter params[], UNUSED void *data)
+{
+	const char *algo = "SHA256";
+	const ssl_hash_strategy_t strategies[] = { SSL_HASH_STRATEGY_AUTO, SSL_HASH_STRATEGY_READ,
+						   SSL_HASH_STRATEGY_MMAP,
+						   SSL_HASH_STRATEGY_DIRECT };
+
+	// not a multiple of the block size to check the unaligned tail of direct reads
+	size_t buf_len = 5 * 1024 * 1024 + 4097;
+	unsigned char *buf = mem_alloc(buf_len);
+	for (size_t i = 0; i < buf_len; ++i)
+		buf[i] = i * 17 + 3;
+
+	char file[] = "/tmp/ssl_util_test_XXXXXX";
+	int fd = mkstemp(file);
+	munit_assert(fd >= 0);
+	munit_assert(buf_len == (size_t)write(fd, buf, buf_len));
+	close(fd);
+
+	unsigned int len;
+	unsigned char *expected = ssl_hash_buf(buf, buf_len, &len, algo);
+	munit_assert_not_null(expected);
+
+	for (size_t i = 0; i < sizeof(strategies) / sizeof(strategies[0]); ++i) {
+		unsigned char *hash;
+		unsigned int hash_len;
+		munit_assert(0 == ssl_hash_file_multi_strategy(file, &algo, 1, &hash, &hash_len,
+							       strategies[i]));
+		munit_assert_uint(len, ==, hash_len);
+		munit_assert_memory_equal(len, expected, hash);
+		mem_free0(hash);
+	}
+
+	// empty files cannot be mapped
+	munit_assert(0 == truncate(file, 0));
+	mem_free0(expected);
+	expected = ssl_hash_buf(buf, 0, &len, algo);
+	for (size_t i = 0; i < sizeof(strategies) / sizeof(strategies[0]); ++i) {
+		unsigned char *hash;
+		unsigned int hash_len;
+		munit_assert(0 == ssl_hash_file_multi_strategy(file, &algo, 1, &hash, &hash_len,
+							       strategies[i]));
+		munit_assert_memory_equal(len, expected, hash);
+		mem_free0(hash);
+	}
+
+	unlink(file);
+	mem_free0(expected);
+	mem_free0(buf);
+
+	return MUNIT_OK;
+}
+
 static UNUSED MunitResult
 test_ssl_verify_signature_from_buf_ssa_ssacert(UNUSED const MunitParameter params[],
 					       UNUSED void *data)
@@ -519,6 +650,196 @@ test_ssl_create_csr_pss(UNUSED const MunitParameter params[], UNUSED void *data)
 	return 0;
 }
 
+static MunitResult
+test_ssl_create_csr_ecdsa(UNUSED const MunitParameter params[], UNUSED void *data)
+{
+	uuid_t *dev_uuid = uuid_new(NULL);
+	munit_assert(NULL != dev_uuid);
+	const char *uid = uuid_string(dev_uuid);
+	munit_assert(NULL != uid);
+
+	munit_assert(0 == ssl_create_csr("testdata/munit-device.csr", "testdata/munit-private.key",
+					 NULL, "common_name", uid, false, ECDSA_P256_KEY));
+	munit_assert(0 == ssl_self_sign_csr("testdata/munit-device.csr",
+					    "testdata/munit-device.cert",
+					    "testdata/munit-private.key", false));
+
+	uuid_free(dev_uuid);
+	unlink("testdata/munit-device.csr");
+	unlink("testdata/munit-device.cert");
+	unlink("testdata/munit-private.key");
+
+	return MUNIT_OK;
+}
+
+static void
+test_create_and_read_token(ssl_key_type_t key_type, EVP_PKEY **pkey, char **cert_buf,
+			   off_t *cert_len)
+{
+	X509 *cert = NULL;
+	STACK_OF(X509) *ca = NULL;
+
+	munit_assert(0 == ssl_create_pkcs12_token("tmptoken_key_type.p12", "tmpcert_key_type.pem",
+						  "trustme", "testuser", key_type));
+	munit_assert(0 ==
+		     ssl_read_pkcs12_token("tmptoken_key_type.p12", "trustme", pkey, &cert, &ca));
+	munit_assert(NULL != *pkey);
+
+	munit_assert(0 < (*cert_len = file_size("tmpcert_key_type.pem")));
+	*cert_buf = mem_alloc0(*cert_len);
+	munit_assert(0 < file_read("tmpcert_key_type.pem", *cert_buf, *cert_len));
+
+	unlink("tmptoken_key_type.p12");
+	unlink("tmpcert_key_type.pem");
+	X509_free(cert);
+	sk_X509_pop_free(ca, X509_free);
+}
+
+static MunitResult
+test_ssl_sign_verify_key_types(UNUSED const MunitParameter params[], UNUSED void *data)
+{
+	const ssl_key_type_t key_types[] = { RSA_SSA_PADDING, RSA_PSS_PADDING, ECDSA_P256_KEY,
+					     ECDSA_P384_KEY, ED25519_KEY };
+	uint8_t buf[] = "signed config";
+
+	for (size_t i = 0; i < sizeof(key_types) / sizeof(key_types[0]); ++i) {
+		EVP_PKEY *pkey = NULL;
+		char *cert_buf = NULL;
+		off_t cert_len;
+		uint8_t *sig = NULL;
+		size_t sig_len;
+
+		DEBUG("Testing key type %s", ssl_key_type_to_string(key_types[i]));
+		test_create_and_read_token(key_types[i], &pkey, &cert_buf, &cert_len);
+
+		munit_assert(0 == ssl_sign_buf(pkey, buf, sizeof(buf), "SHA256", &sig, &sig_len));
+		munit_assert(NULL != sig);
+		munit_assert(0 == ssl_verify_signature_from_buf((uint8_t *)cert_buf, cert_len, sig,
+								sig_len, buf, sizeof(buf),
+								"SHA256"));
+
+		// modified data must not verify
+		buf[0] ^= 0xff;
+		munit_assert(0 != ssl_verify_signature_from_buf((uint8_t *)cert_buf, cert_len, sig,
+								sig_len, buf, sizeof(buf),
+								"SHA256"));
+		buf[0] ^= 0xff;
+
+		mem_free0(sig);
+		mem_free0(cert_buf);
+		EVP_PKEY_free(pkey);
+	}
+
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_ssl_verify_signature_hash_file_ed25519(UNUSED const MunitParameter params[], UNUSED void *data)
+{
+	EVP_PKEY *pkey = NULL;
+	char *cert_buf = NULL;
+	off_t cert_len;
+	uint8_t *sig = NULL;
+	size_t sig_len;
+	const char *conf = "name: \"testconfig\"\n";
+	const char *hash_algo = "SHA256";
+	unsigned char *hash = NULL;
+	unsigned int hash_len = 0;
+
+	test_create_and_read_token(ED25519_KEY, &pkey, &cert_buf, &cert_len);
+	munit_assert(0 ==
+		     ssl_sign_buf(pkey, (const uint8_t *)conf, strlen(conf), NULL, &sig, &sig_len));
+
+	munit_assert(0 <= file_write("tmpconf_ed25519.cert", cert_buf, cert_len));
+	munit_assert(0 <= file_write("tmpconf_ed25519.conf", conf, strlen(conf)));
+	munit_assert(0 <= file_write("tmpconf_ed25519.sig", (char *)sig, sig_len));
+
+	munit_assert(0 == ssl_verify_signature_hash_file("tmpconf_ed25519.cert",
+							 "tmpconf_ed25519.sig",
+							 "tmpconf_ed25519.conf", "SHA256",
+							 &hash_algo, 1, &hash, &hash_len));
+	munit_assert(NULL != hash);
+	munit_assert(SHA256_DIGEST_LENGTH == hash_len);
+
+	unsigned int calc_len = 0;
+	unsigned char *calc_hash = ssl_hash_file("tmpconf_ed25519.conf", &calc_len, "SHA256");
+	munit_assert(NULL != calc_hash);
+	munit_assert(0 == memcmp(hash, calc_hash, calc_len));
+
+	// the verification fails if a requested hash cannot be computed
+	const char *hash_algos[] = { "SHA256", "NO-SUCH-HASH" };
+	unsigned char *hashes[2] = { NULL, NULL };
+	unsigned int hash_lens[2] = { 0, 0 };
+	munit_assert(-2 == ssl_verify_signature_hash_file("tmpconf_ed25519.cert",
+							  "tmpconf_ed25519.sig",
+							  "tmpconf_ed25519.conf", "SHA256",
+							  hash_algos, 2, hashes, hash_lens));
+	munit_assert(NULL == hashes[0] && NULL == hashes[1]);
+
+	unlink("tmpconf_ed25519.cert");
+	unlink("tmpconf_ed25519.conf");
+	unlink("tmpconf_ed25519.sig");
+	mem_free0(calc_hash);
+	mem_free0(hash);
+	mem_free0(sig);
+	mem_free0(cert_buf);
+	EVP_PKEY_free(pkey);
+
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_ssl_wrap_key_ecdh(UNUSED const MunitParameter params[], UNUSED void *data)
+{
+	const ssl_key_type_t key_types[] = { ECDSA_P256_KEY, ECDSA_P384_KEY };
+	// not a multiple of the block size of the key wrap cipher
+	const unsigned char plain_key[] = "0123456789abcdef0123456789abcdef0123456789";
+
+	for (size_t i = 0; i < sizeof(key_types) / sizeof(key_types[0]); ++i) {
+		EVP_PKEY *pkey = NULL;
+		char *cert_buf = NULL;
+		off_t cert_len;
+		unsigned char *wrapped_key = NULL;
+		int wrapped_key_len;
+		unsigned char *unwrapped_key = NULL;
+		int unwrapped_key_len;
+
+		test_create_and_read_token(key_types[i], &pkey, &cert_buf, &cert_len);
+
+		munit_assert(0 == ssl_wrap_key(pkey, plain_key, sizeof(plain_key), &wrapped_key,
+					       &wrapped_key_len));
+		munit_assert(0 == ssl_unwrap_key(pkey, wrapped_key, wrapped_key_len, &unwrapped_key,
+						 &unwrapped_key_len));
+		munit_assert((int)sizeof(plain_key) == unwrapped_key_len);
+		munit_assert(0 == memcmp(plain_key, unwrapped_key, sizeof(plain_key)));
+		mem_free0(unwrapped_key);
+
+		// a corrupted wrapped key must not unwrap
+		wrapped_key[wrapped_key_len - 1] ^= 0xff;
+		munit_assert(0 != ssl_unwrap_key(pkey, wrapped_key, wrapped_key_len, &unwrapped_key,
+						 &unwrapped_key_len));
+
+		mem_free0(wrapped_key);
+		mem_free0(cert_buf);
+		EVP_PKEY_free(pkey);
+	}
+
+	// Ed25519 keys are for signatures only
+	EVP_PKEY *pkey = NULL;
+	char *cert_buf = NULL;
+	off_t cert_len;
+	unsigned char *wrapped_key = NULL;
+	int wrapped_key_len;
+
+	test_create_and_read_token(ED25519_KEY, &pkey, &cert_buf, &cert_len);
+	munit_assert(0 != ssl_wrap_key(pkey, plain_key, sizeof(plain_key), &wrapped_key,
+				       &wrapped_key_len));
+	mem_free0(cert_buf);
+	EVP_PKEY_free(pkey);
+
+	return MUNIT_OK;
+}
+
 static MunitResult
 test_ssl_verify_signature_from_digest_pss_psscert(UNUSED const MunitParameter params[],
 						  UNUSED void *data)
@@ -1275,6 +1596,12 @@ static MunitTest tests[] = {
 	  MUNIT_TEST_OPTION_NONE, NULL },
 	{ "test_ssl_verify_signature_pss_sha512", test_ssl_verify_signature_pss_sha512, setup,
 	  tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+	{ "test_ssl_verify_signature_hash_file", test_ssl_verify_signature_hash_file, setup,
+	  tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+	{ "test_ssl_hash_file_multi", test_ssl_hash_file_multi, setup, tear_down,
+	  MUNIT_TEST_OPTION_NONE, NULL },
+	{ "test_ssl_hash_file_multi_strategy", test_ssl_hash_file_multi_strategy, setup, tear_down,
+	  MUNIT_TEST_OPTION_NONE, NULL },
 	{ "ssl_verify_signature_from_digest sigpss_psscert",
 	  test_ssl_verify_signature_from_digest_pss_psscert, setup, tear_down,
 	  MUNIT_TEST_OPTION_NONE, NULL },
@@ -1303,6 +1630,15 @@ static MunitTest tests[] = {
 	  MUNIT_TEST_OPTION_NONE, NULL },
 	{ "ssl_create_csr_pss", test_ssl_create_csr_pss, setup, tear_down, MUNIT_TEST_OPTION_NONE,
 	  NULL },
+	{ "ssl_create_csr_ecdsa", test_ssl_create_csr_ecdsa, setup, tear_down,
+	  MUNIT_TEST_OPTION_NONE, NULL },
+	{ "test_ssl_sign_verify_key_types", test_ssl_sign_verify_key_types, setup, tear_down,
+	  MUNIT_TEST_OPTION_NONE, NULL },
+	{ "test_ssl_verify_signature_hash_file_ed25519",
+	  test_ssl_verify_signature_hash_file_ed25519, setup, tear_down, MUNIT_TEST_OPTION_NONE,
+	  NULL },
+	{ "test_ssl_wrap_key_ecdh", test_ssl_wrap_key_ecdh, setup, tear_down,
+	  MUNIT_TEST_OPTION_NONE, NULL },
 	{ "test_ssl_read_pkcs12_token_ssa", test_ssl_read_pkcs12_token_ssa, setup, tear_down,
 	  MUNIT_TEST_OPTION_NONE, NULL },
 	{ "test_ssl_read_pkcs12_token_pss", test_ssl_read_pkcs12_token_pss, setup, tear_down,
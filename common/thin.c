@@ -0,0 +1,346 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+//#define LOGF_LOG_MIN_PRIO LOGF_PRIO_TRACE
+
+#define _GNU_SOURCE
+
+#include "thin.h"
+
+#include "macro.h"
+#include "mem.h"
+#include "dm.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <linux/dm-ioctl.h>
+
+#define THIN_DM_BUF_SIZE 16384
+
+extern struct dm_cmd_table cmd_table[];
+
+char *
+thin_get_device_path_new(const char *name)
+{
+	return mem_printf("%s%s", DM_PATH_PREFIX, name);
+}
+
+bool
+thin_device_exists(const char *name)
+{
+	IF_NULL_RETVAL(name, false);
+
+	int fd = dm_open_control();
+	IF_TRUE_RETVAL(fd < 0, false);
+
+	bool exists = dm_get_open_count(fd, name) >= 0;
+	dm_close_control(fd);
+	return exists;
+}
+
+/*
+ * Creates the device node of an active device, if it is not created by
+ * udev or mdev.
+ */
+static int
+thin_create_device_node(const char *name, unsigned long long dev)
+{
+	char *device = thin_get_device_path_new(name);
+
+	if (mknod(device, S_IFBLK | 0600, dev) != 0 && errno != EEXIST) {
+		ERROR_ERRNO("Cannot mknod device %s", device);
+		mem_free0(device);
+		return -1;
+	}
+
+	mem_free0(device);
+	return 0;
+}
+
+/*
+ * Creates a device with a single target spanning the whole device and
+ * activates it.
+ */
+static int
+thin_dm_create(const char *name, const char *target_type, uint64_t sectors, const char *params)
+{
+	int ret = -1;
+	uint8_t buf[THIN_DM_BUF_SIZE] = { 0 };
+	struct dm_ioctl *dmi = (struct dm_ioctl *)buf;
+
+	size_t params_len = strlen(params) + 1;
+	if (sizeof(struct dm_ioctl) + sizeof(struct dm_target_spec) + params_len + 8 >
+	    sizeof(buf)) {
+		ERROR("Table parameters for %s are too long", name);
+		return -1;
+	}
+
+	int fd = dm_open_control();
+	IF_TRUE_RETVAL(fd < 0, -1);
+
+	dm_ioctl_init(dmi, INDEX_DM_DEV_CREATE, sizeof(buf), name, NULL, DM_EXISTS_FLAG, 0, 0, 0);
+	if (dm_ioctl(fd, cmd_table[INDEX_DM_DEV_CREATE].cmd, dmi)) {
+		ERROR_ERRNO("Cannot create %s device %s", target_type, name);
+		goto out;
+	}
+
+	dm_ioctl_init(dmi, INDEX_DM_TABLE_LOAD, sizeof(buf), name, NULL, DM_EXISTS_FLAG, 0, 1, 0);
+	struct dm_target_spec *tgt = (struct dm_target_spec *)&buf[sizeof(struct dm_ioctl)];
+	tgt->sector_start = 0;
+	tgt->length = sectors;
+	tgt->status = 0;
+	strncpy(tgt->target_type, target_type, sizeof(tgt->target_type) - 1);
+
+	char *tgt_params = (char *)tgt + sizeof(struct dm_target_spec);
+	memcpy(tgt_params, params, params_len);
+	// next is the offset of the following target spec relative to the first one
+	tgt->next = (sizeof(struct dm_target_spec) + params_len + 7) & ~7;
+
+	if (dm_ioctl(fd, cmd_table[INDEX_DM_TABLE_LOAD].cmd, dmi)) {
+		ERROR_ERRNO("Cannot load table '%s %s' for %s", target_type, params, name);
+		goto remove;
+	}
+
+	// resume the device to activate the table
+	dm_ioctl_init(dmi, INDEX_DM_DEV_SUSPEND, sizeof(buf), name, NULL, DM_EXISTS_FLAG, 0, 0, 0);
+	if (dm_ioctl(fd, cmd_table[INDEX_DM_DEV_SUSPEND].cmd, dmi)) {
+		ERROR_ERRNO("Cannot resume %s device %s", target_type, name);
+		goto remove;
+	}
+
+	ret = thin_create_device_node(name, dmi->dev);
+	if (ret == 0)
+		DEBUG("Activated %s device %s", target_type, name);
+	goto out;
+
+remove:
+	dm_ioctl_init(dmi, INDEX_DM_DEV_REMOVE, sizeof(buf), name, NULL, DM_EXISTS_FLAG, 0, 0, 0);
+	if (dm_ioctl(fd, cmd_table[INDEX_DM_DEV_REMOVE].cmd, dmi))
+		WARN_ERRNO("Cannot remove incomplete device %s", name);
+out:
+	dm_close_control(fd);
+	return ret;
+}
+
+/*
+ * Reads the status line of the single target of a device into status.
+ */
+static int
+thin_dm_get_status(const char *name, char *status, size_t len)
+{
+	uint8_t buf[THIN_DM_BUF_SIZE] = { 0 };
+	struct dm_ioctl *dmi = (struct dm_ioctl *)buf;
+
+	int fd = dm_open_control();
+	IF_TRUE_RETVAL(fd < 0, -1);
+
+	dm_ioctl_init(dmi, INDEX_DM_TABLE_STATUS, sizeof(buf), name, NULL, DM_EXISTS_FLAG, 0, 0, 0);
+	int ret = dm_ioctl(fd, cmd_table[INDEX_DM_TABLE_STATUS].cmd, dmi);
+	dm_close_control(fd);
+	if (ret) {
+		TRACE_ERRNO("DM_TABLE_STATUS ioctl for %s returned %d", name, ret);
+		return -1;
+	}
+	if (dmi->target_count < 1) {
+		WARN("Device %s has no active table", name);
+		return -1;
+	}
+
+	const char *line = (char *)&buf[dmi->data_start + sizeof(struct dm_target_spec)];
+	snprintf(status, len, "%s", line);
+	return 0;
+}
+
+static int
+thin_dm_message(const char *name, const char *message)
+{
+	uint8_t buf[THIN_DM_BUF_SIZE] = { 0 };
+	struct dm_ioctl *dmi = (struct dm_ioctl *)buf;
+
+	int fd = dm_open_control();
+	IF_TRUE_RETVAL(fd < 0, -1);
+
+	dm_ioctl_init(dmi, INDEX_DM_TARGET_MSG, sizeof(buf), name, NULL, DM_EXISTS_FLAG, 0, 0, 0);
+	struct dm_target_msg *msg = (struct dm_target_msg *)&buf[sizeof(struct dm_ioctl)];
+	msg->sector = 0;
+	snprintf(msg->message, sizeof(buf) - sizeof(struct dm_ioctl) - sizeof(*msg), "%s", message);
+
+	int ret = dm_ioctl(fd, cmd_table[INDEX_DM_TARGET_MSG].cmd, dmi);
+	dm_close_control(fd);
+	if (ret) {
+		ERROR_ERRNO("Message '%s' to %s failed", message, name);
+		return -1;
+	}
+	return 0;
+}
+
+int
+thin_pool_create(const char *name, const char *meta_dev, const char *data_dev,
+		 uint64_t data_sectors, uint32_t block_sectors, uint64_t low_water_blocks)
+{
+	ASSERT(name);
+	ASSERT(meta_dev);
+	ASSERT(data_dev);
+
+	/*
+	 * Discards of the thin volumes are passed down to the data device,
+	 * which is the default of the kernel, thus no feature arguments.
+	 */
+	char *params = mem_printf("%s %s %" PRIu32 " %" PRIu64 " 0", meta_dev, data_dev,
+				  block_sectors, low_water_blocks);
+	int ret = thin_dm_create(name, "thin-pool", data_sectors, params);
+	mem_free0(params);
+
+	return ret;
+}
+
+int
+thin_pool_get_status(const char *name, thin_pool_status_t *status)
+{
+	ASSERT(name);
+	ASSERT(status);
+
+	char line[512];
+	IF_TRUE_RETVAL(thin_dm_get_status(name, line, sizeof(line)), -1);
+
+	mem_memset(status, 0, sizeof(thin_pool_status_t));
+	if (!strncmp(line, "Fail", 4)) {
+		status->failed = true;
+		return 0;
+	}
+
+	/*
+	 * <transaction id> <used meta>/<total meta> <used data>/<total data>
+	 * <held metadata root> ro|rw|out_of_data_space ...
+	 */
+	char mode[32] = { 0 };
+	unsigned long long transaction, meta_used, meta_total, data_used, data_total;
+	if (sscanf(line, "%llu %llu/%llu %llu/%llu %*s %31s", &transaction, &meta_used, &meta_total,
+		   &data_used, &data_total, mode) != 6) {
+		WARN("Cannot parse status '%s' of thin-pool %s", line, name);
+		return -1;
+	}
+
+	status->meta_used = meta_used;
+	status->meta_total = meta_total;
+	status->data_used = data_used;
+	status->data_total = data_total;
+	status->read_only = !strcmp(mode, "ro");
+	status->out_of_space = !strcmp(mode, "out_of_data_space");
+	status->needs_check = strstr(line, "needs_check") != NULL;
+
+	return 0;
+}
+
+int
+thin_pool_create_volume(const char *pool, uint32_t dev_id)
+{
+	ASSERT(pool);
+	IF_TRUE_RETVAL_ERROR(dev_id > THIN_DEV_ID_MAX, -1);
+
+	char *msg = mem_printf("create_thin %" PRIu32, dev_id);
+	int ret = thin_dm_message(pool, msg);
+	mem_free0(msg);
+
+	return ret;
+}
+
+int
+thin_pool_delete_volume(const char *pool, uint32_t dev_id)
+{
+	ASSERT(pool);
+	IF_TRUE_RETVAL_ERROR(dev_id > THIN_DEV_ID_MAX, -1);
+
+	char *msg = mem_printf("delete %" PRIu32, dev_id);
+	int ret = thin_dm_message(pool, msg);
+	mem_free0(msg);
+
+	return ret;
+}
+
+int
+thin_volume_activate(const char *name, const char *pool, uint32_t dev_id, uint64_t sectors)
+{
+	ASSERT(name);
+	ASSERT(pool);
+
+	char *pool_dev = thin_get_device_path_new(pool);
+	char *params = mem_printf("%s %" PRIu32, pool_dev, dev_id);
+	int ret = thin_dm_create(name, "thin", sectors, params);
+	mem_free0(params);
+	mem_free0(pool_dev);
+
+	return ret;
+}
+
+int64_t
+thin_volume_get_mapped_sectors(const char *name)
+{
+	ASSERT(name);
+
+	char line[128];
+	IF_TRUE_RETVAL(thin_dm_get_status(name, line, sizeof(line)), -1);
+
+	// <nr mapped sectors> <highest mapped sector>, or "Fail"
+	unsigned long long mapped;
+	if (sscanf(line, "%llu", &mapped) != 1) {
+		WARN("Cannot parse status '%s' of thin volume %s", line, name);
+		return -1;
+	}
+	return mapped;
+}
+
+int
+thin_device_remove(const char *name)
+{
+	ASSERT(name);
+
+	uint8_t buf[THIN_DM_BUF_SIZE] = { 0 };
+	struct dm_ioctl *dmi = (struct dm_ioctl *)buf;
+
+	int fd = dm_open_control();
+	IF_TRUE_RETVAL(fd < 0, -1);
+
+	dm_ioctl_init(dmi, INDEX_DM_DEV_REMOVE, sizeof(buf), name, NULL, DM_EXISTS_FLAG, 0, 0, 0);
+	int ret = dm_ioctl(fd, cmd_table[INDEX_DM_DEV_REMOVE].cmd, dmi);
+	dm_close_control(fd);
+	if (ret) {
+		if (errno != ENXIO)
+			ERROR_ERRNO("Cannot remove device %s", name);
+		return -1;
+	}
+
+	// remove device node if necessary
+	char *device = thin_get_device_path_new(name);
+	unlink(device);
+	mem_free0(device);
+
+	DEBUG("Removed device %s", name);
+	return 0;
+}
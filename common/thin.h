@@ -0,0 +1,136 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+/**
+ * @file thin.h
+ *
+ * Device-mapper thin provisioning. A thin-pool device allocates blocks of its
+ * data device on demand to thin volumes, which are identified by a 24 bit
+ * device id inside the pool. See the kernel's thin-provisioning.rst.
+ */
+
+#ifndef THIN_H
+#define THIN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// maximum thin device id supported by the kernel (24 bit)
+#define THIN_DEV_ID_MAX ((1 << 24) - 1)
+
+typedef struct thin_pool_status {
+	uint64_t meta_used;  // used metadata blocks (4 KiB)
+	uint64_t meta_total; // total metadata blocks (4 KiB)
+	uint64_t data_used;  // used data blocks (block size of the pool)
+	uint64_t data_total; // total data blocks (block size of the pool)
+	bool failed;	     // the pool failed and is unusable
+	bool read_only;	     // the pool switched to read-only mode
+	bool out_of_space;   // the data device is exhausted
+	bool needs_check;    // the metadata needs to be checked offline
+} thin_pool_status_t;
+
+/**
+ * Returns the path of a thin or thin-pool device.
+ *
+ * @param name The device-mapper name of the device
+ * @return char* The path, must be freed
+ */
+char *
+thin_get_device_path_new(const char *name);
+
+/**
+ * Checks if a device-mapper device with the given name exists.
+ */
+bool
+thin_device_exists(const char *name);
+
+/**
+ * Creates and activates a thin-pool device. A metadata device whose first
+ * block is zeroed is formatted by the kernel.
+ *
+ * @param name The device-mapper name of the pool
+ * @param meta_dev The path of the metadata block device
+ * @param data_dev The path of the data block device
+ * @param data_sectors The size of the data device in 512 byte sectors
+ * @param block_sectors The allocation block size in 512 byte sectors
+ * @param low_water_blocks Free data blocks below which the kernel raises an event
+ * @return int 0 if successful, otherwise -1
+ */
+int
+thin_pool_create(const char *name, const char *meta_dev, const char *data_dev,
+		 uint64_t data_sectors, uint32_t block_sectors, uint64_t low_water_blocks);
+
+/**
+ * Reads the status of a thin-pool device.
+ *
+ * @return int 0 if successful, otherwise -1
+ */
+int
+thin_pool_get_status(const char *name, thin_pool_status_t *status);
+
+/**
+ * Allocates a new, empty thin volume with the given id inside a pool.
+ *
+ * @return int 0 if successful, otherwise -1
+ */
+int
+thin_pool_create_volume(const char *pool, uint32_t dev_id);
+
+/**
+ * Deletes the thin volume with the given id and releases its blocks to the
+ * pool. The volume must not be active.
+ *
+ * @return int 0 if successful, otherwise -1
+ */
+int
+thin_pool_delete_volume(const char *pool, uint32_t dev_id);
+
+/**
+ * Activates a thin volume of a pool as device-mapper device.
+ *
+ * @param name The device-mapper name of the volume
+ * @param pool The device-mapper name of the pool
+ * @param dev_id The id of the volume inside the pool
+ * @param sectors The virtual size of the volume in 512 byte sectors
+ * @return int 0 if successful, otherwise -1
+ */
+int
+thin_volume_activate(const char *name, const char *pool, uint32_t dev_id, uint64_t sectors);
+
+/**
+ * Returns the number of sectors of a thin volume which are backed by blocks of
+ * its pool, or -1 on error.
+ */
+int64_t
+thin_volume_get_mapped_sectors(const char *name);
+
+/**
+ * Removes a thin or thin-pool device-mapper device. The data of the volumes
+ * is kept inside the pool.
+ *
+ * @return int 0 if successful, otherwise -1
+ */
+int
+thin_device_remove(const char *name);
+
+#endif // THIN_H
@@ -0,0 +1,414 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+//#define LOGF_LOG_MIN_PRIO LOGF_PRIO_TRACE
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "workpool.h"
+
+#include "macro.h"
+#include "mem.h"
+#include "list.h"
+#include "event.h"
+#include "fd.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// initial size of the buffer for receiving a result from a worker
+#define WORKPOOL_RESULT_BUF_SIZE 4096
+
+typedef struct workpool_job {
+	workpool_t *pool;
+	int client;
+	workpool_job_func_t func;
+	workpool_done_cb_t done_cb;
+	void *data;
+	bool canceled;
+
+	pid_t pid;
+	event_io_t *io;
+	uint8_t *buf; // length header followed by the result
+	size_t buf_len;
+	size_t buf_size;
+} workpool_job_t;
+
+typedef struct workpool_client {
+	int id;
+	list_t *jobs; // queued jobs in FIFO order
+} workpool_client_t;
+
+struct workpool {
+	unsigned int max_workers;
+	unsigned int max_per_client;
+	list_t *clients; // clients with queued jobs in round robin order
+	list_t *running; // jobs currently executed by a worker
+};
+
+static void
+workpool_dispatch(workpool_t *pool);
+
+static void
+workpool_job_free(workpool_job_t *job)
+{
+	if (job->buf)
+		mem_free0(job->buf);
+	mem_free0(job);
+}
+
+static void
+workpool_job_done(workpool_job_t *job, const uint8_t *result, size_t result_len, bool canceled)
+{
+	IF_NULL_RETURN(job->done_cb);
+
+	job->done_cb(result, result_len, canceled, job->data);
+	// the callback is responsible for data, thus only call it once
+	job->done_cb = NULL;
+	job->data = NULL;
+}
+
+static unsigned int
+workpool_count_running(const workpool_t *pool, int client)
+{
+	unsigned int count = 0;
+	for (const list_t *l = pool->running; l; l = l->next) {
+		const workpool_job_t *job = l->data;
+		if (job->client == client && !job->canceled)
+			count++;
+	}
+	return count;
+}
+
+/*
+ * Reaps the worker of a job which has closed its end of the pipe
+ * and hands the result to the done callback.
+ */
+static void
+workpool_job_finish(workpool_job_t *job)
+{
+	workpool_t *pool = job->pool;
+
+	event_remove_io(job->io);
+	close(event_io_get_fd(job->io));
+	event_io_free(job->io);
+	job->io = NULL;
+
+	if (waitpid(job->pid, NULL, 0) < 0)
+		TRACE_ERRNO("Could not reap worker %d", job->pid);
+
+	pool->running = list_remove(pool->running, job);
+
+	// a result is only valid if it was transferred completely
+	size_t result_len = 0;
+	bool success = job->buf_len >= sizeof(size_t);
+	if (success) {
+		memcpy(&result_len, job->buf, sizeof(size_t));
+		success = job->buf_len - sizeof(size_t) == result_len;
+	}
+	if (!success && !job->canceled)
+		WARN("Worker %d of client %d failed", job->pid, job->client);
+	TRACE("Worker %d of client %d finished", job->pid, job->client);
+
+	workpool_job_done(job, success ? job->buf + sizeof(size_t) : NULL, success ? result_len : 0,
+			  false);
+	workpool_job_free(job);
+
+	workpool_dispatch(pool);
+}
+
+static void
+workpool_job_read_cb(int fd, unsigned events, UNUSED event_io_t *io, void *data)
+{
+	workpool_job_t *job = data;
+	ASSERT(job);
+
+	bool eof = false;
+
+	if (events & EVENT_IO_READ) {
+		while (true) {
+			if (job->buf_len == job->buf_size) {
+				job->buf_size *= 2;
+				job->buf = mem_renew(uint8_t, job->buf, job->buf_size);
+			}
+			ssize_t len =
+				read(fd, job->buf + job->buf_len, job->buf_size - job->buf_len);
+			if (len > 0) {
+				job->buf_len += len;
+				continue;
+			}
+			if (len == 0) {
+				eof = true;
+			} else if (errno == EINTR) {
+				continue;
+			} else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				WARN_ERRNO("Failed to read result of worker %d", job->pid);
+				eof = true;
+			}
+			break;
+		}
+	}
+	if (!(events & EVENT_IO_READ) && (events & EVENT_IO_EXCEPT))
+		eof = true;
+
+	if (eof)
+		workpool_job_finish(job);
+}
+
+static void
+workpool_job_exec(workpool_job_t *job, int fd)
+{
+	size_t result_len = 0;
+	uint8_t *result = job->func(job->data, &result_len);
+	IF_NULL_GOTO(result, error);
+
+	if (fd_write(fd, (char *)&result_len, sizeof(size_t)) != sizeof(size_t))
+		goto error;
+	if (fd_write(fd, (char *)result, result_len) != (int)result_len)
+		goto error;
+
+	close(fd);
+	_exit(EXIT_SUCCESS);
+error:
+	close(fd);
+	_exit(EXIT_FAILURE);
+}
+
+static int
+workpool_job_start(workpool_job_t *job)
+{
+	int fds[2];
+	if (pipe2(fds, O_CLOEXEC) < 0) {
+		ERROR_ERRNO("Could not create pipe for worker");
+		return -1;
+	}
+
+	pid_t pid = fork();
+	switch (pid) {
+	case -1:
+		ERROR_ERRNO("Could not fork worker");
+		close(fds[0]);
+		close(fds[1]);
+		return -1;
+	case 0:
+		close(fds[0]);
+		workpool_job_exec(job, fds[1]);
+		// never reached
+		_exit(EXIT_FAILURE);
+	default:
+		close(fds[1]);
+		break;
+	}
+
+	TRACE("Started worker %d for client %d", pid, job->client);
+
+	fd_make_non_blocking(fds[0]);
+	job->pid = pid;
+	job->buf_size = WORKPOOL_RESULT_BUF_SIZE;
+	job->buf = mem_alloc(job->buf_size);
+	job->io = event_io_new(fds[0], EVENT_IO_READ, workpool_job_read_cb, job);
+	event_add_io(job->io);
+
+	return 0;
+}
+
+static void
+workpool_dispatch(workpool_t *pool)
+{
+	while (list_length(pool->running) < pool->max_workers) {
+		// first client in round robin order which has not reached its limit
+		workpool_client_t *client = NULL;
+		for (list_t *l = pool->clients; l; l = l->next) {
+			workpool_client_t *c = l->data;
+			if (workpool_count_running(pool, c->id) < pool->max_per_client) {
+				client = c;
+				break;
+			}
+		}
+		IF_NULL_RETURN(client);
+
+		workpool_job_t *job = client->jobs->data;
+		client->jobs = list_unlink(client->jobs, client->jobs);
+
+		// move client to the end of the round robin order
+		pool->clients = list_remove(pool->clients, client);
+		if (client->jobs)
+			pool->clients = list_append(pool->clients, client);
+		else
+			mem_free0(client);
+
+		if (workpool_job_start(job) < 0) {
+			workpool_job_done(job, NULL, 0, false);
+			workpool_job_free(job);
+			continue;
+		}
+		pool->running = list_append(pool->running, job);
+	}
+}
+
+workpool_t *
+workpool_new(unsigned int max_workers, unsigned int max_per_client)
+{
+	IF_TRUE_RETVAL_ERROR(max_workers < 1, NULL);
+	IF_TRUE_RETVAL_ERROR(max_per_client < 1 || max_per_client > max_workers, NULL);
+
+	workpool_t *pool = mem_new0(workpool_t, 1);
+	pool->max_workers = max_workers;
+	pool->max_per_client = max_per_client;
+
+	DEBUG("Created worker pool with %u workers (%u per client)", max_workers, max_per_client);
+	return pool;
+}
+
+static void
+workpool_job_kill(workpool_job_t *job)
+{
+	if (kill(job->pid, SIGKILL) < 0)
+		TRACE_ERRNO("Could not kill worker %d", job->pid);
+	job->canceled = true;
+	workpool_job_done(job, NULL, 0, true);
+}
+
+void
+workpool_free(workpool_t *pool)
+{
+	IF_NULL_RETURN(pool);
+
+	while (pool->running) {
+		workpool_job_t *job = pool->running->data;
+		pool->running = list_unlink(pool->running, pool->running);
+
+		workpool_job_kill(job);
+		event_remove_io(job->io);
+		close(event_io_get_fd(job->io));
+		event_io_free(job->io);
+		if (waitpid(job->pid, NULL, 0) < 0)
+			TRACE_ERRNO("Could not reap worker %d", job->pid);
+		workpool_job_free(job);
+	}
+
+	while (pool->clients) {
+		workpool_client_t *client = pool->clients->data;
+		pool->clients = list_unlink(pool->clients, pool->clients);
+		for (list_t *l = client->jobs; l; l = l->next) {
+			workpool_job_done(l->data, NULL, 0, true);
+			workpool_job_free(l->data);
+		}
+		list_delete(client->jobs);
+		mem_free0(client);
+	}
+
+	mem_free0(pool);
+}
+
+void
+workpool_submit(workpool_t *pool, int client, workpool_job_func_t func, workpool_done_cb_t done_cb,
+		void *data)
+{
+	ASSERT(pool);
+	ASSERT(func);
+	ASSERT(done_cb);
+
+	workpool_job_t *job = mem_new0(workpool_job_t, 1);
+	job->pool = pool;
+	job->client = client;
+	job->func = func;
+	job->done_cb = done_cb;
+	job->data = data;
+
+	workpool_client_t *c = NULL;
+	for (list_t *l = pool->clients; l; l = l->next) {
+		workpool_client_t *tmp = l->data;
+		if (tmp->id == client) {
+			c = tmp;
+			break;
+		}
+	}
+	if (!c) {
+		c = mem_new0(workpool_client_t, 1);
+		c->id = client;
+		pool->clients = list_append(pool->clients, c);
+	}
+	c->jobs = list_append(c->jobs, job);
+
+	TRACE("Queued job for client %d", client);
+	workpool_dispatch(pool);
+}
+
+void
+workpool_cancel_client(workpool_t *pool, int client)
+{
+	ASSERT(pool);
+
+	for (list_t *l = pool->clients; l; l = l->next) {
+		workpool_client_t *c = l->data;
+		if (c->id != client)
+			continue;
+
+		pool->clients = list_unlink(pool->clients, l);
+		for (list_t *j = c->jobs; j; j = j->next) {
+			workpool_job_done(j->data, NULL, 0, true);
+			workpool_job_free(j->data);
+		}
+		list_delete(c->jobs);
+		mem_free0(c);
+		break;
+	}
+
+	/*
+	 * Running jobs are only killed here. They are cleaned up as usual as soon
+	 * as their pipe is closed, as the pipe's io event may already be pending.
+	 */
+	for (list_t *l = pool->running; l; l = l->next) {
+		workpool_job_t *job = l->data;
+		if (job->client == client && !job->canceled) {
+			DEBUG("Killing worker %d of canceled client %d", job->pid, client);
+			workpool_job_kill(job);
+		}
+	}
+}
+
+unsigned int
+workpool_get_running(const workpool_t *pool)
+{
+	ASSERT(pool);
+	return list_length(pool->running);
+}
+
+unsigned int
+workpool_get_queued(const workpool_t *pool)
+{
+	ASSERT(pool);
+
+	unsigned int count = 0;
+	for (const list_t *l = pool->clients; l; l = l->next)
+		count += list_length(((const workpool_client_t *)l->data)->jobs);
+	return count;
+}
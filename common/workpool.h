@@ -0,0 +1,114 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+/**
+ * @file workpool.h
+ *
+ * Bounded pool of worker processes for expensive jobs of an event loop based
+ * service. Each job is executed in its own fork()ed worker, its result is
+ * transferred back through a pipe and delivered by a callback from the event
+ * loop. Thus, long running jobs do not block the event loop.
+ *
+ * Jobs are queued per client and clients are served round robin. The number
+ * of workers a single client can occupy is limited, so that workers are left
+ * for jobs of other clients. With a limit of one, the jobs of a client are
+ * executed and completed in the order they were submitted.
+ */
+
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct workpool workpool_t;
+
+/**
+ * Job function executed in the worker process.
+ * @param data The data object given to workpool_submit()
+ * @param result_len Length of the returned result
+ * @return A newly allocated result buffer or NULL on failure
+ */
+typedef uint8_t *(*workpool_job_func_t)(void *data, size_t *result_len);
+
+/**
+ * Callback executed in the event loop after a job has finished.
+ * It is responsible to free the data object given to workpool_submit().
+ * @param result The result of the job or NULL if the job failed
+ * @param result_len Length of the result
+ * @param canceled true if the job was canceled, result is NULL then
+ * @param data The data object given to workpool_submit()
+ */
+typedef void (*workpool_done_cb_t)(const uint8_t *result, size_t result_len, bool canceled,
+				   void *data);
+
+/**
+ * Create a new pool.
+ * @param max_workers Maximum number of concurrently running workers (at least 1)
+ * @param max_per_client Maximum number of concurrently running workers per client
+ *	  (at least 1, at most max_workers)
+ */
+workpool_t *
+workpool_new(unsigned int max_workers, unsigned int max_per_client);
+
+/**
+ * Free the pool. Running workers are killed and the done callbacks
+ * of all running and queued jobs are called with canceled set.
+ */
+void
+workpool_free(workpool_t *pool);
+
+/**
+ * Queue a job which is started as soon as a worker slot is free
+ * and the client is next in turn.
+ * @param client Identifier of the client, e.g. the pid of the connected peer
+ * @param func The job function which is executed in a worker process
+ * @param done_cb The callback which receives the result in the event loop
+ * @param data A data object given to func and done_cb
+ */
+void
+workpool_submit(workpool_t *pool, int client, workpool_job_func_t func, workpool_done_cb_t done_cb,
+		void *data);
+
+/**
+ * Cancel all jobs of a client, e.g. if its connection is closed.
+ * Running workers of the client are killed. The done callbacks of the
+ * jobs are called with canceled set before this function returns.
+ */
+void
+workpool_cancel_client(workpool_t *pool, int client);
+
+/**
+ * Returns the number of currently running workers.
+ */
+unsigned int
+workpool_get_running(const workpool_t *pool);
+
+/**
+ * Returns the number of queued jobs which wait for a worker.
+ */
+unsigned int
+workpool_get_queued(const workpool_t *pool);
+
+#endif /* WORKPOOL_H */
@@ -0,0 +1,279 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+#include "munit.h"
+
+#include "logf.h"
+#include "macro.h"
+#include "mem.h"
+#include "event.h"
+#include "ssl_util.h"
+#include "workpool.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#define TEST_MAX_WORKERS 2
+#define TEST_MAX_PER_CLIENT 1
+#define TEST_LARGE_FILE_SIZE (32 * 1024 * 1024)
+#define TEST_JOBS 4
+
+#define TEST_CLIENT_HASH 1
+#define TEST_CLIENT_VERIFY 2
+
+typedef struct test_state {
+	workpool_t *pool;
+	char large_file[64];
+	unsigned char *large_hash;
+	unsigned int large_hash_len;
+
+	// completion order of the jobs
+	int done[2 * TEST_JOBS];
+	int done_count;
+	int canceled_count;
+	unsigned int max_running;
+} test_state_t;
+
+typedef struct test_job {
+	test_state_t *state;
+	int client;
+} test_job_t;
+
+static void *
+setup(UNUSED const MunitParameter params[], UNUSED void *data)
+{
+	logf_register(&logf_test_write, stderr);
+	ssl_init(false, NULL);
+	event_init();
+
+	test_state_t *state = mem_new0(test_state_t, 1);
+	state->pool = workpool_new(TEST_MAX_WORKERS, TEST_MAX_PER_CLIENT);
+	munit_assert_not_null(state->pool);
+	return state;
+}
+
+static void
+tear_down(void *fixture)
+{
+	test_state_t *state = fixture;
+
+	workpool_free(state->pool);
+	if (state->large_file[0])
+		unlink(state->large_file);
+	if (state->large_hash)
+		mem_free0(state->large_hash);
+	mem_free0(state);
+	ssl_free();
+}
+
+static void
+test_create_large_file(test_state_t *state)
+{
+	strcpy(state->large_file, "/tmp/workpool_test_XXXXXX");
+	int fd = mkstemp(state->large_file);
+	munit_assert(fd >= 0);
+
+	unsigned char *buf = mem_alloc(TEST_LARGE_FILE_SIZE);
+	for (size_t i = 0; i < TEST_LARGE_FILE_SIZE; ++i)
+		buf[i] = i * 13 + 5;
+	munit_assert(TEST_LARGE_FILE_SIZE == write(fd, buf, TEST_LARGE_FILE_SIZE));
+	close(fd);
+
+	state->large_hash =
+		ssl_hash_buf(buf, TEST_LARGE_FILE_SIZE, &state->large_hash_len, "SHA256");
+	munit_assert_not_null(state->large_hash);
+	mem_free0(buf);
+}
+
+static uint8_t *
+test_hash_job(void *data, size_t *result_len)
+{
+	test_job_t *job = data;
+	unsigned int len = 0;
+	uint8_t *hash = ssl_hash_file(job->state->large_file, &len, "SHA256");
+	*result_len = len;
+	return hash;
+}
+
+static uint8_t *
+test_verify_job(UNUSED void *data, size_t *result_len)
+{
+	uint8_t *ret = mem_new0(uint8_t, 1);
+	*ret = ssl_verify_signature("testdata/testpki/ssig.cert", "testdata/sigssa_ssacert",
+				    "testdata/test-quote", "SHA256") == 0;
+	*result_len = 1;
+	return ret;
+}
+
+static uint8_t *
+test_sleep_job(UNUSED void *data, size_t *result_len)
+{
+	sleep(60);
+	*result_len = 0;
+	return mem_new0(uint8_t, 1);
+}
+
+static uint8_t *
+test_fail_job(UNUSED void *data, UNUSED size_t *result_len)
+{
+	return NULL;
+}
+
+static void
+test_done_cb(const uint8_t *result, size_t result_len, bool canceled, void *data)
+{
+	test_job_t *job = data;
+	test_state_t *state = job->state;
+
+	state->max_running = MAX(state->max_running, workpool_get_running(state->pool));
+
+	if (canceled) {
+		state->canceled_count++;
+	} else {
+		munit_assert_not_null(result);
+		if (job->client == TEST_CLIENT_HASH) {
+			munit_assert_size(result_len, ==, state->large_hash_len);
+			munit_assert_memory_equal(result_len, result, state->large_hash);
+		} else {
+			munit_assert_size(result_len, ==, 1);
+			munit_assert_uint8(result[0], ==, 1);
+		}
+		state->done[state->done_count++] = job->client;
+	}
+	mem_free0(job);
+}
+
+static void
+test_submit(test_state_t *state, int client, workpool_job_func_t func)
+{
+	test_job_t *job = mem_new0(test_job_t, 1);
+	job->state = state;
+	job->client = client;
+	workpool_submit(state->pool, client, func, test_done_cb, job);
+}
+
+static MunitResult
+test_workpool_mixed(UNUSED const MunitParameter params[], void *data)
+{
+	test_state_t *state = data;
+	test_create_large_file(state);
+
+	// large hashes are queued first and would block the verifies in a single loop
+	for (int i = 0; i < TEST_JOBS; ++i)
+		test_submit(state, TEST_CLIENT_HASH, test_hash_job);
+	for (int i = 0; i < TEST_JOBS; ++i)
+		test_submit(state, TEST_CLIENT_VERIFY, test_verify_job);
+
+	munit_assert_uint(workpool_get_running(state->pool), ==, TEST_MAX_WORKERS);
+	munit_assert_uint(workpool_get_queued(state->pool), ==, 2 * TEST_JOBS - TEST_MAX_WORKERS);
+
+	event_loop();
+
+	munit_assert_int(state->done_count, ==, 2 * TEST_JOBS);
+	munit_assert_int(state->canceled_count, ==, 0);
+	munit_assert_uint(state->max_running, <=, TEST_MAX_WORKERS);
+	munit_assert_uint(workpool_get_running(state->pool), ==, 0);
+	munit_assert_uint(workpool_get_queued(state->pool), ==, 0);
+
+	// all verifies are done before the last hash, as one worker is left for them
+	int last_verify = -1, last_hash = -1;
+	for (int i = 0; i < state->done_count; ++i) {
+		if (state->done[i] == TEST_CLIENT_VERIFY)
+			last_verify = i;
+		else
+			last_hash = i;
+	}
+	munit_assert_int(last_verify, <, last_hash);
+
+	return MUNIT_OK;
+}
+
+static MunitResult
+test_workpool_cancel(UNUSED const MunitParameter params[], void *data)
+{
+	test_state_t *state = data;
+
+	for (int i = 0; i < TEST_JOBS; ++i)
+		test_submit(state, TEST_CLIENT_HASH, test_sleep_job);
+	test_submit(state, TEST_CLIENT_VERIFY, test_verify_job);
+
+	munit_assert_uint(workpool_get_running(state->pool), ==, TEST_MAX_WORKERS);
+
+	workpool_cancel_client(state->pool, TEST_CLIENT_HASH);
+	munit_assert_int(state->canceled_count, ==, TEST_JOBS);
+	munit_assert_uint(workpool_get_queued(state->pool), ==, 0);
+
+	// returns as soon as the killed worker is reaped, not after its sleep
+	event_loop();
+
+	munit_assert_int(state->done_count, ==, 1);
+	munit_assert_int(state->done[0], ==, TEST_CLIENT_VERIFY);
+	munit_assert_uint(workpool_get_running(state->pool), ==, 0);
+
+	return MUNIT_OK;
+}
+
+static void
+test_fail_done_cb(const uint8_t *result, size_t result_len, bool canceled, void *data)
+{
+	int *count = data;
+	munit_assert_null(result);
+	munit_assert_size(result_len, ==, 0);
+	munit_assert_false(canceled);
+	(*count)++;
+}
+
+static MunitResult
+test_workpool_failure(UNUSED const MunitParameter params[], void *data)
+{
+	test_state_t *state = data;
+	int count = 0;
+
+	for (int i = 0; i < TEST_JOBS; ++i)
+		workpool_submit(state->pool, TEST_CLIENT_HASH, test_fail_job, test_fail_done_cb,
+				&count);
+
+	event_loop();
+
+	munit_assert_int(count, ==, TEST_JOBS);
+
+	return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+	{ "/mixed hash and verify", test_workpool_mixed, setup, tear_down, MUNIT_TEST_OPTION_NONE,
+	  NULL },
+	{ "/cancel", test_workpool_cancel, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+	{ "/failure", test_workpool_failure, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+
+	// Mark the end of the array with an entry where the test function is NULL
+	{ NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+MunitSuite workpool_suite = {
+	"/workpool",		/* name */
+	tests,			/* tests */
+	NULL,			/* suites */
+	1,			/* iterations */
+	MUNIT_SUITE_OPTION_NONE /* options */
+};
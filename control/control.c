@@ -38,9 +38,12 @@
 #include "common/mem.h"
 #include "common/uuid.h"
 #include "common/str.h"
+#include "common/list.h"
 
 #include <getopt.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
 #include <termios.h>
 #include <unistd.h>
 #include <sys/stat.h>
@@ -58,8 +61,12 @@ static void
 print_usage(const char *cmd)
 {
 	printf("\n");
-	printf("Usage: %s [-s <socket file>] <command> [<command args>]\n", cmd);
+	printf("Usage: %s [-s <socket file>] [-m] <command> [<command args>]\n", cmd);
 	printf("\n");
+	printf("options:\n");
+	printf("   -m, --machine\n"
+	       "        Print each response on a single line: [<line>] <code> <response> <message>,\n"
+	       "        where <message> is the response in protobuf text format.\n\n");
 	printf("commands:\n");
 	printf("   list\n"
 	       "        Lists all containers.\n\n");
@@ -89,6 +96,9 @@ print_usage(const char *cmd)
 	       "        Starts the container with the given key (default: all '0') .\n\n");
 	printf("   stop <container-uuid> [--key=<key>]\n"
 	       "        Stops the specified container.\n\n");
+	printf("   restart <container-uuid>\n"
+	       "        Restarts the specified container keeping its namespaces and volumes,\n"
+	       "        or with a full stop/start cycle if its config was changed.\n\n");
 	printf("   config <container-uuid>\n"
 	       "        Prints the config of the specified container.\n\n");
 	printf("   update_config <container-uuid> <container.conf> [<container.sig> <container.cert>]\n"
@@ -104,6 +114,9 @@ print_usage(const char *cmd)
 	       "        Grant audio access to the specified container (cgroups).\n\n");
 	printf("   deny_audio <container-uuid>\n"
 	       "        Deny audio access to the specified container (cgroups).\n\n");
+	printf("   cpu_limits <container-uuid> [--quota=<us>] [--period=<us>] [--weight=<1-10000>] [--burst=<us>]\n"
+	       "        Sets the CPU bandwidth limits of the specified container until its config\n"
+	       "        is reloaded. Omitted options reset the corresponding limit.\n\n");
 	printf("   wipe <container-uuid>\n"
 	       "        Wipes the specified container.\n\n");
 	printf("   push_guestos_config <guestos.conf> <guestos.sig> <guestos.pem>\n"
@@ -132,6 +145,13 @@ print_usage(const char *cmd)
 	printf("   retrieve_logs [<path_to_logstore_dir>]\n"
 	       "        Retrieves logs from the directory defined in LOGFILE_DIR and stores them in the given directory"
 	       " or in the current directory if no directory was given.\n\n");
+	printf("   session [<script>]\n"
+	       "        Reads one command per line from <script> or stdin and sends all of them over a\n"
+	       "        single connection without waiting for each response. Supported are list,\n"
+	       "        list_guestos, reload, get_provisioned, device_stats, create, remove, start,\n"
+	       "        stop, state, config, freeze, unfreeze, wipe, snapshot, allow_audio,\n"
+	       "        deny_audio and ifaces. start and stop take --key=<key> (default: all '0')\n"
+	       "        and start also --setup. Empty lines and lines starting with '#' are skipped.\n\n");
 	printf("\n");
 	exit(-1);
 }
@@ -230,7 +250,347 @@ get_container_uuid_new(const char *identifier, int sock)
 	return valid_uuid;
 }
 
+/*
+ * Prints a response of cmld, either as protobuf text dump or in the
+ * machine-readable single line format. A line > 0 is the line of the
+ * session script which caused the response.
+ */
+static void
+print_response(const DaemonToController *resp, bool machine, int line)
+{
+	if (!machine) {
+		protobuf_dump_message(STDOUT_FILENO, (ProtobufCMessage *)resp);
+		return;
+	}
+
+	const ProtobufCEnumValue *code = protobuf_c_enum_descriptor_get_value(
+		&daemon_to_controller__code__descriptor, resp->code);
+	const ProtobufCEnumValue *response =
+		resp->has_response ?
+			protobuf_c_enum_descriptor_get_value(
+				&daemon_to_controller__response__descriptor, resp->response) :
+			NULL;
+
+	char *text = NULL;
+	protobuf_string_from_message(&text, (ProtobufCMessage *)resp, NULL);
+	for (char *c = text; c && *c; ++c) {
+		if (*c == '\n')
+			*c = ' ';
+	}
+
+	if (line > 0)
+		printf("%d\t", line);
+	printf("%s\t%s\t%s\n", code ? code->name : "UNKNOWN", response ? response->name : "-",
+	       text ? text : "");
+	fflush(stdout);
+	mem_free0(text);
+}
+
+/******************************************************************************/
+/*
+ * Session mode: commands are read line by line and sent over one connection.
+ * Requests are pipelined, i.e., the next request is sent before the response
+ * of the previous one is received. cmld handles the requests of a connection
+ * in order, thus responses are assigned to the script lines in FIFO order.
+ */
+
+// maximum number of requests in flight
+#define SESSION_MAX_PENDING 32
+#define SESSION_MAX_ARGS 16
+
+typedef struct session_cmd {
+	const char *name;
+	ControllerToDaemon__Command command;
+	bool container; // first argument is a container uuid or name
+	bool barrier;	// response may be sent asynchronously or changes the container list
+} session_cmd_t;
+
+static const session_cmd_t session_cmds[] = {
+	{ "list", CONTROLLER_TO_DAEMON__COMMAND__GET_CONTAINER_STATUS, false, false },
+	{ "list_guestos", CONTROLLER_TO_DAEMON__COMMAND__LIST_GUESTOS_CONFIGS, false, false },
+	{ "reload", CONTROLLER_TO_DAEMON__COMMAND__RELOAD_CONTAINERS, false, true },
+	{ "get_provisioned", CONTROLLER_TO_DAEMON__COMMAND__GET_PROVISIONED, false, false },
+	{ "device_stats", CONTROLLER_TO_DAEMON__COMMAND__GET_DEVICE_STATS, false, false },
+	{ "create", CONTROLLER_TO_DAEMON__COMMAND__CREATE_CONTAINER, false, true },
+	{ "remove", CONTROLLER_TO_DAEMON__COMMAND__REMOVE_CONTAINER, true, true },
+	{ "start", CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_START, true, true },
+	{ "stop", CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_STOP, true, true },
+	{ "restart", CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_RESTART, true, true },
+	{ "state", CONTROLLER_TO_DAEMON__COMMAND__GET_CONTAINER_STATUS, true, false },
+	{ "config", CONTROLLER_TO_DAEMON__COMMAND__GET_CONTAINER_CONFIG, true, false },
+	{ "freeze", CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_FREEZE, true, false },
+	{ "unfreeze", CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_UNFREEZE, true, false },
+	{ "wipe", CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_WIPE, true, false },
+	{ "snapshot", CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_SNAPSHOT, true, false },
+	{ "allow_audio", CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_ALLOWAUDIO, true, false },
+	{ "deny_audio", CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_DENYAUDIO, true, false },
+	{ "ifaces", CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_LIST_IFACES, true, false },
+};
+
+typedef struct session {
+	int sock;
+	bool machine;
+	list_t *pending;	    // script lines of requests waiting for a response
+	DaemonToController *status; // container list used to resolve names
+	int errors;
+} session_t;
+
+static void
+session_recv_response(session_t *session)
+{
+	ASSERT(session->pending);
+
+	int *line = session->pending->data;
+	session->pending = list_unlink(session->pending, session->pending);
+
+	DaemonToController *resp = recv_message(session->sock);
+	if (resp->has_response &&
+	    (resp->response == DAEMON_TO_CONTROLLER__RESPONSE__CMD_FAILED ||
+	     resp->response == DAEMON_TO_CONTROLLER__RESPONSE__CMD_UNSUPPORTED))
+		session->errors++;
+
+	if (!session->machine)
+		printf("[%d]\n", *line);
+	print_response(resp, session->machine, *line);
+
+	protobuf_free_message((ProtobufCMessage *)resp);
+	mem_free0(line);
+}
+
+static void
+session_drain(session_t *session)
+{
+	while (session->pending)
+		session_recv_response(session);
+}
+
+static void
+session_update_status(session_t *session)
+{
+	session_drain(session);
+
+	if (session->status)
+		protobuf_free_message((ProtobufCMessage *)session->status);
+
+	ControllerToDaemon msg = CONTROLLER_TO_DAEMON__INIT;
+	msg.command = CONTROLLER_TO_DAEMON__COMMAND__GET_CONTAINER_STATUS;
+	send_message(session->sock, &msg);
+	session->status = recv_message(session->sock);
+}
+
+static const char *
+session_lookup_uuid(const session_t *session, const char *identifier)
+{
+	for (size_t i = 0; i < session->status->n_container_status; ++i) {
+		if (!strcmp(session->status->container_status[i]->uuid, identifier) ||
+		    !strcmp(session->status->container_status[i]->name, identifier))
+			return session->status->container_status[i]->uuid;
+	}
+	return NULL;
+}
+
+/*
+ * Resolves a container uuid or name. The container list is only fetched
+ * again if the container is unknown, e.g., if it was created in this session.
+ */
+static char *
+session_get_container_uuid_new(session_t *session, const char *identifier)
+{
+	const char *uuid = session_lookup_uuid(session, identifier);
+	if (!uuid) {
+		session_update_status(session);
+		uuid = session_lookup_uuid(session, identifier);
+	}
+	return uuid ? mem_strdup(uuid) : NULL;
+}
+
+static int
+session_read_file(const char *file, ProtobufCBinaryData *data)
+{
+	off_t len = file_size(file);
+	IF_TRUE_RETVAL_ERROR(len < 0, -1);
+
+	data->data = mem_alloc(len);
+	data->len = len;
+	if (file_read(file, (char *)data->data, len) < 0) {
+		ERROR("Error reading %s", file);
+		mem_free0(data->data);
+		return -1;
+	}
+	return 0;
+}
+
+static void
+session_free_message(ControllerToDaemon *msg)
+{
+	if (msg->has_container_config_file)
+		mem_free0(msg->container_config_file.data);
+	if (msg->has_container_config_signature)
+		mem_free0(msg->container_config_signature.data);
+	if (msg->has_container_config_certificate)
+		mem_free0(msg->container_config_certificate.data);
+	if (msg->container_start_params) {
+		if (msg->container_start_params->key) {
+			mem_memset0(msg->container_start_params->key,
+				    strlen(msg->container_start_params->key));
+			mem_free0(msg->container_start_params->key);
+		}
+		mem_free0(msg->container_start_params);
+	}
+	for (size_t i = 0; i < msg->n_container_uuids; ++i)
+		mem_free0(msg->container_uuids[i]);
+	mem_free0(msg->container_uuids);
+}
+
+/*
+ * Builds the request for the command with its arguments and sends it.
+ * Returns -1 if the command line is invalid, nothing is sent in this case.
+ */
+static int
+session_send_command(session_t *session, int line, int argc, char **argv)
+{
+	const session_cmd_t *cmd = NULL;
+	for (size_t i = 0; i < sizeof(session_cmds) / sizeof(session_cmds[0]); ++i) {
+		if (!strcasecmp(argv[0], session_cmds[i].name)) {
+			cmd = &session_cmds[i];
+			break;
+		}
+	}
+	if (!cmd) {
+		ERROR("line %d: unsupported command '%s'", line, argv[0]);
+		return -1;
+	}
+
+	ControllerToDaemon msg = CONTROLLER_TO_DAEMON__INIT;
+	msg.command = cmd->command;
+	int argi = 1;
+
+	if (cmd->container) {
+		if (argc < 2) {
+			ERROR("line %d: %s requires a container", line, cmd->name);
+			return -1;
+		}
+		char *uuid = session_get_container_uuid_new(session, argv[argi]);
+		if (!uuid) {
+			ERROR("line %d: container '%s' does not exist", line, argv[argi]);
+			return -1;
+		}
+		argi++;
+		msg.n_container_uuids = 1;
+		msg.container_uuids = mem_new(char *, 1);
+		msg.container_uuids[0] = uuid;
+	}
+
+	if (cmd->command == CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_START ||
+	    cmd->command == CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_STOP) {
+		bool start = cmd->command == CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_START;
+		msg.container_start_params = mem_new0(ContainerStartParams, 1);
+		container_start_params__init(msg.container_start_params);
+		for (; argi < argc; ++argi) {
+			if (!strncmp(argv[argi], "--key=", 6)) {
+				msg.container_start_params->key = mem_strdup(argv[argi] + 6);
+			} else if (start && !strcmp(argv[argi], "--setup")) {
+				msg.container_start_params->has_setup = true;
+				msg.container_start_params->setup = true;
+			} else {
+				break;
+			}
+		}
+		// there is no terminal to ask for a password
+		if (!msg.container_start_params->key)
+			msg.container_start_params->key = mem_strdup(DEFAULT_KEY);
+	} else if (cmd->command == CONTROLLER_TO_DAEMON__COMMAND__CREATE_CONTAINER) {
+		if (argc != 2 && argc != 4) {
+			ERROR("line %d: create requires a config and optionally signature and certificate",
+			      line);
+			goto error;
+		}
+		if (session_read_file(argv[argi++], &msg.container_config_file) < 0)
+			goto error;
+		msg.has_container_config_file = true;
+		if (argi < argc) {
+			if (session_read_file(argv[argi++], &msg.container_config_signature) < 0)
+				goto error;
+			msg.has_container_config_signature = true;
+			if (session_read_file(argv[argi++], &msg.container_config_certificate) < 0)
+				goto error;
+			msg.has_container_config_certificate = true;
+		}
+	}
+
+	if (argi < argc) {
+		ERROR("line %d: unexpected argument '%s'", line, argv[argi]);
+		goto error;
+	}
+
+	send_message(session->sock, &msg);
+	int *pending_line = mem_new0(int, 1);
+	*pending_line = line;
+	session->pending = list_append(session->pending, pending_line);
+
+	if (cmd->barrier)
+		session_drain(session);
+	if (cmd->command == CONTROLLER_TO_DAEMON__COMMAND__RELOAD_CONTAINERS ||
+	    cmd->command == CONTROLLER_TO_DAEMON__COMMAND__REMOVE_CONTAINER)
+		session_update_status(session);
+
+	session_free_message(&msg);
+	return 0;
+error:
+	session_free_message(&msg);
+	return -1;
+}
+
+static int
+session_run(const char *socket_file, const char *script, bool machine)
+{
+	FILE *in = stdin;
+	if (script && !(in = fopen(script, "r")))
+		FATAL_ERRNO("Could not open session script %s", script);
+
+	// on a terminal each response is awaited before the next command is read
+	bool interactive = isatty(fileno(in));
+
+	session_t session = { .sock = sock_connect(socket_file), .machine = machine };
+	session_update_status(&session);
+
+	char *buf = NULL;
+	size_t buf_len = 0;
+	int line = 0;
+	int invalid = 0;
+
+	while (getline(&buf, &buf_len, in) >= 0) {
+		line++;
+
+		char *argv[SESSION_MAX_ARGS];
+		int argc = 0;
+		char *saveptr = NULL;
+		for (char *tok = strtok_r(buf, " \t\r\n", &saveptr); tok && argc < SESSION_MAX_ARGS;
+		     tok = strtok_r(NULL, " \t\r\n", &saveptr))
+			argv[argc++] = tok;
+
+		if (argc == 0 || argv[0][0] == '#')
+			continue;
+
+		if (session_send_command(&session, line, argc, argv) < 0)
+			invalid++;
+
+		if (interactive || list_length(session.pending) >= SESSION_MAX_PENDING)
+			session_drain(&session);
+	}
+	session_drain(&session);
+
+	free(buf);
+	if (in != stdin)
+		fclose(in);
+	protobuf_free_message((ProtobufCMessage *)session.status);
+	close(session.sock);
+
+	return (invalid || session.errors) ? -1 : 0;
+}
+
 static const struct option global_options[] = { { "socket", required_argument, 0, 's' },
+						{ "machine", no_argument, 0, 'm' },
 						{ "help", no_argument, 0, 'h' },
 						{ 0, 0, 0, 0 } };
 
@@ -243,6 +603,12 @@ static const struct option assign_iface_options[] = { { "iface", required_argume
 						      { "persistent", no_argument, 0, 'p' },
 						      { 0, 0, 0, 0 } };
 
+static const struct option cpu_limits_options[] = { { "quota", required_argument, 0, 'q' },
+						    { "period", required_argument, 0, 'p' },
+						    { "weight", required_argument, 0, 'w' },
+						    { "burst", required_argument, 0, 'b' },
+						    { 0, 0, 0, 0 } };
+
 static char *
 get_password_new(const char *prompt)
 {
@@ -277,6 +643,7 @@ main(int argc, char *argv[])
 	logf_register(&logf_test_write, stderr);
 
 	const char *socket_file = CONTROL_SOCKET;
+	bool machine = false;
 	uuid_t *uuid = NULL;
 	int sock = 0;
 	bool has_container_start_params_key = false;
@@ -285,11 +652,14 @@ main(int argc, char *argv[])
 	tcgetattr(STDIN_FILENO, &termios_before);
 
 	for (int c, option_index = 0;
-	     - 1 != (c = getopt_long(argc, argv, "+s:h", global_options, &option_index));) {
+	     - 1 != (c = getopt_long(argc, argv, "+s:mh", global_options, &option_index));) {
 		switch (c) {
 		case 's':
 			socket_file = optarg;
 			break;
+		case 'm':
+			machine = true;
+			break;
 		default: // includes cases 'h' and '?'
 			print_usage(argv[0]);
 		}
@@ -306,6 +676,14 @@ main(int argc, char *argv[])
 	ControllerToDaemon msg = CONTROLLER_TO_DAEMON__INIT;
 
 	const char *command = argv[optind++];
+
+	if (!strcasecmp(command, "session")) {
+		// need at most one more argument (script file)
+		if (optind < argc - 1)
+			print_usage(argv[0]);
+		return session_run(socket_file, optind < argc ? argv[optind] : NULL, machine);
+	}
+
 	/*
 	 * device global commands
 	 */
@@ -533,6 +911,7 @@ main(int argc, char *argv[])
 	uuid = get_container_uuid_new(argv[optind], sock);
 
 	ContainerStartParams container_start_params = CONTAINER_START_PARAMS__INIT;
+	ContainerCpuLimits cpu_limits = CONTAINER_CPU_LIMITS__INIT;
 	if (!strcasecmp(command, "remove")) {
 		msg.command = CONTROLLER_TO_DAEMON__COMMAND__REMOVE_CONTAINER;
 	} else if (!strcasecmp(command, "start")) {
@@ -605,6 +984,8 @@ main(int argc, char *argv[])
 		}
 		msg.container_start_params = &container_start_params;
 		optind += argc - start_argc; // adjust optind to be used with argv
+	} else if (!strcasecmp(command, "restart")) {
+		msg.command = CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_RESTART;
 	} else if (!strcasecmp(command, "freeze")) {
 		msg.command = CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_FREEZE;
 	} else if (!strcasecmp(command, "unfreeze")) {
@@ -617,6 +998,45 @@ main(int argc, char *argv[])
 		msg.command = CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_ALLOWAUDIO;
 	} else if (!strcasecmp(command, "deny_audio")) {
 		msg.command = CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_DENYAUDIO;
+	} else if (!strcasecmp(command, "cpu_limits")) {
+		msg.command = CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_SET_CPU_LIMITS;
+		msg.container_cpu_limits = &cpu_limits;
+
+		optind--;
+		char **start_argv = &argv[optind];
+		int start_argc = argc - optind;
+		optind = 0; // reset optind to scan command-specific options
+		for (int c, option_index = 0;
+		     - 1 != (c = getopt_long(start_argc, start_argv, "q:p:w:b:", cpu_limits_options,
+					     &option_index));) {
+			char *end = NULL;
+			unsigned long value = strtoul(optarg ? optarg : "", &end, 10);
+			if (!optarg || *end != '\0' || value > UINT32_MAX)
+				print_usage(argv[0]);
+
+			switch (c) {
+			case 'q':
+				cpu_limits.has_quota_us = true;
+				cpu_limits.quota_us = value;
+				break;
+			case 'p':
+				cpu_limits.has_period_us = true;
+				cpu_limits.period_us = value;
+				break;
+			case 'w':
+				cpu_limits.has_weight = true;
+				cpu_limits.weight = value;
+				break;
+			case 'b':
+				cpu_limits.has_burst_us = true;
+				cpu_limits.burst_us = value;
+				break;
+			default:
+				print_usage(argv[0]);
+				ASSERT(false); // never reached
+			}
+		}
+		optind += argc - start_argc; // adjust optind to be used with argv
 	} else if (!strcasecmp(command, "state")) {
 		msg.command = CONTROLLER_TO_DAEMON__COMMAND__GET_CONTAINER_STATUS;
 	} else if (!strcasecmp(command, "config")) {
@@ -890,7 +1310,7 @@ handle_resp:
 			goto handle_resp;
 		} break;
 		default:
-			protobuf_dump_message(STDOUT_FILENO, (ProtobufCMessage *)resp);
+			print_response(resp, machine, 0);
 		}
 	} break;
 	case DAEMON_TO_CONTROLLER__CODE__LOG_MESSAGE_FRAGMENT: {
@@ -942,7 +1362,7 @@ handle_resp:
 
 	default:
 		// TODO for now just dump the response in text format
-		protobuf_dump_message(STDOUT_FILENO, (ProtobufCMessage *)resp);
+		print_response(resp, machine, 0);
 	}
 	protobuf_free_message((ProtobufCMessage *)resp);
 
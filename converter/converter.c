@@ -34,6 +34,7 @@
 #include "common/list.h"
 #include "common/protobuf.h"
 #include "common/mem.h"
+#include "common/proc.h"
 
 #include "docker.h"
 #include "util.h"
@@ -49,6 +50,8 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <errno.h>
+#include <stdlib.h>
+#include <sys/wait.h>
 
 #define BUF_SIZE 10 * 4096
 
@@ -57,6 +60,10 @@
 #define MIN_INIT "/sbin/cservice"
 #define FILE_SERVER_ETH "eth0"
 
+// upper bound of concurrently extracted layers, each needs its own staging space
+#define MAX_EXTRACT_WORKERS 8
+#define LAYER_STAGING_SUFFIX "_layers"
+
 #define SSIG_KEY_FILE UTIL_PKI_PATH "dockerlocal-ssig.key"
 #define SSIG_CERT_FILE UTIL_PKI_PATH "dockerlocal-ssig.cert"
 #define LOCALCA_CERT_FILE UTIL_PKI_PATH "ssig_rootca.cert"
@@ -132,6 +139,20 @@ write_guestos_config(docker_config_t *config, const char *root_image_file, const
 	mount_root.image_sha1 = util_hash_sha_image_file_new(root_image_file);
 	mount_root.image_sha2_256 = util_hash_sha256_image_file_new(root_image_file);
 
+	/*
+	 * Build the dm-verity hash tree next to the image, so that cmld verifies
+	 * blocks on access instead of hashing the whole image before it is used.
+	 */
+	char *root_hash_file =
+		mem_printf("%s/%s.hash.img", image_path_unversioned, mount_root.image_file);
+	mount_root.image_verity_sha256 = util_verity_format_new(root_image_file, root_hash_file);
+	if (!mount_root.image_verity_sha256) {
+		WARN("No dm-verity hash tree for %s, image will be fully hashed on use",
+		     root_image_file);
+		unlink(root_hash_file);
+	}
+	mem_free0(root_hash_file);
+
 	cfg.mounts[0] = &mount_root;
 
 	int i = 1;
@@ -243,6 +264,7 @@ free_stuff:
 		mem_free0(cfg.mounts[j]->fs_type);
 		mem_free0(cfg.mounts[j]->image_sha1);
 		mem_free0(cfg.mounts[j]->image_sha2_256);
+		mem_free0(cfg.mounts[j]->image_verity_sha256);
 		if (j > 0) {
 			mem_free0(cfg.mounts[j]);
 		}
@@ -260,6 +282,114 @@ free_stuff:
 	return ret;
 }
 
+static char *
+layer_staging_path_new(const char *extracted_image_path, int layer)
+{
+	// the base layer is extracted in place, all others are merged on top of it
+	if (layer == 0)
+		return mem_strdup(extracted_image_path);
+	return mem_printf("%s" LAYER_STAGING_SUFFIX "/%d", extracted_image_path, layer);
+}
+
+static void
+layer_staging_remove(const char *extracted_image_path, int layer)
+{
+	char *staging_dir = mem_printf("%s" LAYER_STAGING_SUFFIX, extracted_image_path);
+	char *name = mem_printf("%d", layer);
+	if (dir_delete_folder(staging_dir, name) < 0)
+		WARN("Could not remove staging dir %s/%s", staging_dir, name);
+	mem_free0(name);
+	mem_free0(staging_dir);
+}
+
+static pid_t
+extract_layer_start(docker_remote_file_t *layer, const char *in_path, const char *staging_path)
+{
+	pid_t pid = fork();
+	if (pid != 0) {
+		if (pid < 0)
+			ERROR_ERRNO("Could not fork extraction of layer %s", layer->digest);
+		return pid;
+	}
+
+	char *layer_file_name = mem_printf("%s/%s%s", in_path, layer->digest, layer->suffix);
+	INFO("Extracting layer %s to %s", layer_file_name, staging_path);
+	if (dir_mkdir_p(staging_path, 0755) < 0) {
+		ERROR_ERRNO("Can't create dir %s", staging_path);
+		_exit(EXIT_FAILURE);
+	}
+	if (util_tar_extract(layer_file_name, staging_path) < 0) {
+		ERROR("Failed to extract %s", layer_file_name);
+		_exit(EXIT_FAILURE);
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ * Extracts the layers concurrently, each into its own staging directory, and
+ * merges them in order into extracted_image_path as soon as a layer and all
+ * layers below it are extracted.
+ */
+static int
+extract_layers(docker_manifest_t *manifest, const char *in_path, const char *extracted_image_path)
+{
+	int ret = 0;
+	int workers = MAX(1, MIN(sysconf(_SC_NPROCESSORS_ONLN), MAX_EXTRACT_WORKERS));
+	pid_t *pids = mem_new0(pid_t, manifest->layers_size);
+	int started = 0, running = 0;
+
+	for (int merged = 0; merged < manifest->layers_size; ++merged) {
+		for (; ret == 0 && running < workers && started < manifest->layers_size;
+		     ++started, ++running) {
+			char *staging_path = layer_staging_path_new(extracted_image_path, started);
+			pids[started] = extract_layer_start(manifest->layers[started], in_path,
+							    staging_path);
+			mem_free0(staging_path);
+			if (pids[started] < 0) {
+				ret = -1;
+				break;
+			}
+		}
+		if (merged >= started)
+			break;
+
+		int status;
+		if (proc_waitpid(pids[merged], &status, 0) < 0 || !WIFEXITED(status) ||
+		    WEXITSTATUS(status) != EXIT_SUCCESS) {
+			ERROR("Extraction of layer[%d] failed", merged);
+			ret = -1;
+		}
+		running--;
+		if (ret < 0 || merged == 0)
+			continue;
+
+		char *staging_path = layer_staging_path_new(extracted_image_path, merged);
+		INFO("Merging layer[%d]: %s", merged, manifest->layers[merged]->digest);
+		if (util_merge_layer(staging_path, extracted_image_path) < 0) {
+			ERROR("Failed to merge layer %s", staging_path);
+			ret = -1;
+		}
+		mem_free0(staging_path);
+		layer_staging_remove(extracted_image_path, merged);
+	}
+
+	// on errors, remove the staging directories of the layers which were not merged
+	for (int i = 1; ret < 0 && i < started; ++i) {
+		char *staging_path = layer_staging_path_new(extracted_image_path, i);
+		if (file_exists(staging_path))
+			layer_staging_remove(extracted_image_path, i);
+		mem_free0(staging_path);
+	}
+
+	char *staging_dir = mem_printf("%s" LAYER_STAGING_SUFFIX, extracted_image_path);
+	if (file_exists(staging_dir) && rmdir(staging_dir) < 0)
+		WARN_ERRNO("Could not remove staging dir %s", staging_dir);
+	mem_free0(staging_dir);
+
+	mem_free0(pids);
+	return ret;
+}
+
 char *
 merge_layers_new(docker_manifest_t *manifest, char *in_path, char *out_path, char *image_name,
 		 char *image_tag)
@@ -278,17 +408,9 @@ merge_layers_new(docker_manifest_t *manifest, char *in_path, char *out_path, cha
 		goto out;
 	}
 
-	for (int i = 0; i < manifest->layers_size; ++i) {
-		char *layer_file_name = mem_printf("%s/%s%s", in_path, manifest->layers[i]->digest,
-						   manifest->layers[i]->suffix);
-		INFO("Extracting layer[%d]: %s", i, layer_file_name);
-		if (-1 == util_tar_extract(layer_file_name, extracted_image_path)) {
-			ERROR_ERRNO("Failed to extract %s", layer_file_name);
-			mem_free0(layer_file_name);
-			goto out;
-		}
-		mem_free0(layer_file_name);
-	}
+	if (extract_layers(manifest, in_path, extracted_image_path) < 0)
+		goto out;
+
 	image_file = mem_printf("%s/%s", target_image_path, IMAGE_NAME_ROOT);
 	if (util_squash_image(extracted_image_path, image_file) < 0) {
 		mem_free0(image_file);
@@ -205,6 +205,12 @@ docker_parse_manifest_new(const char *raw_file_buffer)
 	for (int i = 0; i < manifest->layers_size; ++i) {
 		cJSON *item = cJSON_GetArrayItem(jlayers, i);
 		manifest->layers[i] = parse_remote_file_new(item, ".tar.gz");
+		// OCI layers may also be compressed with zstd
+		if (manifest->layers[i]->media_type &&
+		    strstr(manifest->layers[i]->media_type, "zstd")) {
+			mem_free0(manifest->layers[i]->suffix);
+			manifest->layers[i]->suffix = mem_strdup(".tar.zst");
+		}
 	}
 
 	cJSON_Delete(jroot);
@@ -27,6 +27,7 @@
 #include "common/mem.h"
 #include "common/file.h"
 #include "common/proc.h"
+#include "common/dir.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -34,17 +35,28 @@
 #include <fcntl.h>
 #include <sys/wait.h>
 #include <stdint.h>
+#include <errno.h>
+#include <sys/stat.h>
 
 #include <openssl/sha.h>
 
 #define OPENSSLBIN_PATH "openssl"
 #define TAR_PATH "tar"
+#define PIGZ_PATH "pigz"
+#define GZIP_PATH "gzip"
+#define PZSTD_PATH "pzstd"
+#define ZSTD_PATH "zstd"
 #define MKSQUASHFS_PATH "mksquashfs"
 #define MKSQUASHFS_COMP "gzip"
 #define MKSQUASHFS_BSIZE "131072"
+#define VERITYSETUP_PATH "veritysetup"
 
 #define SIGN_HASH_BUFFER_SIZE 4096
 
+// whiteout files of OCI image layers
+#define UTIL_WHITEOUT_PREFIX ".wh."
+#define UTIL_WHITEOUT_OPAQUE ".wh..wh..opq"
+
 #define PKIGENSCRIPT_PATH UTIL_PKI_PATH "ssig_pki_generator.sh"
 #define PKIGENCONF_PATH UTIL_PKI_PATH "ssig_pki_generator.conf"
 
@@ -77,13 +89,199 @@
 //    }
 //}
 
+static bool
+util_program_exists(const char *name)
+{
+	const char *env_path = getenv("PATH");
+	IF_NULL_RETVAL(env_path, false);
+
+	bool found = false;
+	char *path = mem_strdup(env_path);
+	char *saveptr = NULL;
+	for (char *dir = strtok_r(path, ":", &saveptr); dir && !found;
+	     dir = strtok_r(NULL, ":", &saveptr)) {
+		char *program = mem_printf("%s/%s", dir, name);
+		found = access(program, X_OK) == 0;
+		mem_free0(program);
+	}
+	mem_free0(path);
+	return found;
+}
+
+static bool
+util_has_suffix(const char *str, const char *suffix)
+{
+	size_t len = strlen(str), suffix_len = strlen(suffix);
+	return len >= suffix_len && !strcmp(str + len - suffix_len, suffix);
+}
+
 int
 util_tar_extract(const char *tar_filename, const char *out_dir)
 {
-	const char *const argv[] = { TAR_PATH, "-xvf", tar_filename, "-C", out_dir, NULL };
+	/*
+	 * Prefer the multi-threaded decompressors: pzstd decompresses the
+	 * independent frames of a zstd stream in parallel, pigz runs reading,
+	 * inflating and checksumming of gzip in separate threads.
+	 */
+	const char *decompressor = NULL;
+	if (util_has_suffix(tar_filename, ".zst"))
+		decompressor = util_program_exists(PZSTD_PATH) ? PZSTD_PATH : ZSTD_PATH;
+	else if (util_has_suffix(tar_filename, ".gz"))
+		decompressor = util_program_exists(PIGZ_PATH) ? PIGZ_PATH : GZIP_PATH;
+
+	if (decompressor) {
+		const char *const argv[] = { TAR_PATH,	   "-x", "-I",	  decompressor, "-f",
+					     tar_filename, "-C", out_dir, NULL };
+		return proc_fork_and_execvp(argv);
+	}
+
+	const char *const argv[] = { TAR_PATH, "-xf", tar_filename, "-C", out_dir, NULL };
 	return proc_fork_and_execvp(argv);
 }
 
+/*
+ * Removes the entry name in dir, which may also be a whole directory tree.
+ */
+static int
+util_remove_entry(const char *dir, const char *name)
+{
+	struct stat st;
+	char *path = mem_printf("%s/%s", dir, name);
+	int ret = 0;
+
+	if (lstat(path, &st) < 0) {
+		ret = errno == ENOENT ? 0 : -1;
+	} else if (S_ISDIR(st.st_mode)) {
+		ret = dir_delete_folder(dir, name);
+	} else if (unlink(path) < 0) {
+		ERROR_ERRNO("Could not remove %s", path);
+		ret = -1;
+	}
+
+	mem_free0(path);
+	return ret;
+}
+
+static int
+util_remove_entry_cb(const char *path, const char *file, UNUSED void *data)
+{
+	return util_remove_entry(path, file);
+}
+
+/*
+ * Removes the whiteouts of a directory tree which is moved as a whole, as
+ * there are no entries of lower layers below it which they could hide.
+ */
+static int
+util_strip_whiteouts_cb(const char *path, const char *file, UNUSED void *data)
+{
+	if (!strncmp(file, UTIL_WHITEOUT_PREFIX, strlen(UTIL_WHITEOUT_PREFIX)))
+		return util_remove_entry(path, file);
+
+	struct stat st;
+	char *entry = mem_printf("%s/%s", path, file);
+	int ret = 0;
+
+	if (lstat(entry, &st) < 0) {
+		ERROR_ERRNO("Could not stat %s", entry);
+		ret = -1;
+	} else if (S_ISDIR(st.st_mode) && dir_foreach(entry, &util_strip_whiteouts_cb, NULL) < 0) {
+		ret = -1;
+	}
+
+	mem_free0(entry);
+	return ret;
+}
+
+/*
+ * Removes the entry of a lower layer which was deleted in this layer. The
+ * opaque whiteout is already handled before the directory is merged.
+ */
+static int
+util_apply_whiteout_cb(UNUSED const char *path, const char *file, void *data)
+{
+	const char *target_dir = data;
+
+	if (!strcmp(file, UTIL_WHITEOUT_OPAQUE) ||
+	    strncmp(file, UTIL_WHITEOUT_PREFIX, strlen(UTIL_WHITEOUT_PREFIX)))
+		return 0;
+
+	return util_remove_entry(target_dir, file + strlen(UTIL_WHITEOUT_PREFIX));
+}
+
+static int
+util_merge_layer_cb(const char *path, const char *file, void *data)
+{
+	const char *target_dir = data;
+	int ret = 0;
+
+	// whiteouts are applied before, see util_merge_layer()
+	if (!strncmp(file, UTIL_WHITEOUT_PREFIX, strlen(UTIL_WHITEOUT_PREFIX)))
+		return 0;
+
+	char *src = mem_printf("%s/%s", path, file);
+	char *dst = mem_printf("%s/%s", target_dir, file);
+
+	struct stat src_st, dst_st;
+	if (lstat(src, &src_st) < 0) {
+		ERROR_ERRNO("Could not stat %s", src);
+		ret = -1;
+		goto out;
+	}
+
+	if (lstat(dst, &dst_st) == 0) {
+		if (S_ISDIR(src_st.st_mode) && S_ISDIR(dst_st.st_mode)) {
+			ret = util_merge_layer(src, dst);
+			// the upper layer defines the attributes of the directory
+			if (lchown(dst, src_st.st_uid, src_st.st_gid) < 0 ||
+			    chmod(dst, src_st.st_mode & 07777) < 0)
+				WARN_ERRNO("Could not set attributes of %s", dst);
+			goto out;
+		}
+		if (util_remove_entry(target_dir, file) < 0) {
+			ret = -1;
+			goto out;
+		}
+	}
+
+	if (S_ISDIR(src_st.st_mode) && dir_foreach(src, &util_strip_whiteouts_cb, NULL) < 0) {
+		ERROR("Could not remove whiteouts in %s", src);
+		ret = -1;
+		goto out;
+	}
+
+	// moving the entry avoids copying any file data
+	if (rename(src, dst) < 0) {
+		ERROR_ERRNO("Could not move %s to %s", src, dst);
+		ret = -1;
+	}
+out:
+	mem_free0(src);
+	mem_free0(dst);
+	return ret;
+}
+
+int
+util_merge_layer(const char *layer_dir, const char *target_dir)
+{
+	char *opaque = mem_printf("%s/%s", layer_dir, UTIL_WHITEOUT_OPAQUE);
+	bool is_opaque = file_exists(opaque);
+	mem_free0(opaque);
+
+	// an opaque directory hides all entries of the lower layers
+	if (is_opaque && dir_foreach(target_dir, &util_remove_entry_cb, NULL) < 0)
+		return -1;
+
+	/*
+	 * Whiteouts only hide entries of the lower layers, thus they are applied
+	 * before the entries of this layer are merged, which may have the same name.
+	 */
+	if (dir_foreach(layer_dir, &util_apply_whiteout_cb, (void *)target_dir) < 0)
+		return -1;
+
+	return dir_foreach(layer_dir, &util_merge_layer_cb, (void *)target_dir) < 0 ? -1 : 0;
+}
+
 static char *
 convert_bin_to_hex_new(const uint8_t *bin, int length)
 {
@@ -153,6 +351,39 @@ util_squash_image(const char *dir, const char *image_file)
 	return proc_fork_and_execvp(argv);
 }
 
+char *
+util_verity_format_new(const char *image_file, const char *hash_file)
+{
+	char *root_hash_file = mem_printf("%s.roothash", hash_file);
+	char *root_hash_arg = mem_printf("--root-hash-file=%s", root_hash_file);
+	char *root_hash = NULL;
+
+	/*
+	 * The superblock written to the hash file holds the salt and block sizes,
+	 * which are read back by cmld when the dm-verity device is set up.
+	 */
+	const char *const argv[] = { VERITYSETUP_PATH, "format",      image_file,
+				     hash_file,	       root_hash_arg, NULL };
+	if (proc_fork_and_execvp(argv) < 0) {
+		ERROR("Failed to create dm-verity hash tree for %s", image_file);
+		goto out;
+	}
+
+	root_hash = file_read_new(root_hash_file, 4096);
+	if (!root_hash) {
+		ERROR("Failed to read dm-verity root hash of %s", image_file);
+		goto out;
+	}
+	root_hash[strcspn(root_hash, "\n")] = '\0';
+	INFO("Created dm-verity hash tree %s for %s with root hash %s", hash_file, image_file,
+	     root_hash);
+out:
+	unlink(root_hash_file);
+	mem_free0(root_hash_arg);
+	mem_free0(root_hash_file);
+	return root_hash;
+}
+
 int
 util_sign_guestos(const char *sig_file, const char *cfg_file, const char *key_file)
 {
@@ -42,12 +42,32 @@ util_hash_sha_image_file_new(const char *image_file);
 char *
 util_hash_sha256_image_file_new(const char *image_file);
 
+/**
+ * Extracts a (compressed) tar archive into out_dir. The decompressor is
+ * chosen by the suffix of the archive.
+ */
 int
 util_tar_extract(const char *tar_filename, const char *out_dir);
 
+/**
+ * Merges the extracted image layer in layer_dir on top of the lower layers in
+ * target_dir and applies the whiteouts of the layer. Entries are moved out of
+ * layer_dir.
+ */
+int
+util_merge_layer(const char *layer_dir, const char *target_dir);
+
 int
 util_squash_image(const char *dir, const char *image_file);
 
+/**
+ * Creates the dm-verity hash tree of an image in hash_file.
+ *
+ * @return The hex encoded root hash, which must be freed, or NULL on error.
+ */
+char *
+util_verity_format_new(const char *image_file, const char *hash_file);
+
 int
 util_sign_guestos(const char *sig_file, const char *cfg_file, const char *key_file);
 
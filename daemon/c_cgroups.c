@@ -38,15 +38,18 @@
 #include "hardware.h"
 #include "cmld.h"
 #include "mount.h"
+#include "cgroups_cpu.h"
 
 #include "common/mem.h"
 #include "common/macro.h"
 #include "common/file.h"
 #include "common/event.h"
 #include "common/dir.h"
+#include "common/devrule.h"
 
 #include <limits.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <sys/mount.h>
@@ -76,6 +79,12 @@
 
 #define CGROUPS_FREEZER_RETRIES CGROUPS_FREEZER_TIMEOUT / CGROUPS_FREEZER_RETRY_INTERVAL
 
+/* Default weights of the io controller and the legacy blkio subsystem */
+#define CGROUPS_IO_WEIGHT_DEFAULT 100
+#define CGROUPS_BLKIO_WEIGHT_DEFAULT 500
+#define CGROUPS_BLKIO_WEIGHT_MIN 10
+#define CGROUPS_BLKIO_WEIGHT_MAX 1000
+
 #define DEVCG_TYPE_BLOCK 1
 #define DEVCG_TYPE_CHAR 2
 
@@ -101,6 +110,7 @@ typedef struct c_cgroups {
 				  assigned devices.  wildcard '*' is mapped to -1 */
 	list_t *allowed_devs; /* list of 3 element int arrays, representing type maj:min of devices
 				 allowed to be accessed. wildcard '*' is mapped to -1 */
+	devrule_index_t *allowed_index; // compiled from allowed_devs list, NULL if outdated
 	bool ns_cgroup;
 } c_cgroups_t;
 
@@ -129,6 +139,7 @@ c_cgroups_free(void *cgroupsp)
 	c_cgroups_t *cgroups = cgroupsp;
 	ASSERT(cgroups);
 
+	devrule_index_free(cgroups->allowed_index);
 	mem_free0(cgroups);
 }
 
@@ -310,11 +321,55 @@ c_cgroups_list_contains_match(const list_t *list, const int *dev)
 	return 0;
 }
 
+static void
+c_cgroups_invalidate_index(c_cgroups_t *cgroups)
+{
+	devrule_index_free(cgroups->allowed_index);
+	cgroups->allowed_index = NULL;
+}
+
+/*
+ * Returns the compiled index of the allowed_devs list. The index is only
+ * rebuilt if the list has changed since the last lookup. Assigned devices
+ * are always part of the allowed_devs list as well.
+ */
+static const devrule_index_t *
+c_cgroups_get_index(c_cgroups_t *cgroups)
+{
+	if (cgroups->allowed_index)
+		return cgroups->allowed_index;
+
+	cgroups->allowed_index = devrule_index_new();
+	for (list_t *elem = cgroups->allowed_devs; elem != NULL; elem = elem->next) {
+		const int *dev_elem = (const int *)elem->data;
+		char type;
+		switch (dev_elem[0]) {
+		case DEVCG_TYPE_CHAR:
+			type = 'c';
+			break;
+		case DEVCG_TYPE_BLOCK:
+			type = 'b';
+			break;
+		default:
+			type = 'a';
+		}
+		if (devrule_index_add(cgroups->allowed_index, type, dev_elem[1], dev_elem[2]) < 0)
+			WARN("Could not index device rule %c %d:%d", type, dev_elem[1],
+			     dev_elem[2]);
+	}
+	DEBUG("Compiled device rule index with %u rules for container %s",
+	      devrule_index_get_count(cgroups->allowed_index),
+	      container_get_name(cgroups->container));
+
+	return cgroups->allowed_index;
+}
+
 static void
 c_cgroups_add_allowed(c_cgroups_t *cgroups, const int *dev)
 {
 	c_cgroups_list_add(&global_allowed_devs_list, dev);
 	c_cgroups_list_add(&cgroups->allowed_devs, dev);
+	c_cgroups_invalidate_index(cgroups);
 }
 
 static void
@@ -786,6 +841,254 @@ out:
 	return ret;
 }
 
+/*
+ * Returns the path of the container's cgroup in the hierarchy of the cpu
+ * subsystem, which may be co-mounted with others, e.g., as 'cpu,cpuacct'.
+ */
+static char *
+c_cgroups_cpu_path_new(const c_cgroups_t *cgroups)
+{
+	for (list_t *l = cgroups->active_cgroups; l; l = l->next) {
+		char *subsys = mem_strdup(l->data);
+		char *saveptr = NULL;
+		for (char *tok = strtok_r(subsys, ",", &saveptr); tok;
+		     tok = strtok_r(NULL, ",", &saveptr)) {
+			if (!strcmp(tok, "cpu")) {
+				char *path = mem_printf(
+					"%s/%s/%s", CGROUPS_FOLDER, (const char *)l->data,
+					uuid_string(container_get_uuid(cgroups->container)));
+				mem_free0(subsys);
+				return path;
+			}
+		}
+		mem_free0(subsys);
+	}
+	return NULL;
+}
+
+static int
+c_cgroups_set_cpu_limits(const c_cgroups_t *cgroups)
+{
+	ASSERT(cgroups);
+
+	const container_cpu_limits_t *limits = container_get_cpu_limits(cgroups->container);
+	if (!cgroups_cpu_limits_is_set(limits)) {
+		INFO("Setting no CPU limits for container %s",
+		     container_get_description(cgroups->container));
+		return 0;
+	}
+
+	char *cpu_path = c_cgroups_cpu_path_new(cgroups);
+	if (!cpu_path) {
+		ERROR("No cgroups cpu subsystem mounted to limit CPU of container %s",
+		      container_get_description(cgroups->container));
+		return -1;
+	}
+
+	int ret = cgroups_cpu_set_limits_legacy(cpu_path, limits);
+	if (!ret)
+		INFO("Set CPU limits of container %s to quota=%u us period=%u us weight=%u burst=%u us",
+		     container_get_description(cgroups->container), limits->quota_us,
+		     limits->period_us, limits->weight, limits->burst_us);
+
+	mem_free0(cpu_path);
+	return ret;
+}
+
+static int
+c_cgroups_update_cpu_limits(void *cgroupsp)
+{
+	c_cgroups_t *cgroups = cgroupsp;
+	ASSERT(cgroups);
+
+	char *cpu_path = c_cgroups_cpu_path_new(cgroups);
+	IF_NULL_RETVAL_ERROR(cpu_path, -1);
+
+	int ret = 0;
+	// the limits are applied on the next start
+	if (file_is_dir(cpu_path)) {
+		ret = cgroups_cpu_set_limits_legacy(cpu_path,
+						    container_get_cpu_limits(cgroups->container));
+		if (!ret)
+			INFO("Updated CPU limits of container %s",
+			     container_get_description(cgroups->container));
+	}
+
+	mem_free0(cpu_path);
+	return ret;
+}
+
+static int
+c_cgroups_set_blkio_throttle(const char *path, const char *file, const char *dev, uint64_t value)
+{
+	// a value of 0 would remove the rule for the device, which does not exist yet
+	IF_TRUE_RETVAL(value == 0, 0);
+
+	char *throttle_path = mem_printf("%s/%s", path, file);
+	int ret = file_printf(throttle_path, "%s %" PRIu64, dev, value);
+	if (ret == -1)
+		WARN("Could not write '%s %" PRIu64 "' to %s", dev, value, throttle_path);
+	mem_free0(throttle_path);
+	return ret;
+}
+
+/**
+ * Configures the blkio subsystem with the I/O limits of the container. The weight
+ * is given in the range of the io controller of the unified hierarchy and mapped
+ * to the range of blkio.weight. The throttling rules are applied to each device
+ * which backs a volume of the container on each start.
+ */
+static int
+c_cgroups_set_io_limits(c_cgroups_t *cgroups)
+{
+	ASSERT(cgroups);
+
+	const container_io_limits_t *limits = container_get_io_limits(cgroups->container);
+	if (!limits->weight && !limits->read_bps && !limits->write_bps && !limits->read_iops &&
+	    !limits->write_iops) {
+		INFO("Setting no I/O limits for container %s",
+		     container_get_description(cgroups->container));
+		return 0;
+	}
+
+	int ret = -1;
+	char *blkio_path = mem_printf("%s/blkio/%s", CGROUPS_FOLDER,
+				      uuid_string(container_get_uuid(cgroups->container)));
+	list_t *devices = NULL;
+
+	if (!file_is_dir(blkio_path)) {
+		ERROR("%s not found (cgroups blkio subsystem not mounted?)", blkio_path);
+		goto out;
+	}
+
+	if (limits->weight) {
+		uint64_t weight = (uint64_t)limits->weight * CGROUPS_BLKIO_WEIGHT_DEFAULT /
+				  CGROUPS_IO_WEIGHT_DEFAULT;
+		weight = MAX(CGROUPS_BLKIO_WEIGHT_MIN, MIN(weight, CGROUPS_BLKIO_WEIGHT_MAX));
+
+		char *weight_path = mem_printf("%s/blkio.weight", blkio_path);
+		if (!file_exists(weight_path)) {
+			WARN("%s file not found, I/O weight of container %s is not applied",
+			     weight_path, container_get_description(cgroups->container));
+		} else if (file_printf(weight_path, "%" PRIu64, weight) == -1) {
+			ERROR("Could not write I/O weight to %s", weight_path);
+			mem_free0(weight_path);
+			goto out;
+		} else {
+			INFO("Set blkio weight of container %s to %" PRIu64,
+			     container_get_description(cgroups->container), weight);
+		}
+		mem_free0(weight_path);
+	}
+
+	devices = container_get_volume_devices_new(cgroups->container);
+	for (list_t *l = devices; l; l = l->next) {
+		const char *dev = l->data;
+		if (c_cgroups_set_blkio_throttle(blkio_path, "blkio.throttle.read_bps_device", dev,
+						 limits->read_bps) ||
+		    c_cgroups_set_blkio_throttle(blkio_path, "blkio.throttle.write_bps_device", dev,
+						 limits->write_bps) ||
+		    c_cgroups_set_blkio_throttle(blkio_path, "blkio.throttle.read_iops_device", dev,
+						 limits->read_iops) ||
+		    c_cgroups_set_blkio_throttle(blkio_path, "blkio.throttle.write_iops_device",
+						 dev, limits->write_iops)) {
+			WARN("Could not limit I/O of container %s on device %s",
+			     container_get_description(cgroups->container), dev);
+			continue;
+		}
+		DEBUG("Limited I/O of container %s on device %s",
+		      container_get_description(cgroups->container), dev);
+	}
+
+	ret = 0;
+out:
+	for (list_t *l = devices; l; l = l->next)
+		mem_free0(l->data);
+	list_delete(devices);
+	mem_free0(blkio_path);
+	return ret;
+}
+
+/*
+ * Applies changed I/O limits to a running container. Throttling rules which
+ * were set before are removed first, as c_cgroups_set_io_limits() only writes
+ * the limits which are configured.
+ */
+static int
+c_cgroups_update_io_limits(void *cgroupsp)
+{
+	c_cgroups_t *cgroups = cgroupsp;
+	ASSERT(cgroups);
+
+	char *blkio_path = mem_printf("%s/blkio/%s", CGROUPS_FOLDER,
+				      uuid_string(container_get_uuid(cgroups->container)));
+
+	// the limits are applied on the next start
+	if (!file_is_dir(blkio_path)) {
+		mem_free0(blkio_path);
+		return 0;
+	}
+
+	const char *throttle_files[] = { "blkio.throttle.read_bps_device",
+					 "blkio.throttle.write_bps_device",
+					 "blkio.throttle.read_iops_device",
+					 "blkio.throttle.write_iops_device" };
+	list_t *devices = container_get_volume_devices_new(cgroups->container);
+	for (list_t *l = devices; l; l = l->next) {
+		for (size_t i = 0; i < sizeof(throttle_files) / sizeof(throttle_files[0]); ++i) {
+			// a value of 0 removes the rule for the device
+			char *throttle_path = mem_printf("%s/%s", blkio_path, throttle_files[i]);
+			if (file_printf(throttle_path, "%s 0", (char *)l->data) == -1)
+				TRACE("Could not remove rule for %s from %s", (char *)l->data,
+				      throttle_path);
+			mem_free0(throttle_path);
+		}
+		mem_free0(l->data);
+	}
+	list_delete(devices);
+
+	char *weight_path = mem_printf("%s/blkio.weight", blkio_path);
+	if (file_exists(weight_path) &&
+	    file_printf(weight_path, "%d", CGROUPS_BLKIO_WEIGHT_DEFAULT) == -1)
+		WARN("Could not reset I/O weight in %s", weight_path);
+	mem_free0(weight_path);
+	mem_free0(blkio_path);
+
+	IF_TRUE_RETVAL(c_cgroups_set_io_limits(cgroups), -1);
+
+	INFO("Updated I/O limits of container %s", container_get_description(cgroups->container));
+	return 0;
+}
+
+/*
+ * Applies a changed RAM limit to a running container.
+ */
+static int
+c_cgroups_update_ram_limit(void *cgroupsp)
+{
+	c_cgroups_t *cgroups = cgroupsp;
+	ASSERT(cgroups);
+
+	char *limit_in_bytes_path = mem_printf("%s/memory/%s/memory.limit_in_bytes", CGROUPS_FOLDER,
+					       uuid_string(container_get_uuid(cgroups->container)));
+
+	int ret = 0;
+	// the limit is applied on the next start
+	if (!file_exists(limit_in_bytes_path)) {
+		TRACE("%s does not exist, container is not running", limit_in_bytes_path);
+	} else if (container_get_ram_limit(cgroups->container) == 0) {
+		ret = file_printf(limit_in_bytes_path, "-1") == -1 ? -1 : 0;
+		if (ret)
+			ERROR("Could not remove RAM limit of container %s",
+			      container_get_description(cgroups->container));
+	} else {
+		ret = c_cgroups_set_ram_limit(cgroups);
+	}
+
+	mem_free0(limit_in_bytes_path);
+	return ret;
+}
+
 static int
 c_cgroups_set_cpu_exclusive(const c_cgroups_t *cgroups, char *path)
 {
@@ -1024,38 +1327,12 @@ c_cgroups_devices_is_dev_allowed(void *cgroupsp, char type, int major, int minor
 	c_cgroups_t *cgroups = cgroupsp;
 	ASSERT(cgroups);
 
-	int type_int;
-	switch (type) {
-	case 'b':
-		type_int = DEVCG_TYPE_BLOCK;
-		break;
-	case 'c':
-		type_int = DEVCG_TYPE_CHAR;
-		break;
-	default:
-		type_int = 0;
-	}
-
-	IF_TRUE_RETVAL(type_int == 0, false);
-	IF_TRUE_RETVAL_TRACE(major < 0 || minor < 0, false);
-
-	int dev[3] = { type_int, major, minor };
-
-	/* search in assigned devices */
-	if (c_cgroups_list_contains_match(cgroups->assigned_devs, dev)) {
-		TRACE("Found match in assigned_devs for device %d:%d, type %c", dev[1], dev[2],
-		      type);
+	if (devrule_index_match(c_cgroups_get_index(cgroups), type, major, minor)) {
+		TRACE("Found match in allowed_devs for device %d:%d, type %c", major, minor, type);
 		return true;
 	}
 
-	/* search in allowed devices */
-	if (c_cgroups_list_contains_match(cgroups->allowed_devs, dev)) {
-		TRACE("Found match in assigned_devs for device %d:%d, type %c", dev[1], dev[2],
-		      type);
-		return true;
-	}
-
-	TRACE("Did not find match for device %d:%d, type %c", dev[1], dev[2], type);
+	TRACE("Did not find match for device %d:%d, type %c", major, minor, type);
 
 	return false;
 }
@@ -1106,6 +1383,20 @@ c_cgroups_start_post_clone(void *cgroupsp)
 		goto error;
 	}
 
+	/* initialize cpu subsystem to limit the cpu bandwidth of the container */
+	if (c_cgroups_set_cpu_limits(cgroups) < 0) {
+		ERROR("Could not configure cgroup CPU limits for container %s",
+		      container_get_description(cgroups->container));
+		goto error;
+	}
+
+	/* initialize blkio subsystem to limit the I/O on the devices of the container */
+	if (c_cgroups_set_io_limits(cgroups) < 0) {
+		ERROR("Could not configure cgroup I/O limits for container %s",
+		      container_get_description(cgroups->container));
+		goto error;
+	}
+
 	/* initialize freezer subsystem */
 	char *freezer_state_path = mem_printf("%s/freezer/%s/freezer.state", CGROUPS_FOLDER,
 					      uuid_string(container_get_uuid(cgroups->container)));
@@ -1356,6 +1647,7 @@ c_cgroups_cleanup(void *cgroupsp, UNUSED bool is_rebooting)
 	}
 	list_delete(cgroups->allowed_devs);
 	cgroups->allowed_devs = NULL;
+	c_cgroups_invalidate_index(cgroups);
 }
 
 static compartment_module_t c_cgroups_module = {
@@ -1392,6 +1684,9 @@ c_cgroups_init(void)
 	container_register_device_deny_handler(MOD_NAME, c_cgroups_devices_dev_deny);
 	container_register_is_device_allowed_handler(MOD_NAME, c_cgroups_devices_is_dev_allowed);
 	container_register_add_pid_to_cgroups_handler(MOD_NAME, c_cgroups_add_pid);
+	container_register_update_cpu_limits_handler(MOD_NAME, c_cgroups_update_cpu_limits);
+	container_register_update_io_limits_handler(MOD_NAME, c_cgroups_update_io_limits);
+	container_register_update_ram_limit_handler(MOD_NAME, c_cgroups_update_ram_limit);
 
 	// mount cgroups if not allready mounted by init
 	if (mount_cgroups(hardware_get_active_cgroups_subsystems()))
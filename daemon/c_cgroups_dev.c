@@ -36,6 +36,7 @@
 #include "common/mem.h"
 #include "common/macro.h"
 #include "common/file.h"
+#include "common/devrule.h"
 
 #include <errno.h>
 #include <fcntl.h>
@@ -79,6 +80,7 @@ typedef struct c_cgroups_dev {
 				  wildcard '*' is mapped to -1 */
 
 	c_cgroups_bpf_prog_t *bpf_prog; // generated bpf prog from allowed_devs list
+	devrule_index_t *allowed_index; // compiled from allowed_devs list, NULL if outdated
 } c_cgroups_dev_t;
 
 /* List of of devices (c_cgroups_dev_item_t) allowed to be used in the running containers.
@@ -540,6 +542,49 @@ c_cgroups_dev_list_remove(list_t **list, const c_cgroups_dev_item_t *dev_item)
 	}
 }
 
+static void
+c_cgroups_dev_invalidate_index(c_cgroups_dev_t *cgroups_dev)
+{
+	devrule_index_free(cgroups_dev->allowed_index);
+	cgroups_dev->allowed_index = NULL;
+}
+
+/*
+ * Returns the compiled index of the allowed_devs list. The index is only
+ * rebuilt if the list has changed since the last lookup.
+ */
+static const devrule_index_t *
+c_cgroups_dev_get_index(c_cgroups_dev_t *cgroups_dev)
+{
+	if (cgroups_dev->allowed_index)
+		return cgroups_dev->allowed_index;
+
+	cgroups_dev->allowed_index = devrule_index_new();
+	for (list_t *l = cgroups_dev->allowed_devs; l; l = l->next) {
+		c_cgroups_dev_item_t *dev_item = l->data;
+		char type;
+		switch (dev_item->type) {
+		case BPF_DEVCG_DEV_CHAR:
+			type = 'c';
+			break;
+		case BPF_DEVCG_DEV_BLOCK:
+			type = 'b';
+			break;
+		default:
+			type = 'a';
+		}
+		if (devrule_index_add(cgroups_dev->allowed_index, type, dev_item->major,
+				      dev_item->minor) < 0)
+			WARN("Could not index device rule %c %d:%d", type, dev_item->major,
+			     dev_item->minor);
+	}
+	DEBUG("Compiled device rule index with %u rules for container %s",
+	      devrule_index_get_count(cgroups_dev->allowed_index),
+	      container_get_name(cgroups_dev->container));
+
+	return cgroups_dev->allowed_index;
+}
+
 static void
 c_cgroups_dev_add_allowed(c_cgroups_dev_t *cgroups_dev, const c_cgroups_dev_item_t *dev_item)
 {
@@ -550,6 +595,7 @@ c_cgroups_dev_add_allowed(c_cgroups_dev_t *cgroups_dev, const c_cgroups_dev_item
 		return;
 
 	c_cgroups_dev_list_add(&cgroups_dev->allowed_devs, dev_item);
+	c_cgroups_dev_invalidate_index(cgroups_dev);
 }
 
 static void
@@ -642,6 +688,7 @@ c_cgroups_dev_deny(void *cgroups_devp, const char *rule)
 
 	cgroups_dev->allowed_devs = list_remove(cgroups_dev->allowed_devs, matched_dev);
 	mem_free0(matched_dev);
+	c_cgroups_dev_invalidate_index(cgroups_dev);
 
 	// an entry for an assigned device should only be present once in the list
 	if ((matched_dev = c_cgroups_dev_list_match(cgroups_dev->assigned_devs, dev_item)) !=
@@ -720,6 +767,7 @@ c_cgroups_dev_free(void *cgroups_devp)
 	c_cgroups_dev_t *cgroups_dev = cgroups_devp;
 	ASSERT(cgroups_dev);
 
+	c_cgroups_dev_invalidate_index(cgroups_dev);
 	mem_free0(cgroups_dev);
 }
 
@@ -833,6 +881,7 @@ c_cgroups_dev_cleanup(void *cgroups_devp, UNUSED bool is_rebooting)
 	}
 	list_delete(cgroups_dev->allowed_devs);
 	cgroups_dev->allowed_devs = NULL;
+	c_cgroups_dev_invalidate_index(cgroups_dev);
 }
 
 static bool
@@ -841,30 +890,7 @@ c_cgroups_dev_is_dev_allowed(void *cgroups_devp, char type, int major, int minor
 	c_cgroups_dev_t *cgroups_dev = cgroups_devp;
 	ASSERT(cgroups_dev);
 
-	short type_bpf;
-	switch (type) {
-	case 'b':
-		type_bpf = BPF_DEVCG_DEV_BLOCK;
-		break;
-	case 'c':
-		type_bpf = BPF_DEVCG_DEV_CHAR;
-		break;
-	default:
-		type_bpf = 0;
-	}
-	IF_TRUE_RETVAL(type_bpf == 0, false);
-	IF_TRUE_RETVAL_TRACE(major < 0 || minor < 0, false);
-
-	for (list_t *l = cgroups_dev->allowed_devs; l; l = l->next) {
-		c_cgroups_dev_item_t *dev_item = l->data;
-		if (dev_item->type != type_bpf)
-			continue;
-		if (dev_item->major == major &&
-		    ((dev_item->minor == minor) || dev_item->minor == -1))
-			return true;
-	}
-
-	return false;
+	return devrule_index_match(c_cgroups_dev_get_index(cgroups_dev), type, major, minor);
 }
 
 static int
@@ -27,6 +27,15 @@
  * This submodule provides functionality to setup control groups for containers.
  * This includes configurations like the max ram for a container and the functionality
  * to freeze and unfreeze a container.
+ *
+ * Containers with a hibernation timeout are sampled periodically. If a container
+ * has not used noticeable cpu time or I/O for the configured time, it is frozen
+ * and its memory is pushed out to swap via memory.reclaim. It is thawed again on
+ * an explicit unfreeze or a wakeup, e.g., on a control request or device event.
+ *
+ * OOM kills inside a container are noticed through memory.events. They are
+ * counted, audited and handled according to the container's OOM policy, i.e.,
+ * the container is restarted or its ram limit is raised for a while.
  */
 
 #define MOD_NAME "c_cgroups_v2"
@@ -34,6 +43,9 @@
 #define _GNU_SOURCE
 
 #include "container.h"
+#include "cgroups_cpu.h"
+#include "audit.h"
+#include "zram.h"
 
 #include "common/mem.h"
 #include "common/macro.h"
@@ -44,9 +56,13 @@
 #include "common/str.h"
 #include "common/uuid.h"
 
+#include <inttypes.h>
 #include <sched.h>
+#include <signal.h>
+#include <time.h>
 #include <sys/inotify.h>
 #include <sys/mount.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #ifndef CLONE_NEWCGROUP
@@ -62,6 +78,16 @@
 
 #define CGROUPS_FREEZER_RETRIES CGROUPS_FREEZER_TIMEOUT / CGROUPS_FREEZER_RETRY_INTERVAL
 
+/* Define the interval in milliseconds in which the activity of a container is sampled */
+#define CGROUPS_IDLE_CHECK_INTERVAL 30000
+/* Cpu time in permille of the interval up to which a container is considered idle */
+#define CGROUPS_IDLE_CPU_PERMILLE 10
+/* Read and written bytes per interval up to which a container is considered idle */
+#define CGROUPS_IDLE_IO_BYTES (1024 * 1024)
+
+/* Define the time in milliseconds for which the ram limit stays raised after an OOM kill */
+#define CGROUPS_OOM_EXPAND_TIMEOUT 60000
+
 char *c_cgroups_subtree = NULL; // in which containers are running in
 
 typedef struct c_cgroups {
@@ -75,6 +101,23 @@ typedef struct c_cgroups {
 
 	event_timer_t *freeze_timer; /* timer to handle a container freeze timeout */
 	int freezer_retries;
+
+	event_timer_t *idle_timer; /* timer to sample the activity for hibernation */
+	uint64_t idle_cpu_usec;	   /* cpu usage at the last sample */
+	uint64_t idle_io_bytes;	   /* read and written bytes at the last sample */
+	unsigned int idle_time;	   /* seconds without noticeable activity */
+	bool hibernated;	   /* frozen by the hibernation policy */
+	struct timespec resume_start;
+
+	pid_t reclaim_pid; /* child which writes memory.reclaim */
+	event_signal_t *reclaim_sig;
+	uint64_t reclaim_bytes; /* memory.current before the reclaim */
+	struct timespec reclaim_start;
+
+	event_inotify_t *inotify_memory_events;
+	uint64_t oom_kills; /* oom_kill count in memory.events at the last check */
+	event_timer_t
+		*oom_expand_timer; /* restores the ram limit after CONTAINER_OOM_POLICY_EXPAND */
 } c_cgroups_t;
 
 static void *
@@ -96,6 +139,12 @@ c_cgroups_new(compartment_t *compartment)
 	cgroups->inotify_cgroup_events = NULL;
 	cgroups->freeze_timer = NULL;
 	cgroups->freezer_retries = 0;
+	cgroups->idle_timer = NULL;
+	cgroups->hibernated = false;
+	cgroups->reclaim_pid = -1;
+	cgroups->reclaim_sig = NULL;
+	cgroups->inotify_memory_events = NULL;
+	cgroups->oom_expand_timer = NULL;
 	return cgroups;
 }
 
@@ -304,6 +353,169 @@ out:
 	return ret;
 }
 
+static int
+c_cgroups_set_cpu_limits(const c_cgroups_t *cgroups)
+{
+	ASSERT(cgroups);
+
+	const container_cpu_limits_t *limits = container_get_cpu_limits(cgroups->container);
+	if (!cgroups_cpu_limits_is_set(limits)) {
+		INFO("Setting no CPU limits for container %s",
+		     container_get_description(cgroups->container));
+		return 0;
+	}
+
+	IF_TRUE_RETVAL(cgroups_cpu_set_limits(cgroups->path, limits), -1);
+
+	INFO("Set CPU limits of container %s to quota=%u us period=%u us weight=%u burst=%u us",
+	     container_get_description(cgroups->container), limits->quota_us, limits->period_us,
+	     limits->weight, limits->burst_us);
+	return 0;
+}
+
+static int
+c_cgroups_update_cpu_limits(void *cgroupsp)
+{
+	c_cgroups_t *cgroups = cgroupsp;
+	ASSERT(cgroups);
+
+	// the limits are applied on the next start
+	IF_FALSE_RETVAL_TRACE(file_is_dir(cgroups->path), 0);
+
+	const container_cpu_limits_t *limits = container_get_cpu_limits(cgroups->container);
+	IF_TRUE_RETVAL(cgroups_cpu_set_limits(cgroups->path, limits), -1);
+
+	INFO("Updated CPU limits of container %s to quota=%u us period=%u us weight=%u burst=%u us",
+	     container_get_description(cgroups->container), limits->quota_us, limits->period_us,
+	     limits->weight, limits->burst_us);
+	return 0;
+}
+
+static char *
+c_cgroups_io_max_value_new(uint64_t value)
+{
+	return value ? mem_printf("%" PRIu64, value) : mem_strdup("max");
+}
+
+/**
+ * Configures the io controller with the weight and the bandwidth and IOPS
+ * limits of the container. The limits are applied to each device which backs
+ * a volume of the container. These devices are set up anew on each start,
+ * thus the limits are applied on each start as well.
+ */
+static int
+c_cgroups_set_io_limits(const c_cgroups_t *cgroups)
+{
+	ASSERT(cgroups);
+
+	const container_io_limits_t *limits = container_get_io_limits(cgroups->container);
+	if (!limits->weight && !limits->read_bps && !limits->write_bps && !limits->read_iops &&
+	    !limits->write_iops) {
+		INFO("Setting no I/O limits for container %s",
+		     container_get_description(cgroups->container));
+		return 0;
+	}
+
+	int ret = -1;
+	char *io_weight_path = mem_printf("%s/io.weight", cgroups->path);
+	char *io_max_path = mem_printf("%s/io.max", cgroups->path);
+	list_t *devices = NULL;
+
+	if (limits->weight) {
+		// io.weight is only available with a weight based I/O scheduler or io.cost
+		if (!file_exists(io_weight_path)) {
+			WARN("%s file not found, I/O weight of container %s is not applied",
+			     io_weight_path, container_get_description(cgroups->container));
+		} else if (file_printf(io_weight_path, "default %u", limits->weight) == -1) {
+			ERROR("Could not write I/O weight %u to %s", limits->weight,
+			      io_weight_path);
+			goto out;
+		} else {
+			INFO("Set I/O weight of container %s to %u",
+			     container_get_description(cgroups->container), limits->weight);
+		}
+	}
+
+	IF_TRUE_GOTO_TRACE(!limits->read_bps && !limits->write_bps && !limits->read_iops &&
+				   !limits->write_iops,
+			   done);
+
+	if (!file_exists(io_max_path)) {
+		ERROR("%s file not found (cgroups io controller not enabled?)", io_max_path);
+		goto out;
+	}
+
+	char *rbps = c_cgroups_io_max_value_new(limits->read_bps);
+	char *wbps = c_cgroups_io_max_value_new(limits->write_bps);
+	char *riops = c_cgroups_io_max_value_new(limits->read_iops);
+	char *wiops = c_cgroups_io_max_value_new(limits->write_iops);
+
+	devices = container_get_volume_devices_new(cgroups->container);
+	for (list_t *l = devices; l; l = l->next) {
+		const char *dev = l->data;
+		if (file_printf(io_max_path, "%s rbps=%s wbps=%s riops=%s wiops=%s", dev, rbps,
+				wbps, riops, wiops) == -1) {
+			// e.g., devices without a request queue
+			WARN("Could not limit I/O of container %s on device %s",
+			     container_get_description(cgroups->container), dev);
+			continue;
+		}
+		INFO("Limited I/O of container %s on device %s to rbps=%s wbps=%s riops=%s wiops=%s",
+		     container_get_description(cgroups->container), dev, rbps, wbps, riops, wiops);
+	}
+
+	mem_free0(rbps);
+	mem_free0(wbps);
+	mem_free0(riops);
+	mem_free0(wiops);
+done:
+	ret = 0;
+out:
+	for (list_t *l = devices; l; l = l->next)
+		mem_free0(l->data);
+	list_delete(devices);
+	mem_free0(io_max_path);
+	mem_free0(io_weight_path);
+	return ret;
+}
+
+/*
+ * Applies changed I/O limits to a running container. Limits which were
+ * set before are reset first, as c_cgroups_set_io_limits() only writes
+ * the limits which are configured.
+ */
+static int
+c_cgroups_update_io_limits(void *cgroupsp)
+{
+	c_cgroups_t *cgroups = cgroupsp;
+	ASSERT(cgroups);
+
+	// the limits are applied on the next start
+	IF_FALSE_RETVAL_TRACE(file_is_dir(cgroups->path), 0);
+
+	char *io_weight_path = mem_printf("%s/io.weight", cgroups->path);
+	if (file_exists(io_weight_path) && file_printf(io_weight_path, "default 100") == -1)
+		WARN("Could not reset I/O weight in %s", io_weight_path);
+	mem_free0(io_weight_path);
+
+	char *io_max_path = mem_printf("%s/io.max", cgroups->path);
+	list_t *devices = container_get_volume_devices_new(cgroups->container);
+	for (list_t *l = devices; l; l = l->next) {
+		if (file_exists(io_max_path) &&
+		    file_printf(io_max_path, "%s rbps=max wbps=max riops=max wiops=max",
+				(char *)l->data) == -1)
+			WARN("Could not reset I/O limits on device %s", (char *)l->data);
+		mem_free0(l->data);
+	}
+	list_delete(devices);
+	mem_free0(io_max_path);
+
+	IF_TRUE_RETVAL(c_cgroups_set_io_limits(cgroups), -1);
+
+	INFO("Updated I/O limits of container %s", container_get_description(cgroups->container));
+	return 0;
+}
+
 static void
 c_cgroups_event_populated(c_cgroups_t *cgroups, bool is_populated)
 {
@@ -330,6 +542,179 @@ c_cgroups_cleanup_freeze_timer(c_cgroups_t *cgroups)
 	cgroups->freezer_retries = 0;
 }
 
+static unsigned int
+c_cgroups_elapsed_ms(const struct timespec *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+/*
+ * Sums up all values of key in a cgroup stat file. Values are either given
+ * as 'key value' lines, e.g., in cpu.stat, or as 'key=value' pairs, e.g.,
+ * for each device in io.stat. Missing files or keys count as 0.
+ */
+static uint64_t
+c_cgroups_stat_sum(const c_cgroups_t *cgroups, const char *file, const char *key)
+{
+	char *path = mem_printf("%s/%s", cgroups->path, file);
+	char *stat = file_exists(path) ? file_read_new(path, 4096) : NULL;
+	mem_free0(path);
+	IF_NULL_RETVAL(stat, 0);
+
+	uint64_t sum = 0;
+	size_t key_len = strlen(key);
+	char *saveptr = NULL;
+	for (char *tok = strtok_r(stat, " \n", &saveptr); tok;
+	     tok = strtok_r(NULL, " \n", &saveptr)) {
+		if (strncmp(tok, key, key_len))
+			continue;
+		if (tok[key_len] == '=') {
+			sum += strtoull(tok + key_len + 1, NULL, 10);
+		} else if (tok[key_len] == '\0') {
+			char *value = strtok_r(NULL, " \n", &saveptr);
+			if (value)
+				sum += strtoull(value, NULL, 10);
+		}
+	}
+	mem_free0(stat);
+	return sum;
+}
+
+static uint64_t
+c_cgroups_get_memory_current(const c_cgroups_t *cgroups)
+{
+	char *path = mem_printf("%s/memory.current", cgroups->path);
+	char *current = file_read_new(path, 64);
+	mem_free0(path);
+	IF_NULL_RETVAL(current, 0);
+
+	uint64_t bytes = strtoull(current, NULL, 10);
+	mem_free0(current);
+	return bytes;
+}
+
+/*
+ * Pages in zswap also hold a swap entry, thus memory.swap.current includes them.
+ * The rest is on the swap devices, where it is accounted with the compression
+ * ratio of the zram device or uncompressed for other swap devices.
+ */
+static int
+c_cgroups_get_swap_stats(void *cgroupsp, container_swap_stats_t *stats)
+{
+	c_cgroups_t *cgroups = cgroupsp;
+	ASSERT(cgroups);
+	ASSERT(stats);
+
+	char *path = mem_printf("%s/memory.swap.current", cgroups->path);
+	char *current = file_exists(path) ? file_read_new(path, 64) : NULL;
+	mem_free0(path);
+	IF_NULL_RETVAL(current, -1);
+
+	stats->swap_used = strtoull(current, NULL, 10);
+	mem_free0(current);
+
+	uint64_t zswapped = c_cgroups_stat_sum(cgroups, "memory.stat", "zswapped");
+	uint64_t on_device = stats->swap_used - MIN(zswapped, stats->swap_used);
+	stats->swap_compressed = c_cgroups_stat_sum(cgroups, "memory.stat", "zswap");
+
+	zram_stats_t zram;
+	if (!zram_get_stats(&zram) && zram.orig_data_size > 0)
+		stats->swap_compressed += on_device * zram.compr_data_size / zram.orig_data_size;
+	else
+		stats->swap_compressed += on_device;
+
+	stats->swap_ins = c_cgroups_stat_sum(cgroups, "memory.stat", "pswpin") +
+			  c_cgroups_stat_sum(cgroups, "memory.stat", "zswpin");
+	stats->swap_outs = c_cgroups_stat_sum(cgroups, "memory.stat", "pswpout") +
+			   c_cgroups_stat_sum(cgroups, "memory.stat", "zswpout");
+	return 0;
+}
+
+static void
+c_cgroups_reclaim_sigchld_cb(UNUSED int signum, event_signal_t *sig, void *data)
+{
+	c_cgroups_t *cgroups = data;
+	ASSERT(cgroups);
+
+	int status = 0;
+	IF_TRUE_RETURN(waitpid(cgroups->reclaim_pid, &status, WNOHANG) <= 0);
+
+	event_remove_signal(sig);
+	event_signal_free(sig);
+	cgroups->reclaim_sig = NULL;
+	cgroups->reclaim_pid = -1;
+
+	// the kernel fails the write if less than the requested amount could be reclaimed
+	uint64_t current = c_cgroups_get_memory_current(cgroups);
+	INFO("Reclaimed %" PRIu64 " of %" PRIu64 " KiB of hibernated container %s in %u ms%s",
+	     (cgroups->reclaim_bytes - MIN(current, cgroups->reclaim_bytes)) / 1024,
+	     cgroups->reclaim_bytes / 1024, container_get_description(cgroups->container),
+	     c_cgroups_elapsed_ms(&cgroups->reclaim_start),
+	     WIFEXITED(status) && WEXITSTATUS(status) == 0 ? "" : " (partially)");
+}
+
+/*
+ * Pushes the memory of a frozen container out to swap. Writing memory.reclaim
+ * blocks until the kernel is done, thus it is written by a child process.
+ */
+static void
+c_cgroups_reclaim(c_cgroups_t *cgroups)
+{
+	IF_TRUE_RETURN(cgroups->reclaim_pid > 0);
+
+	char *reclaim_path = mem_printf("%s/memory.reclaim", cgroups->path);
+	if (!file_exists(reclaim_path)) {
+		WARN("No memory.reclaim support, memory of hibernated container %s stays resident",
+		     container_get_description(cgroups->container));
+		mem_free0(reclaim_path);
+		return;
+	}
+
+	cgroups->reclaim_bytes = c_cgroups_get_memory_current(cgroups);
+	char *amount = mem_printf("%" PRIu64, cgroups->reclaim_bytes);
+	clock_gettime(CLOCK_MONOTONIC, &cgroups->reclaim_start);
+
+	pid_t pid = fork();
+	if (pid == 0) {
+		_exit(file_write(reclaim_path, amount, -1) < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+	} else if (pid < 0) {
+		ERROR_ERRNO("Could not fork reclaim of container %s",
+			    container_get_description(cgroups->container));
+	} else {
+		DEBUG("Reclaiming %" PRIu64 " KiB of hibernated container %s",
+		      cgroups->reclaim_bytes / 1024, container_get_description(cgroups->container));
+		cgroups->reclaim_pid = pid;
+		cgroups->reclaim_sig =
+			event_signal_new(SIGCHLD, c_cgroups_reclaim_sigchld_cb, cgroups);
+		event_add_signal(cgroups->reclaim_sig);
+	}
+
+	mem_free0(amount);
+	mem_free0(reclaim_path);
+}
+
+/*
+ * Stops a running reclaim, e.g. before the container is thawed, so that the
+ * memory of the running container is not pushed out to swap any further.
+ */
+static void
+c_cgroups_reclaim_abort(c_cgroups_t *cgroups)
+{
+	IF_FALSE_RETURN(cgroups->reclaim_pid > 0);
+
+	DEBUG("Aborting reclaim of container %s", container_get_description(cgroups->container));
+
+	// the kernel aborts reclaiming on a fatal signal
+	kill(cgroups->reclaim_pid, SIGKILL);
+	waitpid(cgroups->reclaim_pid, NULL, 0);
+	event_remove_signal(cgroups->reclaim_sig);
+	event_signal_free(cgroups->reclaim_sig);
+	cgroups->reclaim_sig = NULL;
+	cgroups->reclaim_pid = -1;
+}
+
 static void
 c_cgroups_event_freezer(c_cgroups_t *cgroups, bool is_frozen)
 {
@@ -347,11 +732,19 @@ c_cgroups_event_freezer(c_cgroups_t *cgroups, bool is_frozen)
 		INFO("Container %s thawed from freezing or frozen state",
 		     container_get_description(cgroups->container));
 		c_cgroups_cleanup_freeze_timer(cgroups);
+		if (cgroups->hibernated && cgroups->resume_start.tv_sec)
+			INFO("Container %s resumed from hibernation in %u ms",
+			     container_get_description(cgroups->container),
+			     c_cgroups_elapsed_ms(&cgroups->resume_start));
+		cgroups->hibernated = false;
+		cgroups->idle_time = 0;
 		container_set_state(cgroups->container, COMPARTMENT_STATE_RUNNING);
 	} else if (is_frozen && (compartment_state != COMPARTMENT_STATE_FROZEN)) {
 		INFO("Container %s frozen", container_get_description(cgroups->container));
 		c_cgroups_cleanup_freeze_timer(cgroups);
 		container_set_state(cgroups->container, COMPARTMENT_STATE_FROZEN);
+		if (cgroups->hibernated)
+			c_cgroups_reclaim(cgroups);
 	}
 }
 
@@ -391,6 +784,12 @@ c_cgroups_unfreeze(void *cgroupsp)
 	c_cgroups_t *cgroups = cgroupsp;
 	ASSERT(cgroups);
 
+	// resume latency is measured from the request until the cgroup reports thawed
+	if (cgroups->hibernated)
+		clock_gettime(CLOCK_MONOTONIC, &cgroups->resume_start);
+
+	c_cgroups_reclaim_abort(cgroups);
+
 	char *freezer_state_path = mem_printf("%s/cgroup.freeze", cgroups->path);
 	if (file_write(freezer_state_path, "0", -1) == -1) {
 		ERROR_ERRNO("Failed to write to freezer file %s", freezer_state_path);
@@ -472,6 +871,265 @@ c_cgroups_freeze(void *cgroupsp)
 	return 0;
 }
 
+static int
+c_cgroups_wakeup(void *cgroupsp)
+{
+	c_cgroups_t *cgroups = cgroupsp;
+	ASSERT(cgroups);
+
+	IF_FALSE_RETVAL(cgroups->hibernated, 0);
+
+	INFO("Waking up hibernated container %s", container_get_description(cgroups->container));
+	return c_cgroups_unfreeze(cgroups);
+}
+
+static void
+c_cgroups_idle_timer_cb(UNUSED event_timer_t *timer, void *data)
+{
+	c_cgroups_t *cgroups = data;
+	ASSERT(cgroups);
+
+	uint64_t cpu_usec = c_cgroups_stat_sum(cgroups, "cpu.stat", "usage_usec");
+	uint64_t io_bytes = c_cgroups_stat_sum(cgroups, "io.stat", "rbytes") +
+			    c_cgroups_stat_sum(cgroups, "io.stat", "wbytes");
+
+	bool idle = cpu_usec - cgroups->idle_cpu_usec <=
+			    (uint64_t)CGROUPS_IDLE_CHECK_INTERVAL * CGROUPS_IDLE_CPU_PERMILLE &&
+		    io_bytes - cgroups->idle_io_bytes <= CGROUPS_IDLE_IO_BYTES;
+	cgroups->idle_cpu_usec = cpu_usec;
+	cgroups->idle_io_bytes = io_bytes;
+
+	if (!idle || container_get_state(cgroups->container) != COMPARTMENT_STATE_RUNNING) {
+		cgroups->idle_time = 0;
+		return;
+	}
+
+	cgroups->idle_time += CGROUPS_IDLE_CHECK_INTERVAL / 1000;
+	TRACE("Container %s idle for %u s", container_get_description(cgroups->container),
+	      cgroups->idle_time);
+	IF_TRUE_RETURN(cgroups->idle_time < container_get_hibernate_timeout(cgroups->container));
+
+	INFO("Hibernating container %s after %u s without activity",
+	     container_get_description(cgroups->container), cgroups->idle_time);
+	cgroups->hibernated = true;
+	cgroups->resume_start.tv_sec = 0;
+	if (c_cgroups_freeze(cgroups) < 0) {
+		WARN("Could not hibernate container %s",
+		     container_get_description(cgroups->container));
+		cgroups->hibernated = false;
+	}
+	cgroups->idle_time = 0;
+}
+
+static void
+c_cgroups_cleanup_hibernation(c_cgroups_t *cgroups)
+{
+	if (cgroups->idle_timer) {
+		event_remove_timer(cgroups->idle_timer);
+		event_timer_free(cgroups->idle_timer);
+		cgroups->idle_timer = NULL;
+	}
+
+	c_cgroups_reclaim_abort(cgroups);
+
+	cgroups->hibernated = false;
+	cgroups->idle_time = 0;
+}
+
+static int
+c_cgroups_set_oom_group(const c_cgroups_t *cgroups)
+{
+	ASSERT(cgroups);
+
+	IF_FALSE_RETVAL(container_get_oom_config(cgroups->container)->group, 0);
+
+	char *oom_group_path = mem_printf("%s/memory.oom.group", cgroups->path);
+	int ret = file_printf(oom_group_path, "1");
+	if (ret < 0)
+		ERROR("Could not write to %s", oom_group_path);
+	else
+		INFO("Processes of container %s are killed together on OOM",
+		     container_get_description(cgroups->container));
+	mem_free0(oom_group_path);
+
+	return ret < 0 ? -1 : 0;
+}
+
+/*
+ * Limits the swap space and the zswap pool the container may use, so that its
+ * cold anonymous memory is compressed instead of OOM killed at the ram limit.
+ */
+static int
+c_cgroups_set_swap_limits(const c_cgroups_t *cgroups)
+{
+	ASSERT(cgroups);
+
+	const container_swap_limits_t *limits = container_get_swap_limits(cgroups->container);
+	IF_FALSE_RETVAL(limits->enabled, 0);
+
+	int ret = -1;
+	char *swap_max_path = mem_printf("%s/memory.swap.max", cgroups->path);
+	char *zswap_max_path = mem_printf("%s/memory.zswap.max", cgroups->path);
+
+	if (file_printf(swap_max_path, "%uM", limits->swap_max) < 0) {
+		ERROR("Could not write to %s (swap accounting not enabled?)", swap_max_path);
+		goto out;
+	}
+
+	// the zswap pool is optional, its limit only matters if swapping is allowed at all
+	if (file_exists(zswap_max_path)) {
+		if (file_printf(zswap_max_path, "%uM", limits->zswap_max) < 0) {
+			ERROR("Could not write to %s", zswap_max_path);
+			goto out;
+		}
+	} else if (limits->zswap_max > 0) {
+		WARN("zswap not supported by the kernel, ignoring zswap limit of container %s",
+		     container_get_description(cgroups->container));
+	}
+
+	INFO("Set swap limit of container %s to %u MBytes (zswap %u MBytes)%s",
+	     container_get_description(cgroups->container), limits->swap_max, limits->zswap_max,
+	     zram_is_active() ? "" : ", no zram swap device");
+	ret = 0;
+out:
+	mem_free0(swap_max_path);
+	mem_free0(zswap_max_path);
+	return ret;
+}
+
+static void
+c_cgroups_cleanup_oom_expand_timer(c_cgroups_t *cgroups)
+{
+	if (cgroups->oom_expand_timer) {
+		event_remove_timer(cgroups->oom_expand_timer);
+		event_timer_free(cgroups->oom_expand_timer);
+		cgroups->oom_expand_timer = NULL;
+	}
+}
+
+static void
+c_cgroups_oom_expand_timeout_cb(UNUSED event_timer_t *timer, void *data)
+{
+	c_cgroups_t *cgroups = data;
+	ASSERT(cgroups);
+
+	c_cgroups_cleanup_oom_expand_timer(cgroups);
+
+	INFO("Restoring RAM limit of container %s after OOM",
+	     container_get_description(cgroups->container));
+	if (c_cgroups_set_ram_limit(cgroups) < 0)
+		WARN("Could not restore RAM limit of container %s",
+		     container_get_description(cgroups->container));
+}
+
+/*
+ * Raises memory.max by the configured percentage of the ram limit. The raise
+ * is not cumulative, further OOM kills only extend the time until the
+ * configured limit is restored.
+ */
+static void
+c_cgroups_oom_expand(c_cgroups_t *cgroups)
+{
+	ASSERT(cgroups);
+
+	unsigned int ram_limit = container_get_ram_limit(cgroups->container);
+	unsigned int percent = container_get_oom_config(cgroups->container)->expand_percent;
+	if (ram_limit == 0 || percent == 0) {
+		WARN("No RAM limit to expand for container %s",
+		     container_get_description(cgroups->container));
+		return;
+	}
+
+	uint64_t expanded = (uint64_t)ram_limit * (100 + percent) / 100;
+	char *memory_max_path = mem_printf("%s/memory.max", cgroups->path);
+	int ret = file_printf(memory_max_path, "%" PRIu64 "M", expanded);
+	mem_free0(memory_max_path);
+	if (ret < 0) {
+		ERROR("Could not expand RAM limit of container %s",
+		      container_get_description(cgroups->container));
+		return;
+	}
+	INFO("Expanded RAM limit of container %s to %" PRIu64 " MBytes for %d s",
+	     container_get_description(cgroups->container), expanded,
+	     CGROUPS_OOM_EXPAND_TIMEOUT / 1000);
+
+	c_cgroups_cleanup_oom_expand_timer(cgroups);
+	cgroups->oom_expand_timer = event_timer_new(CGROUPS_OOM_EXPAND_TIMEOUT, 1,
+						    &c_cgroups_oom_expand_timeout_cb, cgroups);
+	event_add_timer(cgroups->oom_expand_timer);
+}
+
+/*
+ * Applies a changed RAM limit to a running container. A pending restore
+ * of an expanded limit after an OOM kill is superseded by the new limit.
+ */
+static int
+c_cgroups_update_ram_limit(void *cgroupsp)
+{
+	c_cgroups_t *cgroups = cgroupsp;
+	ASSERT(cgroups);
+
+	// the limit is applied on the next start
+	IF_FALSE_RETVAL_TRACE(file_is_dir(cgroups->path), 0);
+
+	c_cgroups_cleanup_oom_expand_timer(cgroups);
+
+	if (container_get_ram_limit(cgroups->container) == 0) {
+		char *memory_max_path = mem_printf("%s/memory.max", cgroups->path);
+		int ret = file_printf(memory_max_path, "max");
+		mem_free0(memory_max_path);
+		if (ret == -1) {
+			ERROR("Could not remove RAM limit of container %s",
+			      container_get_description(cgroups->container));
+			return -1;
+		}
+		INFO("Removed RAM limit of container %s",
+		     container_get_description(cgroups->container));
+		return 0;
+	}
+
+	return c_cgroups_set_ram_limit(cgroups);
+}
+
+static void
+c_cgroups_memory_events_cb(UNUSED const char *path, UNUSED uint32_t mask,
+			   UNUSED event_inotify_t *inotify, void *data)
+{
+	c_cgroups_t *cgroups = data;
+	ASSERT(cgroups);
+
+	// events of the child cgroup are included, it does not set memory_localevents
+	uint64_t oom_kills = c_cgroups_stat_sum(cgroups, "memory.events", "oom_kill");
+	IF_TRUE_RETURN(oom_kills <= cgroups->oom_kills);
+
+	unsigned int count = oom_kills - cgroups->oom_kills;
+	cgroups->oom_kills = oom_kills;
+	container_add_oom_kills(cgroups->container, count);
+
+	WARN("OOM killer killed %u process(es) in container %s (%u in total)", count,
+	     container_get_description(cgroups->container),
+	     container_get_oom_kills(cgroups->container));
+
+	char *count_str = mem_printf("%u", count);
+	audit_log_event(container_get_uuid(cgroups->container), FSA, CMLD, CONTAINER_MGMT,
+			"oom-kill", uuid_string(container_get_uuid(cgroups->container)), 2, "count",
+			count_str);
+	mem_free0(count_str);
+
+	switch (container_get_oom_config(cgroups->container)->policy) {
+	case CONTAINER_OOM_POLICY_RESTART:
+		INFO("Restarting container %s after OOM kill",
+		     container_get_description(cgroups->container));
+		container_reboot(cgroups->container);
+		break;
+	case CONTAINER_OOM_POLICY_EXPAND:
+		c_cgroups_oom_expand(cgroups);
+		break;
+	default:
+		break;
+	}
+}
+
 static int
 c_cgroups_start_post_clone(void *cgroupsp)
 {
@@ -497,6 +1155,20 @@ c_cgroups_start_post_clone(void *cgroupsp)
 		goto out;
 	}
 
+	/* let the container swap to zram or zswap instead of being OOM killed */
+	if (c_cgroups_set_swap_limits(cgroups) < 0) {
+		ERROR("Could not configure cgroup swap limits for container %s",
+		      container_get_description(cgroups->container));
+		goto out;
+	}
+
+	/* kill all processes of the container together on OOM if configured */
+	if (c_cgroups_set_oom_group(cgroups) < 0) {
+		ERROR("Could not configure cgroup OOM group for container %s",
+		      container_get_description(cgroups->container));
+		goto out;
+	}
+
 	/* initialize cpuset child subsystem to limit access to allowed cpus */
 	if (c_cgroups_set_cpus_allowed(cgroups) < 0) {
 		ERROR("Could not configure cgroup to restrict cpus of container %s",
@@ -504,6 +1176,20 @@ c_cgroups_start_post_clone(void *cgroupsp)
 		goto out;
 	}
 
+	/* initialize cpu subsystem to limit the cpu bandwidth of the container */
+	if (c_cgroups_set_cpu_limits(cgroups) < 0) {
+		ERROR("Could not configure cgroup CPU limits for container %s",
+		      container_get_description(cgroups->container));
+		goto out;
+	}
+
+	/* initialize io subsystem to limit the I/O on the devices of the container */
+	if (c_cgroups_set_io_limits(cgroups) < 0) {
+		ERROR("Could not configure cgroup I/O limits for container %s",
+		      container_get_description(cgroups->container));
+		goto out;
+	}
+
 	/* initialize events handling, e.g., for freezer subsystem */
 	char *events_path = mem_printf("%s/cgroup.events", cgroups->path);
 	cgroups->inotify_cgroup_events =
@@ -511,6 +1197,28 @@ c_cgroups_start_post_clone(void *cgroupsp)
 	event_add_inotify(cgroups->inotify_cgroup_events);
 	mem_free0(events_path);
 
+	/* watch for OOM kills inside the container */
+	cgroups->oom_kills = 0;
+	char *memory_events_path = mem_printf("%s/memory.events", cgroups->path);
+	cgroups->inotify_memory_events = event_inotify_new(memory_events_path, IN_MODIFY,
+							   &c_cgroups_memory_events_cb, cgroups);
+	event_add_inotify(cgroups->inotify_memory_events);
+	mem_free0(memory_events_path);
+
+	/* sample the activity of the container to hibernate it when idle */
+	if (container_get_hibernate_timeout(cgroups->container) > 0) {
+		DEBUG("Hibernating container %s after %u s without activity",
+		      container_get_description(cgroups->container),
+		      container_get_hibernate_timeout(cgroups->container));
+		cgroups->idle_time = 0;
+		cgroups->idle_cpu_usec = 0;
+		cgroups->idle_io_bytes = 0;
+		cgroups->idle_timer =
+			event_timer_new(CGROUPS_IDLE_CHECK_INTERVAL, EVENT_TIMER_REPEAT_FOREVER,
+					&c_cgroups_idle_timer_cb, cgroups);
+		event_add_timer(cgroups->idle_timer);
+	}
+
 	// activate controllers
 	if (c_cgroups_activate_controllers(cgroups->path)) {
 		ERROR("Could not activate cgroup controllers for intermediate cgroup!");
@@ -600,6 +1308,8 @@ c_cgroups_cleanup(void *cgroupsp, UNUSED bool is_rebooting)
 	c_cgroups_t *cgroups = cgroupsp;
 	ASSERT(cgroups);
 
+	c_cgroups_cleanup_hibernation(cgroups);
+
 	if (file_exists(cgroups->path) && file_is_dir(cgroups->path)) {
 		/* recursively remove all subfolders which the container may have created */
 		if (dir_foreach(cgroups->path, &c_cgroups_cleanup_subtree_remove_cb, NULL) < 0) {
@@ -619,6 +1329,12 @@ c_cgroups_cleanup(void *cgroupsp, UNUSED bool is_rebooting)
 		event_inotify_free(cgroups->inotify_cgroup_events);
 		cgroups->inotify_cgroup_events = NULL;
 	}
+	if (cgroups->inotify_memory_events) {
+		event_remove_inotify(cgroups->inotify_memory_events);
+		event_inotify_free(cgroups->inotify_memory_events);
+		cgroups->inotify_memory_events = NULL;
+	}
+	c_cgroups_cleanup_oom_expand_timer(cgroups);
 }
 
 static compartment_module_t c_cgroups_module = {
@@ -657,6 +1373,11 @@ c_cgroups_init(void)
 	container_register_add_pid_to_cgroups_handler(MOD_NAME, c_cgroups_add_pid);
 	container_register_freeze_handler(MOD_NAME, c_cgroups_freeze);
 	container_register_unfreeze_handler(MOD_NAME, c_cgroups_unfreeze);
+	container_register_wakeup_handler(MOD_NAME, c_cgroups_wakeup);
+	container_register_update_cpu_limits_handler(MOD_NAME, c_cgroups_update_cpu_limits);
+	container_register_update_io_limits_handler(MOD_NAME, c_cgroups_update_io_limits);
+	container_register_update_ram_limit_handler(MOD_NAME, c_cgroups_update_ram_limit);
+	container_register_get_swap_stats_handler(MOD_NAME, c_cgroups_get_swap_stats);
 
 	// register cleanup on exit handler
 	if (atexit(&c_cgroups_deinit))
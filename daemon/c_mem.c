@@ -0,0 +1,243 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+/*
+ * @file c_mem.c
+ *
+ * This module applies the per-container memory policies for kernel same-page
+ * merging (KSM) and transparent hugepages (THP), and reports their effect.
+ *
+ * Both policies are set by prctl() in the early child of the container, from
+ * which they are inherited by the init process of the container and all its
+ * descendants, also across execve. PR_SET_MEMORY_MERGE needs CAP_SYS_RESOURCE
+ * in the initial user namespace, thus it has to be set before the container
+ * enters its own user namespace. KSM merges the pages only if the global
+ * scanner is running, see ksm.c.
+ */
+
+#define _GNU_SOURCE
+
+#define MOD_NAME "c_mem"
+
+#include "common/macro.h"
+#include "common/mem.h"
+#include "common/file.h"
+#include "common/dir.h"
+#include "common/proc.h"
+#include "container.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+
+#ifndef PR_SET_MEMORY_MERGE
+#define PR_SET_MEMORY_MERGE 67
+#endif
+
+#ifndef PR_THP_DISABLE_EXCEPT_ADVISED
+#define PR_THP_DISABLE_EXCEPT_ADVISED (1 << 1)
+#endif
+
+#define C_MEM_CGROUP_FOLDER "/sys/fs/cgroup"
+
+typedef struct c_mem {
+	const container_t *container;
+} c_mem_t;
+
+static void *
+c_mem_new(compartment_t *compartment)
+{
+	ASSERT(compartment);
+	IF_NULL_RETVAL(compartment_get_extension_data(compartment), NULL);
+
+	c_mem_t *mem = mem_new0(c_mem_t, 1);
+	mem->container = compartment_get_extension_data(compartment);
+
+	return mem;
+}
+
+static void
+c_mem_free(void *memp)
+{
+	c_mem_t *mem = memp;
+	ASSERT(mem);
+	mem_free0(mem);
+}
+
+static int
+c_mem_start_child_early(void *memp)
+{
+	c_mem_t *mem = memp;
+	ASSERT(mem);
+
+	const container_mem_policy_t *policy = container_get_mem_policy(mem->container);
+
+	/* failing policies only cost memory, thus the container is started anyway */
+	if (policy->ksm_merge) {
+		if (prctl(PR_SET_MEMORY_MERGE, 1, 0, 0, 0) < 0)
+			WARN_ERRNO("Could not enable KSM merging for container %s",
+				   container_get_name(mem->container));
+		else
+			INFO("Enabled KSM merging for container %s",
+			     container_get_name(mem->container));
+	}
+
+	switch (policy->thp) {
+	case CONTAINER_THP_POLICY_NEVER:
+		if (prctl(PR_SET_THP_DISABLE, 1, 0, 0, 0) < 0)
+			WARN_ERRNO("Could not disable THP for container %s",
+				   container_get_name(mem->container));
+		break;
+	case CONTAINER_THP_POLICY_MADVISE:
+		// kernels before 6.18 do not support the flag and fail with EINVAL
+		if (prctl(PR_SET_THP_DISABLE, 1, PR_THP_DISABLE_EXCEPT_ADVISED, 0, 0) < 0)
+			WARN_ERRNO("Could not restrict THP to advised regions for container %s",
+				   container_get_name(mem->container));
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/*
+ * Returns the value of key in a file of 'key value' lines, e.g.,
+ * /proc/<pid>/ksm_stat or memory.stat. Missing files or keys count as 0.
+ */
+static int64_t
+c_mem_stat_get(const char *path, const char *key)
+{
+	char *stat = file_exists(path) ? file_read_new(path, 8192) : NULL;
+	IF_NULL_RETVAL(stat, 0);
+
+	int64_t value = 0;
+	char *saveptr = NULL;
+	for (char *tok = strtok_r(stat, " \n", &saveptr); tok;
+	     tok = strtok_r(NULL, " \n", &saveptr)) {
+		if (strcmp(tok, key))
+			continue;
+		char *v = strtok_r(NULL, " \n", &saveptr);
+		if (v)
+			value = strtoll(v, NULL, 10);
+		break;
+	}
+	mem_free0(stat);
+	return value;
+}
+
+static void
+c_mem_add_ksm_stats(pid_t pid, container_mem_stats_t *stats)
+{
+	char *path = mem_printf("/proc/%d/ksm_stat", pid);
+	stats->ksm_merging_pages += c_mem_stat_get(path, "ksm_merging_pages");
+	stats->ksm_profit += c_mem_stat_get(path, "ksm_process_profit");
+	mem_free0(path);
+}
+
+/*
+ * Adds the KSM statistics of all processes in the cgroup at path and its
+ * descendant cgroups.
+ */
+static int
+c_mem_add_cgroup_ksm_stats_cb(const char *path, const char *file, void *data)
+{
+	container_mem_stats_t *stats = data;
+	char *file_path = mem_printf("%s/%s", path, file);
+
+	if (!strcmp(file, "cgroup.procs")) {
+		char *procs = file_read_new(file_path, 64 * 1024);
+		char *saveptr = NULL;
+		for (char *tok = procs ? strtok_r(procs, "\n", &saveptr) : NULL; tok;
+		     tok = strtok_r(NULL, "\n", &saveptr))
+			c_mem_add_ksm_stats(atoi(tok), stats);
+		mem_free0(procs);
+	} else if (file_is_dir(file_path)) {
+		dir_foreach(file_path, c_mem_add_cgroup_ksm_stats_cb, stats);
+	}
+
+	mem_free0(file_path);
+	return 0;
+}
+
+static int
+c_mem_get_mem_stats(void *memp, container_mem_stats_t *stats)
+{
+	c_mem_t *mem = memp;
+	ASSERT(mem);
+	ASSERT(stats);
+
+	pid_t pid = container_get_pid(mem->container);
+	IF_TRUE_RETVAL(pid <= 0, -1);
+
+	mem_memset(stats, 0, sizeof(container_mem_stats_t));
+
+	/*
+	 * With unified cgroups all processes of the container are found below the
+	 * cgroup of its init process, otherwise only init itself is accounted.
+	 */
+	char *cgroup = proc_get_cgroups_path_new(pid);
+	if (cgroup && *cgroup) {
+		char *cgroup_path = mem_printf("%s%s", C_MEM_CGROUP_FOLDER, cgroup);
+		dir_foreach(cgroup_path, c_mem_add_cgroup_ksm_stats_cb, stats);
+
+		char *memory_stat = mem_printf("%s/memory.stat", cgroup_path);
+		stats->anon_thp = c_mem_stat_get(memory_stat, "anon_thp");
+		mem_free0(memory_stat);
+		mem_free0(cgroup_path);
+	} else {
+		c_mem_add_ksm_stats(pid, stats);
+	}
+	mem_free0(cgroup);
+
+	return 0;
+}
+
+static compartment_module_t c_mem_module = {
+	.name = MOD_NAME,
+	.compartment_new = c_mem_new,
+	.compartment_free = c_mem_free,
+	.compartment_destroy = NULL,
+	.start_post_clone_early = NULL,
+	.start_child_early = c_mem_start_child_early,
+	.start_pre_clone = NULL,
+	.start_post_clone = NULL,
+	.start_pre_exec = NULL,
+	.start_post_exec = NULL,
+	.start_child = NULL,
+	.start_pre_exec_child = NULL,
+	.stop = NULL,
+	.cleanup = NULL,
+	.join_ns = NULL,
+};
+
+static void INIT
+c_mem_init(void)
+{
+	// register this module in container.c
+	compartment_register_module(&c_mem_module);
+
+	// register relevant handlers implemented by this module
+	container_register_get_mem_stats_handler(MOD_NAME, c_mem_get_mem_stats);
+}
@@ -982,8 +982,9 @@ c_net_start_pre_clone(void *netp)
 	if (!container_has_netns(net->container))
 		return 0;
 
-	/* skip on reboots of c0 */
-	if ((cmld_containers_get_c0() == net->container) &&
+	/* skip on reboots of c0 and fast restarts */
+	if ((cmld_containers_get_c0() == net->container ||
+	     container_is_fast_restart(net->container)) &&
 	    (container_get_prev_state(net->container) == COMPARTMENT_STATE_REBOOTING))
 		return 0;
 
@@ -1046,8 +1047,9 @@ c_net_start_post_clone(void *netp)
 	if (!container_has_netns(net->container))
 		return 0;
 
-	/* skip on reboots of c0 */
-	if ((cmld_containers_get_c0() == net->container) &&
+	/* skip on reboots of c0 and fast restarts */
+	if ((cmld_containers_get_c0() == net->container ||
+	     container_is_fast_restart(net->container)) &&
 	    (container_get_prev_state(net->container) == COMPARTMENT_STATE_REBOOTING))
 		return 0;
 
@@ -1239,8 +1241,9 @@ c_net_start_child(void *netp)
 	if (!container_has_netns(net->container) || !(list_length(net->interface_list) > 0))
 		return 0;
 
-	/* skip on reboots of c0 */
-	if ((cmld_containers_get_c0() == net->container) &&
+	/* skip on reboots of c0 and fast restarts */
+	if ((cmld_containers_get_c0() == net->container ||
+	     container_is_fast_restart(net->container)) &&
 	    (container_get_prev_state(net->container) == COMPARTMENT_STATE_REBOOTING))
 		return 0;
 
@@ -1364,8 +1367,9 @@ c_net_cleanup(void *netp, bool is_rebooting)
 	if (!container_has_netns(net->container) || !(list_length(net->interface_list)))
 		return;
 
-	/* skip cleanup and keep netns open on reboots of c0 */
-	if (is_rebooting && (cmld_containers_get_c0() == net->container)) {
+	/* skip cleanup and keep netns open on reboots of c0 and fast restarts */
+	if (is_rebooting && (cmld_containers_get_c0() == net->container ||
+			     container_is_fast_restart(net->container))) {
 		net->fd_netns = open(net->ns_path, O_RDONLY);
 		if (net->fd_netns < 0)
 			WARN("Could not keep netns active for reboot!");
@@ -275,8 +275,9 @@ c_user_cleanup(void *usr, bool is_rebooting)
 	if (!container_has_userns(user->container))
 		return;
 
-	/* skip on reboots of c0 */
-	if (is_rebooting && (cmld_containers_get_c0() == user->container))
+	/* skip on reboots of c0 and fast restarts */
+	if (is_rebooting && (cmld_containers_get_c0() == user->container ||
+			     container_is_fast_restart(user->container)))
 		return;
 
 	/* release bound to filesystem after all modules performed their cleanup() hook. */
@@ -359,8 +360,9 @@ c_user_start_pre_clone(void *usr)
 	if (!container_has_userns(user->container))
 		return 0;
 
-	/* skip on reboots of c0 */
-	if ((cmld_containers_get_c0() == user->container) &&
+	/* skip on reboots of c0 and fast restarts */
+	if ((cmld_containers_get_c0() == user->container ||
+	     container_is_fast_restart(user->container)) &&
 	    (container_get_prev_state(user->container) == COMPARTMENT_STATE_REBOOTING))
 		return 0;
 
@@ -385,8 +387,9 @@ c_user_start_post_clone(void *usr)
 	if (!container_has_userns(user->container))
 		return 0;
 
-	/* skip on reboots of c0 */
-	if ((cmld_containers_get_c0() == user->container) &&
+	/* skip on reboots of c0 and fast restarts */
+	if ((cmld_containers_get_c0() == user->container ||
+	     container_is_fast_restart(user->container)) &&
 	    (container_get_prev_state(user->container) == COMPARTMENT_STATE_REBOOTING))
 		return 0;
 
@@ -51,6 +51,7 @@
 #include "common/str.h"
 #include "common/dm.h"
 #include "common/event.h"
+#include "common/devnode.h"
 
 #include "cmld.h"
 #include "hardware.h"
@@ -59,6 +60,7 @@
 #include "lxcfs.h"
 #include "audit.h"
 #include "verity.h"
+#include "thinpool.h"
 
 #include <unistd.h>
 #include <string.h>
@@ -67,10 +69,10 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/syscall.h>
-#include <sys/sysmacros.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <libgen.h>
+#include <limits.h>
 
 #define MAKE_EXT4FS "mkfs.ext4"
 #define BTRFSTUNE "btrfstune"
@@ -659,6 +661,85 @@ c_vol_setup_busybox_install(void)
 	return proc_fork_and_execvp(argv);
 }
 
+/*
+ * dm-verity devices are read-only and named after the digest of the image and
+ * the root hash of its hash tree instead of the container. Thus, all containers
+ * which mount the same image share one device, its loop devices and its page
+ * cache. The kernel's open count of the device serves as reference count.
+ */
+static char *
+c_vol_verity_label_new(const mount_entry_t *mntent)
+{
+	const char *digest = mount_entry_get_sha256(mntent);
+	const char *root_hash = mount_entry_get_verity_sha256(mntent);
+	ASSERT(root_hash);
+
+	// keep the dm uuid 'CRYPT-VERITY-<uuid>-<name>' within DM_UUID_LEN
+	if (digest)
+		return mem_printf("%.16s-%.64s", digest, root_hash);
+	return mem_printf("%.64s", root_hash);
+}
+
+/*
+ * Writable images of new volumes are allocated from the thin pool, if it is
+ * active. Volumes which already exist as image files are used as before.
+ */
+static bool
+c_vol_is_thin(c_vol_t *vol, const char *img, const mount_entry_t *mntent)
+{
+	switch (mount_entry_get_type(mntent)) {
+	case MOUNT_TYPE_EMPTY:
+	case MOUNT_TYPE_OVERLAY_RW:
+		break;
+	default:
+		return false;
+	}
+
+	char *id_file = mem_printf("%s/%s.thin", container_get_images_dir(vol->container),
+				   mount_entry_get_img(mntent));
+	bool thin = file_exists(id_file) || (thinpool_is_active() && !file_exists(img));
+	mem_free0(id_file);
+
+	return thin;
+}
+
+/*
+ * Activates the thin volume of an image, the volume is allocated in the pool
+ * if it does not exist yet.
+ */
+static char *
+c_vol_setup_thin_volume_new(c_vol_t *vol, const mount_entry_t *mntent, bool *created)
+{
+	char *id_file = mem_printf("%s/%s.thin", container_get_images_dir(vol->container),
+				   mount_entry_get_img(mntent));
+	char *label = mem_printf("%s-%s-thin", uuid_string(container_get_uuid(vol->container)),
+				 mount_entry_get_img(mntent));
+
+	// same size as for image files, see c_vol_create_image_empty()
+	uint64_t size = MAX(mount_entry_get_size(mntent), 10) * 1024 * 1024;
+
+	char *dev = thinpool_volume_setup_new(id_file, label, size, created);
+	if (!dev)
+		ERROR("Could not set up thin volume %s", label);
+
+	mem_free0(id_file);
+	mem_free0(label);
+	return dev;
+}
+
+static void
+c_vol_release_thin_volume(c_vol_t *vol, const mount_entry_t *mntent)
+{
+	if (mount_entry_get_type(mntent) != MOUNT_TYPE_EMPTY &&
+	    mount_entry_get_type(mntent) != MOUNT_TYPE_OVERLAY_RW)
+		return;
+
+	char *label = mem_printf("%s-%s-thin", uuid_string(container_get_uuid(vol->container)),
+				 mount_entry_get_img(mntent));
+	thinpool_volume_release(label);
+	mem_free0(label);
+}
+
 /**
  * Mount an image file. This function will take some time. So call it in a
  * thread or child process.
@@ -671,12 +752,13 @@ static int
 c_vol_mount_image(c_vol_t *vol, const char *root, const mount_entry_t *mntent)
 {
 	char *img, *dev, *img_meta, *dev_meta, *dir, *img_hash;
-	int fd = 0, fd_meta = 0;
+	int fd = 0, fd_meta = 0, verity_fd = -1;
 	bool new_image = false;
 	bool encrypted = mount_entry_is_encrypted(mntent);
 	bool overlay = false;
 	bool shiftids = false;
 	bool verity = mount_entry_get_verity_sha256(mntent) != NULL;
+	bool thin = false;
 	bool is_root = strcmp(mount_entry_get_dir(mntent), "/") == 0;
 	bool setup_mode = container_has_setup_mode(vol->container);
 
@@ -767,7 +849,9 @@ c_vol_mount_image(c_vol_t *vol, const char *root, const mount_entry_t *mntent)
 		}
 	}
 
-	if (c_vol_check_image(vol, img) < 0) {
+	thin = c_vol_is_thin(vol, img, mntent);
+
+	if (!thin && c_vol_check_image(vol, img) < 0) {
 		new_image = true;
 		if (c_vol_create_image(vol, img, mntent) < 0) {
 			goto error;
@@ -775,23 +859,34 @@ c_vol_mount_image(c_vol_t *vol, const char *root, const mount_entry_t *mntent)
 	}
 
 	if (verity) {
-		TRACE("Creating dm-verity device");
-		char *label = mem_printf("%s-%s", uuid_string(container_get_uuid(vol->container)),
-					 mount_entry_get_img(mntent));
+		char *label = c_vol_verity_label_new(mntent);
 		char *verity_dev = verity_get_device_path_new(label);
-		if (file_is_blk(verity_dev) || file_links_to_blk(verity_dev)) {
-			INFO("Using existing mapper device: %s", verity_dev);
+		/*
+		 * Hold the device open until it is mounted, so that it is not
+		 * released by the cleanup of another container meanwhile.
+		 */
+		verity_fd = open(verity_dev, O_RDONLY | O_CLOEXEC);
+		if (verity_fd >= 0) {
+			INFO("Sharing existing dm-verity device %s for image %s", verity_dev,
+			     mount_entry_get_img(mntent));
 		} else {
+			TRACE("Creating dm-verity device");
 			const char *root_hash = mount_entry_get_verity_sha256(mntent);
 			img_hash = c_vol_hash_image_path_new(vol, mntent);
 			IF_NULL_GOTO(img_hash, error);
 
 			if (verity_create_blk_dev(label, img, img_hash, root_hash)) {
-				ERROR("Failed to open %s from %s as dm-verity device with hash-dev %s and hash %s",
-				      label, img, img_hash, root_hash);
-				mem_free0(label);
-				mem_free0(verity_dev);
-				goto error;
+				// another container may have created it concurrently
+				verity_fd = open(verity_dev, O_RDONLY | O_CLOEXEC);
+				if (verity_fd < 0) {
+					ERROR("Failed to open %s from %s as dm-verity device with hash-dev %s and hash %s",
+					      label, img, img_hash, root_hash);
+					mem_free0(label);
+					mem_free0(verity_dev);
+					goto error;
+				}
+				INFO("Sharing concurrently created dm-verity device %s",
+				     verity_dev);
 			}
 
 			int control_fd = -1;
@@ -825,6 +920,15 @@ c_vol_mount_image(c_vol_t *vol, const char *root, const mount_entry_t *mntent)
 		}
 		DEBUG("Device %s is now available\n", dev);
 
+		if (verity_fd < 0 && (verity_fd = open(dev, O_RDONLY | O_CLOEXEC)) < 0) {
+			ERROR_ERRNO("Could not open dm-verity device %s", dev);
+			goto error;
+		}
+
+	} else if (thin) {
+		TRACE("Setting up thin volume");
+		dev = c_vol_setup_thin_volume_new(vol, mntent, &new_image);
+		IF_NULL_GOTO(dev, error);
 	} else {
 		TRACE("Creating loopdev");
 		dev = loopdev_create_new(&fd, img, 0, 0);
@@ -854,18 +958,34 @@ c_vol_mount_image(c_vol_t *vol, const char *root, const mount_entry_t *mntent)
 		} else {
 			DEBUG("Setting up cryptfs volume %s for %s", label, dev);
 
-			img_meta = c_vol_meta_image_path_new(vol, mntent);
-			dev_meta = loopdev_create_new(&fd_meta, img_meta, 0, 0);
-
-			IF_NULL_GOTO(dev_meta, error);
+			/*
+			 * Thin volumes are encrypted without dm-integrity, as the tags
+			 * of a new volume have to be initialized by writing it
+			 * completely, which would provision all of its blocks.
+			 */
+			char *init_state = NULL;
+			if (!thin) {
+				img_meta = c_vol_meta_image_path_new(vol, mntent);
+				dev_meta = loopdev_create_new(&fd_meta, img_meta, 0, 0);
+
+				IF_NULL_GOTO(dev_meta, error);
+
+				// an interrupted initialization is resumed, the volume has no fs yet
+				init_state = mem_printf("%s.init", img_meta);
+				if (file_exists(init_state))
+					new_image = true;
+			}
 
 			mem_free0(crypt);
-			crypt = cryptfs_setup_volume_new(
-				label, dev, container_get_key(vol->container), dev_meta);
+			crypt = cryptfs_setup_volume_new(label, dev,
+							 container_get_key(vol->container),
+							 dev_meta, init_state);
 
 			// release loopdev fd (crypt device should keep it open now)
-			close(fd_meta);
+			if (fd_meta)
+				close(fd_meta);
 			mem_free0(img_meta);
+			mem_free0(init_state);
 
 			if (!crypt) {
 				audit_log_event(container_get_uuid(vol->container), FSA, CMLD,
@@ -1040,6 +1160,8 @@ final_noshift:
 		close(fd_meta);
 	if (img_hash)
 		mem_free0(img_hash);
+	if (verity_fd >= 0)
+		close(verity_fd);
 	return 0;
 
 error:
@@ -1057,9 +1179,32 @@ error:
 		close(fd);
 	if (fd_meta)
 		close(fd_meta);
+	if (verity_fd >= 0)
+		close(verity_fd);
 	return -1;
 }
 
+/*
+ * Removes a shared dm-verity device as soon as no other container has it
+ * mounted anymore.
+ */
+static void
+c_vol_release_verity(int control_fd, const mount_entry_t *mntent)
+{
+	char *label = c_vol_verity_label_new(mntent);
+
+	int open_count = dm_get_open_count(control_fd, label);
+	if (open_count > 0) {
+		DEBUG("Cleanup: dm-verity device %s still used (open count %d)", label, open_count);
+	} else if (open_count == 0) {
+		DEBUG("Cleanup: releasing dm-verity device %s of image %s", label,
+		      mount_entry_get_img(mntent));
+		if (verity_delete_blk_dev(label) < 0)
+			DEBUG("Could not delete dm-verity dev %s", label);
+	}
+	mem_free0(label);
+}
+
 static int
 c_vol_cleanup_dm(c_vol_t *vol)
 {
@@ -1075,6 +1220,11 @@ c_vol_cleanup_dm(c_vol_t *vol)
 
 		mntent = mount_get_entry(vol->mnt, i);
 
+		if (mount_entry_get_verity_sha256(mntent)) {
+			c_vol_release_verity(fd, mntent);
+			continue;
+		}
+
 		label = mem_printf("%s-%s", uuid_string(container_get_uuid(vol->container)),
 				   mount_entry_get_img(mntent));
 
@@ -1083,6 +1233,8 @@ c_vol_cleanup_dm(c_vol_t *vol)
 		char *type = dm_get_target_type_new(fd, label);
 		if (type == NULL) {
 			WARN("Failed to get target type of %s\n", label);
+			c_vol_release_thin_volume(vol, mntent);
+			mem_free0(label);
 			continue;
 		}
 
@@ -1097,6 +1249,9 @@ c_vol_cleanup_dm(c_vol_t *vol)
 		}
 		mem_free0(label);
 		mem_free0(type);
+
+		// thin volumes are the lowest layer below dm-crypt
+		c_vol_release_thin_volume(vol, mntent);
 	}
 	dm_close_control(fd);
 
@@ -1247,40 +1402,30 @@ err:
 	return -1;
 }
 
+/*
+ * Snapshot of the host's /dev shared by all containers. It is only retaken
+ * if device nodes have been added or removed on the host in the meantime.
+ */
+static devnode_snapshot_t *c_vol_dev_snapshot = NULL;
+
+static const devnode_snapshot_t *
+c_vol_get_dev_snapshot(void)
+{
+	if (c_vol_dev_snapshot && !devnode_snapshot_is_stale(c_vol_dev_snapshot))
+		return c_vol_dev_snapshot;
+
+	devnode_snapshot_free(c_vol_dev_snapshot);
+	c_vol_dev_snapshot = devnode_snapshot_new("/dev");
+	return c_vol_dev_snapshot;
+}
+
 static bool
-c_vol_populate_dev_filter_cb(const char *dev_node, void *data)
+c_vol_populate_dev_filter_cb(char type, int major, int minor, void *data)
 {
 	c_vol_t *vol = data;
 	ASSERT(vol);
 
-	// filter out mount points, to avoid copying private stuff, e.g, /dev/pts
-	if (file_is_mountpoint(dev_node)) {
-		TRACE("filter mountpoint '%s'", dev_node);
-		return false;
-	}
-
-	struct stat s;
-	IF_TRUE_RETVAL(stat(dev_node, &s), true);
-
-	char type;
-	switch (s.st_mode & S_IFMT) {
-	case S_IFBLK:
-		type = 'b';
-		break;
-	case S_IFCHR:
-		type = 'c';
-		break;
-	default:
-		return true;
-	}
-
-	if (!container_is_device_allowed(vol->container, type, major(s.st_rdev),
-					 minor(s.st_rdev))) {
-		TRACE("filter device %s (%c %d:%d)", dev_node, type, major(s.st_rdev),
-		      minor(s.st_rdev));
-		return false;
-	}
-	return true;
+	return container_is_device_allowed(vol->container, type, major, minor);
 }
 
 static int
@@ -1530,6 +1675,123 @@ c_vol_get_rootdir(void *volp)
 	return vol->root;
 }
 
+typedef struct c_vol_devices_ctx {
+	const c_vol_t *vol;
+	list_t *devices;
+} c_vol_devices_ctx_t;
+
+static void
+c_vol_devices_add(c_vol_devices_ctx_t *ctx, const char *blk)
+{
+	char *dev_path = mem_printf("/sys/block/%s/dev", blk);
+	char *dev = file_read_new(dev_path, 32);
+	mem_free0(dev_path);
+	IF_NULL_RETURN(dev);
+
+	dev[strcspn(dev, "\n")] = '\0';
+	for (list_t *l = ctx->devices; l; l = l->next) {
+		if (!strcmp(l->data, dev)) {
+			mem_free0(dev);
+			return;
+		}
+	}
+	TRACE("Device %s (%s) backs a volume of container %s", blk, dev,
+	      container_get_description(ctx->vol->container));
+	ctx->devices = list_append(ctx->devices, dev);
+}
+
+static int
+c_vol_devices_slaves_cb(UNUSED const char *path, const char *name, void *data)
+{
+	c_vol_devices_add(data, name);
+	return 0;
+}
+
+static bool
+c_vol_devices_is_in_dir(const char *file, const char *dir)
+{
+	IF_NULL_RETVAL(dir, false);
+
+	size_t len = strlen(dir);
+	return !strncmp(file, dir, len) && file[len] == '/';
+}
+
+static bool
+c_vol_devices_is_shared_verity(const c_vol_t *vol, const char *dm_name)
+{
+	bool ret = false;
+	for (size_t i = 0; !ret && i < mount_get_count(vol->mnt); i++) {
+		const mount_entry_t *mntent = mount_get_entry(vol->mnt, i);
+		if (!mount_entry_get_verity_sha256(mntent))
+			continue;
+
+		char *label = c_vol_verity_label_new(mntent);
+		ret = !strcmp(label, dm_name);
+		mem_free0(label);
+	}
+	return ret;
+}
+
+static int
+c_vol_devices_cb(UNUSED const char *path, const char *name, void *data)
+{
+	c_vol_devices_ctx_t *ctx = data;
+
+	if (!strncmp(name, "dm-", 3)) {
+		// device mapper devices of a container are labeled '<uuid>-<img>'
+		char *dm_name_path = mem_printf("/sys/block/%s/dm/name", name);
+		char *dm_name = file_read_new(dm_name_path, 256);
+		const char *uuid = uuid_string(container_get_uuid(ctx->vol->container));
+		if (dm_name)
+			dm_name[strcspn(dm_name, "\n")] = '\0';
+		if (dm_name &&
+		    ((!strncmp(dm_name, uuid, strlen(uuid)) && dm_name[strlen(uuid)] == '-') ||
+		     c_vol_devices_is_shared_verity(ctx->vol, dm_name))) {
+			c_vol_devices_add(ctx, name);
+			// the loop devices of the data and hash images
+			char *slaves = mem_printf("/sys/block/%s/slaves", name);
+			dir_foreach(slaves, &c_vol_devices_slaves_cb, ctx);
+			mem_free0(slaves);
+		}
+		mem_free0(dm_name_path);
+		if (dm_name)
+			mem_free0(dm_name);
+	} else if (!strncmp(name, "loop", 4)) {
+		char *backing_path = mem_printf("/sys/block/%s/loop/backing_file", name);
+		char *backing =
+			file_exists(backing_path) ? file_read_new(backing_path, PATH_MAX) : NULL;
+		if (backing && (c_vol_devices_is_in_dir(
+					backing, container_get_images_dir(ctx->vol->container)) ||
+				(ctx->vol->os &&
+				 c_vol_devices_is_in_dir(backing, guestos_get_dir(ctx->vol->os)))))
+			c_vol_devices_add(ctx, name);
+		mem_free0(backing_path);
+		if (backing)
+			mem_free0(backing);
+	}
+	return 0;
+}
+
+/*
+ * The volumes are set up by the child of the container, thus the devices
+ * backing them are looked up in sysfs. Loop devices of images of the guestos
+ * may be shared with other containers. This does not matter for per cgroup
+ * limits, as these only apply to the I/O of this container on the device.
+ */
+static list_t *
+c_vol_get_volume_devices_new(void *volp)
+{
+	c_vol_t *vol = volp;
+	ASSERT(vol);
+
+	c_vol_devices_ctx_t ctx = { .vol = vol, .devices = NULL };
+	if (dir_foreach("/sys/block", &c_vol_devices_cb, &ctx) < 0)
+		WARN("Could not list block devices of container %s",
+		     container_get_description(vol->container));
+
+	return ctx.devices;
+}
+
 static int
 c_vol_start_child_early(void *volp)
 {
@@ -1585,6 +1847,13 @@ c_vol_start_post_clone(void *volp)
 	c_vol_t *vol = volp;
 	ASSERT(vol);
 
+	/*
+	 * on fast restarts the dm-verity devices were kept and already checked
+	 * in the background during the initial start
+	 */
+	if (container_is_fast_restart(vol->container))
+		return 0;
+
 	// check image integrity lazy in background for verity enabled images
 	if (c_vol_verify_mount_entries_bg(vol))
 		return 0;
@@ -1619,7 +1888,9 @@ c_vol_start_pre_exec(void *volp)
 
 	INFO("Populating container's /dev.");
 	char *dev_mnt = mem_printf("%s/%s", vol->root, "dev");
-	if (dir_copy_folder("/dev", dev_mnt, &c_vol_populate_dev_filter_cb, vol) < 0) {
+	const devnode_snapshot_t *dev_snapshot = c_vol_get_dev_snapshot();
+	if (!dev_snapshot || devnode_snapshot_populate(dev_snapshot, dev_mnt,
+						       &c_vol_populate_dev_filter_cb, vol) < 0) {
 		ERROR_ERRNO("Could not populate /dev!");
 		mem_free0(dev_mnt);
 		return -COMPARTMENT_ERROR_VOL;
@@ -1981,4 +2252,5 @@ c_vol_init(void)
 	container_register_get_rootdir_handler(MOD_NAME, c_vol_get_rootdir);
 	container_register_get_mnt_handler(MOD_NAME, c_vol_get_mnt);
 	container_register_is_encrypted_handler(MOD_NAME, c_vol_is_encrypted);
+	container_register_get_volume_devices_new_handler(MOD_NAME, c_vol_get_volume_devices_new);
 }
@@ -0,0 +1,189 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+#include "cgroups_cpu.h"
+
+#include "common/macro.h"
+#include "common/mem.h"
+#include "common/file.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+
+#define CGROUPS_CPU_PERIOD_MIN 1000
+#define CGROUPS_CPU_PERIOD_MAX 1000000
+#define CGROUPS_CPU_QUOTA_MIN 1000
+#define CGROUPS_CPU_WEIGHT_MAX 10000
+#define CGROUPS_CPU_SHARES_MIN 2
+#define CGROUPS_CPU_SHARES_MAX 262144
+
+bool
+cgroups_cpu_limits_valid(const container_cpu_limits_t *limits)
+{
+	ASSERT(limits);
+
+	if (limits->period_us && (limits->period_us < CGROUPS_CPU_PERIOD_MIN ||
+				  limits->period_us > CGROUPS_CPU_PERIOD_MAX)) {
+		WARN("CPU period %u us out of range [%d, %d]", limits->period_us,
+		     CGROUPS_CPU_PERIOD_MIN, CGROUPS_CPU_PERIOD_MAX);
+		return false;
+	}
+	if (limits->quota_us && limits->quota_us < CGROUPS_CPU_QUOTA_MIN) {
+		WARN("CPU quota %u us below minimum of %d us", limits->quota_us,
+		     CGROUPS_CPU_QUOTA_MIN);
+		return false;
+	}
+	if (limits->weight > CGROUPS_CPU_WEIGHT_MAX) {
+		WARN("CPU weight %u out of range [1, %d]", limits->weight, CGROUPS_CPU_WEIGHT_MAX);
+		return false;
+	}
+	if (limits->burst_us && limits->burst_us > limits->quota_us) {
+		WARN("CPU burst %u us exceeds quota of %u us", limits->burst_us, limits->quota_us);
+		return false;
+	}
+	return true;
+}
+
+bool
+cgroups_cpu_limits_is_set(const container_cpu_limits_t *limits)
+{
+	ASSERT(limits);
+	return limits->quota_us || limits->period_us || limits->weight || limits->burst_us;
+}
+
+static int
+cgroups_cpu_write(const char *path, const char *file, const char *fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+
+static int
+cgroups_cpu_write(const char *path, const char *file, const char *fmt, ...)
+{
+	char *file_path = mem_printf("%s/%s", path, file);
+	va_list ap;
+	va_start(ap, fmt);
+	char *value = mem_vprintf(fmt, ap);
+	va_end(ap);
+
+	int ret = file_write(file_path, value, -1) < 0 ? -1 : 0;
+	if (ret)
+		ERROR("Could not write '%s' to %s", value, file_path);
+	else
+		TRACE("Wrote '%s' to %s", value, file_path);
+
+	mem_free0(value);
+	mem_free0(file_path);
+	return ret;
+}
+
+/*
+ * The kernel rejects a quota below the current burst, thus the burst is
+ * reset before and set after the quota.
+ */
+static int
+cgroups_cpu_reset_burst(const char *path, const char *file)
+{
+	char *burst_path = mem_printf("%s/%s", path, file);
+	bool exists = file_exists(burst_path);
+	mem_free0(burst_path);
+
+	return exists ? cgroups_cpu_write(path, file, "0") : 0;
+}
+
+int
+cgroups_cpu_set_limits(const char *path, const container_cpu_limits_t *limits)
+{
+	ASSERT(path);
+	ASSERT(limits);
+
+	IF_FALSE_RETVAL(cgroups_cpu_limits_valid(limits), -1);
+
+	char *cpu_max_path = mem_printf("%s/cpu.max", path);
+	bool exists = file_exists(cpu_max_path);
+	mem_free0(cpu_max_path);
+	if (!exists) {
+		ERROR("%s/cpu.max file not found (cgroups cpu controller not enabled?)", path);
+		return -1;
+	}
+
+	uint32_t period = limits->period_us ? limits->period_us : CGROUPS_CPU_PERIOD_DEFAULT;
+	uint32_t weight = limits->weight ? limits->weight : CGROUPS_CPU_WEIGHT_DEFAULT;
+
+	IF_TRUE_RETVAL(cgroups_cpu_reset_burst(path, "cpu.max.burst"), -1);
+
+	char *quota = limits->quota_us ? mem_printf("%u", limits->quota_us) : mem_strdup("max");
+	int ret = cgroups_cpu_write(path, "cpu.max", "%s %u", quota, period);
+	mem_free0(quota);
+	IF_TRUE_RETVAL(ret, -1);
+
+	IF_TRUE_RETVAL(cgroups_cpu_write(path, "cpu.weight", "%u", weight), -1);
+
+	IF_TRUE_RETVAL(limits->burst_us &&
+			       cgroups_cpu_write(path, "cpu.max.burst", "%u", limits->burst_us),
+		       -1);
+
+	return 0;
+}
+
+int
+cgroups_cpu_set_limits_legacy(const char *path, const container_cpu_limits_t *limits)
+{
+	ASSERT(path);
+	ASSERT(limits);
+
+	IF_FALSE_RETVAL(cgroups_cpu_limits_valid(limits), -1);
+
+	char *period_path = mem_printf("%s/cpu.cfs_period_us", path);
+	bool exists = file_exists(period_path);
+	mem_free0(period_path);
+	if (!exists) {
+		ERROR("%s/cpu.cfs_period_us file not found (cgroups cpu subsystem not mounted or no CFS bandwidth control?)",
+		      path);
+		return -1;
+	}
+
+	uint32_t period = limits->period_us ? limits->period_us : CGROUPS_CPU_PERIOD_DEFAULT;
+
+	// map the weight to shares the same way as systemd does
+	uint64_t shares = CGROUPS_CPU_SHARES_DEFAULT;
+	if (limits->weight) {
+		shares = (uint64_t)limits->weight * CGROUPS_CPU_SHARES_DEFAULT /
+			 CGROUPS_CPU_WEIGHT_DEFAULT;
+		shares = MAX(CGROUPS_CPU_SHARES_MIN, MIN(shares, CGROUPS_CPU_SHARES_MAX));
+	}
+
+	IF_TRUE_RETVAL(cgroups_cpu_reset_burst(path, "cpu.cfs_burst_us"), -1);
+	IF_TRUE_RETVAL(cgroups_cpu_write(path, "cpu.cfs_period_us", "%u", period), -1);
+
+	// a quota of -1 removes the limit
+	IF_TRUE_RETVAL(cgroups_cpu_write(path, "cpu.cfs_quota_us", "%" PRId64,
+					 limits->quota_us ? (int64_t)limits->quota_us : -1),
+		       -1);
+
+	IF_TRUE_RETVAL(cgroups_cpu_write(path, "cpu.shares", "%" PRIu64, shares), -1);
+
+	IF_TRUE_RETVAL(limits->burst_us &&
+			       cgroups_cpu_write(path, "cpu.cfs_burst_us", "%u", limits->burst_us),
+		       -1);
+
+	return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+/**
+ * @file cgroups_cpu.h
+ *
+ * Configures the cpu bandwidth controller of a cgroup with the CPU limits of a
+ * container. Used by the cgroups modules for the unified (v2) and the legacy
+ * (v1) hierarchy at container start and for runtime updates.
+ */
+
+#ifndef CGROUPS_CPU_H
+#define CGROUPS_CPU_H
+
+#include "container.h"
+
+#include <stdbool.h>
+
+// defaults of the kernel for limits given as 0
+#define CGROUPS_CPU_PERIOD_DEFAULT 100000
+#define CGROUPS_CPU_WEIGHT_DEFAULT 100
+#define CGROUPS_CPU_SHARES_DEFAULT 1024
+
+/**
+ * Checks the limits against the ranges accepted by the kernel.
+ */
+bool
+cgroups_cpu_limits_valid(const container_cpu_limits_t *limits);
+
+/**
+ * Returns true if any limit differs from the defaults.
+ */
+bool
+cgroups_cpu_limits_is_set(const container_cpu_limits_t *limits);
+
+/**
+ * Writes the limits to cpu.max, cpu.weight and cpu.max.burst of the cgroup
+ * at path. Limits which are 0 reset the corresponding file to the default.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int
+cgroups_cpu_set_limits(const char *path, const container_cpu_limits_t *limits);
+
+/**
+ * Writes the limits to cpu.cfs_period_us, cpu.cfs_quota_us, cpu.shares and
+ * cpu.cfs_burst_us of the cgroup at path in the cpu hierarchy of cgroups v1.
+ * The weight is mapped to the range of cpu.shares.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int
+cgroups_cpu_set_limits_legacy(const char *path, const container_cpu_limits_t *limits);
+
+#endif /* CGROUPS_CPU_H */
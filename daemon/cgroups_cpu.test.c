@@ -0,0 +1,150 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+/**
+ * @file cgroups_cpu.test.c
+ *
+ * Unit Test for cgroups_cpu.c. Applies CPU limits to a fake cgroupfs, i.e.,
+ * a temporary directory with the interface files of the cpu controller, and
+ * checks the values written for the unified and the legacy hierarchy.
+ */
+#include "cgroups_cpu.c"
+
+#include "common/dir.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void
+test_create(const char *dir, const char *file, const char *value)
+{
+	char *path = mem_printf("%s/%s", dir, file);
+	ASSERT(file_write(path, value, -1) >= 0);
+	mem_free0(path);
+}
+
+static void
+test_expect(const char *dir, const char *file, const char *value)
+{
+	char *path = mem_printf("%s/%s", dir, file);
+	char *content = file_read_new(path, 64);
+	ASSERT(content);
+	if (strcmp(content, value))
+		FATAL("%s contains '%s' instead of '%s'", path, content, value);
+	mem_free0(content);
+	mem_free0(path);
+}
+
+static void
+test_cgroups_v2(const char *dir)
+{
+	DEBUG("Set limits on the unified hierarchy");
+
+	test_create(dir, "cpu.max", "max 100000");
+	test_create(dir, "cpu.weight", "100");
+	test_create(dir, "cpu.max.burst", "0");
+
+	container_cpu_limits_t limits = {
+		.quota_us = 50000, .period_us = 20000, .weight = 200, .burst_us = 10000
+	};
+	ASSERT(cgroups_cpu_set_limits(dir, &limits) == 0);
+	test_expect(dir, "cpu.max", "50000 20000");
+	test_expect(dir, "cpu.weight", "200");
+	test_expect(dir, "cpu.max.burst", "10000");
+
+	DEBUG("Reject invalid limits and keep the current ones");
+	container_cpu_limits_t invalid = { .quota_us = 5000, .burst_us = 10000 };
+	ASSERT(cgroups_cpu_set_limits(dir, &invalid) == -1);
+	invalid = (container_cpu_limits_t){ .period_us = 500 };
+	ASSERT(cgroups_cpu_set_limits(dir, &invalid) == -1);
+	invalid = (container_cpu_limits_t){ .weight = 10001 };
+	ASSERT(cgroups_cpu_set_limits(dir, &invalid) == -1);
+	test_expect(dir, "cpu.max", "50000 20000");
+
+	DEBUG("Reset limits to the defaults");
+	container_cpu_limits_t none = { 0 };
+	ASSERT(!cgroups_cpu_limits_is_set(&none));
+	ASSERT(cgroups_cpu_set_limits(dir, &none) == 0);
+	test_expect(dir, "cpu.max", "max 100000");
+	test_expect(dir, "cpu.weight", "100");
+	test_expect(dir, "cpu.max.burst", "0");
+
+	DEBUG("Fail without cpu controller");
+	char *cpu_max = mem_printf("%s/cpu.max", dir);
+	unlink(cpu_max);
+	mem_free0(cpu_max);
+	ASSERT(cgroups_cpu_set_limits(dir, &limits) == -1);
+}
+
+static void
+test_cgroups_v1(const char *dir)
+{
+	DEBUG("Set limits on the legacy hierarchy");
+
+	test_create(dir, "cpu.cfs_period_us", "100000");
+	test_create(dir, "cpu.cfs_quota_us", "-1");
+	test_create(dir, "cpu.shares", "1024");
+
+	// kernels without cfs burst support lack cpu.cfs_burst_us
+	container_cpu_limits_t limits = { .quota_us = 20000, .period_us = 50000, .weight = 50 };
+	ASSERT(cgroups_cpu_set_limits_legacy(dir, &limits) == 0);
+	test_expect(dir, "cpu.cfs_period_us", "50000");
+	test_expect(dir, "cpu.cfs_quota_us", "20000");
+	test_expect(dir, "cpu.shares", "512");
+
+	test_create(dir, "cpu.cfs_burst_us", "0");
+	limits = (container_cpu_limits_t){ .quota_us = 400000, .weight = 10000, .burst_us = 1000 };
+	ASSERT(cgroups_cpu_set_limits_legacy(dir, &limits) == 0);
+	test_expect(dir, "cpu.cfs_period_us", "100000");
+	test_expect(dir, "cpu.cfs_quota_us", "400000");
+	test_expect(dir, "cpu.shares", "102400");
+	test_expect(dir, "cpu.cfs_burst_us", "1000");
+
+	container_cpu_limits_t none = { 0 };
+	ASSERT(cgroups_cpu_set_limits_legacy(dir, &none) == 0);
+	test_expect(dir, "cpu.cfs_quota_us", "-1");
+	test_expect(dir, "cpu.shares", "1024");
+	test_expect(dir, "cpu.cfs_burst_us", "0");
+}
+
+int
+main(void)
+{
+	logf_register(&logf_test_write, stdout);
+	DEBUG("Unit Test: cgroups_cpu.test.c");
+
+	char v2[] = "/tmp/cgroups_cpu_test_XXXXXX";
+	char v1[] = "/tmp/cgroups_cpu_test_XXXXXX";
+	ASSERT(mkdtemp(v2));
+	ASSERT(mkdtemp(v1));
+
+	test_cgroups_v2(v2);
+	test_cgroups_v1(v1);
+
+	ASSERT(dir_delete_folder("/tmp", v2 + strlen("/tmp/")) == 0);
+	ASSERT(dir_delete_folder("/tmp", v1 + strlen("/tmp/")) == 0);
+
+	DEBUG("Unit Test: cgroups_cpu.test.c passed");
+	return 0;
+}
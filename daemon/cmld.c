@@ -51,6 +51,9 @@
 #include "scd.h"
 #include "tss.h"
 #include "ksm.h"
+#include "thinpool.h"
+#include "zram.h"
+#include "cgroups_cpu.h"
 #include "hotplug.h"
 #include "time.h"
 #include "lxcfs.h"
@@ -62,15 +65,18 @@
 #include "oci.h"
 
 #include <inttypes.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <dirent.h>
 #include <errno.h>
+#include <sys/inotify.h>
 #include <sys/prctl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <time.h>
 
 // clang-format off
 #define CMLD_CONTROL_SOCKET SOCK_PATH(control)
@@ -78,6 +84,14 @@
 
 #define CMLD_SUSPEND_TIMEOUT 5000
 
+/*
+ * Global deadline for stopping all containers on device shutdown, afterwards
+ * remaining containers are killed. If they are still not down after the grace
+ * period, the device is shut down anyway.
+ */
+#define CMLD_SHUTDOWN_DEADLINE 60000
+#define CMLD_SHUTDOWN_KILL_GRACE 5000
+
 // files and directories in cmld's home path /data/cml
 #define CMLD_PATH_DEVICE_CONF "device.conf"
 #define CMLD_PATH_USERS_DIR "users"
@@ -93,6 +107,9 @@
 
 #define CMLD_STORAGE_FREE_THRESHOLD 0.2 // 20% reserved space
 
+// upper bound for reading a container config to compute its digest
+#define CMLD_CONFIG_MAX_SIZE (1024 * 1024)
+
 /*
  * dummy key used for unecnrypted c0 and for reboots where the real key
  * is already in kernel
@@ -106,6 +123,18 @@ static const char *cmld_wrapped_keys_path = NULL;
 
 static list_t *cmld_containers_list = NULL; // usually first element is c0
 
+/*
+ * Digests of the config files the container objects were loaded from. Only
+ * configs which changed on storage since then are reloaded.
+ */
+typedef struct cmld_config_digest {
+	char *file;
+	uint64_t digest;
+} cmld_config_digest_t;
+
+static list_t *cmld_config_digest_list = NULL;
+static event_inotify_t *cmld_containers_inotify = NULL;
+
 static control_t *cmld_control_gui = NULL;
 static control_t *cmld_control_cml = NULL;
 
@@ -125,6 +154,33 @@ static bool cmld_device_provisioned = false;
 
 static enum command cmld_device_reboot = POWER_OFF;
 
+/*
+ * Containers are stopped in waves on device shutdown. All containers of a wave
+ * are stopped concurrently, the next wave is started as soon as the previous
+ * one is down. c0 is stopped last as the other containers depend on it.
+ */
+typedef enum cmld_shutdown_wave {
+	CMLD_SHUTDOWN_WAVE_CONTAINERS = 0,
+	CMLD_SHUTDOWN_WAVE_C0,
+	CMLD_SHUTDOWN_WAVE_COUNT
+} cmld_shutdown_wave_t;
+
+typedef struct cmld_shutdown_record {
+	unsigned int ms; // time since start of the shutdown
+	char *msg;
+} cmld_shutdown_record_t;
+
+static struct {
+	bool active;
+	unsigned int wave;
+	unsigned int remaining; // containers which are not yet down
+	unsigned int wave_remaining[CMLD_SHUTDOWN_WAVE_COUNT];
+	struct timespec start;
+	event_timer_t *timer; // deadline, afterwards grace period after kill
+	bool killed;
+	list_t *timeline; // cmld_shutdown_record_t
+} cmld_shutdown = { 0 };
+
 #ifdef OCI
 // clang-format off
 #define CMLD_OCI_CONTROL_SOCKET SOCK_PATH(oci-control)
@@ -520,11 +576,20 @@ cmld_container_new(const char *store_path, const uuid_t *existing_uuid, const ui
 
 	bool usb_pin_entry = container_config_get_usb_pin_entry(conf);
 
+	unsigned int hibernate_timeout = container_config_get_hibernate_idle_timeout(conf);
+
+	container_resources_t resources;
+	container_config_get_io_limits(conf, &resources.io_limits);
+	container_config_get_cpu_limits(conf, &resources.cpu_limits);
+	container_config_get_oom_config(conf, &resources.oom_config);
+	container_config_get_mem_policy(conf, &resources.mem_policy);
+	container_config_get_swap_limits(conf, &resources.swap_limits);
+
 	c = container_new(uuid, name, type, ns_usr, ns_net, os, config_filename, images_dir,
 			  ram_limit, cpus_allowed, color, allow_autostart, allow_system_time,
 			  dns_server, pnet_cfg_list, allowed_devices, assigned_devices,
 			  vnet_cfg_list, usbdev_list, init, init_argv, init_env, init_env_len,
-			  fifo_list, ttype, usb_pin_entry);
+			  fifo_list, ttype, usb_pin_entry, hibernate_timeout, &resources);
 	if (c) {
 		// overwrite image sizes of mount table
 		container_config_fill_mount(conf, container_get_mnt(c));
@@ -576,6 +641,145 @@ cmld_containers_add(container_t *container)
 	cmld_containers_list = list_append(cmld_containers_list, container);
 }
 
+static bool
+cmld_config_digest_calc(const char *file, uint64_t *digest)
+{
+	char *buf = file_read_new(file, CMLD_CONFIG_MAX_SIZE);
+	IF_NULL_RETVAL_TRACE(buf, false);
+
+	// FNV-1a is sufficient to detect changes, configs are verified on load anyway
+	uint64_t h = 14695981039346656037ULL;
+	for (const unsigned char *p = (const unsigned char *)buf; *p; ++p) {
+		h ^= *p;
+		h *= 1099511628211ULL;
+	}
+	mem_free0(buf);
+
+	*digest = h;
+	return true;
+}
+
+static cmld_config_digest_t *
+cmld_config_digest_get(const char *file)
+{
+	for (list_t *l = cmld_config_digest_list; l; l = l->next) {
+		cmld_config_digest_t *d = l->data;
+		if (!strcmp(d->file, file))
+			return d;
+	}
+	return NULL;
+}
+
+static void
+cmld_config_digest_remove(const char *file)
+{
+	cmld_config_digest_t *d = cmld_config_digest_get(file);
+	IF_NULL_RETURN(d);
+
+	cmld_config_digest_list = list_remove(cmld_config_digest_list, d);
+	mem_free0(d->file);
+	mem_free0(d);
+}
+
+/*
+ * Remembers the digest of the config a container object was loaded from.
+ */
+static void
+cmld_config_digest_update(const container_t *container)
+{
+	const char *file = container_get_config_filename(container);
+	IF_NULL_RETURN(file);
+
+	uint64_t digest;
+	if (!cmld_config_digest_calc(file, &digest)) {
+		cmld_config_digest_remove(file);
+		return;
+	}
+
+	cmld_config_digest_t *d = cmld_config_digest_get(file);
+	if (!d) {
+		d = mem_new0(cmld_config_digest_t, 1);
+		d->file = mem_strdup(file);
+		cmld_config_digest_list = list_append(cmld_config_digest_list, d);
+	}
+	d->digest = digest;
+}
+
+/*
+ * Returns true if the config file differs from the one the corresponding
+ * container object was loaded from, or if it has not been loaded yet.
+ */
+static bool
+cmld_config_digest_changed(const char *file)
+{
+	uint64_t digest;
+	IF_FALSE_RETVAL(cmld_config_digest_calc(file, &digest), true);
+
+	cmld_config_digest_t *d = cmld_config_digest_get(file);
+	return !d || d->digest != digest;
+}
+
+static void
+cmld_config_digest_free_all(void)
+{
+	for (list_t *l = cmld_config_digest_list; l; l = l->next) {
+		cmld_config_digest_t *d = l->data;
+		mem_free0(d->file);
+		mem_free0(d);
+	}
+	list_delete(cmld_config_digest_list);
+	cmld_config_digest_list = NULL;
+}
+
+/*
+ * Applies the resource limits of the updated config which can be changed at
+ * runtime, i.e., the RAM, CPU and I/O limits, to a created container.
+ * On failure the previous limits are kept.
+ */
+static void
+cmld_container_update_limits(container_t *container)
+{
+	container_config_t *conf = container_config_new(container_get_config_filename(container),
+							NULL, 0, NULL, 0, NULL, 0);
+	IF_NULL_RETURN_WARN(conf);
+
+	unsigned int ram_limit = container_config_get_ram_limit(conf);
+	unsigned int prev_ram_limit = container_get_ram_limit(container);
+	if (ram_limit != prev_ram_limit) {
+		container_set_ram_limit(container, ram_limit);
+		if (container_update_ram_limit(container) < 0) {
+			WARN("Could not update RAM limit of container %s, restoring previous limit",
+			     container_get_name(container));
+			container_set_ram_limit(container, prev_ram_limit);
+			container_update_ram_limit(container);
+		}
+	}
+
+	container_cpu_limits_t cpu_limits;
+	container_config_get_cpu_limits(conf, &cpu_limits);
+	if (memcmp(&cpu_limits, container_get_cpu_limits(container), sizeof(cpu_limits)))
+		cmld_container_set_cpu_limits(container, &cpu_limits);
+
+	container_io_limits_t io_limits;
+	container_config_get_io_limits(conf, &io_limits);
+	container_io_limits_t prev_io_limits = *container_get_io_limits(container);
+	if (io_limits.weight != prev_io_limits.weight ||
+	    io_limits.read_bps != prev_io_limits.read_bps ||
+	    io_limits.write_bps != prev_io_limits.write_bps ||
+	    io_limits.read_iops != prev_io_limits.read_iops ||
+	    io_limits.write_iops != prev_io_limits.write_iops) {
+		container_set_io_limits(container, &io_limits);
+		if (container_update_io_limits(container) < 0) {
+			WARN("Could not update I/O limits of container %s, restoring previous limits",
+			     container_get_name(container));
+			container_set_io_limits(container, &prev_io_limits);
+			container_update_io_limits(container);
+		}
+	}
+
+	container_config_free(conf);
+}
+
 int
 cmld_reload_container(const uuid_t *uuid, const char *path)
 {
@@ -591,8 +795,12 @@ cmld_reload_container(const uuid_t *uuid, const char *path)
 	if (c) {
 		compartment_state_t state = container_get_state(c);
 		if (state != COMPARTMENT_STATE_STOPPED) {
-			DEBUG("Refusing to reload already created and not stopped container %s.",
+			DEBUG("Refusing to reload already created and not stopped container %s,"
+			      " applying resource limits and deferring the remaining config"
+			      " update until it is stopped.",
 			      container_get_name(c));
+			cmld_container_update_limits(c);
+			container_set_sync_state(c, false);
 			goto cleanup;
 		}
 		DEBUG("Removing outdated created container %s for config update",
@@ -611,6 +819,7 @@ cmld_reload_container(const uuid_t *uuid, const char *path)
 	cmld_containers_list = list_append(cmld_containers_list, c);
 
 	container_set_sync_state(c, true);
+	cmld_config_digest_update(c);
 	ret = 0;
 
 cleanup:
@@ -649,6 +858,15 @@ cmld_load_containers_cb(const char *path, const char *name, UNUSED void *data)
 		goto cleanup;
 	}
 
+	char *file = mem_printf("%s/%s", path, name);
+	bool changed = cmld_config_digest_changed(file);
+	mem_free0(file);
+	if (!changed && cmld_container_get_by_uuid(uuid)) {
+		TRACE("Config %s is unchanged, skipping reload", name);
+		res = 1;
+		goto cleanup;
+	}
+
 	if (cmld_reload_container((const uuid_t *)uuid, path) != 0) {
 		WARN("Failed to reload container");
 		goto cleanup;
@@ -679,6 +897,58 @@ cmld_load_containers(const char *path)
 	return 0;
 }
 
+/*
+ * Reloads single configs of known containers as soon as they are written to
+ * the containers directory. Containers which are not stopped only apply their
+ * resource limits and pick up the remaining update on their next stop, see
+ * cmld_container_config_sync_cb(). Configs of new containers are only loaded
+ * by an explicit RELOAD_CONTAINERS command.
+ */
+static void
+cmld_containers_inotify_cb(const char *path, uint32_t mask, UNUSED event_inotify_t *inotify,
+			   UNUSED void *data)
+{
+	IF_NULL_RETURN(path);
+
+	const char *name = strrchr(path, '/');
+	IF_NULL_RETURN(name);
+	name++;
+
+	size_t len = strlen(name);
+	if (len < 5 || strcmp(name + len - 5, ".conf"))
+		return;
+
+	if (mask & (IN_DELETE | IN_MOVED_FROM)) {
+		DEBUG("Config %s was removed from storage", path);
+		cmld_config_digest_remove(path);
+		return;
+	}
+
+	if (!cmld_config_digest_changed(path)) {
+		TRACE("Config %s is unchanged", path);
+		return;
+	}
+
+	char *prefix = mem_strndup(name, len - 5);
+	uuid_t *uuid = uuid_new(prefix);
+	mem_free0(prefix);
+	IF_NULL_RETURN_WARN(uuid);
+
+	container_t *container = cmld_container_get_by_uuid(uuid);
+	uuid_free(uuid);
+	if (!container) {
+		INFO("Config %s of unknown container written to storage, not loaded until"
+		     " containers are reloaded",
+		     path);
+		return;
+	}
+
+	INFO("Config %s changed on storage, reloading", path);
+	audit_log_event(container_get_uuid(container), SSA, CMLD, CONTAINER_MGMT, "config-reload",
+			uuid_string(container_get_uuid(container)), 0);
+	cmld_load_containers_cb(cmld_container_path, name, NULL);
+}
+
 int
 cmld_reload_containers(void)
 {
@@ -691,8 +961,9 @@ cmld_reload_containers(void)
 }
 
 /**
- * Checks if a filename in the /data/logs directory contains
- * "1970" and renames the found files with a new timestamp
+ * Checks if a filename in the /data/logs directory contains a timestamp
+ * of "1970" and renames the found files with a new timestamp. Segments of
+ * the log stores are numbered and thus not affected.
  */
 void
 cmld_rename_logfiles()
@@ -703,7 +974,7 @@ cmld_rename_logfiles()
 	directory = opendir(LOGFILE_DIR);
 	if (directory != NULL) {
 		while ((entry = readdir(directory)) != NULL) {
-			if (strstr(entry->d_name, "197") != NULL) {
+			if (strstr(entry->d_name, ".1970-") != NULL) {
 				DEBUG("Found file to rename %s", entry->d_name);
 				char *filename_with_old_timestamp = mem_strdup(entry->d_name);
 				char *filename = strtok(filename_with_old_timestamp, ".");
@@ -1120,41 +1391,206 @@ cmld_handle_device_shutdown(void)
 	exit(0);
 }
 
+static bool
+cmld_container_is_down(const container_t *container)
+{
+	compartment_state_t state = container_get_state(container);
+	return state == COMPARTMENT_STATE_STOPPED || state == COMPARTMENT_STATE_ZOMBIE;
+}
+
+static cmld_shutdown_wave_t
+cmld_shutdown_get_wave(const container_t *container)
+{
+	return container == cmld_containers_get_c0() ? CMLD_SHUTDOWN_WAVE_C0 :
+						       CMLD_SHUTDOWN_WAVE_CONTAINERS;
+}
+
+static void
+cmld_shutdown_record(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/*
+ * Adds an entry to the shutdown timeline, which is logged when the
+ * device goes down in order to tune the shutdown of containers.
+ */
+static void
+cmld_shutdown_record(const char *fmt, ...)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	cmld_shutdown_record_t *record = mem_new0(cmld_shutdown_record_t, 1);
+	record->ms = (now.tv_sec - cmld_shutdown.start.tv_sec) * 1000 +
+		     (now.tv_nsec - cmld_shutdown.start.tv_nsec) / 1000000;
+
+	va_list ap;
+	va_start(ap, fmt);
+	record->msg = mem_vprintf(fmt, ap);
+	va_end(ap);
+
+	DEBUG("Device shutdown: %s", record->msg);
+	cmld_shutdown.timeline = list_append(cmld_shutdown.timeline, record);
+}
+
+static void
+cmld_shutdown_finish(void)
+{
+	cmld_shutdown_record("all containers down");
+
+	INFO("Device shutdown timeline:");
+	for (list_t *l = cmld_shutdown.timeline; l; l = l->next) {
+		cmld_shutdown_record_t *record = l->data;
+		INFO("  %6u ms: %s", record->ms, record->msg);
+		mem_free0(record->msg);
+		mem_free0(record);
+	}
+	list_delete(cmld_shutdown.timeline);
+	cmld_shutdown.timeline = NULL;
+
+	if (cmld_shutdown.timer) {
+		event_remove_timer(cmld_shutdown.timer);
+		event_timer_free(cmld_shutdown.timer);
+		cmld_shutdown.timer = NULL;
+	}
+	cmld_shutdown.active = false;
+
+	IF_TRUE_RETURN_TRACE(cmld_hostedmode);
+
+	/* all containers are down, so shut down */
+	DEBUG("Device shutdown: last container down; shutdown now");
+
+	container_t *c0 = cmld_containers_get_c0();
+	if (c0)
+		audit_log_event(container_get_uuid(c0), SSA, CMLD, CONTAINER_MGMT, "shutdown",
+				uuid_string(container_get_uuid(c0)), 0);
+
+	cmld_handle_device_shutdown();
+}
+
+/*
+ * Stops all containers of the next wave which still has running containers.
+ */
+static void
+cmld_shutdown_next_wave(void)
+{
+	while (cmld_shutdown.wave < CMLD_SHUTDOWN_WAVE_COUNT &&
+	       cmld_shutdown.wave_remaining[cmld_shutdown.wave] == 0)
+		cmld_shutdown.wave++;
+
+	if (cmld_shutdown.remaining == 0) {
+		cmld_shutdown_finish();
+		return;
+	}
+
+	cmld_shutdown_record("starting wave %u with %u containers", cmld_shutdown.wave,
+			     cmld_shutdown.wave_remaining[cmld_shutdown.wave]);
+
+	for (list_t *l = cmld_containers_list; l; l = l->next) {
+		container_t *container = l->data;
+		if (cmld_container_is_down(container) ||
+		    cmld_shutdown_get_wave(container) != cmld_shutdown.wave ||
+		    container_get_state(container) == COMPARTMENT_STATE_SHUTTING_DOWN)
+			continue;
+
+		DEBUG("Device shutdown: stopping container %s",
+		      container_get_description(container));
+		cmld_container_stop(container);
+	}
+}
+
 /**
- * This observer callback is attached to each container in order to check for other running containers.
- * It ensures that as soon as the last container went down, the device is shut down.
+ * This observer callback is attached to each container which is not down on device shutdown.
+ * It ensures that the next wave is stopped when the current one is down and that the device
+ * is shut down as soon as the last container went down.
  */
 static void
 cmld_shutdown_container_cb(container_t *container, container_callback_t *cb, UNUSED void *data)
 {
-	compartment_state_t state = container_get_state(container);
+	IF_FALSE_RETURN(cmld_container_is_down(container));
+
+	container_unregister_observer(container, cb);
 
-	if (!(state == COMPARTMENT_STATE_STOPPED || state == COMPARTMENT_STATE_ZOMBIE)) {
+	cmld_shutdown_wave_t wave = cmld_shutdown_get_wave(container);
+	cmld_shutdown.wave_remaining[wave]--;
+	cmld_shutdown.remaining--;
+
+	cmld_shutdown_record("container %s down (wave %u, %u remaining)",
+			     container_get_description(container), wave, cmld_shutdown.remaining);
+
+	// containers killed after the deadline are collected without starting further waves
+	if (cmld_shutdown.killed) {
+		if (cmld_shutdown.remaining == 0)
+			cmld_shutdown_finish();
 		return;
 	}
 
-	container_unregister_observer(container, cb);
+	if (cmld_shutdown.wave_remaining[cmld_shutdown.wave] == 0)
+		cmld_shutdown_next_wave();
+}
 
-	DEBUG("Device shutdown: container %s went down, checking others before shutdown",
-	      container_get_description(container));
+static void
+cmld_shutdown_timeout_cb(event_timer_t *timer, UNUSED void *data)
+{
+	event_timer_free(timer);
+	cmld_shutdown.timer = NULL;
+
+	if (cmld_shutdown.killed) {
+		cmld_shutdown_record("%u containers not down after kill, giving up",
+				     cmld_shutdown.remaining);
+		cmld_shutdown_finish();
+		return;
+	}
+
+	cmld_shutdown_record("deadline reached, killing %u remaining containers",
+			     cmld_shutdown.remaining);
+	cmld_shutdown.killed = true;
 
 	for (list_t *l = cmld_containers_list; l; l = l->next) {
-		if (!(container_get_state(l->data) == COMPARTMENT_STATE_STOPPED ||
-		      container_get_state(l->data) == COMPARTMENT_STATE_ZOMBIE)) {
-			DEBUG("Device shutdown: There are still running containers, can't shut down");
-			return;
-		}
+		container_t *container = l->data;
+		if (cmld_container_is_down(container))
+			continue;
+		WARN("Device shutdown: killing container %s", container_get_description(container));
+		container_kill(container);
 	}
 
-	IF_TRUE_RETURN_TRACE(cmld_hostedmode);
+	cmld_shutdown.timer =
+		event_timer_new(CMLD_SHUTDOWN_KILL_GRACE, 1, cmld_shutdown_timeout_cb, NULL);
+	event_add_timer(cmld_shutdown.timer);
+}
 
-	/* all containers are down, so shut down */
-	DEBUG("Device shutdown: last container down; shutdown now");
+/*
+ * Starts the orchestrated shutdown of all containers, the device is shut down
+ * (or rebooted) as soon as all containers are down.
+ */
+static void
+cmld_shutdown_start(void)
+{
+	IF_TRUE_RETURN_TRACE(cmld_shutdown.active);
 
-	audit_log_event(container_get_uuid(container), SSA, CMLD, CONTAINER_MGMT, "shutdown",
-			uuid_string(container_get_uuid(container)), 0);
+	memset(&cmld_shutdown, 0, sizeof(cmld_shutdown));
+	cmld_shutdown.active = true;
+	clock_gettime(CLOCK_MONOTONIC, &cmld_shutdown.start);
 
-	cmld_handle_device_shutdown();
+	for (list_t *l = cmld_containers_list; l; l = l->next) {
+		container_t *container = l->data;
+		if (cmld_container_is_down(container))
+			continue;
+
+		if (!container_register_observer(container, &cmld_shutdown_container_cb, NULL)) {
+			ERROR("Could not register observer shutdown callback for %s",
+			      container_get_description(container));
+			continue;
+		}
+		cmld_shutdown.wave_remaining[cmld_shutdown_get_wave(container)]++;
+		cmld_shutdown.remaining++;
+	}
+
+	cmld_shutdown_record("shutdown of %u containers started", cmld_shutdown.remaining);
+
+	cmld_shutdown.timer =
+		event_timer_new(CMLD_SHUTDOWN_DEADLINE, 1, cmld_shutdown_timeout_cb, NULL);
+	event_add_timer(cmld_shutdown.timer);
+
+	cmld_shutdown_next_wave();
 }
 
 /**
@@ -1165,7 +1601,6 @@ static void
 cmld_shutdown_c0_cb(container_t *c0, container_callback_t *cb, UNUSED void *data)
 {
 	compartment_state_t c0_state = container_get_state(c0);
-	bool shutdown_now = true;
 
 	/* only execute the callback if c0 goes down */
 	if (!(c0_state == COMPARTMENT_STATE_SHUTTING_DOWN ||
@@ -1175,42 +1610,11 @@ cmld_shutdown_c0_cb(container_t *c0, container_callback_t *cb, UNUSED void *data
 	audit_log_event(container_get_uuid(c0), SSA, CMLD, CONTAINER_MGMT, "shutdown-c0-start",
 			uuid_string(container_get_uuid(c0)), 0);
 
-	DEBUG("Device shutdown: c0 went down or shutting down, checking others before shutdown");
-
-	/* iterate over containers and check their status:
-	 * - every container, which is not yet down gets an observer to inspect global containers' statuses
-	 * - every container, which is furthermore not yet shutting down, is sent the shutdown command, which
-	 *   needs not to be done for c0, as this observer callback call tells that it is either already
-	 *   dead or in shutting down state
-	 */
-	for (list_t *l = cmld_containers_list; l; l = l->next) {
-		if (!(container_get_state(l->data) == COMPARTMENT_STATE_STOPPED ||
-		      container_get_state(l->data) == COMPARTMENT_STATE_ZOMBIE)) {
-			shutdown_now = false;
-			if (!container_register_observer(l->data, &cmld_shutdown_container_cb,
-							 NULL)) {
-				ERROR("Could not register observer shutdown callback for %s",
-				      container_get_description(l->data));
-			}
-			if (l->data != c0 &&
-			    !(container_get_state(l->data) == COMPARTMENT_STATE_SHUTTING_DOWN)) {
-				DEBUG("Device shutdown: There is another running container:%s. Shut it down first",
-				      container_get_description(l->data));
-				cmld_container_stop(l->data);
-			}
-		}
-	}
+	DEBUG("Device shutdown: c0 went down or shutting down, stopping others before shutdown");
 
 	container_unregister_observer(c0, cb);
 
-	if (shutdown_now && !cmld_hostedmode) {
-		/* all containers are down, so shut down */
-		DEBUG("Device shutdown: all containers already down; shutdown now");
-		audit_log_event(container_get_uuid(c0), SSA, CMLD, CONTAINER_MGMT, "shutdown",
-				uuid_string(container_get_uuid(c0)), 0);
-
-		cmld_handle_device_shutdown();
-	}
+	cmld_shutdown_start();
 }
 
 /*
@@ -1259,7 +1663,7 @@ cmld_init_c0(const char *path, const char *c0os)
 		container_new(c0_uuid, "c0", CONTAINER_TYPE_CONTAINER, false, c0_ns_net, c0_os,
 			      NULL, c0_images_folder, c0_ram_limit, NULL, 0xffffff00, false, false,
 			      cmld_get_device_host_dns(), NULL, NULL, NULL, NULL, NULL, init,
-			      init_argv, NULL, 0, NULL, CONTAINER_TOKEN_TYPE_NONE, false);
+			      init_argv, NULL, 0, NULL, CONTAINER_TOKEN_TYPE_NONE, false, 0, NULL);
 
 	/* store c0 as first element of the cmld_containers_list */
 	cmld_containers_list = list_prepend(cmld_containers_list, new_c0);
@@ -1464,6 +1868,27 @@ cmld_init(const char *path)
 	else
 		INFO("ksm initialized.");
 
+	const char *thin_pool_data = device_config_get_thin_pool_data(device_config);
+	if (thin_pool_data) {
+		if (thinpool_init(cmld_path, thin_pool_data,
+				  device_config_get_thin_pool_size(device_config),
+				  device_config_get_thin_pool_warn_percent(device_config)) < 0) {
+			WARN("Could not init thin pool, using image files for container volumes");
+		} else {
+			INFO("thin pool initialized.");
+			if (atexit(&thinpool_cleanup))
+				WARN("Could not register on exit cleanup method 'thinpool_cleanup()'");
+		}
+	}
+
+	uint64_t zram_size = device_config_get_zram_size(device_config);
+	if (zram_size > 0) {
+		if (zram_init(zram_size, device_config_get_zram_algorithm(device_config)) < 0)
+			WARN("Could not init zram swap device");
+		else
+			INFO("zram initialized.");
+	}
+
 	if (device_config_get_tpm_enabled(device_config)) {
 		if (tss_init(!cmld_is_hostedmode_active()) < 0) {
 			FATAL("Failed to initialize TSS / TPM 2.0 and tpm2d");
@@ -1535,6 +1960,16 @@ cmld_init(const char *path)
 	if (cmld_load_containers(containers_path) < 0)
 		FATAL("Could not load containers");
 
+	cmld_containers_inotify =
+		event_inotify_new(containers_path,
+				  IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM,
+				  &cmld_containers_inotify_cb, NULL);
+	if (event_add_inotify(cmld_containers_inotify) < 0) {
+		WARN("Could not watch %s, configs are only reloaded on request", containers_path);
+		event_inotify_free(cmld_containers_inotify);
+		cmld_containers_inotify = NULL;
+	}
+
 	if (cmld_start_c0(cmld_containers_get_c0()) < 0)
 		FATAL("Could not start c0");
 
@@ -1565,6 +2000,7 @@ cmld_container_create_from_config(const uint8_t *config, size_t config_len, uint
 		cmld_container_new(path, NULL, config, config_len, sig, sig_len, cert, cert_len);
 	if (c) {
 		cmld_containers_list = list_append(cmld_containers_list, c);
+		cmld_config_digest_update(c);
 		audit_log_event(container_get_uuid(c), SSA, CMLD, CONTAINER_MGMT,
 				"container-create", uuid_string(container_get_uuid(c)), 0);
 		INFO("Created container %s (uuid=%s).", container_get_name(c),
@@ -1673,6 +2109,112 @@ cmld_container_stop(container_t *container)
 	return 0;
 }
 
+/*
+ * Reloads and starts a container which was stopped for a restart with a changed
+ * config. Reloading frees the container object, thus this is not done by the
+ * observer itself but deferred to the next iteration of the event loop.
+ */
+static void
+cmld_container_restart_start_cb(event_timer_t *timer, void *data)
+{
+	uuid_t *uuid = data;
+	ASSERT(uuid);
+
+	event_timer_free(timer);
+
+	if (cmld_reload_container(uuid, cmld_get_containers_dir()) != 0) {
+		ERROR("Failed to reload container on restart");
+		goto out;
+	}
+	container_t *container = cmld_container_get_by_uuid(uuid);
+	IF_NULL_GOTO_WARN(container, out);
+
+	if (container_get_token_type(container) != CONTAINER_TOKEN_TYPE_NONE) {
+		INFO("Container %s was stopped with its new config, start it with its token",
+		     container_get_description(container));
+		goto out;
+	}
+
+	INFO("Starting container %s with its new config", container_get_description(container));
+	if (cmld_container_start(container))
+		WARN("Restart of '%s' failed", container_get_description(container));
+out:
+	uuid_free(uuid);
+}
+
+/*
+ * This callback handles the stop of a container which is restarted with a
+ * full stop/start cycle.
+ */
+static void
+cmld_container_restart_cb(container_t *container, container_callback_t *cb, void *data)
+{
+	uuid_t *uuid = data;
+	ASSERT(uuid);
+
+	IF_FALSE_RETURN(container_get_state(container) == COMPARTMENT_STATE_STOPPED);
+	container_unregister_observer(container, cb);
+
+	event_timer_t *timer = event_timer_new(0, 1, cmld_container_restart_start_cb, uuid);
+	event_add_timer(timer);
+}
+
+int
+cmld_container_restart(container_t *container)
+{
+	ASSERT(container);
+
+	if (container == cmld_containers_get_c0()) {
+		WARN("Restart of c0 is not supported");
+		return -1;
+	}
+
+	if (container_get_state(container) != COMPARTMENT_STATE_RUNNING) {
+		WARN("Container %s is not running, not restarting",
+		     container_get_description(container));
+		return -1;
+	}
+
+	/*
+	 * A changed config may affect the namespaces and volumes, which are kept
+	 * by a fast restart, thus do a full stop/start cycle in this case.
+	 */
+	if (!container_get_sync_state(container)) {
+		INFO("Config of container %s changed, restarting with full stop/start cycle",
+		     container_get_description(container));
+
+		uuid_t *uuid = uuid_new(uuid_string(container_get_uuid(container)));
+		container_callback_t *cb =
+			container_register_observer(container, cmld_container_restart_cb, uuid);
+		if (!cb) {
+			WARN("Could not register container restart observer callback for %s",
+			     container_get_description(container));
+			uuid_free(uuid);
+			return -1;
+		}
+
+		// the container is reloaded by the restart observer, not by config_sync_cb
+		container_set_sync_state(container, true);
+		if (cmld_container_stop(container)) {
+			container_unregister_observer(container, cb);
+			container_set_sync_state(container, false);
+			uuid_free(uuid);
+			return -1;
+		}
+		return 0;
+	}
+
+	// cmld_reboot_container_cb() starts the container again on REBOOTING
+	if (container_restart(container) < 0) {
+		DEBUG("Some modules could not be stopped successfully, killing container.");
+		container_kill(container);
+	}
+
+	audit_log_event(container_get_uuid(container), SSA, CMLD, CONTAINER_MGMT,
+			"container-restart", uuid_string(container_get_uuid(container)), 0);
+	return 0;
+}
+
 int
 cmld_container_freeze(container_t *container)
 {
@@ -1697,6 +2239,27 @@ cmld_container_allow_audio(container_t *container)
 	return container_allow_audio(container);
 }
 
+int
+cmld_container_set_cpu_limits(container_t *container, const container_cpu_limits_t *cpu_limits)
+{
+	ASSERT(container);
+	ASSERT(cpu_limits);
+
+	IF_FALSE_RETVAL(cgroups_cpu_limits_valid(cpu_limits), -1);
+
+	container_cpu_limits_t prev = *container_get_cpu_limits(container);
+	container_set_cpu_limits(container, cpu_limits);
+	if (container_update_cpu_limits(container) < 0) {
+		WARN("Could not update CPU limits of container %s, restoring previous limits",
+		     container_get_name(container));
+		container_set_cpu_limits(container, &prev);
+		container_update_cpu_limits(container);
+		return -1;
+	}
+
+	return 0;
+}
+
 int
 cmld_container_deny_audio(container_t *container)
 {
@@ -1792,6 +2355,13 @@ cmld_netif_phys_add_by_name(const char *if_name)
 void
 cmld_cleanup(void)
 {
+	if (cmld_containers_inotify) {
+		event_remove_inotify(cmld_containers_inotify);
+		event_inotify_free(cmld_containers_inotify);
+		cmld_containers_inotify = NULL;
+	}
+	cmld_config_digest_free_all();
+
 	for (list_t *l = cmld_containers_list; l; l = l->next) {
 		container_t *container = l->data;
 		container_free(container);
@@ -1828,11 +2398,10 @@ cmld_reboot_device(void)
 	// handle the actual reboot, after all containers are down
 	cmld_device_reboot = REBOOT;
 
-	container_t *c0 = cmld_containers_get_c0();
-	IF_NULL_RETURN(c0);
+	IF_NULL_RETURN(cmld_containers_get_c0());
 
-	// stopping c0 also stops other containers.
-	cmld_container_stop(c0);
+	// c0 is stopped in the last wave, after the containers depending on it
+	cmld_shutdown_start();
 }
 
 static bool
@@ -77,7 +77,8 @@ void
 cmld_containers_add(container_t *container);
 
 /**
- * Reloads all containers from storage path.
+ * Reloads all containers from storage path. Containers whose config did not
+ * change on storage since it was loaded are skipped.
  *
  * @return 0 on success, -1 on error
  */
@@ -157,6 +158,17 @@ cmld_container_ctrl_with_input_abort(void);
 int
 cmld_container_stop(container_t *container);
 
+/**
+ * Restarts a running container. If its config is in sync, the namespaces and
+ * volumes of the container are kept and only the init process and the per-boot
+ * setup of the modules are run again. Otherwise, the container is stopped,
+ * reloaded with its new config and started again, if it needs no token to start.
+ *
+ * @return 0 if the restart was emitted, -1 otherwise.
+ */
+int
+cmld_container_restart(container_t *container);
+
 int
 cmld_container_freeze(container_t *container);
 
@@ -166,6 +178,15 @@ cmld_container_unfreeze(container_t *container);
 int
 cmld_container_allow_audio(container_t *container);
 
+/**
+ * Changes the CPU limits of a container at runtime. The limits are kept until
+ * the container's config is reloaded.
+ *
+ * @return 0 on success, -1 if the limits are invalid or could not be applied.
+ */
+int
+cmld_container_set_cpu_limits(container_t *container, const container_cpu_limits_t *cpu_limits);
+
 int
 cmld_container_deny_audio(container_t *container);
 
@@ -125,6 +125,7 @@ struct compartment {
 	list_t *helper_child_list; // helper childs spawned during startup
 	bool is_doing_cleanup;
 	bool is_rebooting;
+	bool is_fast_restart; // keep namespaces and volumes in the next REBOOTING state
 };
 
 struct compartment_callback {
@@ -661,6 +662,8 @@ compartment_sigchld_handle_helpers(compartment_t *compartment, event_signal_t *s
 		compartment_state_t state = compartment->is_rebooting ?
 						    COMPARTMENT_STATE_REBOOTING :
 						    COMPARTMENT_STATE_STOPPED;
+		if (!compartment->is_rebooting)
+			compartment->is_fast_restart = false;
 		compartment_set_state(compartment, state);
 		compartment->is_rebooting = false;
 	}
@@ -683,7 +686,8 @@ compartment_sigchld_cb(UNUSED int signum, event_signal_t *sig, void *data)
 	int status = 0;
 	if (compartment->pid > 0 && (pid = proc_waitpid(-(compartment->pid), &status, WNOHANG))) {
 		if (pid == compartment->pid) {
-			bool rebooting = false;
+			// may already be set by compartment_reboot()
+			bool rebooting = compartment->is_rebooting;
 			if (WIFEXITED(status)) {
 				INFO("Container %s terminated (init process exited with status=%d)",
 				     compartment_get_description(compartment), WEXITSTATUS(status));
@@ -1031,19 +1035,21 @@ compartment_start_child_early(void *data)
 		compartment_module_get_mod_instance_by_name(compartment, "c_user");
 	compartment_module_instance_t *c_net =
 		compartment_module_get_mod_instance_by_name(compartment, "c_net");
-	// on reboots of c0 rejoin existing userns and netns
-	if (compartment_uuid_is_c0id(compartment_get_uuid(compartment)) &&
-	    compartment->prev_state == COMPARTMENT_STATE_REBOOTING) {
-		if (c_user && c_user->module && c_user->module->join_ns) {
+	// on reboots of c0 and fast restarts rejoin existing userns and netns
+	bool rejoin_ns = (compartment_uuid_is_c0id(compartment_get_uuid(compartment)) ||
+			  compartment->is_fast_restart) &&
+			 compartment->prev_state == COMPARTMENT_STATE_REBOOTING;
+
+	if (c_user && compartment_has_userns(compartment)) {
+		if (rejoin_ns && c_user->module && c_user->module->join_ns)
 			IF_TRUE_GOTO((ret = c_user->module->join_ns(c_user->instance)) < 0, error);
-		}
-		if (c_net && c_net->module && c_net->module->join_ns) {
-			IF_TRUE_GOTO((ret = c_net->module->join_ns(c_net->instance)) < 0, error);
-		}
-	} else {
-		if (c_user && compartment_has_userns(compartment))
+		else
 			clone_flags |= CLONE_NEWUSER;
-		if (c_net && compartment_has_netns(compartment))
+	}
+	if (c_net && compartment_has_netns(compartment)) {
+		if (rejoin_ns && c_net->module && c_net->module->join_ns)
+			IF_TRUE_GOTO((ret = c_net->module->join_ns(c_net->instance)) < 0, error);
+		else
 			clone_flags |= CLONE_NEWNET;
 	}
 
@@ -1159,6 +1165,9 @@ compartment_start_post_clone_cb(int fd, unsigned events, event_io_t *io, void *d
 		IF_TRUE_GOTO_WARN((module->start_pre_exec(c_mod->instance) < 0), error_pre_exec);
 	}
 
+	// all modules are set up, the next stop is a regular one again
+	compartment->is_fast_restart = false;
+
 	// skip setup of start timer and maintain SETUP state if in SETUP mode
 	if (compartment_get_state(compartment) != COMPARTMENT_STATE_SETUP) {
 		compartment_set_state(compartment, COMPARTMENT_STATE_BOOTING);
@@ -1458,6 +1467,40 @@ compartment_kill(compartment_t *compartment)
 	}
 }
 
+void
+compartment_reboot(compartment_t *compartment)
+{
+	ASSERT(compartment);
+
+	if (compartment_get_state(compartment) == COMPARTMENT_STATE_STOPPED) {
+		DEBUG("Trying to reboot stopped compartment... doing nothing.");
+		return;
+	}
+
+	INFO("Rebooting compartment %s", compartment_get_description(compartment));
+	compartment->is_rebooting = true;
+	compartment_kill(compartment);
+}
+
+int
+compartment_restart(compartment_t *compartment)
+{
+	ASSERT(compartment);
+
+	INFO("Restarting compartment %s keeping its namespaces and volumes",
+	     compartment_get_description(compartment));
+	compartment->is_rebooting = true;
+	compartment->is_fast_restart = true;
+	return compartment_stop(compartment);
+}
+
+bool
+compartment_is_fast_restart(const compartment_t *compartment)
+{
+	ASSERT(compartment);
+	return compartment->is_fast_restart;
+}
+
 /* This callback determines the compartment's state and forces its shutdown,
  * when a compartment could not be stopped in time*/
 static void
@@ -287,6 +287,32 @@ compartment_stop(compartment_t *compartment);
 void
 compartment_kill(compartment_t *compartment);
 
+/**
+ * Forcefully terminate the execution of a compartment and go through the
+ * REBOOTING state afterwards, as if the compartment rebooted itself.
+ */
+void
+compartment_reboot(compartment_t *compartment);
+
+/**
+ * Gracefully stop a running compartment and start it again through the
+ * REBOOTING state. In contrast to a regular reboot, the user and network
+ * namespaces as well as the block devices of the volumes are kept and
+ * reused by the next start, only the init process and the per-boot setup
+ * of the modules are run again.
+ *
+ * @return 0 on success, -1 if some modules could not be stopped, see compartment_stop().
+ */
+int
+compartment_restart(compartment_t *compartment);
+
+/**
+ * Returns true while a compartment is restarted by compartment_restart(),
+ * i.e., from the stop until all start hooks of the modules have been run.
+ */
+bool
+compartment_is_fast_restart(const compartment_t *compartment);
+
 /**
  * Register a unix socket which is bound into the compartment at the given path during
  * compartment start. The function **must** be called before starting the compartment
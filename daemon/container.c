@@ -61,6 +61,15 @@ struct container {
 
 	bool usb_pin_entry;
 
+	unsigned int hibernate_timeout; /* idle time in seconds before hibernation, 0 if disabled */
+
+	container_io_limits_t io_limits;
+	container_cpu_limits_t cpu_limits;
+	container_oom_config_t oom_config;
+	unsigned int oom_kills;
+	container_mem_policy_t mem_policy;
+	container_swap_limits_t swap_limits;
+
 	// virtual network interfaces from container config
 	list_t *vnet_cfg_list;
 	// network interfaces from container config
@@ -93,7 +102,8 @@ container_new(const uuid_t *uuid, const char *name, container_type_t type, bool
 	      list_t *pnet_cfg_list, char **allowed_devices, char **assigned_devices,
 	      list_t *vnet_cfg_list, list_t *usbdev_list, const char *init, char **init_argv,
 	      char **init_env, size_t init_env_len, list_t *fifo_list, container_token_type_t ttype,
-	      bool usb_pin_entry)
+	      bool usb_pin_entry, unsigned int hibernate_timeout,
+	      const container_resources_t *resources)
 {
 	container_t *container = mem_new0(container_t, 1);
 
@@ -142,6 +152,19 @@ container_new(const uuid_t *uuid, const char *name, container_type_t type, bool
 
 	container->usb_pin_entry = usb_pin_entry;
 
+	container->hibernate_timeout = hibernate_timeout;
+
+	if (resources) {
+		container->io_limits = resources->io_limits;
+		container->cpu_limits = resources->cpu_limits;
+		container->oom_config = resources->oom_config;
+		container->mem_policy = resources->mem_policy;
+		container->swap_limits = resources->swap_limits;
+	} else {
+		container->oom_config.policy = CONTAINER_OOM_POLICY_NOTIFY;
+		container->mem_policy.thp = CONTAINER_THP_POLICY_DEFAULT;
+	}
+
 	// set type specific flags for compartment
 	uint64_t flags = 0;
 	if (type == CONTAINER_TYPE_KVM)
@@ -379,6 +402,27 @@ container_kill(container_t *container)
 	compartment_kill(container->compartment);
 }
 
+void
+container_reboot(container_t *container)
+{
+	ASSERT(container);
+	compartment_reboot(container->compartment);
+}
+
+int
+container_restart(container_t *container)
+{
+	ASSERT(container);
+	return compartment_restart(container->compartment);
+}
+
+bool
+container_is_fast_restart(const container_t *container)
+{
+	ASSERT(container);
+	return compartment_is_fast_restart(container->compartment);
+}
+
 int
 container_bind_socket_before_start(container_t *container, const char *path)
 {
@@ -512,9 +556,13 @@ container_wipe_image_cb(const char *path, const char *name, UNUSED void *data)
 {
 	ASSERT(data);
 	container_t *container = data;
-	/* Only do the rest of the callback if the file name ends with .img */
+	/*
+	 * Only do the rest of the callback if the file name ends with .img or with
+	 * .thin, the thin pool releases volumes whose id file was removed
+	 */
 	int len = strlen(name);
-	if (len >= 4 && !strcmp(name + len - 4, ".img")) {
+	if ((len >= 4 && !strcmp(name + len - 4, ".img")) ||
+	    (len >= 5 && !strcmp(name + len - 5, ".thin"))) {
 		char *image_path = mem_printf("%s/%s", path, name);
 		DEBUG("Deleting image of container %s: %s", container_get_description(container),
 		      image_path);
@@ -639,6 +687,13 @@ container_get_ram_limit(const container_t *container)
 	return container->ram_limit;
 }
 
+void
+container_set_ram_limit(container_t *container, unsigned int ram_limit)
+{
+	ASSERT(container);
+	container->ram_limit = ram_limit;
+}
+
 const char *
 container_get_cpus_allowed(const container_t *container)
 {
@@ -789,6 +844,78 @@ container_get_usb_pin_entry(const container_t *container)
 	return container->usb_pin_entry;
 }
 
+unsigned int
+container_get_hibernate_timeout(const container_t *container)
+{
+	ASSERT(container);
+	return container->hibernate_timeout;
+}
+
+const container_io_limits_t *
+container_get_io_limits(const container_t *container)
+{
+	ASSERT(container);
+	return &container->io_limits;
+}
+
+void
+container_set_io_limits(container_t *container, const container_io_limits_t *io_limits)
+{
+	ASSERT(container);
+	ASSERT(io_limits);
+	container->io_limits = *io_limits;
+}
+
+const container_cpu_limits_t *
+container_get_cpu_limits(const container_t *container)
+{
+	ASSERT(container);
+	return &container->cpu_limits;
+}
+
+void
+container_set_cpu_limits(container_t *container, const container_cpu_limits_t *cpu_limits)
+{
+	ASSERT(container);
+	ASSERT(cpu_limits);
+	container->cpu_limits = *cpu_limits;
+}
+
+const container_oom_config_t *
+container_get_oom_config(const container_t *container)
+{
+	ASSERT(container);
+	return &container->oom_config;
+}
+
+unsigned int
+container_get_oom_kills(const container_t *container)
+{
+	ASSERT(container);
+	return container->oom_kills;
+}
+
+const container_mem_policy_t *
+container_get_mem_policy(const container_t *container)
+{
+	ASSERT(container);
+	return &container->mem_policy;
+}
+
+const container_swap_limits_t *
+container_get_swap_limits(const container_t *container)
+{
+	ASSERT(container);
+	return &container->swap_limits;
+}
+
+void
+container_add_oom_kills(container_t *container, unsigned int count)
+{
+	ASSERT(container);
+	container->oom_kills += count;
+}
+
 /* Functions usually implemented and registered by c_user module */
 CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(setuid0, int, void *)
 CONTAINER_MODULE_FUNCTION_WRAPPER_IMPL(setuid0, int, 0)
@@ -813,6 +940,18 @@ CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(freeze, int, void *)
 CONTAINER_MODULE_FUNCTION_WRAPPER_IMPL(freeze, int, 0)
 CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(unfreeze, int, void *)
 CONTAINER_MODULE_FUNCTION_WRAPPER_IMPL(unfreeze, int, 0)
+CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(wakeup, int, void *)
+CONTAINER_MODULE_FUNCTION_WRAPPER_IMPL(wakeup, int, 0)
+CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(get_volume_devices_new, list_t *, void *)
+CONTAINER_MODULE_FUNCTION_WRAPPER_IMPL(get_volume_devices_new, list_t *, NULL)
+CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(update_cpu_limits, int, void *)
+CONTAINER_MODULE_FUNCTION_WRAPPER_IMPL(update_cpu_limits, int, 0)
+
+CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(update_io_limits, int, void *)
+CONTAINER_MODULE_FUNCTION_WRAPPER_IMPL(update_io_limits, int, 0)
+
+CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(update_ram_limit, int, void *)
+CONTAINER_MODULE_FUNCTION_WRAPPER_IMPL(update_ram_limit, int, 0)
 CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(allow_audio, int, void *)
 CONTAINER_MODULE_FUNCTION_WRAPPER_IMPL(allow_audio, int, 0)
 CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(deny_audio, int, void *)
@@ -825,6 +964,8 @@ CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(is_device_allowed, bool, void *, char, in
 CONTAINER_MODULE_FUNCTION_WRAPPER4_IMPL(is_device_allowed, bool, true, char, int, int)
 CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(add_pid_to_cgroups, int, void *, pid_t)
 CONTAINER_MODULE_FUNCTION_WRAPPER2_IMPL(add_pid_to_cgroups, int, 0, pid_t)
+CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(get_swap_stats, int, void *, container_swap_stats_t *)
+CONTAINER_MODULE_FUNCTION_WRAPPER2_IMPL(get_swap_stats, int, -1, container_swap_stats_t *)
 
 /* Functions usually implemented and registered by c_vol module */
 CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(get_rootdir, char *, void *)
@@ -848,6 +989,10 @@ CONTAINER_MODULE_FUNCTION_WRAPPER_IMPL(get_creation_time, time_t, 0)
 CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(get_uptime, time_t, void *)
 CONTAINER_MODULE_FUNCTION_WRAPPER_IMPL(get_uptime, time_t, 0)
 
+/* Functions usually implemented and registered by c_mem module */
+CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(get_mem_stats, int, void *, container_mem_stats_t *)
+CONTAINER_MODULE_FUNCTION_WRAPPER2_IMPL(get_mem_stats, int, -1, container_mem_stats_t *)
+
 /* Functions usually implemented and registered by c_cap module */
 CONTAINER_MODULE_REGISTER_WRAPPER_IMPL(set_cap_current_process, int, void *)
 CONTAINER_MODULE_FUNCTION_WRAPPER_IMPL(set_cap_current_process, int, 0)
@@ -99,6 +99,104 @@ typedef struct container_vnet_cfg {
  * The CML bridges or moves the physical IF into the container and enforces
  * filtering of layer 2 frames based on MAC adresses
  */
+/**
+ * Limits for the I/O of a container on the devices backing its volumes.
+ * Values of 0 mean no limit or, for the weight, the default weight.
+ */
+typedef struct container_io_limits {
+	uint32_t weight; /* proportional share 1..10000 */
+	uint64_t read_bps;
+	uint64_t write_bps;
+	uint64_t read_iops;
+	uint64_t write_iops;
+} container_io_limits_t;
+
+/**
+ * CPU bandwidth limits of a container. A quota of 0 means no limit, a period
+ * or weight of 0 the default period or weight.
+ */
+typedef struct container_cpu_limits {
+	uint32_t quota_us;  /* cpu time per period, exceeds the period for multiple cpus */
+	uint32_t period_us; /* length of the period */
+	uint32_t weight;    /* proportional share 1..10000 */
+	uint32_t burst_us;  /* unused quota which may be accumulated, at most quota_us */
+} container_cpu_limits_t;
+
+/**
+ * Swap limits of a container. If not enabled, the kernel defaults apply.
+ */
+typedef struct container_swap_limits {
+	bool enabled;	    /* set the limits for the container */
+	uint32_t swap_max;  /* MB of swap, 0 for no swap */
+	uint32_t zswap_max; /* MB of compressed memory in zswap, 0 to bypass zswap */
+} container_swap_limits_t;
+
+/**
+ * Swap usage of a container.
+ */
+typedef struct container_swap_stats {
+	uint64_t swap_used;	  /* bytes swapped out */
+	uint64_t swap_compressed; /* bytes the swapped out memory takes in zswap and zram */
+	uint64_t swap_ins;	  /* pages swapped in */
+	uint64_t swap_outs;	  /* pages swapped out */
+} container_swap_stats_t;
+
+/**
+ * Reaction to an OOM kill inside a container.
+ */
+typedef enum {
+	CONTAINER_OOM_POLICY_NOTIFY = 1,
+	CONTAINER_OOM_POLICY_RESTART,
+	CONTAINER_OOM_POLICY_EXPAND,
+} container_oom_policy_t;
+
+/**
+ * OOM handling of a container.
+ */
+typedef struct container_oom_config {
+	bool group;		       /* kill all processes of the container together */
+	container_oom_policy_t policy; /* reaction to an OOM kill */
+	unsigned int expand_percent;   /* raise of the ram limit for CONTAINER_OOM_POLICY_EXPAND */
+} container_oom_config_t;
+
+/**
+ * Use of transparent hugepages inside a container.
+ */
+typedef enum {
+	CONTAINER_THP_POLICY_DEFAULT = 1,
+	CONTAINER_THP_POLICY_NEVER,
+	CONTAINER_THP_POLICY_MADVISE,
+} container_thp_policy_t;
+
+/**
+ * Memory policies applied to the process tree of a container.
+ */
+typedef struct container_mem_policy {
+	bool ksm_merge;		    /* merge identical anonymous pages of all processes */
+	container_thp_policy_t thp; /* use of transparent hugepages */
+} container_mem_policy_t;
+
+/**
+ * Resource policies of a container, passed to container_new() as a whole.
+ * Without resource policies, no limits and the default policies apply.
+ */
+typedef struct container_resources {
+	container_io_limits_t io_limits;
+	container_cpu_limits_t cpu_limits;
+	container_oom_config_t oom_config;
+	container_mem_policy_t mem_policy;
+	container_swap_limits_t swap_limits;
+} container_resources_t;
+
+/**
+ * Memory statistics of the processes of a container.
+ */
+typedef struct container_mem_stats {
+	uint64_t ksm_merging_pages; /* pages merged by KSM */
+	int64_t ksm_profit;	    /* bytes saved by KSM minus its metadata overhead */
+	uint64_t anon_thp;	    /* bytes of anonymous transparent hugepages */
+} container_mem_stats_t;
+
 typedef struct container_pnet_cfg {
 	char *pnet_name;
 	bool mac_filter;
@@ -138,7 +236,8 @@ container_new(const uuid_t *uuid, const char *name, container_type_t type, bool
 	      list_t *net_ifaces, char **allowed_devices, char **assigned_devices,
 	      list_t *vnet_cfg_list, list_t *usbdev_list, const char *init, char **init_argv,
 	      char **init_env, size_t init_env_len, list_t *fifo_list, container_token_type_t ttype,
-	      bool usb_pin_entry);
+	      bool usb_pin_entry, unsigned int hibernate_timeout,
+	      const container_resources_t *resources);
 
 /**
  * Free a container data structure.
@@ -214,6 +313,13 @@ container_get_color_rgb_string(const container_t *container);
 unsigned int
 container_get_ram_limit(const container_t *container);
 
+/**
+ * Sets the RAM limit of the container in MBytes. The limit is applied on the
+ * next start or by container_update_ram_limit() to a running container.
+ */
+void
+container_set_ram_limit(container_t *container, unsigned int ram_limit);
+
 const char *
 container_get_cpus_allowed(const container_t *container);
 
@@ -248,6 +354,69 @@ container_get_token_type(const container_t *container);
 bool
 container_get_usb_pin_entry(const container_t *container);
 
+/**
+ * Returns the idle time in seconds after which the container is hibernated, 0 if disabled.
+ */
+unsigned int
+container_get_hibernate_timeout(const container_t *container);
+
+/**
+ * Returns the I/O limits of the container.
+ */
+const container_io_limits_t *
+container_get_io_limits(const container_t *container);
+
+/**
+ * Sets the I/O limits of the container. The limits are applied on the next
+ * start or by container_update_io_limits() to a running container.
+ */
+void
+container_set_io_limits(container_t *container, const container_io_limits_t *io_limits);
+
+/**
+ * Returns the CPU limits of the container.
+ */
+const container_cpu_limits_t *
+container_get_cpu_limits(const container_t *container);
+
+/**
+ * Sets the CPU limits of the container. The limits are applied on the next
+ * start or by container_update_cpu_limits() to a running container.
+ */
+void
+container_set_cpu_limits(container_t *container, const container_cpu_limits_t *cpu_limits);
+
+/**
+ * Returns the OOM handling of the container.
+ */
+const container_oom_config_t *
+container_get_oom_config(const container_t *container);
+
+/**
+ * Returns the number of processes killed by the OOM killer inside the container
+ * since it was created.
+ */
+unsigned int
+container_get_oom_kills(const container_t *container);
+
+/**
+ * Returns the KSM and transparent hugepage policy of the container.
+ */
+const container_mem_policy_t *
+container_get_mem_policy(const container_t *container);
+
+/**
+ * Returns the swap limits of the container.
+ */
+const container_swap_limits_t *
+container_get_swap_limits(const container_t *container);
+
+/**
+ * Adds OOM kills observed by the cgroups module to the counter of the container.
+ */
+void
+container_add_oom_kills(container_t *container, unsigned int count);
+
 list_t *
 container_get_pnet_cfg_list(const container_t *container);
 
@@ -376,6 +545,26 @@ container_stop(container_t *container);
 void
 container_kill(container_t *container);
 
+/**
+ * Kills the container and starts it again as soon as it is stopped, the same
+ * way as a reboot triggered inside the container.
+ */
+void
+container_reboot(container_t *container);
+
+/**
+ * Stops the container and starts it again as soon as it is stopped, keeping
+ * its namespaces and volumes. See compartment_restart().
+ */
+int
+container_restart(container_t *container);
+
+/**
+ * Returns true while the container is restarted by container_restart().
+ */
+bool
+container_is_fast_restart(const container_t *container);
+
 int
 container_bind_socket_before_start(container_t *container, const char *path);
 
@@ -468,6 +657,44 @@ CONTAINER_MODULE_WRAPPER_DECLARE(freeze, int)
  */
 CONTAINER_MODULE_WRAPPER_DECLARE(unfreeze, int)
 
+/**
+ * Thaw a container if it was frozen by the hibernation policy, e.g., on
+ * a request or device event for it. Containers frozen explicitly stay frozen.
+ *
+ * @return 0 if ok, negative values indicate errors.
+ */
+CONTAINER_MODULE_WRAPPER_DECLARE(wakeup, int)
+
+/**
+ * Returns the block devices which currently back the volumes of the container,
+ * e.g., loop, dm-verity and dm-crypt devices, as list of "major:minor" strings.
+ */
+CONTAINER_MODULE_WRAPPER_DECLARE(get_volume_devices_new, list_t *)
+
+/**
+ * Applies the current CPU limits of the container to its cgroup, if the
+ * container is running.
+ *
+ * @return 0 if ok, negative values indicate errors.
+ */
+CONTAINER_MODULE_WRAPPER_DECLARE(update_cpu_limits, int)
+
+/**
+ * Applies the current I/O limits of the container to its cgroup, if the
+ * container is running.
+ *
+ * @return 0 if ok, negative values indicate errors.
+ */
+CONTAINER_MODULE_WRAPPER_DECLARE(update_io_limits, int)
+
+/**
+ * Applies the current RAM limit of the container to its cgroup, if the
+ * container is running.
+ *
+ * @return 0 if ok, negative values indicate errors.
+ */
+CONTAINER_MODULE_WRAPPER_DECLARE(update_ram_limit, int)
+
 /**
  * Registers the corresponding handler for container_allow_audio
  */
@@ -478,6 +705,12 @@ CONTAINER_MODULE_WRAPPER_DECLARE(allow_audio, int)
  */
 CONTAINER_MODULE_WRAPPER_DECLARE(deny_audio, int)
 
+/**
+ * Fills stats with the swap usage of the container.
+ * Returns -1 if the container is not running.
+ */
+CONTAINER_MODULE_WRAPPER_DECLARE(get_swap_stats, int, container_swap_stats_t *stats)
+
 /**
  * Adds a network interface to the container
  */
@@ -633,4 +866,10 @@ CONTAINER_MODULE_WRAPPER_DECLARE(get_uptime, time_t)
  */
 CONTAINER_MODULE_WRAPPER_DECLARE(get_creation_time, time_t)
 
+/**
+ * Fills stats with the KSM and transparent hugepage usage of the container.
+ * Returns -1 if the container is not running.
+ */
+CONTAINER_MODULE_WRAPPER_DECLARE(get_mem_stats, int, container_mem_stats_t *stats)
+
 #endif /* CONTAINER_H */
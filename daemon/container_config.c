@@ -35,6 +35,7 @@
 
 #include <stdint.h>
 #include <inttypes.h>
+#include <string.h>
 
 #include "cmld.h"
 #include "crypto.h"
@@ -669,6 +670,109 @@ container_config_get_usb_pin_entry(const container_config_t *config)
 	return config->cfg->usb_pin_entry;
 }
 
+uint32_t
+container_config_get_hibernate_idle_timeout(const container_config_t *config)
+{
+	ASSERT(config);
+	ASSERT(config->cfg);
+	return config->cfg->hibernate_idle_timeout;
+}
+
+void
+container_config_get_io_limits(const container_config_t *config, container_io_limits_t *io_limits)
+{
+	ASSERT(config);
+	ASSERT(config->cfg);
+	ASSERT(io_limits);
+
+	memset(io_limits, 0, sizeof(container_io_limits_t));
+	IF_NULL_RETURN(config->cfg->io_limits);
+
+	io_limits->weight = config->cfg->io_limits->weight;
+	io_limits->read_bps = config->cfg->io_limits->read_bps;
+	io_limits->write_bps = config->cfg->io_limits->write_bps;
+	io_limits->read_iops = config->cfg->io_limits->read_iops;
+	io_limits->write_iops = config->cfg->io_limits->write_iops;
+}
+
+void
+container_config_get_cpu_limits(const container_config_t *config,
+				container_cpu_limits_t *cpu_limits)
+{
+	ASSERT(config);
+	ASSERT(config->cfg);
+	ASSERT(cpu_limits);
+
+	memset(cpu_limits, 0, sizeof(container_cpu_limits_t));
+	IF_NULL_RETURN(config->cfg->cpu_limits);
+
+	cpu_limits->quota_us = config->cfg->cpu_limits->quota_us;
+	cpu_limits->period_us = config->cfg->cpu_limits->period_us;
+	cpu_limits->weight = config->cfg->cpu_limits->weight;
+	cpu_limits->burst_us = config->cfg->cpu_limits->burst_us;
+}
+
+void
+container_config_get_swap_limits(const container_config_t *config,
+				 container_swap_limits_t *swap_limits)
+{
+	ASSERT(config);
+	ASSERT(config->cfg);
+	ASSERT(swap_limits);
+
+	memset(swap_limits, 0, sizeof(container_swap_limits_t));
+	IF_NULL_RETURN(config->cfg->swap_limits);
+
+	swap_limits->enabled = true;
+	swap_limits->swap_max = config->cfg->swap_limits->swap_max;
+	swap_limits->zswap_max = config->cfg->swap_limits->zswap_max;
+}
+
+void
+container_config_get_oom_config(const container_config_t *config,
+				container_oom_config_t *oom_config)
+{
+	ASSERT(config);
+	ASSERT(config->cfg);
+	ASSERT(oom_config);
+
+	oom_config->group = config->cfg->oom_group;
+	oom_config->expand_percent = config->cfg->oom_expand_percent;
+
+	switch (config->cfg->oom_policy) {
+	case CONTAINER_OOM_POLICY__OOM_RESTART:
+		oom_config->policy = CONTAINER_OOM_POLICY_RESTART;
+		break;
+	case CONTAINER_OOM_POLICY__OOM_EXPAND:
+		oom_config->policy = CONTAINER_OOM_POLICY_EXPAND;
+		break;
+	default:
+		oom_config->policy = CONTAINER_OOM_POLICY_NOTIFY;
+	}
+}
+
+void
+container_config_get_mem_policy(const container_config_t *config,
+				container_mem_policy_t *mem_policy)
+{
+	ASSERT(config);
+	ASSERT(config->cfg);
+	ASSERT(mem_policy);
+
+	mem_policy->ksm_merge = config->cfg->ksm_merge;
+
+	switch (config->cfg->thp_policy) {
+	case CONTAINER_THP_POLICY__THP_NEVER:
+		mem_policy->thp = CONTAINER_THP_POLICY_NEVER;
+		break;
+	case CONTAINER_THP_POLICY__THP_MADVISE:
+		mem_policy->thp = CONTAINER_THP_POLICY_MADVISE;
+		break;
+	default:
+		mem_policy->thp = CONTAINER_THP_POLICY_DEFAULT;
+	}
+}
+
 const char *
 container_config_get_cpus_allowed(const container_config_t *config)
 {
@@ -241,4 +241,44 @@ container_config_get_usbtoken_serial(const container_config_t *config);
 bool
 container_config_get_usb_pin_entry(const container_config_t *config);
 
+/**
+ * Returns the idle time in seconds after which the container is hibernated, 0 if disabled.
+ */
+uint32_t
+container_config_get_hibernate_idle_timeout(const container_config_t *config);
+
+/**
+ * Fills io_limits with the I/O limits of the container, all 0 if none are configured.
+ */
+void
+container_config_get_io_limits(const container_config_t *config, container_io_limits_t *io_limits);
+
+/**
+ * Fills cpu_limits with the CPU limits of the container, all 0 if none are configured.
+ */
+void
+container_config_get_cpu_limits(const container_config_t *config,
+				container_cpu_limits_t *cpu_limits);
+
+/**
+ * Fills oom_config with the OOM handling of the container.
+ */
+void
+container_config_get_oom_config(const container_config_t *config,
+				container_oom_config_t *oom_config);
+
+/**
+ * Fills mem_policy with the KSM and transparent hugepage policy of the container.
+ */
+void
+container_config_get_mem_policy(const container_config_t *config,
+				container_mem_policy_t *mem_policy);
+
+/**
+ * Fills swap_limits with the swap limits of the container.
+ */
+void
+container_config_get_swap_limits(const container_config_t *config,
+				 container_swap_limits_t *swap_limits);
+
 #endif /* C_CONFIG_H */
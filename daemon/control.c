@@ -33,6 +33,7 @@
 #include "hardware.h"
 #include "crypto.h"
 #include "audit.h"
+#include "thinpool.h"
 
 //#define LOGF_LOG_MIN_PRIO LOGF_PRIO_TRACE
 #include "common/macro.h"
@@ -48,9 +49,10 @@
 #include "common/reboot.h"
 #include "common/file.h"
 #include "common/dir.h"
-#include "common/str.h"
 #include "common/proc.h"
+#include "common/logstore.h"
 
+#include <stdlib.h>
 #include <unistd.h>
 #include <inttypes.h>
 
@@ -64,6 +66,9 @@
 
 #define LOGGER_ENTRY_MAX_LEN (5 * 1024)
 
+// initial chunk size of the arena used while handling a single request
+#define CONTROL_ARENA_CHUNK_SIZE (64 * 1024)
+
 struct control {
 	int sock; // listen socket fd
 	bool privileged;
@@ -72,96 +77,201 @@ struct control {
 
 static list_t *control_list = NULL;
 
+/*
+ * Arena for the received message and the response of the request which is
+ * currently handled. It is reset in one go after the response has been sent.
+ */
+static mem_arena_t *control_arena = NULL;
+
 /**
- * @brief callback for the dir_foreach function sending a file as LogMessage to the Controller
- * @path: Expects path string without trailing "/" at the end
- * @return 1 on error, 0 else 
+ * Sends len bytes of buf as fragment of the LogMessage with the given name to
+ * the Controller, the last fragment of a message is marked by final.
+ * @return 1 on error, 0 else
  */
 static int
-control_send_file_as_log_message_cb(const char *path, const char *file, void UNUSED *data)
+control_send_log_fragment(int *fd, const char *name, const char *buf, size_t len, bool final)
 {
-	IF_NULL_RETVAL(path, 1);
-	IF_NULL_RETVAL(file, 1);
-
-	int *fd = (int *)data;
 	int ret = 0;
-	str_t *path_str = str_new(path);
-	str_append(path_str, "/");
-	str_append(path_str, file);
 
 	LogMessage message = LOG_MESSAGE__INIT;
+	message.name = mem_strdup(name);
+	message.msg = mem_strndup(buf, len);
 
-	message.name = mem_strdup(file);
 	DaemonToController out = DAEMON_TO_CONTROLLER__INIT;
 	if (cmld_get_device_uuid()) {
 		TRACE("Setting uuid: %s", cmld_get_device_uuid());
 		out.device_uuid = mem_strdup(cmld_get_device_uuid());
 	}
+	out.code = final ? DAEMON_TO_CONTROLLER__CODE__LOG_MESSAGE_FINAL :
+			   DAEMON_TO_CONTROLLER__CODE__LOG_MESSAGE_FRAGMENT;
+	out.log_message = &message;
 
-	DEBUG("Opening and sending %s", str_buffer(path_str));
+	if (protobuf_send_message(*fd, (ProtobufCMessage *)&out) < 0) {
+		ERROR_ERRNO("Could not finish sending %s", name);
+		ret = 1;
+	}
 
-	char *file_buf =
-		file_read_new(str_buffer(path_str), (size_t)file_size(str_buffer(path_str)));
+	mem_free0(message.name);
+	mem_free0(message.msg);
+	mem_free0(out.device_uuid);
+	return ret;
+}
+
+/**
+ * Sends the text file at file_path as LogMessage with the given name to the Controller.
+ * @return 1 on error, 0 else
+ */
+static int
+control_send_log_message(int *fd, const char *name, const char *file_path)
+{
+	int ret = 0;
 
-	if (file_buf) {
-		int max_fragment_size = PROTOBUF_MAX_MESSAGE_SIZE - PROTOBUF_MAX_OVERHEAD;
-		int sent = 0;
-		int size = strlen(file_buf);
+	DEBUG("Opening and sending %s", file_path);
 
-		while (0 < size - sent) {
-			fflush(stdout);
-			fflush(stderr);
+	char *file_buf = file_read_new(file_path, (size_t)file_size(file_path));
+	if (!file_buf) {
+		DEBUG("File %s could not be read to buffer.", file_path);
+		return 1;
+	}
 
-			// send fragments if size exceeds fragment_size
-			int tosend = size - sent;
-			if (tosend > max_fragment_size) {
-				out.code = DAEMON_TO_CONTROLLER__CODE__LOG_MESSAGE_FRAGMENT;
-				message.msg =
-					(char *)mem_strndup(file_buf + sent, max_fragment_size);
+	size_t max_fragment_size = PROTOBUF_MAX_MESSAGE_SIZE - PROTOBUF_MAX_OVERHEAD;
+	size_t size = strlen(file_buf);
+	size_t sent = 0;
 
-				DEBUG("Sending fragment of logfile %s, sent: %d, remaining: %d",
-				      str_buffer(path_str), sent, size - sent);
+	while (sent < size) {
+		fflush(stdout);
+		fflush(stderr);
 
-				out.log_message = &message;
-				if (protobuf_send_message(*fd, (ProtobufCMessage *)&out) < 0) {
-					ERROR_ERRNO("Could not finish sending %s",
-						    str_buffer(path_str));
-					ret = 1;
-					break;
-				}
+		// send fragments if size exceeds fragment_size
+		size_t tosend = MIN(size - sent, max_fragment_size);
+		bool final = sent + tosend == size;
 
-				sent += max_fragment_size;
-				mem_free0(message.msg);
-			} else {
-				DEBUG("Sending final fragment of logfile %s, sent: %d, remaining: %d",
-				      str_buffer(path_str), sent, size - sent);
-				out.code = DAEMON_TO_CONTROLLER__CODE__LOG_MESSAGE_FINAL;
-				message.msg = (char *)mem_strndup(file_buf + sent, size - sent);
-
-				out.log_message = &message;
-				if (protobuf_send_message(*fd, (ProtobufCMessage *)&out) < 0) {
-					ERROR_ERRNO("Could not finish sending %s",
-						    str_buffer(path_str));
-					ret = 1;
-					break;
-				}
+		DEBUG("Sending %sfragment of logfile %s, sent: %zu, remaining: %zu",
+		      final ? "final " : "", file_path, sent, size - sent);
 
-				sent += strlen(message.msg);
-				mem_free0(message.msg);
-			}
+		if (control_send_log_fragment(fd, name, file_buf + sent, tosend, final)) {
+			ret = 1;
+			break;
+		}
+		sent += tosend;
+	}
+
+	mem_free0(file_buf);
+	return ret;
+}
+
+/**
+ * @brief callback for the dir_foreach function sending a file as LogMessage to the Controller
+ * Files of log stores are skipped, see control_send_logstore().
+ * @path: Expects path string without trailing "/" at the end
+ * @return 1 on error, 0 else
+ */
+static int
+control_send_file_as_log_message_cb(const char *path, const char *file, void *data)
+{
+	IF_NULL_RETVAL(path, 1);
+	IF_NULL_RETVAL(file, 1);
+
+	char *store_name = logstore_get_name_new(file);
+	if (store_name) {
+		mem_free0(store_name);
+		return 0;
+	}
+
+	char *file_path = mem_printf("%s/%s", path, file);
+	int ret = control_send_log_message(data, file, file_path);
+	mem_free0(file_path);
+	return ret;
+}
+
+/**
+ * @brief callback for the dir_foreach function collecting the names of the log stores
+ */
+static int
+control_collect_logstores_cb(UNUSED const char *path, const char *file, void *data)
+{
+	list_t **stores = data;
+
+	char *store_name = logstore_get_name_new(file);
+	IF_NULL_RETVAL(store_name, 0);
+
+	for (list_t *l = *stores; l; l = l->next) {
+		if (!strcmp(l->data, store_name)) {
+			mem_free0(store_name);
+			return 0;
 		}
-		mem_free0(file_buf);
-	} else {
-		DEBUG("File %s could not be read to buffer.", str_buffer(path_str));
-		ret = 1;
 	}
+	*stores = list_append(*stores, store_name);
+	return 0;
+}
+
+/**
+ * State of streaming the records of a log store as LogMessage fragments.
+ * The records are collected in buf until a full fragment is reached, which is
+ * only sent once more records follow, as the last fragment has to be marked.
+ */
+typedef struct control_log_stream {
+	int *fd;
+	const char *name;
+	char *buf;
+	size_t len;
+	size_t size;
+} control_log_stream_t;
+
+static int
+control_log_stream_cb(const char *buf, size_t len, void *data)
+{
+	control_log_stream_t *stream = data;
+
+	while (len > 0) {
+		if (stream->len == stream->size) {
+			if (control_send_log_fragment(stream->fd, stream->name, stream->buf,
+						      stream->len, false))
+				return -1;
+			stream->len = 0;
+		}
 
-	if (out.device_uuid != NULL) {
-		mem_free0(out.device_uuid);
+		size_t n = MIN(len, stream->size - stream->len);
+		memcpy(stream->buf + stream->len, buf, n);
+		stream->len += n;
+		buf += n;
+		len -= n;
 	}
+	return 0;
+}
 
-	str_free(path_str, true);
+/**
+ * Sends the decompressed records of all segments of a log store in LOGFILE_DIR
+ * as a single LogMessage '<name>.log' to the Controller. The records are
+ * streamed into the fragments, thus at most one fragment is held in memory.
+ * @return 1 on error, 0 else
+ */
+static int
+control_send_logstore(int *fd, const char *name)
+{
+	int ret = 1;
+	char *log_name = mem_printf("%s.log", name);
+	control_log_stream_t stream = { .fd = fd,
+					.name = log_name,
+					.size = PROTOBUF_MAX_MESSAGE_SIZE - PROTOBUF_MAX_OVERHEAD };
+
+	logstore_t *store = logstore_open_readonly(LOGFILE_DIR, name);
+	IF_NULL_GOTO_WARN(store, out);
+
+	stream.buf = mem_alloc(stream.size);
+	ssize_t len =
+		logstore_read_range_foreach(store, 0, time(NULL), &control_log_stream_cb, &stream);
+	if (len < 0)
+		WARN("Could not send log store %s", name);
+	else if (len > 0)
+		ret = control_send_log_fragment(fd, log_name, stream.buf, stream.len, true);
+	else
+		ret = 0;
 
+out:
+	logstore_free(store);
+	mem_free0(stream.buf);
+	mem_free0(log_name);
 	return ret;
 }
 
@@ -216,24 +326,49 @@ control_container_type_to_proto(container_type_t type)
 /**
  * Get the ContainerStatus for the given container.
  *
+ * @param arena the arena from which the ContainerStatus is allocated
  * @param container the container object from which to generate the ContainerStatus
  * @return  a new ContainerStatus object with information about the given container;
- *          has to be free'd with control_container_status_free()
+ *          valid until the arena is reset
  */
 static ContainerStatus *
-control_container_status_new(const container_t *container)
+control_container_status_new(mem_arena_t *arena, const container_t *container)
 {
-	ContainerStatus *c_status = mem_new(ContainerStatus, 1);
+	ContainerStatus *c_status = mem_arena_alloc(arena, sizeof(ContainerStatus));
 	container_status__init(c_status);
-	c_status->uuid = mem_strdup(uuid_string(container_get_uuid(container)));
-	c_status->name = mem_strdup(container_get_name(container));
+	c_status->uuid = mem_arena_strdup(arena, uuid_string(container_get_uuid(container)));
+	c_status->name = mem_arena_strdup(arena, container_get_name(container));
 	c_status->type = control_container_type_to_proto(container_get_type(container));
 	c_status->state = control_compartment_state_to_proto(container_get_state(container));
 	c_status->uptime = container_get_uptime(container);
 	c_status->created = container_get_creation_time(container);
+	c_status->has_oom_kills = true;
+	c_status->oom_kills = container_get_oom_kills(container);
+
+	container_mem_stats_t mem_stats;
+	if (!container_get_mem_stats(container, &mem_stats)) {
+		c_status->has_ksm_merging_pages = true;
+		c_status->ksm_merging_pages = mem_stats.ksm_merging_pages;
+		c_status->has_ksm_profit = true;
+		c_status->ksm_profit = mem_stats.ksm_profit;
+		c_status->has_anon_thp = true;
+		c_status->anon_thp = mem_stats.anon_thp;
+	}
+
+	container_swap_stats_t swap_stats;
+	if (!container_get_swap_stats(container, &swap_stats)) {
+		c_status->has_swap_used = true;
+		c_status->swap_used = swap_stats.swap_used;
+		c_status->has_swap_compressed = true;
+		c_status->swap_compressed = swap_stats.swap_compressed;
+		c_status->has_swap_ins = true;
+		c_status->swap_ins = swap_stats.swap_ins;
+		c_status->has_swap_outs = true;
+		c_status->swap_outs = swap_stats.swap_outs;
+	}
 
 	const guestos_t *os = container_get_guestos(container);
-	c_status->guestos = os ? mem_strdup(guestos_get_name(os)) : mem_strdup("none");
+	c_status->guestos = mem_arena_strdup(arena, os ? guestos_get_name(os) : "none");
 
 	c_status->trust_level = CONTAINER_TRUST__UNSIGNED;
 
@@ -253,22 +388,6 @@ control_container_status_new(const container_t *container)
 	return c_status;
 }
 
-/**
- * Free the given ContainerStatus object that was previously allocated
- * by control_container_status_new().
- *
- * @param c_status the previously allocated ContainerStatus object
- */
-static void
-control_container_status_free(ContainerStatus *c_status)
-{
-	IF_NULL_RETURN(c_status);
-	mem_free0(c_status->name);
-	mem_free0(c_status->uuid);
-	mem_free0(c_status->guestos);
-	mem_free0(c_status);
-}
-
 static ssize_t
 control_read_send(int cfd, int fd)
 {
@@ -851,6 +970,7 @@ control_check_command(control_t *control, const ControllerToDaemon *msg)
 	    (msg->command == CONTROLLER_TO_DAEMON__COMMAND__GET_CONTAINER_CONFIG) ||
 	    (msg->command == CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_CMLD_HANDLES_PIN) ||
 	    (msg->command == CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_STOP) ||
+	    (msg->command == CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_RESTART) ||
 	    (msg->command == CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_LIST_IFACES) ||
 	    (msg->command == CONTROLLER_TO_DAEMON__COMMAND__PUSH_GUESTOS_CONFIG)) {
 		TRACE("Received command %d is valid in provisioned mode", msg->command);
@@ -862,6 +982,22 @@ control_check_command(control_t *control, const ControllerToDaemon *msg)
 	return false;
 }
 
+static void
+control_thin_volume_cb(const char *name, uint64_t size, int64_t used, void *data)
+{
+	list_t **volumes = data;
+
+	ThinVolumeStats *volume = mem_new(ThinVolumeStats, 1);
+	thin_volume_stats__init(volume);
+	volume->name = mem_strdup(name);
+	volume->size = size;
+	if (used >= 0) {
+		volume->has_used = true;
+		volume->used = used;
+	}
+	*volumes = list_append(*volumes, volume);
+}
+
 /**
  * Handles a single decoded ControllerToDaemon message.
  *
@@ -923,28 +1059,24 @@ control_handle_message(control_t *control, const ControllerToDaemon *msg, int fd
 	case CONTROLLER_TO_DAEMON__COMMAND__LIST_CONTAINERS: {
 		// assemble list of relevant containers and allocate memory for result
 		size_t n = cmld_containers_get_count();
-		char **results = mem_new(char *, n);
+		char **results = mem_arena_calloc(control_arena, n, sizeof(char *));
 
 		// fill result with data from guestos
 		for (size_t i = 0; i < n; i++) {
 			container_t *container = cmld_container_get_by_index(i);
 			const char *uuid = uuid_string(container_get_uuid(container));
-			results[i] = mem_strdup(uuid);
+			results[i] = mem_arena_strdup(control_arena, uuid);
 		}
 
-		// build and send response message to controller
+		// build and send response message to controller,
+		// the result is released with the arena after the request
 		DaemonToController out = DAEMON_TO_CONTROLLER__INIT;
 		out.code = DAEMON_TO_CONTROLLER__CODE__CONTAINERS_LIST;
 		out.n_container_uuids = n;
 		out.container_uuids = results;
-		if (protobuf_send_message(fd, (ProtobufCMessage *)&out) < 0) {
+		if (protobuf_send_message_arena(fd, (ProtobufCMessage *)&out, control_arena) < 0) {
 			WARN("Could not send list of containers to MDM");
 		}
-
-		// collect garbage
-		for (size_t i = 0; i < n; i++)
-			mem_free0(results[i]);
-		mem_free0(results);
 	} break;
 
 	case CONTROLLER_TO_DAEMON__COMMAND__GET_CONTAINER_STATUS: {
@@ -952,28 +1084,25 @@ control_handle_message(control_t *control, const ControllerToDaemon *msg, int fd
 		list_t *containers = control_build_container_list_from_uuids(msg->n_container_uuids,
 									     msg->container_uuids);
 		size_t n = list_length(containers);
-		ContainerStatus **results = mem_new(ContainerStatus *, n);
+		ContainerStatus **results =
+			mem_arena_calloc(control_arena, n, sizeof(ContainerStatus *));
 
 		// fill result with data from container
-		for (size_t i = 0; i < n; i++) {
-			container_t *container = list_nth_data(containers, i);
-			results[i] = control_container_status_new(container);
-		}
+		size_t i = 0;
+		for (list_t *l = containers; l; l = l->next)
+			results[i++] = control_container_status_new(control_arena, l->data);
 
-		// build and send response message to controller
+		// build and send response message to controller,
+		// the result is released with the arena after the request
 		DaemonToController out = DAEMON_TO_CONTROLLER__INIT;
 		out.code = DAEMON_TO_CONTROLLER__CODE__CONTAINER_STATUS;
 		out.n_container_status = n;
 		out.container_status = results;
-		if (protobuf_send_message(fd, (ProtobufCMessage *)&out) < 0) {
+		if (protobuf_send_message_arena(fd, (ProtobufCMessage *)&out, control_arena) < 0) {
 			WARN("Could not send container status to MDM");
 		}
 
-		// collect garbage
 		list_delete(containers);
-		for (size_t i = 0; i < n; i++)
-			control_container_status_free(results[i]);
-		mem_free0(results);
 	} break;
 
 	case CONTROLLER_TO_DAEMON__COMMAND__GET_CONTAINER_CONFIG: {
@@ -1092,6 +1221,17 @@ control_handle_message(control_t *control, const ControllerToDaemon *msg, int fd
 		int dir_ret =
 			dir_foreach(LOGFILE_DIR, &control_send_file_as_log_message_cb, (void *)&fd);
 
+		// log stores are sent with their records decompressed and without indexes
+		list_t *stores = NULL;
+		if (dir_ret >= 0 &&
+		    dir_foreach(LOGFILE_DIR, &control_collect_logstores_cb, &stores) >= 0) {
+			for (list_t *l = stores; l; l = l->next)
+				dir_ret += control_send_logstore(&fd, l->data);
+		}
+		for (list_t *l = stores; l; l = l->next)
+			mem_free0(l->data);
+		list_delete(stores);
+
 		if (dir_ret < 0) {
 			WARN("Something went wrong during traversal of LOGFILE_DIR");
 		} else if (dir_ret > 0) {
@@ -1292,6 +1432,30 @@ control_handle_message(control_t *control, const ControllerToDaemon *msg, int fd
 			device_stats->mem_available = proc_get_mem_available(meminfo);
 		}
 
+		thinpool_stats_t thin_stats;
+		if (thinpool_get_stats(&thin_stats) == 0) {
+			device_stats->has_thin_pool_data = true;
+			device_stats->has_thin_pool_data_used = true;
+			device_stats->has_thin_pool_meta = true;
+			device_stats->has_thin_pool_meta_used = true;
+			device_stats->has_thin_pool_provisioned = true;
+			device_stats->thin_pool_data = thin_stats.data_size;
+			device_stats->thin_pool_data_used = thin_stats.data_used;
+			device_stats->thin_pool_meta = thin_stats.meta_size;
+			device_stats->thin_pool_meta_used = thin_stats.meta_used;
+			device_stats->thin_pool_provisioned = thin_stats.provisioned;
+
+			list_t *volumes = NULL;
+			thinpool_foreach_volume(&control_thin_volume_cb, &volumes);
+			device_stats->n_thin_volumes = list_length(volumes);
+			device_stats->thin_volumes =
+				mem_new(ThinVolumeStats *, device_stats->n_thin_volumes);
+			size_t i = 0;
+			for (list_t *l = volumes; l; l = l->next)
+				device_stats->thin_volumes[i++] = l->data;
+			list_delete(volumes);
+		}
+
 		out.device_stats = device_stats;
 
 		if (protobuf_send_message(fd, (ProtobufCMessage *)&out) < 0)
@@ -1442,6 +1606,13 @@ control_handle_message(control_t *control, const ControllerToDaemon *msg, int fd
 		}
 		break;
 
+	case CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_RESTART:
+		IF_NULL_RETURN(container);
+		res = cmld_container_restart(container);
+		control_send_message(res ? CONTROL_RESPONSE_CMD_FAILED : CONTROL_RESPONSE_CMD_OK,
+				     fd);
+		break;
+
 	case CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_FREEZE:
 		IF_NULL_RETURN(container);
 		res = cmld_container_freeze(container);
@@ -1467,6 +1638,23 @@ control_handle_message(control_t *control, const ControllerToDaemon *msg, int fd
 		control_send_message(res ? CONTROL_RESPONSE_CMD_FAILED : CONTROL_RESPONSE_CMD_OK,
 				     fd);
 		break;
+	case CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_SET_CPU_LIMITS: {
+		IF_NULL_RETURN(container);
+		if (!msg->container_cpu_limits) {
+			ERROR("Missing cpu limits");
+			control_send_message(CONTROL_RESPONSE_CMD_FAILED, fd);
+			break;
+		}
+		container_cpu_limits_t cpu_limits = {
+			.quota_us = msg->container_cpu_limits->quota_us,
+			.period_us = msg->container_cpu_limits->period_us,
+			.weight = msg->container_cpu_limits->weight,
+			.burst_us = msg->container_cpu_limits->burst_us,
+		};
+		res = cmld_container_set_cpu_limits(container, &cpu_limits);
+		control_send_message(res ? CONTROL_RESPONSE_CMD_FAILED : CONTROL_RESPONSE_CMD_OK,
+				     fd);
+	} break;
 	case CONTROLLER_TO_DAEMON__COMMAND__CONTAINER_WIPE:
 		IF_NULL_RETURN(container);
 		res = cmld_container_wipe(container);
@@ -1554,6 +1742,8 @@ control_handle_message(control_t *control, const ControllerToDaemon *msg, int fd
 			ERROR("Missing command or exec_pty info");
 			break;
 		}
+		if (container_wakeup(container) < 0)
+			WARN("Could not wake up container %s", container_get_name(container));
 		if (container_run(container, msg->exec_pty, msg->exec_command, msg->n_exec_args,
 				  msg->exec_args, fd) < 0) {
 			ERROR("Failed to exec");
@@ -1657,13 +1847,15 @@ control_cb_recv_message_local(int fd, unsigned events, event_io_t *io, void *dat
 	 * Thus, we have to read pending date before handling the EXCEPT event.
 	 */
 	if (events & EVENT_IO_READ) {
-		ControllerToDaemon *msg = (ControllerToDaemon *)protobuf_recv_message(
-			fd, &controller_to_daemon__descriptor);
+		ControllerToDaemon *msg = (ControllerToDaemon *)protobuf_recv_message_arena(
+			fd, &controller_to_daemon__descriptor, control_arena);
 		// close connection if client EOF, or protocol parse error
 		IF_NULL_GOTO_TRACE(msg, connection_err);
 		control_handle_message(control, msg, fd);
-		TRACE("Handled control connection %d", fd);
-		protobuf_free_message((ProtobufCMessage *)msg);
+		TRACE("Handled control connection %d (%zu bytes of request memory)", fd,
+		      mem_arena_get_used(control_arena));
+		// releases the message and everything allocated for the response at once
+		mem_arena_reset(control_arena);
 	}
 	// also check EXCEPT flag
 	if (events & EVENT_IO_EXCEPT) {
@@ -1673,6 +1865,7 @@ control_cb_recv_message_local(int fd, unsigned events, event_io_t *io, void *dat
 	return;
 
 connection_err:
+	mem_arena_reset(control_arena);
 	cmld_container_ctrl_with_input_abort();
 	event_remove_io(io);
 	event_io_free(io);
@@ -1725,6 +1918,13 @@ control_cb_accept(int fd, unsigned events, event_io_t *io, void *data)
 	event_add_io(event);
 }
 
+static void
+control_arena_free(void)
+{
+	mem_arena_free(control_arena);
+	control_arena = NULL;
+}
+
 control_t *
 control_new(int sock, bool privileged)
 {
@@ -1737,6 +1937,13 @@ control_new(int sock, bool privileged)
 	control->sock = sock;
 	control->privileged = privileged;
 
+	// shared by all control instances, requests are handled one at a time
+	if (!control_arena) {
+		control_arena = mem_arena_new(CONTROL_ARENA_CHUNK_SIZE);
+		if (atexit(&control_arena_free))
+			WARN("Could not register on exit cleanup method 'control_arena_free()'");
+	}
+
 	event_io_t *event = event_io_new(sock, EVENT_IO_READ, control_cb_accept, control);
 	event_add_io(event);
 
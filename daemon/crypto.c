@@ -128,6 +128,8 @@ crypto_verify_result_from_proto(TokenToDaemon__Code code)
 
 typedef struct crypto_callback_task {
 	crypto_hash_callback_t hash_complete;
+	crypto_hash_multi_callback_t hash_multi_complete;
+	size_t hash_algos_len;
 	crypto_hash_buf_callback_t hash_buf_complete;
 	crypto_verify_callback_t verify_complete;
 	crypto_verify_buf_callback_t verify_buf_complete;
@@ -159,6 +161,44 @@ crypto_callback_hash_task_new(crypto_hash_callback_t cb, void *data, const char
 	return task;
 }
 
+static crypto_callback_task_t *
+crypto_callback_hash_multi_task_new(crypto_hash_multi_callback_t cb, void *data,
+				    const char *hash_file, size_t hash_algos_len)
+{
+	crypto_callback_task_t *task = mem_new0(crypto_callback_task_t, 1);
+	task->hash_multi_complete = cb;
+	task->data = data;
+	task->hash_file = mem_strdup(hash_file);
+	task->hash_algos_len = hash_algos_len;
+	return task;
+}
+
+/*
+ * Reports the hash_values of a CRYPTO_HASH_OK response, or NULL hashes if msg
+ * is NULL, to the callback of a multi hash task.
+ */
+static void
+crypto_callback_hash_multi_complete(crypto_callback_task_t *task, const TokenToDaemon *msg)
+{
+	char **hashes = mem_new0(char *, task->hash_algos_len);
+
+	if (msg && msg->n_hash_values == task->hash_algos_len) {
+		for (size_t i = 0; i < task->hash_algos_len; ++i)
+			hashes[i] = convert_bin_to_hex_new(msg->hash_values[i].data,
+							   msg->hash_values[i].len);
+	} else if (msg) {
+		ERROR("Missing hash_values in CRYPTO_HASH_OK response!");
+	}
+
+	task->hash_multi_complete(hashes, task->hash_algos_len, task->hash_file, task->data);
+
+	for (size_t i = 0; i < task->hash_algos_len; ++i) {
+		if (hashes[i])
+			mem_free0(hashes[i]);
+	}
+	mem_free0(hashes);
+}
+
 static crypto_callback_task_t *
 crypto_callback_hash_buf_task_new(crypto_hash_buf_callback_t cb, void *data,
 				  const unsigned char *hash_buf, size_t hash_buf_len,
@@ -256,6 +296,10 @@ crypto_cb(int fd, unsigned events, event_io_t *io, void *data)
 		// deal with CRYPTO_HASH_* cases
 		case TOKEN_TO_DAEMON__CODE__CRYPTO_HASH_OK:
 			TRACE("Received HASH_OK message, ");
+			if (task->hash_multi_complete) {
+				crypto_callback_hash_multi_complete(task, msg);
+				break;
+			}
 			if (msg->has_hash_value) {
 				char *hash = convert_bin_to_hex_new(msg->hash_value.data,
 								    msg->hash_value.len);
@@ -271,7 +315,11 @@ crypto_cb(int fd, unsigned events, event_io_t *io, void *data)
 			}
 			ERROR("Missing hash_value in CRYPTO_HASH_OK response!"); // fallthrough
 		case TOKEN_TO_DAEMON__CODE__CRYPTO_HASH_ERROR:
-			task->hash_complete(NULL, task->hash_file, task->hash_algo, task->data);
+			if (task->hash_multi_complete)
+				crypto_callback_hash_multi_complete(task, NULL);
+			else
+				task->hash_complete(NULL, task->hash_file, task->hash_algo,
+						    task->data);
 			break;
 
 		// deal with CRYPTO_VERIFY_* cases
@@ -437,6 +485,38 @@ crypto_hash_file(const char *file, crypto_hashalgo_t hashalgo, crypto_hash_callb
 	return 0;
 }
 
+int
+crypto_hash_file_multi(const char *file, const crypto_hashalgo_t *hashalgos, size_t hashalgos_len,
+		       crypto_hash_multi_callback_t cb, void *data)
+{
+	ASSERT(file);
+	ASSERT(hashalgos);
+	ASSERT(hashalgos_len > 0);
+	ASSERT(cb);
+
+	crypto_callback_task_t *task =
+		crypto_callback_hash_multi_task_new(cb, data, file, hashalgos_len);
+
+	DaemonToToken out = DAEMON_TO_TOKEN__INIT;
+	out.code = DAEMON_TO_TOKEN__CODE__CRYPTO_HASH_FILE;
+	out.hash_file = task->hash_file;
+	out.n_hash_algos = hashalgos_len;
+	out.hash_algos = mem_new0(HashAlgo, hashalgos_len);
+	for (size_t i = 0; i < hashalgos_len; ++i)
+		out.hash_algos[i] = crypto_hashalgo_to_proto(hashalgos[i]);
+
+	TRACE("Requesting scd to hash file at %s with %zu algorithms", task->hash_file,
+	      hashalgos_len);
+
+	int ret = crypto_send_msg(&out, task);
+	mem_free0(out.hash_algos);
+	if (ret < 0) {
+		crypto_callback_task_free(task);
+		return -1;
+	}
+	return 0;
+}
+
 int
 crypto_hash_buf(const unsigned char *buf, size_t buf_len, crypto_hashalgo_t hashalgo,
 		crypto_hash_buf_callback_t cb, void *data)
@@ -57,6 +57,29 @@ int
 crypto_hash_file(const char *file, crypto_hashalgo_t hashalgo, crypto_hash_callback_t cb,
 		 void *data);
 
+/**
+ * Callback function for receiving the results of a hash operation with several
+ * hash algorithms. hash_strings holds the hashes in the order of the requested
+ * algorithms, or NULL entries if the file could not be hashed.
+ */
+typedef void (*crypto_hash_multi_callback_t)(char *const *hash_strings, size_t hash_strings_len,
+					     const char *hash_file, void *data);
+
+/**
+ * Requests the scd to hash the given file with several hash algorithms in a single
+ * pass and report the hashes to the given callback. Thus, the file is only read once.
+ *
+ * @param file the file to hash
+ * @param hashalgos array of the hash algorithms to use
+ * @param hashalgos_len number of entries in hashalgos
+ * @param cb the callback to receive the result
+ * @param data custom data parameter to pass to the callback
+ * @return 0 if the hash request was sent and the callback is expected to be called, -1 otherwise
+ */
+int
+crypto_hash_file_multi(const char *file, const crypto_hashalgo_t *hashalgos, size_t hashalgos_len,
+		       crypto_hash_multi_callback_t cb, void *data);
+
 /**
  * Requests the scd to hash the given buffer and report the hash to the given callback.
  *
@@ -250,3 +250,50 @@ device_config_get_audit_size(const device_config_t *config)
 
 	return config->cfg->audit_size;
 }
+
+const char *
+device_config_get_thin_pool_data(const device_config_t *config)
+{
+	ASSERT(config);
+	ASSERT(config->cfg);
+
+	const char *data = config->cfg->thin_pool_data;
+	return (data && *data) ? data : NULL;
+}
+
+uint64_t
+device_config_get_thin_pool_size(const device_config_t *config)
+{
+	ASSERT(config);
+	ASSERT(config->cfg);
+
+	return config->cfg->thin_pool_size;
+}
+
+uint32_t
+device_config_get_thin_pool_warn_percent(const device_config_t *config)
+{
+	ASSERT(config);
+	ASSERT(config->cfg);
+
+	return config->cfg->thin_pool_warn_percent;
+}
+
+uint64_t
+device_config_get_zram_size(const device_config_t *config)
+{
+	ASSERT(config);
+	ASSERT(config->cfg);
+
+	return config->cfg->zram_size;
+}
+
+const char *
+device_config_get_zram_algorithm(const device_config_t *config)
+{
+	ASSERT(config);
+	ASSERT(config->cfg);
+
+	const char *algorithm = config->cfg->zram_algorithm;
+	return (algorithm && *algorithm) ? algorithm : NULL;
+}
@@ -94,4 +94,30 @@ device_config_get_audit_size(const device_config_t *config);
 
 bool
 device_config_get_tpm_enabled(const device_config_t *config);
+
+/**
+ * Returns the block device or file of the thin pool for the data volumes of
+ * containers, or NULL if no thin pool is configured.
+ */
+const char *
+device_config_get_thin_pool_data(const device_config_t *config);
+
+uint64_t
+device_config_get_thin_pool_size(const device_config_t *config);
+
+uint32_t
+device_config_get_thin_pool_warn_percent(const device_config_t *config);
+
+/**
+ * Returns the size in MB of the zram swap device, 0 if none is configured.
+ */
+uint64_t
+device_config_get_zram_size(const device_config_t *config);
+
+/**
+ * Returns the compression algorithm of the zram swap device, or NULL for the
+ * kernel default.
+ */
+const char *
+device_config_get_zram_algorithm(const device_config_t *config);
 #endif /* DEVICE_H */
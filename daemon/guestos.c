@@ -192,38 +192,24 @@ check_mount_image_free(check_mount_image_t *task)
 	mem_free0(task);
 }
 
+// both hashes of an image are computed in one pass over the image file
+static const crypto_hashalgo_t check_mount_image_hash_algos[] = { SHA1, SHA256 };
+
 static void
-check_mount_image_cb_sha256(const char *hash_string, UNUSED const char *hash_file,
-			    UNUSED crypto_hashalgo_t hash_algo, void *data)
+check_mount_image_cb_hashes(char *const *hash_strings, UNUSED size_t hash_strings_len,
+			    UNUSED const char *hash_file, void *data)
 {
 	check_mount_image_t *task = data;
 	ASSERT(task);
 
-	bool match = mount_entry_match_sha256(task->e, hash_string);
+	bool match = mount_entry_match_sha1(task->e, hash_strings[0]) &&
+		     mount_entry_match_sha256(task->e, hash_strings[1]);
 	task->cb(match ? CHECK_IMAGE_GOOD : CHECK_IMAGE_HASH_MISMATCH, task->os, task->e,
 		 task->data);
 
 	check_mount_image_free(task);
 }
 
-static void
-check_mount_image_cb_sha1(const char *hash_string, UNUSED const char *hash_file,
-			  UNUSED crypto_hashalgo_t hash_algo, void *data)
-{
-	check_mount_image_t *task = data;
-	ASSERT(task);
-
-	bool match = mount_entry_match_sha1(task->e, hash_string);
-	if (match) {
-		// compute next hash
-		crypto_hash_file(task->img_path, SHA256, check_mount_image_cb_sha256, task);
-		return;
-	}
-	task->cb(CHECK_IMAGE_HASH_MISMATCH, task->os, task->e, task->data);
-
-	check_mount_image_free(task);
-}
-
 static uint8_t *
 convert_hex_to_bin_new(const char *hex_str, int *out_length)
 {
@@ -378,7 +364,14 @@ guestos_check_mount_image(guestos_t *os, mount_entry_t *e, check_mount_image_com
 	DEBUG("Checking image %s (thorough, non-blocking)", img_path);
 
 	check_mount_image_t *task = check_mount_image_new(os, e, img_path, cb, data);
-	crypto_hash_file(img_path, SHA1, check_mount_image_cb_sha1, task);
+	if (crypto_hash_file_multi(img_path, check_mount_image_hash_algos,
+				   sizeof(check_mount_image_hash_algos) /
+					   sizeof(check_mount_image_hash_algos[0]),
+				   check_mount_image_cb_hashes, task) < 0) {
+		ERROR("Could not request hashes of image %s", img_path);
+		check_mount_image_free(task);
+		cb(CHECK_IMAGE_ERROR, os, e, data);
+	}
 
 	mem_free0(img_path);
 }
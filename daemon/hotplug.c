@@ -659,6 +659,7 @@ hotplug_handle_usb_device(unsigned actions, uevent_event_t *event)
 				container_device_allow(mapping->container, 'c',
 						       mapping->usbdev->major,
 						       mapping->usbdev->minor, mapping->assign);
+				container_wakeup(mapping->container);
 			}
 		}
 		mem_free0(serial);
@@ -32,6 +32,7 @@
 #include "common/event.h"
 #include "common/file.h"
 #include "common/logf.h"
+#include "common/logstore.h"
 
 #include "cmld.h"
 #include "hardware.h"
@@ -48,7 +49,7 @@
 #include <string.h>
 
 logf_handler_t *cml_daemon_logfile_handler = NULL;
-static void *main_logfile_p = NULL;
+static logstore_t *main_logstore = NULL;
 static bool is_handling_sigint = false;
 
 /******************************************************************************/
@@ -86,25 +87,14 @@ main_sigterm_cb(UNUSED int signum, UNUSED event_signal_t *sig, UNUSED void *data
 		ERROR("Could not stop all containers");
 }
 
-static void
-main_logfile_rename_cb(UNUSED event_timer_t *timer, UNUSED void *data)
-{
-	DEBUG("Logfile will be closed and a new file opened");
-	logf_unregister(cml_daemon_logfile_handler);
-	logf_file_close(main_logfile_p);
-
-	main_logfile_p = logf_file_new(LOGFILE_DIR "/cml-daemon");
-	cml_daemon_logfile_handler = logf_register(&logf_file_write, main_logfile_p);
-	logf_handler_set_prio(cml_daemon_logfile_handler, LOGF_PRIO_TRACE);
-}
-
 static void INIT
 main_init(void)
 {
 	logf_register(&logf_file_write, stdout);
 
-	main_logfile_p = logf_file_new(LOGFILE_DIR "/cml-daemon");
-	cml_daemon_logfile_handler = logf_register(&logf_file_write, main_logfile_p);
+	main_logstore = logstore_new(LOGFILE_DIR, "cml-daemon", LOGSTORE_SEGMENT_SIZE_DEFAULT,
+				     LOGSTORE_SEGMENT_AGE_DEFAULT, LOGSTORE_BUDGET_DEFAULT);
+	cml_daemon_logfile_handler = logf_register(&logstore_write, main_logstore);
 	logf_handler_set_prio(cml_daemon_logfile_handler, LOGF_PRIO_TRACE);
 
 	main_core_dump_enable();
@@ -134,11 +124,6 @@ main(int argc, char **argv)
 	event_add_signal(sig_term);
 
 	DEBUG("Initializing cmld...");
-	event_timer_t *logfile_timer =
-		event_timer_new(HOURS_TO_MILLISECONDS(24), EVENT_TIMER_REPEAT_FOREVER,
-				main_logfile_rename_cb, NULL);
-	event_add_timer(logfile_timer);
-
 	if (cmld_init(path) < 0)
 		FATAL("Could not init cmld");
 
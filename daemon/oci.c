@@ -524,7 +524,7 @@ oci_container_new(const char *store_path, const char *peer_path, const char *bun
 			  ram_limit, cpus_allowed, color, allow_autostart, dns_server,
 			  pnet_cfg_list, allowed_devices, assigned_devices, vnet_cfg_list,
 			  usbdev_list, init, init_argv, init_env, init_env_len, fifo_list, ttype,
-			  usb_pin_entry);
+			  usb_pin_entry, 0, NULL);
 
 	if (c) {
 		DEBUG("Loaded oci config for container %s", container_get_name(c));
@@ -0,0 +1,491 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+//#define LOGF_LOG_MIN_PRIO LOGF_PRIO_TRACE
+
+#define _LARGEFILE64_SOURCE
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "thinpool.h"
+
+#include "common/macro.h"
+#include "common/mem.h"
+#include "common/dir.h"
+#include "common/dm.h"
+#include "common/event.h"
+#include "common/file.h"
+#include "common/loopdev.h"
+#include "common/thin.h"
+
+#include "audit.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define THINPOOL_NAME "cml-thinpool"
+#define THINPOOL_META_IMG "thinpool.meta.img"
+#define THINPOOL_VOLUMES_DIR "thinpool"
+
+// allocation block size of 64 KiB in 512 byte sectors
+#define THINPOOL_BLOCK_SECTORS 128
+#define THINPOOL_META_BLOCK_SIZE 4096
+
+// metadata size recommended by thin_metadata_size for the block size with some margin
+#define THINPOOL_META_BYTES_PER_BLOCK 64
+#define THINPOOL_META_SIZE_MIN (2 * 1024 * 1024ULL)
+#define THINPOOL_META_SIZE_MAX (16 * 1024 * 1024 * 1024ULL)
+
+#define THINPOOL_MONITOR_INTERVAL 30000
+
+// registry entries younger than this may belong to a volume which is set up right now
+#define THINPOOL_GC_GRACE_SECS 300
+
+typedef struct thinpool_volume {
+	uint32_t id;
+	uint64_t size;
+	char id_file[PATH_MAX];
+	char name[DM_NAME_LEN];
+} thinpool_volume_t;
+
+static char *thinpool_volumes_dir = NULL;
+static unsigned int thinpool_warn_percent = 0;
+static event_timer_t *thinpool_timer = NULL;
+
+// avoid flooding the audit log with the same condition on each check
+static bool thinpool_low_space_reported = false;
+static bool thinpool_failure_reported = false;
+
+static int
+thinpool_create_sparse_file(const char *file, uint64_t size)
+{
+	INFO("Creating sparse file %s with %" PRIu64 " bytes for thin pool", file, size);
+
+	int fd = open(file, O_LARGEFILE | O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (fd < 0) {
+		ERROR_ERRNO("Could not create %s", file);
+		return -1;
+	}
+	if (ftruncate64(fd, size) < 0) {
+		ERROR_ERRNO("Could not ftruncate %s", file);
+		close(fd);
+		unlink(file);
+		return -1;
+	}
+	close(fd);
+	return 0;
+}
+
+static int
+thinpool_create(const char *path, const char *data_path, uint64_t data_size)
+{
+	int ret = -1;
+	int data_fd = -1, meta_fd = -1;
+	char *data_dev = NULL, *meta_dev = NULL;
+	char *meta_img = mem_printf("%s/%s", path, THINPOOL_META_IMG);
+
+	if (file_is_blk(data_path)) {
+		data_dev = mem_strdup(data_path);
+		data_fd = open(data_dev, O_RDONLY | O_CLOEXEC);
+		IF_TRUE_GOTO_ERROR(data_fd < 0, out);
+	} else {
+		if (!file_exists(data_path)) {
+			IF_TRUE_GOTO_ERROR(data_size == 0, out);
+			IF_TRUE_GOTO(thinpool_create_sparse_file(data_path,
+								 data_size * 1024 * 1024),
+				     out);
+			// the metadata of a previous pool does not match the new data file
+			if (file_exists(meta_img) && unlink(meta_img) < 0)
+				WARN_ERRNO("Could not remove stale %s", meta_img);
+		}
+		data_dev = loopdev_create_new(&data_fd, data_path, 0, 0);
+		IF_NULL_GOTO_ERROR(data_dev, out);
+	}
+
+	uint64_t data_blocks = dm_get_blkdev_size64(data_fd) / 512 / THINPOOL_BLOCK_SECTORS;
+	IF_TRUE_GOTO_ERROR(data_blocks == 0, out);
+
+	if (!file_exists(meta_img)) {
+		uint64_t meta_size = data_blocks * THINPOOL_META_BYTES_PER_BLOCK;
+		meta_size = MAX(meta_size, THINPOOL_META_SIZE_MIN);
+		meta_size = MIN(meta_size, THINPOOL_META_SIZE_MAX);
+		meta_size -= meta_size % THINPOOL_META_BLOCK_SIZE;
+		// a zeroed metadata device is formatted by the kernel
+		IF_TRUE_GOTO(thinpool_create_sparse_file(meta_img, meta_size), out);
+	}
+	meta_dev = loopdev_create_new(&meta_fd, meta_img, 0, 0);
+	IF_NULL_GOTO_ERROR(meta_dev, out);
+
+	uint64_t low_water = data_blocks * (100 - MIN(thinpool_warn_percent, 100)) / 100;
+	ret = thin_pool_create(THINPOOL_NAME, meta_dev, data_dev,
+			       data_blocks * THINPOOL_BLOCK_SECTORS, THINPOOL_BLOCK_SECTORS,
+			       low_water);
+	if (ret == 0)
+		INFO("Created thin pool on %s (%s) with %" PRIu64 " blocks of %d sectors",
+		     data_path, data_dev, data_blocks, THINPOOL_BLOCK_SECTORS);
+
+out:
+	// release fds of loop devices (the pool keeps them open now)
+	if (data_fd >= 0)
+		close(data_fd);
+	if (meta_fd >= 0)
+		close(meta_fd);
+	mem_free0(data_dev);
+	mem_free0(meta_dev);
+	mem_free0(meta_img);
+	return ret;
+}
+
+/*
+ * Reads the registry entry of a volume, which consists of
+ * '<size> <id file> <device-mapper name>'.
+ */
+static int
+thinpool_volume_read(uint32_t id, thinpool_volume_t *volume)
+{
+	char *entry = mem_printf("%s/%" PRIu32, thinpool_volumes_dir, id);
+	char *content = file_read_new(entry, PATH_MAX + DM_NAME_LEN + 32);
+	mem_free0(entry);
+	IF_NULL_RETVAL(content, -1);
+
+	mem_memset(volume, 0, sizeof(thinpool_volume_t));
+	volume->id = id;
+	int n = sscanf(content, "%" SCNu64 " %4095s %127s", &volume->size, volume->id_file,
+		       volume->name);
+	mem_free0(content);
+
+	if (n != 3) {
+		WARN("Invalid registry entry for thin volume %" PRIu32, id);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Allocates a free id for a new volume by exclusively creating its registry
+ * entry, which also works for concurrent allocations in forked children.
+ */
+static int
+thinpool_volume_alloc(const char *id_file, const char *name, uint64_t size, uint32_t *id)
+{
+	for (uint32_t i = 1; i <= THIN_DEV_ID_MAX; i++) {
+		char *entry = mem_printf("%s/%" PRIu32, thinpool_volumes_dir, i);
+		int fd = open(entry, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+		if (fd < 0) {
+			mem_free0(entry);
+			if (errno == EEXIST)
+				continue;
+			ERROR_ERRNO("Could not create registry entry for thin volume");
+			return -1;
+		}
+		close(fd);
+
+		int ret = file_printf(entry, "%" PRIu64 " %s %s\n", size, id_file, name);
+		if (ret < 0 || file_printf(id_file, "%" PRIu32 "\n", i) < 0 ||
+		    thin_pool_create_volume(THINPOOL_NAME, i) < 0) {
+			ERROR("Could not allocate thin volume %s", name);
+			unlink(id_file);
+			unlink(entry);
+			mem_free0(entry);
+			return -1;
+		}
+
+		mem_free0(entry);
+		*id = i;
+		return 0;
+	}
+
+	ERROR("No free thin volume id left");
+	return -1;
+}
+
+static int
+thinpool_sum_provisioned_cb(UNUSED const char *path, const char *file, void *data)
+{
+	uint64_t *provisioned = data;
+	thinpool_volume_t volume;
+
+	IF_TRUE_RETVAL(thinpool_volume_read(strtoul(file, NULL, 10), &volume), 0);
+	*provisioned += volume.size;
+	return 0;
+}
+
+static uint64_t
+thinpool_get_provisioned(void)
+{
+	uint64_t provisioned = 0;
+	if (dir_foreach(thinpool_volumes_dir, &thinpool_sum_provisioned_cb, &provisioned) < 0)
+		WARN("Could not read thin volume registry");
+	return provisioned;
+}
+
+char *
+thinpool_volume_setup_new(const char *id_file, const char *name, uint64_t size, bool *created)
+{
+	ASSERT(id_file);
+	ASSERT(name);
+	IF_NULL_RETVAL_ERROR(thinpool_volumes_dir, NULL);
+
+	uint32_t id = 0;
+	thinpool_volume_t volume;
+	bool new_volume = false;
+
+	if (file_exists(id_file)) {
+		char *content = file_read_new(id_file, 32);
+		IF_NULL_RETVAL_ERROR(content, NULL);
+		id = strtoul(content, NULL, 10);
+		mem_free0(content);
+
+		IF_TRUE_RETVAL_ERROR(thinpool_volume_read(id, &volume), NULL);
+		if (strcmp(volume.id_file, id_file)) {
+			ERROR("Thin volume %" PRIu32 " is registered for %s, not for %s", id,
+			      volume.id_file, id_file);
+			return NULL;
+		}
+		size = volume.size;
+	} else {
+		IF_TRUE_RETVAL(thinpool_volume_alloc(id_file, name, size, &id), NULL);
+		new_volume = true;
+
+		thinpool_stats_t stats;
+		if (thinpool_get_stats(&stats) == 0 && stats.provisioned > stats.data_size)
+			INFO("Thin pool is overcommitted: %" PRIu64 " MB provisioned on %" PRIu64
+			     " MB",
+			     stats.provisioned / (1024 * 1024), stats.data_size / (1024 * 1024));
+	}
+
+	if (!thin_device_exists(name) &&
+	    thin_volume_activate(name, THINPOOL_NAME, id, size / 512) < 0) {
+		ERROR("Could not activate thin volume %" PRIu32 " as %s", id, name);
+		return NULL;
+	}
+
+	DEBUG("Using thin volume %" PRIu32 " as %s for %s", id, name, id_file);
+	if (created)
+		*created = new_volume;
+	return thin_get_device_path_new(name);
+}
+
+void
+thinpool_volume_release(const char *name)
+{
+	ASSERT(name);
+
+	if (thin_device_exists(name) && thin_device_remove(name) < 0)
+		WARN("Could not release thin volume %s", name);
+}
+
+/*
+ * Releases volumes to the pool whose id file has been removed.
+ */
+static int
+thinpool_gc_cb(const char *path, const char *file, UNUSED void *data)
+{
+	thinpool_volume_t volume;
+	IF_TRUE_RETVAL(thinpool_volume_read(strtoul(file, NULL, 10), &volume), 0);
+
+	if (file_exists(volume.id_file))
+		return 0;
+
+	char *entry = mem_printf("%s/%s", path, file);
+	struct stat s;
+	if (stat(entry, &s) < 0 || time(NULL) - s.st_mtime < THINPOOL_GC_GRACE_SECS)
+		goto out;
+
+	// an active volume is rejected by the kernel
+	if (thin_pool_delete_volume(THINPOOL_NAME, volume.id) < 0) {
+		WARN("Could not delete orphaned thin volume %" PRIu32 " (%s)", volume.id,
+		     volume.name);
+		goto out;
+	}
+	INFO("Deleted orphaned thin volume %" PRIu32 " (%s)", volume.id, volume.name);
+	if (unlink(entry) < 0)
+		WARN_ERRNO("Could not remove registry entry %s", entry);
+out:
+	mem_free0(entry);
+	return 0;
+}
+
+static void
+thinpool_monitor_cb(UNUSED event_timer_t *timer, UNUSED void *data)
+{
+	thin_pool_status_t status;
+	if (thin_pool_get_status(THINPOOL_NAME, &status) < 0) {
+		WARN("Could not get status of thin pool");
+		return;
+	}
+
+	if (status.failed || status.read_only || status.out_of_space || status.needs_check) {
+		if (!thinpool_failure_reported) {
+			ERROR("Thin pool is %s",
+			      status.failed ?
+				      "failed" :
+				      status.out_of_space ?
+				      "out of data space" :
+				      status.needs_check ? "in need of a check" : "read-only");
+			audit_log_event(NULL, FSA, CMLD, GENERIC, "thinpool-failure", NULL, 0);
+			thinpool_failure_reported = true;
+		}
+	} else {
+		thinpool_failure_reported = false;
+	}
+
+	unsigned int data_percent =
+		status.data_total ? status.data_used * 100 / status.data_total : 0;
+	unsigned int meta_percent =
+		status.meta_total ? status.meta_used * 100 / status.meta_total : 0;
+	unsigned int percent = MAX(data_percent, meta_percent);
+
+	if (percent >= thinpool_warn_percent) {
+		if (!thinpool_low_space_reported) {
+			WARN("Thin pool usage reached %u%% (data %u%%, metadata %u%%)", percent,
+			     data_percent, meta_percent);
+			char *used = mem_printf("%u", percent);
+			audit_log_event(NULL, FSA, CMLD, GENERIC, "thinpool-low-space", NULL, 2,
+					"used", used);
+			mem_free0(used);
+			thinpool_low_space_reported = true;
+		}
+	} else {
+		thinpool_low_space_reported = false;
+	}
+
+	if (dir_foreach(thinpool_volumes_dir, &thinpool_gc_cb, NULL) < 0)
+		WARN("Could not read thin volume registry");
+}
+
+int
+thinpool_init(const char *path, const char *data_path, uint64_t data_size,
+	      unsigned int warn_percent)
+{
+	ASSERT(path);
+	ASSERT(data_path);
+
+	thinpool_warn_percent = warn_percent;
+
+	char *volumes_dir = mem_printf("%s/%s", path, THINPOOL_VOLUMES_DIR);
+	if (dir_mkdir_p(volumes_dir, 0700) < 0) {
+		ERROR_ERRNO("Could not create %s", volumes_dir);
+		mem_free0(volumes_dir);
+		return -1;
+	}
+
+	if (thin_device_exists(THINPOOL_NAME)) {
+		INFO("Reusing active thin pool %s", THINPOOL_NAME);
+	} else if (thinpool_create(path, data_path, data_size) < 0) {
+		ERROR("Could not create thin pool on %s", data_path);
+		mem_free0(volumes_dir);
+		return -1;
+	}
+
+	thinpool_volumes_dir = volumes_dir;
+
+	// check usage and release orphaned volumes now and then periodically
+	thinpool_monitor_cb(NULL, NULL);
+	thinpool_timer = event_timer_new(THINPOOL_MONITOR_INTERVAL, EVENT_TIMER_REPEAT_FOREVER,
+					 &thinpool_monitor_cb, NULL);
+	event_add_timer(thinpool_timer);
+
+	return 0;
+}
+
+void
+thinpool_cleanup(void)
+{
+	if (thinpool_timer) {
+		event_remove_timer(thinpool_timer);
+		event_timer_free(thinpool_timer);
+		thinpool_timer = NULL;
+	}
+	mem_free0(thinpool_volumes_dir);
+}
+
+bool
+thinpool_is_active(void)
+{
+	return thinpool_volumes_dir != NULL;
+}
+
+int
+thinpool_get_stats(thinpool_stats_t *stats)
+{
+	ASSERT(stats);
+	IF_NULL_RETVAL(thinpool_volumes_dir, -1);
+
+	thin_pool_status_t status;
+	IF_TRUE_RETVAL(thin_pool_get_status(THINPOOL_NAME, &status), -1);
+	IF_TRUE_RETVAL(status.failed, -1);
+
+	stats->data_size = status.data_total * THINPOOL_BLOCK_SECTORS * 512;
+	stats->data_used = status.data_used * THINPOOL_BLOCK_SECTORS * 512;
+	stats->meta_size = status.meta_total * THINPOOL_META_BLOCK_SIZE;
+	stats->meta_used = status.meta_used * THINPOOL_META_BLOCK_SIZE;
+	stats->provisioned = thinpool_get_provisioned();
+
+	return 0;
+}
+
+typedef struct thinpool_foreach_data {
+	thinpool_volume_cb_t func;
+	void *data;
+} thinpool_foreach_data_t;
+
+static int
+thinpool_foreach_volume_cb(UNUSED const char *path, const char *file, void *data)
+{
+	thinpool_foreach_data_t *foreach = data;
+	thinpool_volume_t volume;
+
+	IF_TRUE_RETVAL(thinpool_volume_read(strtoul(file, NULL, 10), &volume), 0);
+
+	int64_t used = -1;
+	if (thin_device_exists(volume.name)) {
+		int64_t mapped = thin_volume_get_mapped_sectors(volume.name);
+		used = mapped < 0 ? -1 : mapped * 512;
+	}
+
+	foreach
+		->func(volume.name, volume.size, used, foreach->data);
+	return 0;
+}
+
+void
+thinpool_foreach_volume(thinpool_volume_cb_t func, void *data)
+{
+	ASSERT(func);
+	IF_NULL_RETURN(thinpool_volumes_dir);
+
+	thinpool_foreach_data_t foreach = { .func = func, .data = data };
+	if (dir_foreach(thinpool_volumes_dir, &thinpool_foreach_volume_cb, &foreach) < 0)
+		WARN("Could not read thin volume registry");
+}
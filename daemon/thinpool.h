@@ -0,0 +1,122 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+/**
+ * @file thinpool.h
+ *
+ * Optional storage backend which allocates the writable data volumes of the
+ * containers from a single dm-thin pool on a dedicated partition or large file,
+ * instead of a sparse image file per volume.
+ *
+ * A volume is referenced by a small id file '<image>.thin' in the images
+ * directory of its container, which holds the id of the volume inside the pool.
+ * The pool keeps a registry of all allocated volumes, so that volumes whose id
+ * file was removed, e.g., by wiping the container, are released to the pool.
+ *
+ * Volumes in the pool are encrypted without dm-integrity, as its tags have to
+ * be initialized by writing the whole volume, which defeats overcommitting.
+ */
+
+#ifndef THINPOOL_H
+#define THINPOOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct thinpool_stats {
+	uint64_t data_size;   // size of the data device in bytes
+	uint64_t data_used;   // allocated bytes of the data device
+	uint64_t meta_size;   // size of the metadata device in bytes
+	uint64_t meta_used;   // used bytes of the metadata device
+	uint64_t provisioned; // sum of the virtual sizes of all volumes in bytes
+} thinpool_stats_t;
+
+/**
+ * Callback for thinpool_foreach_volume().
+ *
+ * @param name The device-mapper name of the volume
+ * @param size The virtual size of the volume in bytes
+ * @param used The allocated bytes of the volume or -1 if it is not active
+ */
+typedef void (*thinpool_volume_cb_t)(const char *name, uint64_t size, int64_t used, void *data);
+
+/**
+ * Sets up the thin pool, or reuses it if it is still active from a previous run,
+ * and starts monitoring its usage.
+ *
+ * @param path Directory for the metadata of the pool and the volume registry.
+ * @param data_path Block device or file holding the data of the pool.
+ * @param data_size Size in MB of the file, if it has to be created.
+ * @param warn_percent Data or metadata usage in percent from which on a warning is audited.
+ * @return 0 on success, -1 on error.
+ */
+int
+thinpool_init(const char *path, const char *data_path, uint64_t data_size,
+	      unsigned int warn_percent);
+
+/**
+ * Stops monitoring the pool. The pool device is kept active.
+ */
+void
+thinpool_cleanup(void);
+
+/**
+ * Returns true if the pool is set up and new volumes are allocated from it.
+ */
+bool
+thinpool_is_active(void);
+
+/**
+ * Activates the volume referenced by id_file. If id_file does not exist, a new
+ * empty volume is allocated in the pool first.
+ *
+ * @param id_file The id file of the volume.
+ * @param name The device-mapper name for the volume.
+ * @param size The virtual size of a new volume in bytes.
+ * @param created Set to true if a new volume was allocated.
+ * @return The path of the volume's block device or NULL on error.
+ */
+char *
+thinpool_volume_setup_new(const char *id_file, const char *name, uint64_t size, bool *created);
+
+/**
+ * Deactivates a volume. Its data is kept inside the pool.
+ */
+void
+thinpool_volume_release(const char *name);
+
+/**
+ * Returns the usage of the pool.
+ *
+ * @return 0 on success, -1 if the pool is not active or its status is unavailable.
+ */
+int
+thinpool_get_stats(thinpool_stats_t *stats);
+
+/**
+ * Calls func for each volume allocated in the pool.
+ */
+void
+thinpool_foreach_volume(thinpool_volume_cb_t func, void *data);
+
+#endif /* THINPOOL_H */
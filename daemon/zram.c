@@ -0,0 +1,256 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+//#define LOGF_LOG_MIN_PRIO LOGF_PRIO_TRACE
+
+#define _GNU_SOURCE
+
+#include "zram.h"
+
+#include "common/macro.h"
+#include "common/mem.h"
+#include "common/file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/swap.h>
+#include <sys/sysmacros.h>
+
+#define ZRAM_HOT_ADD "/sys/class/zram-control/hot_add"
+#define ZRAM_SYSFS_FMT "/sys/block/zram%d/%s"
+#define ZRAM_DEV_FMT "/dev/zram%d"
+
+// prefer the zram device to swap on disk, which gets negative priorities by default
+#define ZRAM_SWAP_PRIO 100
+
+#define ZRAM_SWAP_MAGIC "SWAPSPACE2"
+#define ZRAM_SWAP_VERSION 1
+
+/*
+ * Header in the first page of a swap device as written by mkswap, the magic is
+ * stored in the last bytes of that page.
+ */
+struct zram_swap_header {
+	char bootbits[1024];
+	uint32_t version;
+	uint32_t last_page;
+	uint32_t nr_badpages;
+	unsigned char uuid[16];
+	unsigned char volume_name[16];
+};
+
+static int zram_id = -1;
+
+static char *
+zram_sysfs_path_new(int id, const char *attr)
+{
+	return mem_printf(ZRAM_SYSFS_FMT, id, attr);
+}
+
+/*
+ * Returns the id of a zram device which is already used as swap,
+ * e.g., by a previous run of cmld, or -1.
+ */
+static int
+zram_get_active_swap(void)
+{
+	char *swaps = file_read_new("/proc/swaps", 4096);
+	IF_NULL_RETVAL(swaps, -1);
+
+	int id = -1;
+	char *saveptr = NULL;
+	for (char *line = strtok_r(swaps, "\n", &saveptr); line;
+	     line = strtok_r(NULL, "\n", &saveptr)) {
+		if (sscanf(line, ZRAM_DEV_FMT, &id) == 1)
+			break;
+		id = -1;
+	}
+	mem_free0(swaps);
+	return id;
+}
+
+/*
+ * Creates the device node of the zram device, if it is not created by
+ * udev or mdev.
+ */
+static char *
+zram_create_device_node_new(int id)
+{
+	char *device = mem_printf(ZRAM_DEV_FMT, id);
+	IF_TRUE_RETVAL(file_exists(device), device);
+
+	char *dev_path = zram_sysfs_path_new(id, "dev");
+	char *dev = file_read_new(dev_path, 64);
+	mem_free0(dev_path);
+
+	unsigned int major, minor;
+	if (!dev || sscanf(dev, "%u:%u", &major, &minor) != 2) {
+		ERROR("Cannot get device number of %s", device);
+		goto error;
+	}
+	if (mknod(device, S_IFBLK | 0600, makedev(major, minor)) != 0 && errno != EEXIST) {
+		ERROR_ERRNO("Cannot mknod device %s", device);
+		goto error;
+	}
+	mem_free0(dev);
+	return device;
+error:
+	mem_free0(dev);
+	mem_free0(device);
+	return NULL;
+}
+
+static int
+zram_mkswap(const char *device, uint64_t size)
+{
+	long page_size = sysconf(_SC_PAGESIZE);
+	uint64_t pages = size / page_size;
+	IF_TRUE_RETVAL_ERROR(pages < 2 || pages - 1 > UINT32_MAX, -1);
+
+	char *page = mem_new0(char, page_size);
+	struct zram_swap_header *header = (struct zram_swap_header *)page;
+	header->version = ZRAM_SWAP_VERSION;
+	header->last_page = pages - 1;
+	memcpy(page + page_size - strlen(ZRAM_SWAP_MAGIC), ZRAM_SWAP_MAGIC,
+	       strlen(ZRAM_SWAP_MAGIC));
+
+	int ret = -1;
+	int fd = open(device, O_WRONLY | O_CLOEXEC);
+	if (fd < 0) {
+		ERROR_ERRNO("Cannot open %s", device);
+		goto out;
+	}
+	if (pwrite(fd, page, page_size, 0) != page_size) {
+		ERROR_ERRNO("Cannot write swap header to %s", device);
+		goto out;
+	}
+	ret = 0;
+out:
+	if (fd >= 0)
+		close(fd);
+	mem_free0(page);
+	return ret;
+}
+
+int
+zram_init(uint64_t size, const char *algorithm)
+{
+	IF_TRUE_RETVAL_ERROR(size == 0, -1);
+
+	int id = zram_get_active_swap();
+	if (id >= 0) {
+		INFO("Reusing active zram swap device " ZRAM_DEV_FMT, id);
+		zram_id = id;
+		return 0;
+	}
+
+	if (!file_exists(ZRAM_HOT_ADD)) {
+		ERROR("%s not found, zram not supported by the kernel?", ZRAM_HOT_ADD);
+		return -1;
+	}
+
+	// reading hot_add allocates a new device and returns its id
+	char *hot_add = file_read_new(ZRAM_HOT_ADD, 64);
+	if (!hot_add || sscanf(hot_add, "%d", &id) != 1) {
+		ERROR("Cannot add zram device");
+		mem_free0(hot_add);
+		return -1;
+	}
+	mem_free0(hot_add);
+
+	char *device = NULL;
+	char *attr = NULL;
+
+	// the algorithm has to be selected before the size
+	if (algorithm) {
+		attr = zram_sysfs_path_new(id, "comp_algorithm");
+		if (file_printf(attr, "%s", algorithm) < 0)
+			WARN("Cannot set compression algorithm %s of zram device, using default",
+			     algorithm);
+		mem_free0(attr);
+	}
+
+	attr = zram_sysfs_path_new(id, "disksize");
+	if (file_printf(attr, "%" PRIu64 "M", size) < 0) {
+		ERROR("Cannot set size of zram device to %" PRIu64 " MB", size);
+		goto error;
+	}
+
+	IF_NULL_GOTO(device = zram_create_device_node_new(id), error);
+	IF_TRUE_GOTO(zram_mkswap(device, size * 1024 * 1024), error);
+
+	if (swapon(device, SWAP_FLAG_PREFER | ((ZRAM_SWAP_PRIO << SWAP_FLAG_PRIO_SHIFT) &
+					       SWAP_FLAG_PRIO_MASK)) < 0) {
+		ERROR_ERRNO("Cannot enable swap on %s", device);
+		goto error;
+	}
+
+	INFO("Enabled zram swap device %s with %" PRIu64 " MB", device, size);
+	zram_id = id;
+	mem_free0(device);
+	mem_free0(attr);
+	return 0;
+
+error:
+	mem_free0(device);
+	mem_free0(attr);
+	// release the device again
+	if (file_printf("/sys/class/zram-control/hot_remove", "%d", id) < 0)
+		WARN("Cannot remove zram device %d", id);
+	return -1;
+}
+
+bool
+zram_is_active(void)
+{
+	return zram_id >= 0;
+}
+
+int
+zram_get_stats(zram_stats_t *stats)
+{
+	ASSERT(stats);
+	IF_FALSE_RETVAL(zram_is_active(), -1);
+
+	char *attr = zram_sysfs_path_new(zram_id, "mm_stat");
+	char *mm_stat = file_read_new(attr, 256);
+	mem_free0(attr);
+	IF_NULL_RETVAL(mm_stat, -1);
+
+	// orig_data_size compr_data_size mem_used_total mem_limit ...
+	unsigned long long orig, compr, used;
+	int n = sscanf(mm_stat, "%llu %llu %llu", &orig, &compr, &used);
+	mem_free0(mm_stat);
+	IF_TRUE_RETVAL(n != 3, -1);
+
+	stats->orig_data_size = orig;
+	stats->compr_data_size = compr;
+	stats->mem_used_total = used;
+	return 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+/**
+ * @file zram.h
+ *
+ * Optional compressed swap device in RAM. Cold anonymous memory of containers
+ * is swapped out to the zram device and kept compressed, instead of the
+ * containers being OOM killed at their RAM limit. How much of it a container
+ * may use is limited by its swap limits in the cgroups module.
+ */
+
+#ifndef ZRAM_H
+#define ZRAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct zram_stats {
+	uint64_t orig_data_size;  // uncompressed bytes stored in the device
+	uint64_t compr_data_size; // compressed bytes stored in the device
+	uint64_t mem_used_total;  // memory in bytes used by the device including overhead
+} zram_stats_t;
+
+/**
+ * Sets up a zram device and enables it as swap with a higher priority than
+ * other swap devices. A zram swap device which is still active from a
+ * previous run is reused.
+ *
+ * @param size Size in MB of the uncompressed data the device may hold.
+ * @param algorithm Compression algorithm or NULL for the kernel default.
+ * @return 0 on success, -1 on error.
+ */
+int
+zram_init(uint64_t size, const char *algorithm);
+
+/**
+ * Returns true if the zram swap device is set up.
+ */
+bool
+zram_is_active(void);
+
+/**
+ * Returns the usage of the zram swap device.
+ *
+ * @return 0 on success, -1 if the device is not active or its stats are unavailable.
+ */
+int
+zram_get_stats(zram_stats_t *stats);
+
+#endif /* ZRAM_H */
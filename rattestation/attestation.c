@@ -26,14 +26,16 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/random.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <errno.h>
+#include <string.h>
 #include "ibmtss/Unmarshal_fp.h"
 
 #include "common/macro.h"
 #include "common/mem.h"
 #include "common/protobuf.h"
 #include "common/event.h"
-#include "common/sock.h"
-#include "common/fd.h"
 #include "common/ssl_util.h"
 #include "common/hex.h"
 
@@ -44,27 +46,43 @@
 #include "modsig.h"
 #include "hash.h"
 #include "ima_verify.h"
+#include "refstore.h"
 #include "container_verify.h"
 
 #define TPM2D_SERVICE_PORT "9505"
+#define ATTESTATION_NONCE_LEN 8
 
-struct attestation_resp_cb_data {
-	void (*resp_verified_cb)(bool);
-	size_t nonce_len;
-	uint8_t *nonce;
+struct attestation_ctx {
 	RAttestationConfig *config;
+	// configured PCR values converted once for all verifications
+	uint8_t **pcr;
+	// reference measurements of the approved container images or NULL
+	refstore_t *refstore;
+};
+
+struct attestation_request {
+	attestation_ctx_t *ctx;
+	char *host;
+	int sock;
+	struct addrinfo *addrs;	    // resolved addresses of host
+	struct addrinfo *next_addr; // address to try if the current connect fails
+	uint8_t nonce[ATTESTATION_NONCE_LEN];
+	event_io_t *io;
+	event_timer_t *timer;
+	void (*result_cb)(const char *host, attestation_result_t result, void *data);
+	void *data;
 };
 
 static bool
-attestation_verify_resp(Tpm2dToRemote *resp, RAttestationConfig *config, uint8_t *nonce,
+attestation_verify_resp(Tpm2dToRemote *resp, const attestation_ctx_t *ctx, uint8_t *nonce,
 			size_t nonce_len)
 {
-	ASSERT(config);
+	ASSERT(ctx);
 	ASSERT(nonce);
 	ASSERT(resp);
 	ASSERT(resp->n_pcr_values < 24);
-	ASSERT((config->halg == SHA256_DIGEST_LENGTH) || (config->halg == SHA_DIGEST_LENGTH));
 
+	RAttestationConfig *config = ctx->config;
 	bool ret = false;
 	uint8_t quote[resp->quoted.len];
 	uint8_t sig[resp->signature.len];
@@ -72,7 +90,6 @@ attestation_verify_resp(Tpm2dToRemote *resp, RAttestationConfig *config, uint8_t
 	uint8_t *s = sig;   // Required as TSS functions manipulate pointer
 	uint32_t quote_len = resp->quoted.len;
 	uint32_t sig_len = resp->signature.len;
-	uint8_t pcr[resp->n_pcr_values][config->halg];
 
 	if (resp->has_quoted) {
 		INFO("Response contains quote (Length %zu)", resp->quoted.len);
@@ -108,14 +125,6 @@ attestation_verify_resp(Tpm2dToRemote *resp, RAttestationConfig *config, uint8_t
 
 	bool ret_pcr = true;
 	for (size_t i = 0; i < config->n_pcr_values; i++) {
-		if (convert_hex_to_bin(config->pcr_values[i]->value,
-				       strlen(config->pcr_values[i]->value), pcr[i],
-				       config->halg)) {
-			ERROR("Failed to convert configured PCR value %s: Invalid hex string",
-			      config->pcr_values[i]->value);
-			ret_pcr = false;
-			continue;
-		}
 		if (resp->pcr_values[i]->value.len != config->halg) {
 			ERROR("Length of configured PCR value %zu invalid (%zu,	must be %u)", i,
 			      resp->pcr_values[i]->value.len, config->halg);
@@ -133,7 +142,7 @@ attestation_verify_resp(Tpm2dToRemote *resp, RAttestationConfig *config, uint8_t
 			ret_pcr = false;
 			continue;
 		}
-		if (memcmp(pcr[i], resp->pcr_values[i]->value.data, config->halg)) {
+		if (memcmp(ctx->pcr[i], resp->pcr_values[i]->value.data, config->halg)) {
 			ERROR_HEXDUMP(resp->pcr_values[i]->value.data,
 				      resp->pcr_values[i]->value.len, "PCR_%d VERIFICATION FAILED",
 				      resp->pcr_values[i]->number);
@@ -181,8 +190,6 @@ attestation_verify_resp(Tpm2dToRemote *resp, RAttestationConfig *config, uint8_t
 	}
 
 	// Verify signature
-	ssl_init(false, NULL);
-
 	int retssl = ssl_verify_signature_from_buf(resp->certificate.data, resp->certificate.len,
 						   tpmt_signature.signature.rsapss.sig.t.buffer,
 						   tpmt_signature.signature.rsapss.sig.t.size,
@@ -273,7 +280,7 @@ attestation_verify_resp(Tpm2dToRemote *resp, RAttestationConfig *config, uint8_t
 		}
 		int ret_container = container_verify_runtime_measurements(
 			resp->ml_container_entry, resp->n_ml_container_entry, hash_algo,
-			resp->pcr_values[container_index]->value.data);
+			resp->pcr_values[container_index]->value.data, ctx->refstore);
 		if (ret_container != 0) {
 			ERROR("Failed to verify container measurement list");
 			ret = false;
@@ -288,17 +295,144 @@ err:
 	DEBUG("REMOTE ATTESTATION: %s", ret ? "SUCCESSFUL" : "FAILED");
 	DEBUG("---------------------------");
 
-	// Free resources
+	return ret;
+}
+
+attestation_ctx_t *
+attestation_ctx_new(const char *config_file)
+{
+	// Read the configuration which contains information about the remote attestation request
+	// as well as the expected values for the PCRs
+	RAttestationConfig *config = rattestation_read_config_new(config_file);
+	if (!config) {
+		ERROR("Failed to read config file %s. The file has to be provided as a command line argument",
+		      config_file);
+		return NULL;
+	}
+
+	if (config->halg != SHA256_DIGEST_LENGTH && config->halg != SHA_DIGEST_LENGTH) {
+		ERROR("Unsupported hash algorithm length %u in config file %s", config->halg,
+		      config_file);
+		protobuf_free_message((ProtobufCMessage *)config);
+		return NULL;
+	}
+	if (config->atype == IDS_ATTESTATION_TYPE__ADVANCED && !config->has_pcrs) {
+		ERROR("Missing PCR bitmap configuration for attestation type advanced");
+		protobuf_free_message((ProtobufCMessage *)config);
+		return NULL;
+	}
+
+	attestation_ctx_t *ctx = mem_new0(attestation_ctx_t, 1);
+	ctx->config = config;
+	ctx->pcr = mem_new0(uint8_t *, config->n_pcr_values);
+	for (size_t i = 0; i < config->n_pcr_values; i++) {
+		ctx->pcr[i] = mem_alloc0(config->halg);
+		if (convert_hex_to_bin(config->pcr_values[i]->value,
+				       strlen(config->pcr_values[i]->value), ctx->pcr[i],
+				       config->halg)) {
+			ERROR("Failed to convert configured PCR value %s: Invalid hex string",
+			      config->pcr_values[i]->value);
+			attestation_ctx_free(ctx);
+			return NULL;
+		}
+	}
+
+	if (config->reference_manifest_dir) {
+		if (!config->reference_signer_cert) {
+			ERROR("Missing certificate to verify the reference manifests");
+			attestation_ctx_free(ctx);
+			return NULL;
+		}
+		ctx->refstore = refstore_new_from_dir(config->reference_manifest_dir,
+						      config->reference_signer_cert);
+		if (!ctx->refstore) {
+			attestation_ctx_free(ctx);
+			return NULL;
+		}
+	}
+
+	ssl_init(false, NULL);
+
+	return ctx;
+}
+
+void
+attestation_ctx_free(attestation_ctx_t *ctx)
+{
+	IF_NULL_RETURN(ctx);
+
+	for (size_t i = 0; i < ctx->config->n_pcr_values; i++)
+		mem_free0(ctx->pcr[i]);
+	mem_free0(ctx->pcr);
+	refstore_free(ctx->refstore);
+	protobuf_free_message((ProtobufCMessage *)ctx->config);
+	mem_free0(ctx);
+
 	ssl_free();
+}
 
-	return ret;
+const char *
+attestation_result_to_string(attestation_result_t result)
+{
+	switch (result) {
+	case ATTESTATION_RESULT_VERIFIED:
+		return "verified";
+	case ATTESTATION_RESULT_FAILED:
+		return "failed";
+	case ATTESTATION_RESULT_UNREACHABLE:
+		return "unreachable";
+	case ATTESTATION_RESULT_INVALID_RESPONSE:
+		return "invalid_response";
+	case ATTESTATION_RESULT_TIMEOUT:
+		return "timeout";
+	}
+	return "unknown";
+}
+
+static void
+attestation_request_finish(struct attestation_request *req, attestation_result_t result)
+{
+	if (req->io) {
+		event_remove_io(req->io);
+		event_io_free(req->io);
+	}
+	if (req->timer) {
+		event_remove_timer(req->timer);
+		event_timer_free(req->timer);
+	}
+	if (req->sock >= 0 && close(req->sock) < 0)
+		WARN_ERRNO("Failed to close connected tpm2d socket");
+	if (req->addrs)
+		freeaddrinfo(req->addrs);
+
+	INFO("Attestation of %s: %s", req->host, attestation_result_to_string(result));
+
+	// call registerd handler with verification result
+	if (req->result_cb)
+		(req->result_cb)(req->host, result, req->data);
+
+	mem_free0(req->host);
+	mem_free0(req);
+}
+
+static void
+attestation_request_timeout_cb(event_timer_t *timer, void *data)
+{
+	struct attestation_request *req = data;
+
+	// the timer fires only once and was already removed from the event loop
+	event_timer_free(timer);
+	req->timer = NULL;
+
+	WARN("Attestation request to %s timed out", req->host);
+	attestation_request_finish(req, ATTESTATION_RESULT_TIMEOUT);
 }
 
 static void
-attestation_response_recv_cb(int fd, unsigned events, event_io_t *io, void *data)
+attestation_response_recv_cb(int fd, unsigned events, UNUSED event_io_t *io, void *data)
 {
-	bool verified = false;
-	struct attestation_resp_cb_data *resp_cb_data = data;
+	struct attestation_request *req = data;
+	attestation_result_t result = ATTESTATION_RESULT_INVALID_RESPONSE;
 
 	if (events & EVENT_IO_EXCEPT) {
 		WARN("Exception on connected socket to control client; closing socket");
@@ -311,90 +445,214 @@ attestation_response_recv_cb(int fd, unsigned events, event_io_t *io, void *data
 		(Tpm2dToRemote *)protobuf_recv_message(fd, &tpm2d_to_remote__descriptor);
 	IF_NULL_GOTO_ERROR(resp, cleanup);
 
-	verified = attestation_verify_resp(resp, resp_cb_data->config, resp_cb_data->nonce,
-					   resp_cb_data->nonce_len);
+	result = attestation_verify_resp(resp, req->ctx, req->nonce, ATTESTATION_NONCE_LEN) ?
+			 ATTESTATION_RESULT_VERIFIED :
+			 ATTESTATION_RESULT_FAILED;
 
 	protobuf_free_message((ProtobufCMessage *)resp);
 	INFO("Handled response on connection %d", fd);
 
 cleanup:
-	event_remove_io(io);
-	event_io_free(io);
-	if (close(fd) < 0)
-		WARN_ERRNO("Failed to close connected tpm2d socket");
-	// call registerd handler with verification result
-	if (resp_cb_data->resp_verified_cb)
-		(resp_cb_data->resp_verified_cb)(verified);
-	if (resp_cb_data->nonce)
-		mem_free0(resp_cb_data->nonce);
-	protobuf_free_message((ProtobufCMessage *)resp_cb_data->config);
-	mem_free0(resp_cb_data);
+	attestation_request_finish(req, result);
 }
 
-int
-attestation_do_request(const char *host, char *config_file, void (*resp_verified_cb)(bool))
+static int
+attestation_request_send(struct attestation_request *req)
 {
-	// Set nonce
-	size_t nonce_len = 8;
-	uint8_t nonce[nonce_len];
-	if (getrandom(nonce, nonce_len, (unsigned int)0) != (ssize_t)nonce_len) {
-		ERROR("Failed to create attestation request: Failed to retrieve random nonce from /dev/urandom");
-		return -1;
-	}
-
-	// Read the configuration which contains information about the remote attestation request
-	// as well as the expected values for the PCRs
-	RAttestationConfig *config = rattestation_read_config_new(config_file);
-	if (!config) {
-		ERROR("Failed to read config file %s. The file has to be provided as a command line argument",
-		      config_file);
-		return -1;
-	}
+	RAttestationConfig *config = req->ctx->config;
 
 	// build RemoteToTpm2d message
 	RemoteToTpm2d msg = REMOTE_TO_TPM2D__INIT;
 
 	msg.code = REMOTE_TO_TPM2D__CODE__ATTESTATION_REQ;
 	msg.has_qualifyingdata = true;
-	msg.qualifyingdata.data = nonce;
-	msg.qualifyingdata.len = nonce_len;
+	msg.qualifyingdata.data = req->nonce;
+	msg.qualifyingdata.len = ATTESTATION_NONCE_LEN;
 	msg.has_atype = true;
 	msg.atype = config->atype;
 	if (config->atype == IDS_ATTESTATION_TYPE__ADVANCED) {
-		if (!config->has_pcrs) {
-			ERROR("Missing PCR bitmap configuration for attestation type advanced");
-			return -1;
-		}
 		msg.has_pcrs = true;
 		msg.pcrs = config->pcrs;
 	}
 	msg.attest_ima = config->verify_ima;
 	msg.attest_containers = config->verify_containers;
 
-	int sock = sock_inet_create_and_connect(SOCK_STREAM, host, TPM2D_SERVICE_PORT);
-	IF_TRUE_RETVAL(sock < 0, -1);
+	DEBUG("Sending attestation request to TPM2D on %s:%s", req->host, TPM2D_SERVICE_PORT);
 
-	DEBUG("Sending attestation request to TPM2D on %s:%s", host, TPM2D_SERVICE_PORT);
-
-	ssize_t msg_size = protobuf_send_message(sock, (ProtobufCMessage *)&msg);
+	ssize_t msg_size = protobuf_send_message(req->sock, (ProtobufCMessage *)&msg);
 	IF_TRUE_RETVAL(msg_size < 0, -1);
 
 	INFO("Send message with size %zd", msg_size);
-	DEBUG_HEXDUMP(nonce, nonce_len, "Request with Nonce");
-
-	struct attestation_resp_cb_data *resp_cb_data =
-		mem_new0(struct attestation_resp_cb_data, 1);
-	resp_cb_data->resp_verified_cb = resp_verified_cb;
-	resp_cb_data->nonce = mem_new0(uint8_t, nonce_len);
-	memcpy(resp_cb_data->nonce, nonce, nonce_len);
-	resp_cb_data->nonce_len = nonce_len;
-	resp_cb_data->config = config;
-
-	DEBUG("Register Response handler on sockfd=%d", sock);
-	fd_make_non_blocking(sock);
-	event_io_t *event =
-		event_io_new(sock, EVENT_IO_READ, attestation_response_recv_cb, resp_cb_data);
-	event_add_io(event);
+	DEBUG_HEXDUMP(req->nonce, ATTESTATION_NONCE_LEN, "Request with Nonce");
+
+	return 0;
+}
+
+/*
+ * Starts a non-blocking connect to the next resolved address of the request,
+ * so that an unreachable host does not stall the requests to other hosts.
+ * @return the socket or -1 if no address is left
+ */
+static int
+attestation_connect_next(struct attestation_request *req)
+{
+	while (req->next_addr) {
+		struct addrinfo *cur = req->next_addr;
+		req->next_addr = cur->ai_next;
+
+		int sock = socket(cur->ai_family, cur->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+				  cur->ai_protocol);
+		if (sock < 0)
+			continue;
+		if (connect(sock, cur->ai_addr, cur->ai_addrlen) == 0 || errno == EINPROGRESS)
+			return sock;
+		close(sock);
+	}
+	return -1;
+}
+
+static void
+attestation_connected_cb(int fd, unsigned events, event_io_t *io, void *data);
+
+/*
+ * Connects to the next address of the request and waits for the connection,
+ * the socket becomes writable as soon as the connection is established.
+ * @return 0 on success, -1 if no address is left
+ */
+static int
+attestation_connect_start(struct attestation_request *req)
+{
+	req->sock = attestation_connect_next(req);
+	IF_TRUE_RETVAL(req->sock < 0, -1);
+
+	req->io = event_io_new(req->sock, EVENT_IO_WRITE, attestation_connected_cb, req);
+	event_add_io(req->io);
+	return 0;
+}
+
+static void
+attestation_connected_cb(int fd, unsigned events, event_io_t *io, void *data)
+{
+	struct attestation_request *req = data;
+
+	event_remove_io(io);
+	event_io_free(io);
+	req->io = NULL;
+
+	int error = 0;
+	socklen_t len = sizeof(error);
+	if ((events & EVENT_IO_EXCEPT) || getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 ||
+	    error) {
+		WARN("Connection to %s:%s failed: %s", req->host, TPM2D_SERVICE_PORT,
+		     strerror(error ? error : errno));
+
+		// e.g., IPv6 is not routed for a dual-stack host, retry with its next address
+		if (close(fd) < 0)
+			WARN_ERRNO("Failed to close tpm2d socket");
+		req->sock = -1;
+		if (attestation_connect_start(req) < 0)
+			attestation_request_finish(req, ATTESTATION_RESULT_UNREACHABLE);
+		return;
+	}
+
+	freeaddrinfo(req->addrs);
+	req->addrs = req->next_addr = NULL;
+
+	if (attestation_request_send(req) < 0) {
+		attestation_request_finish(req, ATTESTATION_RESULT_UNREACHABLE);
+		return;
+	}
+
+	DEBUG("Register Response handler on sockfd=%d", fd);
+	req->io = event_io_new(fd, EVENT_IO_READ, attestation_response_recv_cb, req);
+	event_add_io(req->io);
+}
+
+int
+attestation_request_start(attestation_ctx_t *ctx, const char *host, unsigned int timeout_ms,
+			  void (*result_cb)(const char *host, attestation_result_t result,
+					    void *data),
+			  void *data)
+{
+	ASSERT(ctx);
+	ASSERT(host);
+
+	struct attestation_request *req = mem_new0(struct attestation_request, 1);
+
+	// Set nonce
+	if (getrandom(req->nonce, ATTESTATION_NONCE_LEN, (unsigned int)0) !=
+	    (ssize_t)ATTESTATION_NONCE_LEN) {
+		ERROR("Failed to create attestation request: Failed to retrieve random nonce from /dev/urandom");
+		mem_free0(req);
+		return -1;
+	}
+
+	struct addrinfo hints;
+	mem_memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC; // allow for ipv6 and ipv4
+	hints.ai_socktype = SOCK_STREAM;
+
+	int status = getaddrinfo(host, TPM2D_SERVICE_PORT, &hints, &req->addrs);
+	if (status) {
+		WARN("getaddrinfo error for %s: %s", host, gai_strerror(status));
+		mem_free0(req);
+		return -1;
+	}
+	req->next_addr = req->addrs;
+
+	if (attestation_connect_start(req) < 0) {
+		ERROR("Connection to remote host %s failed!", host);
+		freeaddrinfo(req->addrs);
+		mem_free0(req);
+		return -1;
+	}
+
+	req->ctx = ctx;
+	req->host = mem_strdup(host);
+	req->result_cb = result_cb;
+	req->data = data;
+
+	if (timeout_ms > 0) {
+		req->timer = event_timer_new(timeout_ms, 1, attestation_request_timeout_cb, req);
+		event_add_timer(req->timer);
+	}
+
+	return 0;
+}
+
+struct attestation_single_data {
+	attestation_ctx_t *ctx;
+	void (*resp_verified_cb)(bool);
+};
+
+static void
+attestation_single_result_cb(UNUSED const char *host, attestation_result_t result, void *data)
+{
+	struct attestation_single_data *single = data;
+	void (*resp_verified_cb)(bool) = single->resp_verified_cb;
+
+	attestation_ctx_free(single->ctx);
+	mem_free0(single);
+
+	if (resp_verified_cb)
+		resp_verified_cb(result == ATTESTATION_RESULT_VERIFIED);
+}
+
+int
+attestation_do_request(const char *host, char *config_file, void (*resp_verified_cb)(bool))
+{
+	attestation_ctx_t *ctx = attestation_ctx_new(config_file);
+	IF_NULL_RETVAL(ctx, -1);
+
+	struct attestation_single_data *single = mem_new0(struct attestation_single_data, 1);
+	single->ctx = ctx;
+	single->resp_verified_cb = resp_verified_cb;
+
+	if (attestation_request_start(ctx, host, 0, attestation_single_result_cb, single) < 0) {
+		attestation_ctx_free(ctx);
+		mem_free0(single);
+		return -1;
+	}
 
 	return 0;
 }
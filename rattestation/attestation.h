@@ -1,5 +1,49 @@
 #ifndef IP_AGENT_ATTESTATION_H
 #define IP_AGENT_ATTESTATION_H
+
+#include <stdbool.h>
+
+typedef enum attestation_result {
+	ATTESTATION_RESULT_VERIFIED = 0,
+	ATTESTATION_RESULT_FAILED,	     // the response did not pass the verification
+	ATTESTATION_RESULT_UNREACHABLE,	     // the host could not be connected
+	ATTESTATION_RESULT_INVALID_RESPONSE, // no valid response was received
+	ATTESTATION_RESULT_TIMEOUT,	     // the host did not respond in time
+} attestation_result_t;
+
+/*
+ * Verification context, which holds the parsed configuration with the
+ * reference values and is shared by all requests verified against it.
+ */
+typedef struct attestation_ctx attestation_ctx_t;
+
+/*
+ * Reads the configuration and prepares the reference values for verification.
+ * Returns NULL on error.
+ */
+attestation_ctx_t *
+attestation_ctx_new(const char *config_file);
+
+void
+attestation_ctx_free(attestation_ctx_t *ctx);
+
+const char *
+attestation_result_to_string(attestation_result_t result);
+
+/*
+ * Starts an asynchronous attestation request to a host
+ *
+ * The connection is established without blocking the event loop. As soon as
+ * the response is verified, the request failed or timeout_ms (0 for no timeout)
+ * elapsed, result_cb is called with the outcome. Returns -1 if the request could
+ * not be started, in which case result_cb is not called.
+ */
+int
+attestation_request_start(attestation_ctx_t *ctx, const char *host, unsigned int timeout_ms,
+			  void (*result_cb)(const char *host, attestation_result_t result,
+					    void *data),
+			  void *data);
+
 /*
  * Do the attestation request
  *
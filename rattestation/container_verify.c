@@ -36,10 +36,38 @@
 #include "common/macro.h"
 
 #include "hash.h"
+#include "refstore.h"
+#include "container_verify.h"
+
+/*
+ * Checks each measured container image against the reference measurements.
+ * All entries are checked to report every image which is not allowed.
+ */
+static int
+container_verify_references(MlContainerEntry **entries, size_t len, const refstore_t *refstore)
+{
+	int ret = 0;
+
+	for (size_t i = 0; i < len; i++) {
+		const char *name = NULL;
+		refstore_result_t result = refstore_check(refstore, entries[i]->data_hash.data,
+							  entries[i]->data_hash.len, &name);
+		if (result != REFSTORE_ALLOWED) {
+			ERROR("Container image %s (%s) is not allowed: %s", entries[i]->filename,
+			      name ? name : "no reference", refstore_result_to_string(result));
+			ret = -1;
+			continue;
+		}
+		DEBUG("Container image %s matches reference %s", entries[i]->filename, name);
+	}
+
+	return ret;
+}
 
 int
 container_verify_runtime_measurements(MlContainerEntry **entries, size_t len,
-				      hash_algo_t pcr_hash_algo, uint8_t *pcr_tpm)
+				      hash_algo_t pcr_hash_algo, uint8_t *pcr_tpm,
+				      const refstore_t *refstore)
 {
 	int hash_size = hash_algo_to_size(pcr_hash_algo);
 	IF_FALSE_RETVAL_ERROR(hash_size > 0, -1);
@@ -78,7 +106,18 @@ container_verify_runtime_measurements(MlContainerEntry **entries, size_t len,
 	}
 
 	INFO("Verify container TPM PCR SUCCESSFUL");
-	WARN("Verify container signatures not yet implemented");
+
+	if (!refstore) {
+		WARN("No reference measurements configured, measured container images are not verified");
+		return 0;
+	}
+
+	if (container_verify_references(entries, len, refstore) < 0) {
+		ERROR("Failed to verify container images against reference measurements");
+		return -1;
+	}
+
+	INFO("Verify container images against reference measurements SUCCESSFUL");
 
 	return 0;
 }
\ No newline at end of file
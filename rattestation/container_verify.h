@@ -24,8 +24,16 @@
 #ifndef CONTAINER_VERIFY_H_
 #define CONTAINER_VERIFY_H_
 
+#include "refstore.h"
+
+/*
+ * Replays the container measurement list into the container PCR and compares
+ * it with the quoted value. If refstore is not NULL, each measured image must
+ * also be approved by the reference measurements.
+ */
 int
 container_verify_runtime_measurements(MlContainerEntry **entries, size_t len,
-				      hash_algo_t pcr_hash_algo, uint8_t *pcr_tpm);
+				      hash_algo_t pcr_hash_algo, uint8_t *pcr_tpm,
+				      const refstore_t *refstore);
 
 #endif // CONTAINER_VERIFY_H_
\ No newline at end of file
@@ -30,6 +30,11 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <signal.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "attestation.h"
 
@@ -48,9 +53,32 @@
 #define LOGFILE_DIR "/data/logs"
 #define LOGFILE_PATH LOGFILE_DIR "/rattestation"
 
+#define FLEET_DEFAULT_PARALLEL 32
+#define FLEET_DEFAULT_TIMEOUT 30
+
 static logf_handler_t *logfile_handler = NULL;
 static logf_handler_t *logfile_handler_stdout = NULL;
 
+typedef struct fleet_host {
+	char *name;
+	attestation_result_t result;
+	struct timespec start;
+	unsigned int duration_ms;
+} fleet_host_t;
+
+/* state of the verification of all hosts in fleet mode */
+static struct {
+	attestation_ctx_t *ctx;
+	fleet_host_t *hosts;
+	size_t n_hosts;
+	size_t next;
+	size_t running;
+	size_t done;
+	unsigned int parallel;
+	unsigned int timeout_ms;
+	const char *report_file;
+} fleet;
+
 static void
 main_sigint_cb(UNUSED int signum, UNUSED event_signal_t *sig, UNUSED void *data)
 {
@@ -65,6 +93,127 @@ main_return_result_and_exit(bool validated)
 	exit(validated ? 0 : -1);
 }
 
+static void
+main_print_usage(const char *progname)
+{
+	printf("Usage: %s [remote_host [config_file]]\n", progname);
+	printf("       %s --fleet <hosts_file> [--config <config_file>] [--parallel <n>]\n"
+	       "          [--timeout <seconds>] [--report <report_file>]\n\n",
+	       progname);
+	printf("In fleet mode, all hosts listed in hosts_file (one per line) are attested\n"
+	       "concurrently and a report with one JSON object per host is written.\n");
+}
+
+/*
+ * Reads the hosts to attest, one per line. Empty lines and lines starting
+ * with '#' are skipped.
+ */
+static int
+fleet_read_hosts(const char *hosts_file)
+{
+	FILE *fp = fopen(hosts_file, "r");
+	if (!fp) {
+		ERROR_ERRNO("Could not open hosts file %s", hosts_file);
+		return -1;
+	}
+
+	char line[256];
+	while (fgets(line, sizeof(line), fp)) {
+		char host[256];
+		if (sscanf(line, "%255s", host) != 1 || host[0] == '#')
+			continue;
+		if (strpbrk(host, "\"\\")) {
+			WARN("Skipping invalid host %s", host);
+			continue;
+		}
+		fleet.hosts = mem_renew(fleet_host_t, fleet.hosts, fleet.n_hosts + 1);
+		mem_memset(&fleet.hosts[fleet.n_hosts], 0, sizeof(fleet_host_t));
+		fleet.hosts[fleet.n_hosts].name = mem_strdup(host);
+		fleet.n_hosts++;
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+static bool
+fleet_write_report(void)
+{
+	bool all_verified = true;
+	FILE *fp = fleet.report_file ? fopen(fleet.report_file, "w") : stdout;
+	if (!fp) {
+		ERROR_ERRNO("Could not open report file %s", fleet.report_file);
+		fp = stdout;
+	}
+
+	for (size_t i = 0; i < fleet.n_hosts; i++) {
+		fleet_host_t *host = &fleet.hosts[i];
+		fprintf(fp, "{\"host\": \"%s\", \"result\": \"%s\", \"duration_ms\": %u}\n",
+			host->name, attestation_result_to_string(host->result), host->duration_ms);
+		if (host->result != ATTESTATION_RESULT_VERIFIED)
+			all_verified = false;
+	}
+
+	if (fp != stdout)
+		fclose(fp);
+
+	INFO("Attested %zu hosts, %s", fleet.n_hosts,
+	     all_verified ? "all verified" : "verification failed for some hosts");
+	return all_verified;
+}
+
+static void
+fleet_host_finish(fleet_host_t *host, attestation_result_t result)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	host->result = result;
+	host->duration_ms = (now.tv_sec - host->start.tv_sec) * 1000 +
+			    (now.tv_nsec - host->start.tv_nsec) / 1000000;
+	fleet.done++;
+}
+
+static void
+fleet_start_requests(void);
+
+static void
+fleet_result_cb(UNUSED const char *name, attestation_result_t result, void *data)
+{
+	fleet_host_finish(data, result);
+	fleet.running--;
+	fleet_start_requests();
+}
+
+/*
+ * Keeps up to fleet.parallel requests running and exits with the overall
+ * result as soon as all hosts are attested.
+ */
+static void
+fleet_start_requests(void)
+{
+	while (fleet.running < fleet.parallel && fleet.next < fleet.n_hosts) {
+		fleet_host_t *host = &fleet.hosts[fleet.next++];
+		clock_gettime(CLOCK_MONOTONIC, &host->start);
+		if (attestation_request_start(fleet.ctx, host->name, fleet.timeout_ms,
+					      fleet_result_cb, host) < 0)
+			fleet_host_finish(host, ATTESTATION_RESULT_UNREACHABLE);
+		else
+			fleet.running++;
+	}
+
+	if (fleet.done == fleet.n_hosts)
+		main_return_result_and_exit(fleet_write_report());
+}
+
+static const struct option main_options[] = { { "fleet", required_argument, 0, 'f' },
+					      { "config", required_argument, 0, 'c' },
+					      { "parallel", required_argument, 0, 'p' },
+					      { "timeout", required_argument, 0, 't' },
+					      { "report", required_argument, 0, 'r' },
+					      { "help", no_argument, 0, 'h' },
+					      { 0, 0, 0, 0 } };
+
 int
 main(int argc, char **argv)
 {
@@ -74,8 +223,34 @@ main(int argc, char **argv)
 	logf_handler_set_prio(logfile_handler, LOGF_PRIO_TRACE);
 	logf_handler_set_prio(logfile_handler_stdout, LOGF_PRIO_TRACE);
 
-	char *rhost = (argc < 2) ? "127.0.0.1" : argv[1];
-	char *config_file = (argc < 3) ? "rattestation.conf" : argv[2];
+	char *hosts_file = NULL;
+	char *config_file = "rattestation.conf";
+	int parallel = FLEET_DEFAULT_PARALLEL;
+	int timeout = FLEET_DEFAULT_TIMEOUT;
+
+	int c;
+	while ((c = getopt_long(argc, argv, "f:c:p:t:r:h", main_options, NULL)) != -1) {
+		switch (c) {
+		case 'f':
+			hosts_file = optarg;
+			break;
+		case 'c':
+			config_file = optarg;
+			break;
+		case 'p':
+			parallel = atoi(optarg);
+			break;
+		case 't':
+			timeout = atoi(optarg);
+			break;
+		case 'r':
+			fleet.report_file = optarg;
+			break;
+		default:
+			main_print_usage(argv[0]);
+			return c == 'h' ? 0 : -1;
+		}
+	}
 
 	event_init();
 
@@ -83,6 +258,41 @@ main(int argc, char **argv)
 	event_signal_t *sig = event_signal_new(SIGINT, &main_sigint_cb, NULL);
 	event_add_signal(sig);
 
+	if (hosts_file) {
+		if (parallel <= 0 || timeout < 0) {
+			main_print_usage(argv[0]);
+			return -1;
+		}
+		// a host closing its connection must not terminate the whole run
+		signal(SIGPIPE, SIG_IGN);
+		// keep the report on stdout readable
+		logf_handler_set_prio(logfile_handler_stdout, LOGF_PRIO_WARN);
+
+		fleet.parallel = parallel;
+		fleet.timeout_ms = timeout * 1000;
+		if (fleet_read_hosts(hosts_file) < 0)
+			main_return_result_and_exit(false);
+		// nothing attested must not be reported as all verified
+		if (fleet.n_hosts == 0) {
+			ERROR("No hosts to attest in %s", hosts_file);
+			main_print_usage(argv[0]);
+			return -1;
+		}
+
+		// the config and reference values are shared by the requests to all hosts
+		fleet.ctx = attestation_ctx_new(config_file);
+		if (!fleet.ctx)
+			main_return_result_and_exit(false);
+
+		fleet_start_requests();
+		event_loop();
+		return 0;
+	}
+
+	char *rhost = (optind < argc) ? argv[optind] : "127.0.0.1";
+	if (optind + 1 < argc)
+		config_file = argv[optind + 1];
+
 	/*
 	 * do attestation and register the main_retrun_result_and_exit handler
 	 * as callback when the response has been validated
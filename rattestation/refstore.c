@@ -0,0 +1,381 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+#include "config.pb-c.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "common/macro.h"
+#include "common/mem.h"
+#include "common/file.h"
+#include "common/dir.h"
+#include "common/list.h"
+#include "common/hex.h"
+#include "common/protobuf.h"
+#include "common/ssl_util.h"
+
+#include "refstore.h"
+
+#define REFSTORE_DIGEST_MAX 64
+#define REFSTORE_MANIFEST_SUFFIX ".manifest"
+#define REFSTORE_SIG_SUFFIX ".sig"
+#define REFSTORE_MANIFEST_MAX_SIZE (16 * 1024 * 1024)
+
+// initial number of slots of the hash tables, always a power of two
+#define REFSTORE_TABLE_SIZE_MIN 64
+
+typedef struct refstore_image {
+	uint8_t digest[REFSTORE_DIGEST_MAX];
+	size_t digest_len; // 0 marks a free slot
+	char *name;	   // NULL if the digest is only revoked
+	uint64_t version;
+	bool revoked;
+} refstore_image_t;
+
+typedef struct refstore_name {
+	char *name; // NULL marks a free slot
+	uint64_t min_version;
+} refstore_name_t;
+
+/*
+ * Both indexes are hash tables with open addressing and linear probing, which
+ * are kept at most half full.
+ */
+struct refstore {
+	refstore_image_t *images;
+	size_t images_size;
+	size_t n_images;
+	refstore_name_t *names;
+	size_t names_size;
+	size_t n_names;
+};
+
+static uint64_t
+refstore_hash(const uint8_t *buf, size_t len)
+{
+	// FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= buf[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static refstore_image_t *
+refstore_image_slot(refstore_image_t *images, size_t size, const uint8_t *digest, size_t len)
+{
+	size_t i = refstore_hash(digest, len) & (size - 1);
+	while (images[i].digest_len &&
+	       (images[i].digest_len != len || memcmp(images[i].digest, digest, len)))
+		i = (i + 1) & (size - 1);
+	return &images[i];
+}
+
+static refstore_name_t *
+refstore_name_slot(refstore_name_t *names, size_t size, const char *name)
+{
+	size_t i = refstore_hash((const uint8_t *)name, strlen(name)) & (size - 1);
+	while (names[i].name && strcmp(names[i].name, name))
+		i = (i + 1) & (size - 1);
+	return &names[i];
+}
+
+/*
+ * Returns the entry of digest, which is added if it does not exist yet.
+ */
+static refstore_image_t *
+refstore_image_get(refstore_t *store, const uint8_t *digest, size_t len)
+{
+	if (2 * (store->n_images + 1) > store->images_size) {
+		size_t size = store->images_size * 2;
+		refstore_image_t *images = mem_new0(refstore_image_t, size);
+		for (size_t i = 0; i < store->images_size; i++) {
+			refstore_image_t *old = &store->images[i];
+			if (old->digest_len)
+				*refstore_image_slot(images, size, old->digest, old->digest_len) =
+					*old;
+		}
+		mem_free0(store->images);
+		store->images = images;
+		store->images_size = size;
+	}
+
+	refstore_image_t *image =
+		refstore_image_slot(store->images, store->images_size, digest, len);
+	if (!image->digest_len) {
+		memcpy(image->digest, digest, len);
+		image->digest_len = len;
+		store->n_images++;
+	}
+	return image;
+}
+
+static refstore_name_t *
+refstore_name_get(refstore_t *store, const char *name)
+{
+	if (2 * (store->n_names + 1) > store->names_size) {
+		size_t size = store->names_size * 2;
+		refstore_name_t *names = mem_new0(refstore_name_t, size);
+		for (size_t i = 0; i < store->names_size; i++) {
+			refstore_name_t *old = &store->names[i];
+			if (old->name)
+				*refstore_name_slot(names, size, old->name) = *old;
+		}
+		mem_free0(store->names);
+		store->names = names;
+		store->names_size = size;
+	}
+
+	refstore_name_t *entry = refstore_name_slot(store->names, store->names_size, name);
+	if (!entry->name) {
+		entry->name = mem_strdup(name);
+		store->n_names++;
+	}
+	return entry;
+}
+
+static int
+refstore_parse_digest(const char *hex, uint8_t *digest, size_t *len)
+{
+	size_t hex_len = strlen(hex);
+	if (hex_len < 2 || hex_len % 2 || hex_len / 2 > REFSTORE_DIGEST_MAX ||
+	    convert_hex_to_bin(hex, hex_len, digest, hex_len / 2)) {
+		WARN("Invalid digest %s in reference manifest", hex);
+		return -1;
+	}
+	*len = hex_len / 2;
+	return 0;
+}
+
+static void
+refstore_add_manifest(refstore_t *store, const ReferenceManifest *manifest)
+{
+	uint8_t digest[REFSTORE_DIGEST_MAX];
+	size_t len;
+
+	for (size_t i = 0; i < manifest->n_images; i++) {
+		const ReferenceImage *ref = manifest->images[i];
+		if (refstore_parse_digest(ref->digest, digest, &len))
+			continue;
+
+		refstore_image_t *image = refstore_image_get(store, digest, len);
+		if (!image->name || ref->version > image->version) {
+			mem_free0(image->name);
+			image->name = mem_strdup(ref->name);
+			image->version = ref->version;
+		}
+	}
+
+	// revocations are sticky, no other manifest can approve the digest again
+	for (size_t i = 0; i < manifest->n_revoked_digests; i++) {
+		if (refstore_parse_digest(manifest->revoked_digests[i], digest, &len))
+			continue;
+		refstore_image_get(store, digest, len)->revoked = true;
+	}
+
+	for (size_t i = 0; i < manifest->n_min_versions; i++) {
+		refstore_name_t *entry = refstore_name_get(store, manifest->min_versions[i]->name);
+		entry->min_version =
+			MAX(entry->min_version, manifest->min_versions[i]->min_version);
+	}
+
+	INFO("Loaded reference manifest %s version %" PRIu64 " (%zu images, %zu revoked)",
+	     manifest->name, manifest->version, manifest->n_images, manifest->n_revoked_digests);
+}
+
+static ReferenceManifest *
+refstore_manifest_read_new(const char *file, const char *signer_cert)
+{
+	ReferenceManifest *manifest = NULL;
+	char *sig_file = mem_printf("%s%s", file, REFSTORE_SIG_SUFFIX);
+	uint8_t *buf = NULL, *sig = NULL;
+
+	off_t len = file_size(file);
+	off_t sig_len = file_size(sig_file);
+	if (len <= 0 || len > REFSTORE_MANIFEST_MAX_SIZE || sig_len <= 0 ||
+	    sig_len > REFSTORE_MANIFEST_MAX_SIZE) {
+		WARN("Skipping reference manifest %s: missing or invalid manifest or signature",
+		     file);
+		goto out;
+	}
+
+	buf = mem_alloc(len);
+	sig = mem_alloc(sig_len);
+	if (file_read(file, (char *)buf, len) != len ||
+	    file_read(sig_file, (char *)sig, sig_len) != sig_len) {
+		WARN("Skipping reference manifest %s: failed to read manifest or signature", file);
+		goto out;
+	}
+
+	if (ssl_verify_signature_from_buf((uint8_t *)signer_cert, strlen(signer_cert), sig, sig_len,
+					  buf, len, "SHA256")) {
+		ERROR("Skipping reference manifest %s: signature verification failed", file);
+		goto out;
+	}
+
+	manifest = (ReferenceManifest *)protobuf_message_new_from_buf(
+		buf, len, &reference_manifest__descriptor);
+	if (!manifest)
+		WARN("Skipping reference manifest %s: failed to parse manifest", file);
+out:
+	mem_free0(buf);
+	mem_free0(sig);
+	mem_free0(sig_file);
+	return manifest;
+}
+
+struct refstore_load_data {
+	const char *signer_cert;
+	list_t *manifests;
+};
+
+static int
+refstore_load_manifest_cb(const char *path, const char *file, void *data)
+{
+	struct refstore_load_data *load = data;
+	size_t len = strlen(file), suffix_len = strlen(REFSTORE_MANIFEST_SUFFIX);
+
+	if (len <= suffix_len || strcmp(file + len - suffix_len, REFSTORE_MANIFEST_SUFFIX))
+		return 0;
+
+	char *manifest_file = mem_printf("%s/%s", path, file);
+	ReferenceManifest *manifest = refstore_manifest_read_new(manifest_file, load->signer_cert);
+	mem_free0(manifest_file);
+
+	if (manifest)
+		load->manifests = list_append(load->manifests, manifest);
+	return 0;
+}
+
+static bool
+refstore_manifest_is_superseded(const ReferenceManifest *manifest, list_t *manifests)
+{
+	for (list_t *l = manifests; l; l = l->next) {
+		const ReferenceManifest *other = l->data;
+		if (other != manifest && !strcmp(other->name, manifest->name) &&
+		    other->version > manifest->version)
+			return true;
+	}
+	return false;
+}
+
+refstore_t *
+refstore_new_from_dir(const char *dir, const char *signer_cert)
+{
+	ASSERT(dir);
+	ASSERT(signer_cert);
+
+	struct refstore_load_data load = { .signer_cert = signer_cert, .manifests = NULL };
+	if (dir_foreach(dir, &refstore_load_manifest_cb, &load) < 0) {
+		ERROR("Failed to read reference manifests from %s", dir);
+		return NULL;
+	}
+
+	refstore_t *store = mem_new0(refstore_t, 1);
+	store->images_size = REFSTORE_TABLE_SIZE_MIN;
+	store->images = mem_new0(refstore_image_t, store->images_size);
+	store->names_size = REFSTORE_TABLE_SIZE_MIN;
+	store->names = mem_new0(refstore_name_t, store->names_size);
+
+	for (list_t *l = load.manifests; l; l = l->next) {
+		ReferenceManifest *manifest = l->data;
+		if (refstore_manifest_is_superseded(manifest, load.manifests))
+			INFO("Skipping superseded reference manifest %s version %" PRIu64,
+			     manifest->name, manifest->version);
+		else
+			refstore_add_manifest(store, manifest);
+	}
+
+	for (list_t *l = load.manifests; l; l = l->next)
+		protobuf_free_message((ProtobufCMessage *)l->data);
+	list_delete(load.manifests);
+
+	INFO("Reference store contains %zu digests and %zu minimum versions", store->n_images,
+	     store->n_names);
+	return store;
+}
+
+void
+refstore_free(refstore_t *store)
+{
+	IF_NULL_RETURN(store);
+
+	for (size_t i = 0; i < store->images_size; i++)
+		mem_free0(store->images[i].name);
+	for (size_t i = 0; i < store->names_size; i++)
+		mem_free0(store->names[i].name);
+	mem_free0(store->images);
+	mem_free0(store->names);
+	mem_free0(store);
+}
+
+refstore_result_t
+refstore_check(const refstore_t *store, const uint8_t *digest, size_t digest_len, const char **name)
+{
+	ASSERT(store);
+	ASSERT(digest);
+
+	if (digest_len == 0 || digest_len > REFSTORE_DIGEST_MAX)
+		return REFSTORE_UNKNOWN;
+
+	const refstore_image_t *image =
+		refstore_image_slot(store->images, store->images_size, digest, digest_len);
+	if (!image->digest_len)
+		return REFSTORE_UNKNOWN;
+
+	if (name)
+		*name = image->name;
+
+	if (image->revoked)
+		return REFSTORE_REVOKED;
+	if (!image->name)
+		return REFSTORE_UNKNOWN;
+
+	const refstore_name_t *entry =
+		refstore_name_slot(store->names, store->names_size, image->name);
+	if (entry->name && image->version < entry->min_version)
+		return REFSTORE_OUTDATED;
+
+	return REFSTORE_ALLOWED;
+}
+
+const char *
+refstore_result_to_string(refstore_result_t result)
+{
+	switch (result) {
+	case REFSTORE_ALLOWED:
+		return "allowed";
+	case REFSTORE_UNKNOWN:
+		return "unknown";
+	case REFSTORE_REVOKED:
+		return "revoked";
+	case REFSTORE_OUTDATED:
+		return "outdated";
+	}
+	return "invalid";
+}
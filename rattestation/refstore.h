@@ -0,0 +1,69 @@
+/*
+ * This file is part of GyroidOS
+ * Copyright(c) 2026 Fraunhofer AISEC
+ * Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 (GPL 2), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GPL 2 license for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ * Contact Information:
+ * Fraunhofer AISEC <gyroidos@aisec.fraunhofer.de>
+ */
+
+/*
+ * Store of the reference measurements of approved container images.
+ *
+ * The store is loaded from signed reference manifests and indexes the images by
+ * their digest and name, so that each measured image is checked in constant time
+ * against the approved versions and revocations of all manifests.
+ */
+
+#ifndef REFSTORE_H_
+#define REFSTORE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum refstore_result {
+	REFSTORE_ALLOWED = 0,
+	REFSTORE_UNKNOWN,  // the image is not approved by any manifest
+	REFSTORE_REVOKED,  // the image digest was revoked
+	REFSTORE_OUTDATED, // the version of the image is below the minimum version for its name
+} refstore_result_t;
+
+typedef struct refstore refstore_t;
+
+/*
+ * Loads all manifests '<name>.manifest' in dir whose signature in
+ * '<name>.manifest.sig' is valid for signer_cert (PEM). Manifests with an
+ * invalid signature are skipped. Returns NULL on error.
+ */
+refstore_t *
+refstore_new_from_dir(const char *dir, const char *signer_cert);
+
+void
+refstore_free(refstore_t *store);
+
+/*
+ * Checks the digest of a measured image. If name is not NULL, it is set to
+ * the name of the image, if the digest is known.
+ */
+refstore_result_t
+refstore_check(const refstore_t *store, const uint8_t *digest, size_t digest_len,
+	       const char **name);
+
+const char *
+refstore_result_to_string(refstore_result_t result);
+
+#endif /* REFSTORE_H_ */
@@ -43,6 +43,8 @@ LOCAL_SRC_FILES := \
 	common/protobuf.c \
 	common/reboot.c \
 	common/ssl_util.c \
+	common/workpool.c \
+	common/logstore.c \
 	scd.proto \
 	device.proto \
 	control.c \
@@ -42,6 +42,7 @@
 #include "common/file.h"
 #include "common/protobuf.h"
 #include "common/ssl_util.h"
+#include "common/workpool.h"
 
 #include <unistd.h>
 
@@ -50,14 +51,36 @@
 // maximum no. of connections waiting to be accepted on the listening socket
 #define SCD_CONTROL_SOCK_LISTEN_BACKLOG 8
 #define KEY_LENGTH_BYTES 64
+// upper bound for the number of crypto workers, independent of the number of cpus
+#define SCD_CONTROL_MAX_WORKERS 8
 
 //#undef LOGF_LOG_MIN_PRIO
 //#define LOGF_LOG_MIN_PRIO LOGF_PRIO_TRACE
 
 struct scd_control {
-	int sock; // listen socket fd
+	int sock;	  // listen socket fd
+	workpool_t *pool; // workers for crypto requests
 };
 
+/*
+ * A client connection. Its requests are handled strictly in the order they
+ * were received: while a crypto job of the connection is executed by the pool,
+ * all later requests of the connection wait in pending.
+ */
+typedef struct scd_control_conn {
+	scd_control_t *control;
+	int fd;
+	int peer;	 // key of the connection's jobs in the pool, the pid of the peer
+	list_t *pending; // received DaemonToToken messages which are not handled yet
+	bool busy;	 // a crypto job of this connection is queued or running
+	bool closed;	 // the connection is closed, free as soon as not busy
+} scd_control_conn_t;
+
+typedef struct scd_control_job {
+	DaemonToToken *msg;
+	scd_control_conn_t *conn;
+} scd_control_job_t;
+
 UNUSED static list_t *control_list = NULL;
 
 /* keep in sync with offered algorithms by protobuf */
@@ -464,13 +487,8 @@ scd_control_handle_message(const DaemonToToken *msg, int fd)
 		}
 		protobuf_send_message(fd, (ProtobufCMessage *)&out);
 	} break;
-	/*
-	 * This case handles hashing request as part of
-	 * TSF.CML.SecureCompartmentInit and TSF.CML.Updates
-	 * and wraps the corresponding OpenSSL calls.
-	 */
-	case DAEMON_TO_TOKEN__CODE__CRYPTO_HASH_FILE: {
-		TRACE("SCD: Handle messsage CRYPTO_HASH_FILE");
+	case DAEMON_TO_TOKEN__CODE__CRYPTO_HASH_BUF: {
+		TRACE("SCD: Handle messsage CRYPTO_HASH_BUF");
 		unsigned int hash_len;
 		const char *hash_algo;
 		unsigned char *hash = NULL;
@@ -480,8 +498,9 @@ scd_control_handle_message(const DaemonToToken *msg, int fd)
 		hash_algo = switch_proto_hash_algo(msg->hash_algo);
 
 		if (hash_algo) {
-			if ((hash = ssl_hash_file(msg->hash_file, &hash_len, hash_algo)) == NULL) {
-				ERROR("Hashing file failed");
+			if ((hash = ssl_hash_buf(msg->hash_buf.data, msg->hash_buf.len, &hash_len,
+						 hash_algo)) == NULL) {
+				ERROR("Hashing buffer failed");
 			} else {
 				out.has_hash_value = true;
 				out.hash_value.len = hash_len;
@@ -494,20 +513,102 @@ scd_control_handle_message(const DaemonToToken *msg, int fd)
 		if (hash)
 			mem_free0(hash);
 	} break;
-	case DAEMON_TO_TOKEN__CODE__CRYPTO_HASH_BUF: {
-		TRACE("SCD: Handle messsage CRYPTO_HASH_BUF");
+	default:
+		WARN("DaemonToToken command %d unknown or not implemented yet", msg->code);
+		TokenToDaemon out = TOKEN_TO_DAEMON__INIT;
+		out.code = TOKEN_TO_DAEMON__CODE__CMD_UNKNOWN;
+		protobuf_send_message(fd, (ProtobufCMessage *)&out);
+		break;
+	}
+}
+
+/*
+ * Hashes the file of a CRYPTO_HASH_FILE request with all requested hash_algos
+ * in a single pass and returns the packed response.
+ */
+static uint8_t *
+scd_control_handle_hash_file_multi(const DaemonToToken *msg, size_t *result_len)
+{
+	uint8_t *result = NULL;
+	TokenToDaemon out = TOKEN_TO_DAEMON__INIT;
+	out.code = TOKEN_TO_DAEMON__CODE__CRYPTO_HASH_ERROR;
+
+	size_t n = msg->n_hash_algos;
+	const char **hash_algos = mem_new0(const char *, n);
+	unsigned char **hashes = mem_new0(unsigned char *, n);
+	unsigned int *hash_lens = mem_new0(unsigned int, n);
+	ProtobufCBinaryData *hash_values = mem_new0(ProtobufCBinaryData, n);
+
+	bool algos_valid = true;
+	for (size_t i = 0; i < n; ++i) {
+		if ((hash_algos[i] = switch_proto_hash_algo(msg->hash_algos[i])) == NULL)
+			algos_valid = false;
+	}
+
+	if (algos_valid &&
+	    ssl_hash_file_multi(msg->hash_file, hash_algos, n, hashes, hash_lens) == 0) {
+		for (size_t i = 0; i < n; ++i) {
+			hash_values[i].data = hashes[i];
+			hash_values[i].len = hash_lens[i];
+		}
+		out.n_hash_values = n;
+		out.hash_values = hash_values;
+		out.code = TOKEN_TO_DAEMON__CODE__CRYPTO_HASH_OK;
+	} else {
+		ERROR("Hashing file failed");
+	}
+
+	*result_len = protobuf_pack_message_new((ProtobufCMessage *)&out, &result);
+
+	for (size_t i = 0; i < n; ++i) {
+		if (hashes[i])
+			mem_free0(hashes[i]);
+	}
+	mem_free0(hash_algos);
+	mem_free0(hashes);
+	mem_free0(hash_lens);
+	mem_free0(hash_values);
+	return result;
+}
+
+/*
+ * Executes crypto requests which may take long, e.g., hashing or verifying
+ * large files, in a worker process of the pool (see scd_control_is_crypto_job()).
+ * The packed response is sent to the client by scd_control_crypto_job_done_cb().
+ */
+static uint8_t *
+scd_control_crypto_job_exec(void *data, size_t *result_len)
+{
+	scd_control_job_t *job = data;
+	ASSERT(job);
+
+	const DaemonToToken *msg = job->msg;
+	uint8_t *result = NULL;
+
+	switch (msg->code) {
+	/*
+	 * This case handles hashing request as part of
+	 * TSF.CML.SecureCompartmentInit and TSF.CML.Updates
+	 * and wraps the corresponding OpenSSL calls.
+	 */
+	case DAEMON_TO_TOKEN__CODE__CRYPTO_HASH_FILE: {
+		TRACE("SCD: Handle messsage CRYPTO_HASH_FILE");
 		unsigned int hash_len;
 		const char *hash_algo;
 		unsigned char *hash = NULL;
 		TokenToDaemon out = TOKEN_TO_DAEMON__INIT;
 		out.code = TOKEN_TO_DAEMON__CODE__CRYPTO_HASH_ERROR;
 
+		if (msg->n_hash_algos > 0) {
+			result = scd_control_handle_hash_file_multi(msg, result_len);
+			break;
+		}
+
 		hash_algo = switch_proto_hash_algo(msg->hash_algo);
 
 		if (hash_algo) {
-			if ((hash = ssl_hash_buf(msg->hash_buf.data, msg->hash_buf.len, &hash_len,
-						 hash_algo)) == NULL) {
-				ERROR("Hashing buffer failed");
+			if ((hash = ssl_hash_file(msg->hash_file, &hash_len, hash_algo)) == NULL) {
+				ERROR("Hashing file failed");
 			} else {
 				out.has_hash_value = true;
 				out.hash_value.len = hash_len;
@@ -516,7 +617,7 @@ scd_control_handle_message(const DaemonToToken *msg, int fd)
 			}
 		}
 
-		protobuf_send_message(fd, (ProtobufCMessage *)&out);
+		*result_len = protobuf_pack_message_new((ProtobufCMessage *)&out, &result);
 		if (hash)
 			mem_free0(hash);
 	} break;
@@ -542,7 +643,7 @@ scd_control_handle_message(const DaemonToToken *msg, int fd)
 							  switch_proto_hash_algo(msg->hash_algo));
 		}
 
-		protobuf_send_message(fd, (ProtobufCMessage *)&out);
+		*result_len = protobuf_pack_message_new((ProtobufCMessage *)&out, &result);
 		if (tmp_data_file) {
 			unlink(tmp_data_file);
 			mem_free0(tmp_data_file);
@@ -569,15 +670,99 @@ scd_control_handle_message(const DaemonToToken *msg, int fd)
 		out.code = scd_control_handle_verify(msg->verify_data_file, msg->verify_sig_file,
 						     msg->verify_cert_file, ignore_time,
 						     switch_proto_hash_algo(msg->hash_algo));
-		protobuf_send_message(fd, (ProtobufCMessage *)&out);
+		*result_len = protobuf_pack_message_new((ProtobufCMessage *)&out, &result);
 	} break;
 	default:
-		WARN("DaemonToToken command %d unknown or not implemented yet", msg->code);
-		TokenToDaemon out = TOKEN_TO_DAEMON__INIT;
-		out.code = TOKEN_TO_DAEMON__CODE__CMD_UNKNOWN;
-		protobuf_send_message(fd, (ProtobufCMessage *)&out);
+		ERROR("DaemonToToken command %d is not a crypto job", msg->code);
 		break;
 	}
+
+	return result;
+}
+
+static void
+scd_control_conn_free(scd_control_conn_t *conn)
+{
+	for (list_t *l = conn->pending; l; l = l->next)
+		protobuf_free_message((ProtobufCMessage *)l->data);
+	list_delete(conn->pending);
+	mem_free0(conn);
+}
+
+static void
+scd_control_conn_process(scd_control_conn_t *conn);
+
+static void
+scd_control_crypto_job_done_cb(const uint8_t *result, size_t result_len, bool canceled, void *data)
+{
+	scd_control_job_t *job = data;
+	ASSERT(job);
+	scd_control_conn_t *conn = job->conn;
+
+	// the result is dropped if the connection of the client is already closed
+	if (!canceled && !conn->closed) {
+		if (result) {
+			if (protobuf_send_message_packed(conn->fd, result, result_len) < 0)
+				WARN("Could not send crypto response to fd %d", conn->fd);
+		} else {
+			TokenToDaemon out = TOKEN_TO_DAEMON__INIT;
+			out.code = (job->msg->code == DAEMON_TO_TOKEN__CODE__CRYPTO_HASH_FILE) ?
+					   TOKEN_TO_DAEMON__CODE__CRYPTO_HASH_ERROR :
+					   TOKEN_TO_DAEMON__CODE__CRYPTO_VERIFY_ERROR;
+			protobuf_send_message(conn->fd, (ProtobufCMessage *)&out);
+		}
+	}
+
+	protobuf_free_message((ProtobufCMessage *)job->msg);
+	mem_free0(job);
+
+	conn->busy = false;
+	if (conn->closed)
+		scd_control_conn_free(conn);
+	else
+		scd_control_conn_process(conn);
+}
+
+static bool
+scd_control_is_crypto_job(const DaemonToToken *msg)
+{
+	switch (msg->code) {
+	case DAEMON_TO_TOKEN__CODE__CRYPTO_HASH_FILE:
+	case DAEMON_TO_TOKEN__CODE__CRYPTO_VERIFY_FILE:
+	case DAEMON_TO_TOKEN__CODE__CRYPTO_VERIFY_BUF:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Handles the pending requests of a connection in order, until a crypto
+ * job has to wait for its worker.
+ */
+static void
+scd_control_conn_process(scd_control_conn_t *conn)
+{
+	while (!conn->busy && conn->pending) {
+		DaemonToToken *msg = conn->pending->data;
+		conn->pending = list_unlink(conn->pending, conn->pending);
+
+		if (scd_control_is_crypto_job(msg)) {
+			// token operations are still handled (serialized) in the event loop
+			scd_control_job_t *job = mem_new0(scd_control_job_t, 1);
+			job->msg = msg;
+			job->conn = conn;
+			conn->busy = true;
+			workpool_submit(conn->control->pool, conn->peer,
+					scd_control_crypto_job_exec, scd_control_crypto_job_done_cb,
+					job);
+			DEBUG("Queued crypto job for control connection %d", conn->fd);
+		} else {
+			scd_control_handle_message(msg, conn->fd);
+			protobuf_free_message((ProtobufCMessage *)msg);
+			DEBUG("Handled control connection %d", conn->fd);
+		}
+	}
 }
 
 /**
@@ -589,20 +774,22 @@ scd_control_handle_message(const DaemonToToken *msg, int fd)
  *		    from which the incoming message is read
  * @param events    event flags
  * @param io	    pointer to associated event_io_t struct
- * @param data	    pointer to this scd_control_t struct
+ * @param data	    pointer to the scd_control_conn_t struct of the connection
  */
 static void
-scd_control_cb_recv_message(int fd, unsigned events, event_io_t *io, UNUSED void *data)
+scd_control_cb_recv_message(int fd, unsigned events, event_io_t *io, void *data)
 {
+	scd_control_conn_t *conn = data;
+	ASSERT(conn);
+
 	if (events & EVENT_IO_READ) {
 		DaemonToToken *msg =
 			(DaemonToToken *)protobuf_recv_message(fd, &daemon_to_token__descriptor);
 		// close connection if client EOF, or protocol parse error
 		IF_NULL_GOTO_TRACE(msg, connection_err);
 
-		scd_control_handle_message(msg, fd);
-		protobuf_free_message((ProtobufCMessage *)msg);
-		DEBUG("Handled control connection %d", fd);
+		conn->pending = list_append(conn->pending, msg);
+		scd_control_conn_process(conn);
 	}
 	if (events & EVENT_IO_EXCEPT) {
 		INFO("Control client closed connection; disconnecting control socket.");
@@ -615,6 +802,13 @@ connection_err:
 	event_io_free(io);
 	if (close(fd) < 0)
 		WARN_ERRNO("Failed to close connected control socket");
+	/*
+	 * Other connections of the same peer share its key in the pool, thus
+	 * a job of this connection is not canceled but its result is dropped.
+	 */
+	conn->closed = true;
+	if (!conn->busy)
+		scd_control_conn_free(conn);
 	return;
 }
 /**
@@ -651,7 +845,23 @@ scd_control_cb_accept(int fd, unsigned events, event_io_t *io, void *data)
 
 	fd_make_non_blocking(cfd);
 
-	event_io_t *event = event_io_new(cfd, EVENT_IO_READ, scd_control_cb_recv_message, control);
+	scd_control_conn_t *conn = mem_new0(scd_control_conn_t, 1);
+	conn->control = control;
+	conn->fd = cfd;
+
+	/*
+	 * Clients like cmld open a new connection per request, thus jobs are
+	 * scheduled fairly per peer process instead of per connection.
+	 */
+	uint32_t peer_pid;
+	if (sock_unix_get_peer_pid(cfd, &peer_pid) < 0) {
+		WARN_ERRNO("Could not get peer of control connection %d", cfd);
+		conn->peer = -cfd;
+	} else {
+		conn->peer = peer_pid;
+	}
+
+	event_io_t *event = event_io_new(cfd, EVENT_IO_READ, scd_control_cb_recv_message, conn);
 	event_add_io(event);
 }
 
@@ -669,8 +879,14 @@ scd_control_new(const char *path)
 		return NULL;
 	}
 
+	// at least two workers, so that a long running job does not block all others
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int workers = MIN(MAX(cpus, 2), SCD_CONTROL_MAX_WORKERS);
+
 	scd_control_t *scd_control = mem_new0(scd_control_t, 1);
 	scd_control->sock = sock;
+	// a single peer, e.g. cmld, may occupy all but one worker, which is left for other peers
+	scd_control->pool = workpool_new(workers, workers - 1);
 
 	event_io_t *event = event_io_new(sock, EVENT_IO_READ, scd_control_cb_accept, scd_control);
 	event_add_io(event);
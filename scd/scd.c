@@ -36,6 +36,7 @@
 #include "common/mem.h"
 #include "common/event.h"
 #include "common/logf.h"
+#include "common/logstore.h"
 #include "common/sock.h"
 #include "common/dir.h"
 #include "common/file.h"
@@ -74,7 +75,8 @@ static list_t *scd_token_list = NULL;
 
 static scd_control_t *scd_control_cmld = NULL;
 static logf_handler_t *scd_logfile_handler = NULL;
-static void *scd_logfile_p = NULL;
+static logstore_t *scd_logstore = NULL;
+static ssl_key_type_t scd_key_type = RSA_SSA_PADDING;
 
 static void
 scd_sigterm_cb(UNUSED int signum, UNUSED event_signal_t *sig, UNUSED void *data)
@@ -130,6 +132,38 @@ scd_in_provisioning_mode(void)
 	return file_is_regular(PROVISIONING_MODE_FILE);
 }
 
+/*
+ * Reads the type of key pairs to be created from the device config.
+ * RSA keys are kept if the device config is not available yet.
+ */
+static void
+scd_load_key_type(void)
+{
+	DeviceConfig *dev_cfg = (DeviceConfig *)protobuf_message_new_from_textfile(
+		DEVICE_CONF, &device_config__descriptor);
+	if (!dev_cfg) {
+		WARN("Failed to load device config from file \"%s\", using %s keys", DEVICE_CONF,
+		     ssl_key_type_to_string(scd_key_type));
+		return;
+	}
+
+	if (ssl_key_type_from_string(dev_cfg->key_type, &scd_key_type) < 0)
+		WARN("Unknown key type '%s' in device config, using %s keys", dev_cfg->key_type,
+		     ssl_key_type_to_string(scd_key_type));
+	else
+		INFO("Using %s keys for device CSR and %s keys for softtokens",
+		     ssl_key_type_to_string(scd_key_type),
+		     ssl_key_type_to_string(scd_get_softtoken_key_type()));
+
+	protobuf_free_message((ProtobufCMessage *)dev_cfg);
+}
+
+ssl_key_type_t
+scd_get_softtoken_key_type(void)
+{
+	return scd_key_type == ED25519_KEY ? ECDSA_P256_KEY : scd_key_type;
+}
+
 static void
 provisioning_mode()
 {
@@ -224,8 +258,9 @@ provisioning_mode()
 				FATAL("Could not write device config to \"%s\"!", DEVICE_CONF);
 			}
 
+			// the key type is not applicable to a key created in the TPM
 			if (ssl_create_csr(DEVICE_CSR_FILE, dev_key_file, NULL, common_name, uid,
-					   use_tpm, RSA_SSA_PADDING) != 0) {
+					   use_tpm, scd_key_type) != 0) {
 				FATAL("Unable to create CSR");
 			}
 
@@ -271,7 +306,8 @@ provisioning_mode()
 		char *token_file =
 			mem_printf("%s/%s%s", SCD_TOKEN_DIR, TOKEN_DEFAULT_NAME, TOKEN_DEFAULT_EXT);
 		if (ssl_create_pkcs12_token(token_file, NULL, TOKEN_DEFAULT_PASS,
-					    TOKEN_DEFAULT_NAME, RSA_SSA_PADDING) != 0) {
+					    TOKEN_DEFAULT_NAME,
+					    scd_get_softtoken_key_type()) != 0) {
 			FATAL("Unable to create initial user token");
 		}
 		mem_free0(token_file);
@@ -290,18 +326,6 @@ provisioning_mode()
 	}
 }
 
-static void
-scd_logfile_rename_cb(UNUSED event_timer_t *timer, UNUSED void *data)
-{
-	INFO("Logfile must be closed and a new file opened");
-	logf_unregister(scd_logfile_handler);
-	logf_file_close(scd_logfile_p);
-
-	scd_logfile_p = logf_file_new(LOGFILE_DIR "/cml-scd");
-	scd_logfile_handler = logf_register(&logf_file_write, scd_logfile_p);
-	logf_handler_set_prio(scd_logfile_handler, LOGF_PRIO_TRACE);
-}
-
 int
 main(int argc, char **argv)
 {
@@ -313,14 +337,11 @@ main(int argc, char **argv)
 		logf_register(&logf_klog_write, logf_klog_new(argv[0]));
 	logf_register(&logf_file_write, stdout);
 
-	scd_logfile_p = logf_file_new(LOGFILE_DIR "/cml-scd");
-	scd_logfile_handler = logf_register(&logf_file_write, scd_logfile_p);
+	scd_logstore = logstore_new(LOGFILE_DIR, "cml-scd", LOGSTORE_SEGMENT_SIZE_DEFAULT,
+				    LOGSTORE_SEGMENT_AGE_DEFAULT, LOGSTORE_BUDGET_DEFAULT);
+	scd_logfile_handler = logf_register(&logstore_write, scd_logstore);
 	logf_handler_set_prio(scd_logfile_handler, LOGF_PRIO_TRACE);
 
-	event_timer_t *logfile_timer = event_timer_new(
-		HOURS_TO_MILLISECONDS(24), EVENT_TIMER_REPEAT_FOREVER, scd_logfile_rename_cb, NULL);
-	event_add_timer(logfile_timer);
-
 	event_signal_t *sig_term = event_signal_new(SIGTERM, &scd_sigterm_cb, NULL);
 	event_add_signal(sig_term);
 
@@ -329,6 +350,7 @@ main(int argc, char **argv)
 	dir_mkdir_p("/var/tmp/sc-hsm-embedded", 0755);
 #endif
 
+	scd_load_key_type();
 	provisioning_mode();
 
 	INFO("Starting scd ...");
@@ -33,6 +33,8 @@
 
 #include "scd_shared.h"
 
+#include "common/ssl_util.h"
+
 /**
  * Returns the type of the token
  */
@@ -70,4 +72,11 @@ scd_token_free(scd_token_t *token);
 bool
 scd_in_provisioning_mode(void);
 
+/**
+ * Returns the type of key pairs created for softtokens, as configured in the
+ * device config. As softtokens wrap keys, Ed25519 is replaced by ECDSA P-256.
+ */
+ssl_key_type_t
+scd_get_softtoken_key_type(void);
+
 #endif // SCD_H
@@ -45,7 +45,8 @@ struct softtoken {
  * creates a new pkcs12 softtoken.
  */
 int
-softtoken_create_p12(const char *filename, const char *passwd, const char *name)
+softtoken_create_p12(const char *filename, const char *passwd, const char *name,
+		     ssl_key_type_t key_type)
 {
 	ASSERT(filename);
 	ASSERT(passwd);
@@ -57,7 +58,7 @@ softtoken_create_p12(const char *filename, const char *passwd, const char *name)
 		return -1;
 	}
 
-	if (ssl_create_pkcs12_token(filename, NULL, passwd, name, RSA_SSA_PADDING) != 0) {
+	if (ssl_create_pkcs12_token(filename, NULL, passwd, name, key_type) != 0) {
 		ERROR("Unable to create pkcs12 token");
 		return -1;
 	}
@@ -27,6 +27,8 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include "common/ssl_util.h"
+
 #include <openssl/pem.h>
 #include <openssl/x509v3.h>
 
@@ -35,10 +37,11 @@
 typedef struct softtoken softtoken_t;
 
 /**
- * creates new p12 token file.
+ * creates new p12 token file with a key pair of type key_type.
  */
 int
-softtoken_create_p12(const char *filename, const char *passwd, const char *name);
+softtoken_create_p12(const char *filename, const char *passwd, const char *name,
+		     ssl_key_type_t key_type);
 
 /**
  * removes a pkcs12 token file.
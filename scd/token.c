@@ -22,6 +22,7 @@
  */
 
 #include "token.h"
+#include "scd.h"
 
 #include "tokencontrol.pb-c.h"
 
@@ -524,8 +525,8 @@ token_new(const token_constr_data_t *constr_data)
 		token_file = mem_printf("%s/%s%s", constr_data->init_str.softtoken_dir,
 					constr_data->uuid, STOKEN_DEFAULT_EXT);
 		if (!file_exists(token_file)) {
-			if (softtoken_create_p12(token_file, STOKEN_DEFAULT_PASS,
-						 constr_data->uuid) != 0) {
+			if (softtoken_create_p12(token_file, STOKEN_DEFAULT_PASS, constr_data->uuid,
+						 scd_get_softtoken_key_type()) != 0) {
 				ERROR("Could not create new softtoken file");
 				mem_free0(token_file);
 				goto err;
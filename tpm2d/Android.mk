@@ -44,6 +44,7 @@ LOCAL_SRC_FILES := \
 	common/fd.c \
 	common/protobuf.c \
 	common/cryptfs.c \
+	common/logstore.c \
 	attestation.proto \
 	tpm2d.proto \
 	control.c \
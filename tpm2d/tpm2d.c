@@ -32,6 +32,7 @@
 #include "common/mem.h"
 #include "common/event.h"
 #include "common/logf.h"
+#include "common/logstore.h"
 #include "common/file.h"
 #include "common/dir.h"
 #include "common/sock.h"
@@ -51,7 +52,7 @@ static bool no_setup_keys = false;
 static tpm2d_control_t *tpm2d_control_cmld = NULL;
 static tpm2d_rcontrol_t *tpm2d_rcontrol_attest = NULL;
 static logf_handler_t *tpm2d_logfile_handler = NULL;
-static void *tpm2d_logfile_p = NULL;
+static logstore_t *tpm2d_logstore = NULL;
 
 static uint32_t tpm2d_salt_key_handle = TPM_RH_NULL;
 
@@ -66,18 +67,6 @@ static uint32_t tpm2d_as_key_handle_pt_ps = TPM2D_STORAGE_KEY_PERSIST_HANDLE;
 static char *tpm2d_as_key_pwd_pt = TPM2D_PRIMARY_STORAGE_KEY_PW;
 #endif
 
-static void
-tpm2d_logfile_rename_cb(UNUSED event_timer_t *timer, UNUSED void *data)
-{
-	INFO("Logfile must be closed and a new file opened");
-	logf_unregister(tpm2d_logfile_handler);
-	logf_file_close(tpm2d_logfile_p);
-
-	tpm2d_logfile_p = logf_file_new(LOGFILE_DIR "/cml-tpm2d");
-	tpm2d_logfile_handler = logf_register(&logf_file_write, tpm2d_logfile_p);
-	logf_handler_set_prio(tpm2d_logfile_handler, LOGF_PRIO_TRACE);
-}
-
 static void
 tpm2d_setup_salt_key(void)
 {
@@ -316,8 +305,9 @@ main(UNUSED int argc, char **argv)
 		}
 	}
 
-	tpm2d_logfile_p = logf_file_new(LOGFILE_DIR "/cml-tpm2d");
-	tpm2d_logfile_handler = logf_register(&logf_file_write, tpm2d_logfile_p);
+	tpm2d_logstore = logstore_new(LOGFILE_DIR, "cml-tpm2d", LOGSTORE_SEGMENT_SIZE_DEFAULT,
+				      LOGSTORE_SEGMENT_AGE_DEFAULT, LOGSTORE_BUDGET_DEFAULT);
+	tpm2d_logfile_handler = logf_register(&logstore_write, tpm2d_logstore);
 	logf_handler_set_prio(tpm2d_logfile_handler, LOGF_PRIO_TRACE);
 
 	INFO("Starting tpm2d ...");
@@ -329,11 +319,6 @@ main(UNUSED int argc, char **argv)
 	event_signal_t *sig_term = event_signal_new(SIGTERM, &main_sigterm_cb, NULL);
 	event_add_signal(sig_term);
 
-	event_timer_t *logfile_timer =
-		event_timer_new(HOURS_TO_MILLISECONDS(24), EVENT_TIMER_REPEAT_FOREVER,
-				tpm2d_logfile_rename_cb, NULL);
-	event_add_timer(logfile_timer);
-
 	tpm2d_init();
 
 	TRACE("Try to create directory for socket if not existing");